@@ -22,6 +22,7 @@ AI::AI(void)
 	world = NULL;
 
 	dynManager = NULL;
+	frameArena = NULL;
 }
 
 
@@ -79,6 +80,14 @@ void AI::shutdown()
 		ai7 = NULL;
 	}
 	
+	// Rockets and landmines still out take their bodies out of the world
+	if (dynManager)
+	{
+		delete dynManager;
+		dynManager = NULL;
+	}
+	Explosion::shutdown();
+
 	if (world)
 	{
 		delete world;
@@ -105,14 +114,14 @@ void AI::shutdown()
 		wpEditor = NULL;
 	}
 
-	if (dynManager)
+	if (frameArena)
 	{
-		delete dynManager;
-		dynManager = NULL;
+		delete frameArena;
+		frameArena = NULL;
 	}
 }
 
-void AI::initialize(Renderer* r, Input* i, Sound* s)
+bool AI::initialize(Renderer* r, Input* i, Sound* s)
 {
 	raceStartTimer = 4.0f;
 	raceStarted = false;
@@ -127,10 +136,12 @@ void AI::initialize(Renderer* r, Input* i, Sound* s)
 	sound = s;
 	count = 25;
 	fps = 0;
+	lastFrameCount = 0;
 	racerIndex = 0;
 	numberOfWaypoints = 0;
 
 	dynManager = new DynamicObjManager();
+	frameArena = new FrameArena(FRAME_ARENA_SIZE);
 
 	wpEditor = new WaypointEditor(renderer);
 	//wpEditor->openFile();
@@ -156,6 +167,10 @@ void AI::initialize(Renderer* r, Input* i, Sound* s)
 
 	//Initialize world
 	world = new World(r->getDevice(), renderer, physics);
+	if (!world->initialized)
+	{
+		return false;
+	}
 	world->setPosAndRot(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 
 	//Initialize AI-Racers
@@ -191,6 +206,8 @@ void AI::initialize(Renderer* r, Input* i, Sound* s)
 
 	// This is how you set an object for the camera to focus on!
 	renderer->setFocus(racers[racerIndex]->getIndex());
+
+	return true;
 }
 
 void AI::initializeAIRacers()
@@ -273,18 +290,36 @@ void AI::initializeCheckpoints()
 }
 
 void AI::simulate(float seconds)
+{
+	simulateTick(seconds);
+
+	// The end of the tick, however simulateTick got there (the countdown
+	// returns early). Whatever was destroyed is released and taken out of what
+	// the renderer publishes for the tick, and nothing in the arena is needed past here.
+	DynamicObjManager::manager->endFrame();
+	frameArena->reset();
+}
+
+void AI::simulateTick(float seconds)
 {
 	_ASSERT(seconds > 0.0f);
 
 	Intention intention = input->getIntention();
 
+	ContactCache::endFrame();
+
+	// Emitters spawn against what was left alive at the end of the last tick
+	hkVector4 viewer = racers[racerIndex]->body->getPosition();
+	float viewerPos[3] = { viewer(0), viewer(1), viewer(2) };
+	ParticleBudget::budget->startTick(SmokeSystem::system->getCount() + LaserSystem::system->getCount(), viewerPos);
+
 	// Debugging Information ---------------------------------------
 	if(input->debugging()){
 		displayDebugInfo(intention, seconds);
 	}
 	else{
-		std::string stringArray[] = {""};
-		//renderer->setText(stringArray, sizeof(stringArray) / sizeof(std::string));
+		const char* lines[] = {""};
+		//renderer->setText(lines, sizeof(lines) / sizeof(const char*));
 	}
 	// ---------------------------------------------------------------
 	
@@ -402,6 +437,7 @@ void AI::simulate(float seconds)
 			racers[i]->computeRPM();
 		}
 
+		Racer::applyQueuedForces(seconds);
 		physics->step(seconds);
 
 		for (int i = 0; i < NUMRACERS; i++)
@@ -562,7 +598,8 @@ void AI::simulate(float seconds)
 	}
 	if(intention.aPressed){
 		
-		vector<Waypoint*> passWaypoints = vector<Waypoint*>();
+		vector<Waypoint*, FrameAllocator<Waypoint*> > passWaypoints;
+		passWaypoints.reserve(NUMWAYPOINTS);
 		for(int i = 0; i < NUMWAYPOINTS; i++){
 			passWaypoints.push_back(waypoints[i]);
 		}
@@ -572,6 +609,7 @@ void AI::simulate(float seconds)
 
 	
 	
+	Racer::applyQueuedForces(seconds);
 	physics->step(seconds);
 
 
@@ -584,7 +622,6 @@ void AI::simulate(float seconds)
 	DynamicObjManager::manager->update(seconds);
 	SmokeSystem::system->update(seconds);
 	LaserSystem::system->update(seconds);
-	
 
 	return;
 }
@@ -650,24 +687,22 @@ void AI::updateRacerPlacement(int left, int right)
 }
 
 
-std::string AI::getFPSString(float milliseconds)
+int AI::getFPS(float milliseconds)
 {
 	count++;
 
+	// Frames rendered over the last ticks; there can be several, or none, per tick
 	if (count > 20)
 	{
-		fps = (int) floor(1000.0f / milliseconds);
+		fps = (int) floor((renderer->frameCount - lastFrameCount) * 1000.0f / (count * milliseconds) + 0.5f);
+		lastFrameCount = renderer->frameCount;
 		count = 0;
 	}
-	
-	char tmp[5];
-
-	_itoa_s(fps, tmp, 5, 10);
 
-	return std::string("FPS: ").append((const char*) tmp);
+	return fps;
 }
 
-std::string AI::boolToString(bool boolean)
+const char* AI::boolToString(bool boolean)
 {
 	if(boolean == true){
 		return "True";
@@ -677,223 +712,105 @@ std::string AI::boolToString(bool boolean)
 	}
 }
 
+// Formatted into the frame arena, so nothing here touches the heap
 void AI::displayDebugInfo(Intention intention, float seconds)
 {
-		char buf1[33];
-		_itoa_s(intention.rightTrig, buf1, 10);
-		char buf2[33];
-		_itoa_s(intention.leftTrig, buf2, 10);
-		char buf3[33];
-		_itoa_s(intention.rightStickX, buf3, 10);
-		char buf4[33];
-		_itoa_s(intention.rightStickY, buf4, 10);
-		char buf5[33];
-		_itoa_s(intention.leftStickX, buf5, 10);
-		char buf6[33];
-		_itoa_s((int) (intention.acceleration * 100.0f), buf6, 10);
-		char buf7[33];
-		_itoa_s((int) (intention.leftStickY), buf7, 10);
-
-		char buf8[33];
+		FrameArena* arena = FrameArena::arena;
+
 		hkVector4 vel = racers[racerIndex]->body->getLinearVelocity();
 		float velocity = vel.dot3(racers[racerIndex]->drawable->getZhkVector());
-		_itoa_s((int) (velocity), buf8, 10);
-
-		char buf9[33];
-		_itoa_s((int) (Racer::accelerationScale), buf9, 10);
-
-		char buf10[33];
-		_itoa_s((int) (racers[racerIndex]->kills), buf10, 10);
-		char buf11[33];
-		_itoa_s(racerMinds[racerIndex]->getCurrentWaypoint(), buf11, 10);
-		char buf12[33];
-		_itoa_s(racerMinds[racerIndex]->getCheckpointTime(), buf12, 10);
-		char buf13[33];
-		_itoa_s(racerMinds[racerIndex]->getSpeedCooldown(), buf13, 10);
-		char buf14[33];
-		_itoa_s(racerIndex, buf14, 10);
-		char buf15[33];
-		_itoa_s(racerMinds[racerIndex]->getCurrentLap(), buf15, 10);
-		char buf16[33];
-		_itoa_s(racers[racerIndex]->health, buf16, 10);
-		char buf17[33];
-		_itoa_s(racerMinds[racerIndex]->getLaserLevel(), buf17, 10);
-		char buf18[33];
-		_itoa_s(racerMinds[racerIndex]->getPlacement(), buf18, 10);
-		char buf19[33];
-		_itoa_s(racerMinds[racerIndex]->getOverallPosition(), buf19, 10);
-		char buf20[33];
-		_itoa_s(racerMinds[racerIndex]->getSpeedLevel(), buf20, 10);
-		char buf21[33];
-		_itoa_s(racerMinds[racerIndex]->getCurrentCheckpoint(), buf21, 10);
-		char buf22[33];
-		_itoa_s((int)(racerMinds[racerIndex]->getRotationAngle()*1000.0f), buf22, 10);
-		char buf23[33];
-		_itoa_s((int)(racerMinds[racerIndex]->getSpeedAmmo()), buf23, 10);
-		char buf24[33];
-		_itoa_s((int)(racerMinds[racerIndex]->getRocketAmmo()), buf24, 10);
-		char buf25[33];
-		_itoa_s((int)(racerMinds[racerIndex]->getLandmineAmmo()), buf25, 10);
-		char buf26[33];
-		_itoa_s(racers[racerIndex]->suicides, buf26, 10);
-		char buf27[33];
-		_itoa_s(racers[racerIndex]->deaths, buf27, 10);
-		char buf28[33];
-		_itoa_s(racers[racerIndex]->givenDamage, buf28, 10);
-		char buf29[33];
-		_itoa_s(racers[racerIndex]->takenDamage, buf29, 10);
-		
-		std::string stringArray[] = { getFPSString(seconds * 1000.0f), 
-			"X: " + boolToString(intention.xPressed),
-			"Y: " + boolToString(intention.yPressed),
-			"A: " + boolToString(intention.aPressed),
-			"B: " + boolToString(intention.bPressed),
-			"Back: " + boolToString(intention.selectPressed),
-			"Start: " + boolToString(intention.startPressed),
-			std::string("Right Trigger: ").append(buf1),
-			std::string("Left Trigger: ").append(buf2),
-			std::string("RStick X: ").append(buf3),
-			std::string("RStick Y: ").append(buf4),
-			std::string("LStickX: ").append(buf5),
-			std::string("LStickY: ").append(buf7),
-			std::string("Acceleration: ").append(buf6),
+
+		const char* lines[] = { arena->format("FPS: %d", getFPS(seconds * 1000.0f)),
+			arena->format("X: %s", boolToString(intention.xPressed)),
+			arena->format("Y: %s", boolToString(intention.yPressed)),
+			arena->format("A: %s", boolToString(intention.aPressed)),
+			arena->format("B: %s", boolToString(intention.bPressed)),
+			arena->format("Back: %s", boolToString(intention.selectPressed)),
+			arena->format("Start: %s", boolToString(intention.startPressed)),
+			arena->format("Right Trigger: %d", intention.rightTrig),
+			arena->format("Left Trigger: %d", intention.leftTrig),
+			arena->format("RStick X: %d", intention.rightStickX),
+			arena->format("RStick Y: %d", intention.rightStickY),
+			arena->format("LStickX: %d", intention.leftStickX),
+			arena->format("LStickY: %d", (int) (intention.leftStickY)),
+			arena->format("Acceleration: %d", (int) (intention.acceleration * 100.0f)),
 			" ",
 			"Player Information:",
-			std::string("Currently Looking at Player #").append(buf14),
-			std::string("Velocity: ").append(buf8),
-			std::string("Accel. Scale: ").append(buf9),
-			std::string("Current Lap: ").append(buf15),
-			std::string("Kills: ").append(buf10),
-			std::string("Deaths: ").append(buf27),
-			std::string("Suicides: ").append(buf26),
-			std::string("Given Damage: ").append(buf28),
-			std::string("Taken Damage: ").append(buf29),
-			std::string("Current Waypoint: ").append(buf11),
-			//std::string("Current Checkpoint: ").append(buf22),
-			//std::string("Checkpoint Time: ").append(buf12),
-			//std::string("Speed level: ").append(buf21),
-			//std::string("Speed Boost Cooldown: ").append(buf13),
-			std::string("Health: ").append(buf16),
-			//std::string("Laser Level: ").append(buf17),
-			std::string("Placement: ").append(buf18),
-			std::string("Overall position value: ").append(buf19),
-			//std::string("Rotation Angle: ").append(buf22),
-			std::string("Ammo Counts:"),
-			std::string("Speed Boost: ").append(buf23),
-			std::string("Rocket: ").append(buf24),
-			std::string("Landmine: ").append(buf25)};
+			arena->format("Currently Looking at Player #%d", racerIndex),
+			arena->format("Velocity: %d", (int) (velocity)),
+			arena->format("Accel. Scale: %d", (int) (Racer::accelerationScale)),
+			arena->format("Current Lap: %d", racerMinds[racerIndex]->getCurrentLap()),
+			arena->format("Kills: %d", (int) (racers[racerIndex]->kills)),
+			arena->format("Deaths: %d", racers[racerIndex]->deaths),
+			arena->format("Suicides: %d", racers[racerIndex]->suicides),
+			arena->format("Given Damage: %d", racers[racerIndex]->givenDamage),
+			arena->format("Taken Damage: %d", racers[racerIndex]->takenDamage),
+			arena->format("Current Waypoint: %d", racerMinds[racerIndex]->getCurrentWaypoint()),
+			//arena->format("Current Checkpoint: %d", racerMinds[racerIndex]->getCurrentCheckpoint()),
+			//arena->format("Checkpoint Time: %d", racerMinds[racerIndex]->getCheckpointTime()),
+			//arena->format("Speed level: %d", racerMinds[racerIndex]->getSpeedLevel()),
+			//arena->format("Speed Boost Cooldown: %d", racerMinds[racerIndex]->getSpeedCooldown()),
+			arena->format("Health: %d", racers[racerIndex]->health),
+			//arena->format("Laser Level: %d", racerMinds[racerIndex]->getLaserLevel()),
+			arena->format("Placement: %d", racerMinds[racerIndex]->getPlacement()),
+			arena->format("Overall position value: %d", racerMinds[racerIndex]->getOverallPosition()),
+			//arena->format("Rotation Angle: %d", (int) (racerMinds[racerIndex]->getRotationAngle() * 1000.0f)),
+			"Ammo Counts:",
+			arena->format("Speed Boost: %d", (int) (racerMinds[racerIndex]->getSpeedAmmo())),
+			arena->format("Rocket: %d", (int) (racerMinds[racerIndex]->getRocketAmmo())),
+			arena->format("Landmine: %d", (int) (racerMinds[racerIndex]->getLandmineAmmo())),
+			" ",
+			arena->format("Wheel contact cache hits: %d", ContactCache::hits),
+			arena->format("Wheel contact cache misses: %d", ContactCache::misses),
+			arena->format("Racer forces (%s): %d us per tick", Racer::batchForces ? "batched" : "one at a time",
+				(int) Racer::forceMicroseconds),
+			arena->format("Texture cache hits: %d", TextureCache::cache->hits),
+			arena->format("Texture cache misses: %d", TextureCache::cache->misses),
+			arena->format("Texture memory (KB): %d", (int) (TextureCache::cache->bytesResident / 1024)),
+			arena->format("Drawables visible: %d", renderer->visibleCount),
+			arena->format("Drawables culled: %d", renderer->culledCount),
+			arena->format("Shadows culled: %d", renderer->culledShadowCount),
+			arena->format("Drawables per level of detail: %d %d %d %d", renderer->lodCounts[0], renderer->lodCounts[1],
+				renderer->lodCounts[2], renderer->lodCounts[3]),
+			arena->format("Track chunks drawn: %d of %d", renderer->chunksVisible, renderer->chunksTotal),
+			arena->format("Racer shadows: %d volumes, %d blobs, %d none", renderer->shadowTierCounts[SHADOW_TIER_VOLUME],
+				renderer->shadowTierCounts[SHADOW_TIER_BLOB], renderer->shadowTierCounts[SHADOW_TIER_NONE]),
+			arena->format("Tick drawn: %d (%d transforms dropped)", (int) renderer->drawnTick, renderer->transformsDropped),
+			arena->format("Particles: %d of %d, %d emitters throttled, %d refused", ParticleBudget::budget->live,
+				ParticleBudget::budget->capacity, ParticleBudget::budget->throttled, ParticleBudget::budget->refused),
+			arena->format("Sound voices: %d playing, %d taken over, %d sounds dropped", Sound::sound->voicePool->getPlaying(SFX_FORMAT),
+				Sound::sound->voicePool->steals, Sound::sound->voicePool->rejections),
+			arena->format("State changes submitted: %d", StateCache::cache->frameSubmitted),
+			arena->format("State changes filtered: %d", StateCache::cache->frameFiltered)};
 	
-		renderer->setText(stringArray, sizeof(stringArray) / sizeof(std::string));
+		renderer->setText(lines, sizeof(lines) / sizeof(const char*));
 }
 
+// The table is made once, into fixed buffers; after that it is only handed to the renderer
 void AI::displayPostGameStatistics()
 {
 	if(generatePostGameStatistics){
-	char buf1[33];
-	_itoa_s((int) (racerPlacement[7]->getKills()), buf1, 10);
-	char buf2[33];
-	_itoa_s((int) (racerPlacement[6]->getKills()), buf2, 10);
-	char buf3[33];
-	_itoa_s((int) (racerPlacement[5]->getKills()), buf3, 10);
-	char buf4[33];
-	_itoa_s((int) (racerPlacement[4]->getKills()), buf4, 10);
-	char buf5[33];
-	_itoa_s((int) (racerPlacement[3]->getKills()), buf5, 10);
-	char buf26[33];
-	_itoa_s((int) (racerPlacement[2]->getKills()), buf26, 10);
-	char buf27[33];
-	_itoa_s((int) (racerPlacement[1]->getKills()), buf27, 10);
-	char buf28[33];
-	_itoa_s((int) (racerPlacement[0]->getKills()), buf28, 10);
-
-	char buf6[33];
-	_itoa_s((int) (racerPlacement[7]->getDeaths()), buf6, 10);
-	char buf7[33];
-	_itoa_s((int) (racerPlacement[6]->getDeaths()), buf7, 10);
-	char buf8[33];
-	_itoa_s((int) (racerPlacement[5]->getDeaths()), buf8, 10);
-	char buf9[33];
-	_itoa_s((int) (racerPlacement[4]->getDeaths()), buf9, 10);
-	char buf10[33];
-	_itoa_s((int) (racerPlacement[3]->getDeaths()), buf10, 10);
-	char buf29[33];
-	_itoa_s((int) (racerPlacement[2]->getDeaths()), buf29, 10);
-	char buf30[33];
-	_itoa_s((int) (racerPlacement[1]->getDeaths()), buf30, 10);
-	char buf31[33];
-	_itoa_s((int) (racerPlacement[0]->getDeaths()), buf31, 10);
-
-	char buf11[33];
-	_itoa_s((int) (racerPlacement[7]->getSuicides()), buf11, 10);
-	char buf12[33];
-	_itoa_s((int) (racerPlacement[6]->getSuicides()), buf12, 10);
-	char buf13[33];
-	_itoa_s((int) (racerPlacement[5]->getSuicides()), buf13, 10);
-	char buf14[33];
-	_itoa_s((int) (racerPlacement[4]->getSuicides()), buf14, 10);
-	char buf15[33];
-	_itoa_s((int) (racerPlacement[3]->getSuicides()), buf15, 10);
-	char buf32[33];
-	_itoa_s((int) (racerPlacement[2]->getSuicides()), buf32, 10);
-	char buf33[33];
-	_itoa_s((int) (racerPlacement[1]->getSuicides()), buf33, 10);
-	char buf34[33];
-	_itoa_s((int) (racerPlacement[0]->getSuicides()), buf34, 10);
-
-	char buf16[33];
-	_itoa_s((int) (racerPlacement[7]->getDamageDone()), buf16, 10);
-	char buf17[33];
-	_itoa_s((int) (racerPlacement[6]->getDamageDone()), buf17, 10);
-	char buf18[33];
-	_itoa_s((int) (racerPlacement[5]->getDamageDone()), buf18, 10);
-	char buf19[33];
-	_itoa_s((int) (racerPlacement[4]->getDamageDone()), buf19, 10);
-	char buf20[33];
-	_itoa_s((int) (racerPlacement[3]->getDamageDone()), buf20, 10);
-	char buf35[33];
-	_itoa_s((int) (racerPlacement[2]->getDamageDone()), buf35, 10);
-	char buf36[33];
-	_itoa_s((int) (racerPlacement[1]->getDamageDone()), buf36, 10);
-	char buf37[33];
-	_itoa_s((int) (racerPlacement[0]->getDamageDone()), buf37, 10);
-
-	char buf21[33];
-	_itoa_s((int) (racerPlacement[7]->getDamageTaken()), buf21, 10);
-	char buf22[33];
-	_itoa_s((int) (racerPlacement[6]->getDamageTaken()), buf22, 10);
-	char buf23[33];
-	_itoa_s((int) (racerPlacement[5]->getDamageTaken()), buf23, 10);
-	char buf24[33];
-	_itoa_s((int) (racerPlacement[4]->getDamageTaken()), buf24, 10);
-	char buf25[33];
-	_itoa_s((int) (racerPlacement[3]->getDamageTaken()), buf25, 10);
-	char buf38[33];
-	_itoa_s((int) (racerPlacement[2]->getDamageTaken()), buf38, 10);
-	char buf39[33];
-	_itoa_s((int) (racerPlacement[1]->getDamageTaken()), buf39, 10);
-	char buf40[33];
-	_itoa_s((int) (racerPlacement[0]->getDamageTaken()), buf40, 10);
-
-	postGameStatistics[0] = std::string("     Player Name:     Colour:     Kills:     Deaths:     Suicides:     Damage Done:     Damage Taken:");
-	postGameStatistics[1] = std::string("1st: " + getSpaces(racerPlacement[7]->getRacerName(),17) + getSpaces(racerPlacement[7]->getRacerColour(),12) + getSpaces(buf1,11) + getSpaces(buf6,12)  + getSpaces(buf11,14) + getSpaces(buf16,17) + buf21); // 1st place
-	postGameStatistics[2] = std::string("2nd: " + getSpaces(racerPlacement[6]->getRacerName(),17) + getSpaces(racerPlacement[6]->getRacerColour(),12) + getSpaces(buf2,11) + getSpaces(buf7,12)  + getSpaces(buf12,14) + getSpaces(buf17,17) + buf22); // 2nd place
-	postGameStatistics[3] = std::string("3rd: " + getSpaces(racerPlacement[5]->getRacerName(),17) + getSpaces(racerPlacement[5]->getRacerColour(),12) + getSpaces(buf3,11) + getSpaces(buf8,12)  + getSpaces(buf13,14) + getSpaces(buf18,17) + buf23); // 3rd place
-	postGameStatistics[4] = std::string("4th: " + getSpaces(racerPlacement[4]->getRacerName(),17) + getSpaces(racerPlacement[4]->getRacerColour(),12) + getSpaces(buf4,11) + getSpaces(buf9,12)  + getSpaces(buf14,14) + getSpaces(buf19,17) + buf24); // 4th place
-	postGameStatistics[5] = std::string("5th: " + getSpaces(racerPlacement[3]->getRacerName(),17) + getSpaces(racerPlacement[3]->getRacerColour(),12) + getSpaces(buf5,11) + getSpaces(buf10,12) + getSpaces(buf15,14) + getSpaces(buf20,17) + buf25);  // 5th place
-	postGameStatistics[6] = std::string("6th: " + getSpaces(racerPlacement[2]->getRacerName(),17) + getSpaces(racerPlacement[2]->getRacerColour(),12) + getSpaces(buf26,11) + getSpaces(buf29,12) + getSpaces(buf32,14) + getSpaces(buf35,17) + buf38); // 6th place
-	postGameStatistics[7] = std::string("7th: " + getSpaces(racerPlacement[1]->getRacerName(),17) + getSpaces(racerPlacement[1]->getRacerColour(),12) + getSpaces(buf27,11) + getSpaces(buf30,12) + getSpaces(buf33,14) + getSpaces(buf36,17) + buf39); // 7th place
-	postGameStatistics[8] = std::string("8th: " + getSpaces(racerPlacement[0]->getRacerName(),17) + getSpaces(racerPlacement[0]->getRacerColour(),12) + getSpaces(buf28,11) + getSpaces(buf31,12) + getSpaces(buf34,14) + getSpaces(buf37,17) + buf40); // 8th place
+	const char* places[NUMRACERS] = { "1st", "2nd", "3rd", "4th", "5th", "6th", "7th", "8th" };
 
-	generatePostGameStatistics = false;
+	sprintf_s(postGameStatistics[0], POST_GAME_LINE_LENGTH, "     Player Name:     Colour:     Kills:     Deaths:     Suicides:     Damage Done:     Damage Taken:");
+
+	for (int i = 0; i < NUMRACERS; i++)
+	{
+		AIMind* mind = racerPlacement[NUMRACERS - 1 - i];	// Sorted last place first
+
+		sprintf_s(postGameStatistics[i + 1], POST_GAME_LINE_LENGTH, "%s: %-17s%-12s%-11d%-12d%-14d%-17d%d", places[i],
+			mind->getRacerName().c_str(), mind->getRacerColour().c_str(), (int) (mind->getKills()), (int) (mind->getDeaths()),
+			(int) (mind->getSuicides()), (int) (mind->getDamageDone()), (int) (mind->getDamageTaken()));
 	}
 
-	renderer->setText(postGameStatistics, sizeof(postGameStatistics) / sizeof(std::string));
-}
+	generatePostGameStatistics = false;
+	}
 
-std::string AI::getSpaces(std::string input, int numSpaces){
-	std::string output = input;
-	for(int i = 0; i < (int)numSpaces - (int)input.size(); i++){
-		output.append(" ");
+	const char* lines[NUMRACERS + 1];
+	for (int i = 0; i < NUMRACERS + 1; i++)
+	{
+		lines[i] = postGameStatistics[i];
 	}
-	return output;
-}
+
+	renderer->setText(lines, NUMRACERS + 1);
+}
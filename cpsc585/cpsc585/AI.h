@@ -17,31 +17,36 @@
 #include "Ability.h"
 #include "CheckpointTimer.h"
 #include "DynamicObjManager.h"
+#include "Explosion.h"
+#include "FrameArena.h"
 
 #define NUMRACERS 8
 #define NUMWAYPOINTS 83
 #define NUMCHECKPOINTS 4
 
+#define FRAME_ARENA_SIZE (64 * 1024)
+#define POST_GAME_LINE_LENGTH 128
+
 class AI
 {
 public:
 	AI(void);
 	~AI(void);
 	void shutdown();
-	void initialize(Renderer* renderer, Input* input, Sound* sound);
+	bool initialize(Renderer* renderer, Input* input, Sound* sound);	// False if the track couldn't be loaded
 	void simulate(float milliseconds);
 	void displayDebugInfo(Intention intention, float milliseconds);
 	void updateRacerPlacement(int left, int right);
 
 private:
-	std::string getFPSString(float milliseconds);
+	void simulateTick(float seconds);
+	int getFPS(float milliseconds);
 	void initializeAIRacers();
 	void initializeCheckpoints();
 	void displayPostGameStatistics();
-	std::string boolToString(bool boolean);
-	std::string getSpaces(std::string input, int numSpaces);
+	const char* boolToString(bool boolean);
 
-	std::string postGameStatistics[9];
+	char postGameStatistics[NUMRACERS + 1][POST_GAME_LINE_LENGTH];
 	bool generatePostGameStatistics;
 
 	Renderer* renderer;
@@ -53,9 +58,11 @@ private:
 	WaypointEditor* wpEditor;
 
 	DynamicObjManager* dynManager;
+	FrameArena* frameArena;		// Scratch for this frame's debug text, reset at the end of simulate
 
 	int count;
 	int fps;
+	int lastFrameCount;		// Renderer's, when fps was last worked out
 	int currentWaypoint;
 
 	// Race start/end stuff
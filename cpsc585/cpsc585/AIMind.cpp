@@ -289,10 +289,7 @@ void AIMind::update(HUD* hud, Intention intention, float seconds, Waypoint* wayp
 
 				if (speedBoost->onCooldown())
 				{
-					char buf1[33];
 					speedBoost->updateCooldown(seconds);
-					std::string stringArray[] = { buf1 };//, buf2, buf3, buf4 };
-					//renderer->setText(stringArray, 1);
 				}
 
 				if (laser->onCooldown())
@@ -755,18 +752,18 @@ void AIMind::updateWaypointsAndLap(float seconds, Waypoint* waypoints[], Waypoin
 		prevWaypoint = currentWaypoint - 1;
 	}
 	D3DXVECTOR3 current = waypoints[currentWaypoint]->drawable->getPosition();
-	hkVector4* currentPos = new hkVector4(current.x, current.y, current.z);
+	hkVector4 currentPos(current.x, current.y, current.z);
 	D3DXVECTOR3 prev = waypoints[prevWaypoint]->drawable->getPosition();
-	hkVector4* prevPos = new hkVector4(prev.x, prev.y, prev.z);
+	hkVector4 prevPos(prev.x, prev.y, prev.z);
 
 	hkSimdReal distanceOfRacer = waypoints[currentWaypoint]->wpPosition.distanceTo(getRacerPosition());
 
-	if(waypoints[currentWaypoint]->passedWaypoint(currentPos, prevPos, &racer->body->getPosition())){
+	if(waypoints[currentWaypoint]->passedWaypoint(&currentPos, &prevPos, &racer->body->getPosition())){
 		if(waypoints[currentWaypoint]->getWaypointType() == LAP_POINT){
 			currentLap += 1;
 		}
 	}
-	if(waypoints[currentWaypoint]->passedWaypoint(currentPos, prevPos, &racer->body->getPosition())
+	if(waypoints[currentWaypoint]->passedWaypoint(&currentPos, &prevPos, &racer->body->getPosition())
 		|| (distanceOfRacer.isLess(22) && waypoints[currentWaypoint]->getWaypointType() != LAP_POINT)){
 		if(currentWaypoint == 82){
 			currentWaypoint = 0;
@@ -0,0 +1,16 @@
+#pragma once
+
+
+// Makes and controls the source voices a VoicePool hands out. Voices are
+// opaque to the pool; what plays on them is up to whoever acquires one. A
+// format is the pool's number for a group of voices that share a wave format.
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() {}
+
+	virtual void* createVoice(int format) = 0;		// NULL on failure
+	virtual void destroyVoice(void* voice) = 0;
+	virtual void stopVoice(void* voice) = 0;		// Stops it and drops whatever is queued
+	virtual bool isPlaying(void* voice) = 0;		// Anything still queued
+};
@@ -38,7 +38,7 @@ void Camera::setFocus(Drawable* focus)
 
 void Camera::update()
 {
-	position = focusObject->getPosition();
+	position = focusObject->getRenderPosition();
 
 	position = position + (lookDir * -7.0f);
 	position.y += 2.0f;
@@ -51,6 +51,12 @@ void Camera::update()
 }
 
 
+D3DXVECTOR3 Camera::getPosition()
+{
+	return position;
+}
+
+
 void Camera::setLookDir(float x, float y, float z)
 {
 	lookDir.x = x;
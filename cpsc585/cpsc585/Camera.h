@@ -17,6 +17,7 @@ public:
 
 	void render();
 	void getViewMatrix(D3DXMATRIX& matrix);
+	D3DXVECTOR3 getPosition();
 	void setLookDir(float x, float y, float z);
 
 private:
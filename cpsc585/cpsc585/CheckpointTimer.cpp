@@ -33,13 +33,13 @@ int CheckpointTimer::update(Waypoint* checkpoints[], Waypoint* prevCheckpoints[]
 		prevCheckpoint = currentCheckpoint - 1;
 	}
 	D3DXVECTOR3 current = checkpoints[currentCheckpoint]->drawable->getPosition();
-	hkVector4* currentPos = new hkVector4(current.x, current.y, current.z);
+	hkVector4 currentPos(current.x, current.y, current.z);
 	D3DXVECTOR3 prev = prevCheckpoints[currentCheckpoint]->drawable->getPosition();
-	hkVector4* prevPos = new hkVector4(prev.x, prev.y, prev.z);
+	hkVector4 prevPos(prev.x, prev.y, prev.z);
 
 	hkSimdReal distanceOfRacer = checkpoints[currentCheckpoint]->wpPosition.distanceTo(racer->body->getPosition());
 
-	if(checkpoints[currentCheckpoint]->passedWaypoint(currentPos, prevPos, &racer->body->getPosition())
+	if(checkpoints[currentCheckpoint]->passedWaypoint(&currentPos, &prevPos, &racer->body->getPosition())
 		&& distanceOfRacer.isLess(50)){
 		checkPointTime += checkpoints[currentCheckpoint]->getCheckPointTime();
 		if(currentCheckpoint == 3){ // NEEDS TO BE UPDATED BASED ON NUMBER OF CHECKPOINTS
@@ -0,0 +1,690 @@
+#include "CollisionMesh.h"
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <algorithm>
+
+
+struct CollisionMeshHeader
+{
+	char magic[4];
+	int version;
+	int indexSize;			// Bytes per index, so a file written with other index types is refused
+	int vertexCount;
+	int triangleCount;
+};
+
+struct WeldCell
+{
+	int x, y, z;
+
+	bool operator<(const WeldCell& other) const
+	{
+		if (x != other.x) return x < other.x;
+		if (y != other.y) return y < other.y;
+		return z < other.z;
+	}
+};
+
+static void sub(const float* a, const float* b, float* out)
+{
+	out[0] = a[0] - b[0];
+	out[1] = a[1] - b[1];
+	out[2] = a[2] - b[2];
+}
+
+static void cross(const float* a, const float* b, float* out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float dot(const float* a, const float* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Unnormalized face normal (length is twice the area)
+static void faceNormal(const float* a, const float* b, const float* c, float* out)
+{
+	float e1[3], e2[3];
+	sub(b, a, e1);
+	sub(c, a, e2);
+	cross(e1, e2, out);
+}
+
+static float normalize(float* v)
+{
+	float length = sqrt(dot(v, v));
+	if (length > 0.0f)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+	return length;
+}
+
+
+CollisionMeshParams::CollisionMeshParams()
+{
+	weldDistance = 0.001f;
+	minArea = 0.000001f;
+	minNormalY = -0.25f;
+	flatAngle = 0.035f;		// ~2 degrees
+	maxError = 0.05f;
+	maxPasses = 16;
+}
+
+
+CollisionMesh::CollisionMesh()
+{
+	vertices = NULL;
+	indices = NULL;
+	neighbours = NULL;
+	planes = NULL;
+	nearbyStart = NULL;
+	nearby = NULL;
+	vertexCount = 0;
+	triangleCount = 0;
+
+	sourceTriangleCount = 0;
+	droppedDegenerate = 0;
+	droppedNonDrivable = 0;
+	collapsedVertices = 0;
+}
+
+
+CollisionMesh::~CollisionMesh()
+{
+	release();
+}
+
+void CollisionMesh::release()
+{
+	if (vertices)
+	{
+		delete [] vertices;
+		vertices = NULL;
+	}
+
+	if (indices)
+	{
+		delete [] indices;
+		indices = NULL;
+	}
+
+	if (neighbours)
+	{
+		delete [] neighbours;
+		neighbours = NULL;
+	}
+
+	if (planes)
+	{
+		delete [] planes;
+		planes = NULL;
+	}
+
+	if (nearbyStart)
+	{
+		delete [] nearbyStart;
+		nearbyStart = NULL;
+	}
+
+	if (nearby)
+	{
+		delete [] nearby;
+		nearby = NULL;
+	}
+
+	vertexCount = 0;
+	triangleCount = 0;
+}
+
+void CollisionMesh::build(const float* vertexData, int stride, int numVertices,
+	const unsigned int* indexData, int numIndices, const CollisionMeshParams& params)
+{
+	release();
+
+	sourceTriangleCount = numIndices / 3;
+	droppedDegenerate = 0;
+	droppedNonDrivable = 0;
+	collapsedVertices = 0;
+
+	std::vector<float> positions;
+	std::vector<unsigned long> tris;
+
+	weld(vertexData, stride, numVertices, indexData, numIndices, params, positions, tris);
+	collapsedVertices = decimate(positions, tris, params);
+
+	// Compact away vertices no triangle references any more
+	std::vector<int> remap(positions.size() / 3, -1);
+	vertexCount = 0;
+	for (unsigned int i = 0; i < tris.size(); i++)
+	{
+		if (remap[tris[i]] < 0)
+		{
+			remap[tris[i]] = vertexCount++;
+		}
+	}
+
+	triangleCount = tris.size() / 3;
+	vertices = new float[vertexCount * 3];
+	indices = new unsigned int[triangleCount * 3];
+
+	for (unsigned int i = 0; i < remap.size(); i++)
+	{
+		if (remap[i] >= 0)
+		{
+			vertices[remap[i] * 3 + 0] = positions[i * 3 + 0];
+			vertices[remap[i] * 3 + 1] = positions[i * 3 + 1];
+			vertices[remap[i] * 3 + 2] = positions[i * 3 + 2];
+		}
+	}
+
+	for (unsigned int i = 0; i < tris.size(); i++)
+	{
+		indices[i] = remap[tris[i]];
+	}
+
+	buildAdjacency();
+	buildNearby();
+}
+
+void CollisionMesh::buildAdjacency()
+{
+	neighbours = new long[triangleCount * 3];
+	planes = new float[triangleCount * 4];
+
+	// Pair up triangles sharing an edge (first match wins on non-manifold edges)
+	std::map<std::pair<unsigned long, unsigned long>, long> openEdges;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			neighbours[t * 3 + e] = -1;
+
+			unsigned long a = indices[t * 3 + e];
+			unsigned long b = indices[t * 3 + (e + 1) % 3];
+			std::pair<unsigned long, unsigned long> edge(a < b ? a : b, a < b ? b : a);
+
+			std::map<std::pair<unsigned long, unsigned long>, long>::iterator found = openEdges.find(edge);
+			if (found == openEdges.end())
+			{
+				openEdges[edge] = t * 3 + e;
+			}
+			else if (found->second >= 0)
+			{
+				neighbours[t * 3 + e] = found->second / 3;
+				neighbours[found->second] = t;
+				found->second = -1;
+			}
+		}
+
+		float* plane = &planes[t * 4];
+		const float* p0 = &vertices[indices[t * 3] * 3];
+		faceNormal(p0, &vertices[indices[t * 3 + 1] * 3], &vertices[indices[t * 3 + 2] * 3], plane);
+		normalize(plane);
+		plane[3] = dot(plane, p0);
+	}
+}
+
+void CollisionMesh::buildNearby()
+{
+	std::vector<float> boxes(triangleCount * 6);
+	std::vector<std::pair<float, int> > byMinX(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		float* box = &boxes[t * 6];
+		for (int k = 0; k < 3; k++)
+		{
+			const float* p = &vertices[indices[t * 3 + k] * 3];
+			for (int a = 0; a < 3; a++)
+			{
+				box[a] = k == 0 ? p[a] : std::min(box[a], p[a]);
+				box[3 + a] = k == 0 ? p[a] : std::max(box[3 + a], p[a]);
+			}
+		}
+		byMinX[t] = std::make_pair(box[0], t);
+	}
+	std::sort(byMinX.begin(), byMinX.end());
+
+	// Sweep along x, so only boxes that already overlap there (with the margin) are compared
+	std::vector<std::vector<long> > lists(triangleCount);
+	for (int i = 0; i < triangleCount; i++)
+	{
+		int t = byMinX[i].second;
+		const float* a = &boxes[t * 6];
+
+		for (int j = i + 1; j < triangleCount && byMinX[j].first <= a[3] + COLLISION_NEARBY_MARGIN; j++)
+		{
+			int u = byMinX[j].second;
+			const float* b = &boxes[u * 6];
+
+			bool close = true;
+			for (int k = 0; k < 3 && close; k++)
+			{
+				close = b[k] <= a[3 + k] + COLLISION_NEARBY_MARGIN && a[k] <= b[3 + k] + COLLISION_NEARBY_MARGIN;
+			}
+
+			if (close)
+			{
+				lists[t].push_back(u);
+				lists[u].push_back(t);
+			}
+		}
+	}
+
+	nearbyStart = new int[triangleCount + 1];
+	nearbyStart[0] = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		nearbyStart[t + 1] = nearbyStart[t] + lists[t].size();
+	}
+
+	nearby = new long[nearbyStart[triangleCount] > 0 ? nearbyStart[triangleCount] : 1];
+	for (int t = 0; t < triangleCount; t++)
+	{
+		std::copy(lists[t].begin(), lists[t].end(), nearby + nearbyStart[t]);
+	}
+}
+
+void CollisionMesh::weld(const float* vertexData, int stride, int numVertices,
+	const unsigned int* indexData, int numIndices, const CollisionMeshParams& params,
+	std::vector<float>& positions, std::vector<unsigned long>& tris)
+{
+	float cellSize = params.weldDistance > 0.000001f ? params.weldDistance : 0.000001f;
+	float weldDistanceSq = params.weldDistance * params.weldDistance;
+
+	std::map<WeldCell, std::vector<int> > grid;
+	std::vector<int> welded(numVertices);
+
+	// Merge every source vertex with any already-kept vertex within weldDistance
+	for (int i = 0; i < numVertices; i++)
+	{
+		const float* p = vertexData + i * stride;
+
+		WeldCell cell;
+		cell.x = (int) floor(p[0] / cellSize);
+		cell.y = (int) floor(p[1] / cellSize);
+		cell.z = (int) floor(p[2] / cellSize);
+
+		int match = -1;
+		for (int dx = -1; dx <= 1 && match < 0; dx++)
+		{
+			for (int dy = -1; dy <= 1 && match < 0; dy++)
+			{
+				for (int dz = -1; dz <= 1 && match < 0; dz++)
+				{
+					WeldCell neighbour = { cell.x + dx, cell.y + dy, cell.z + dz };
+					std::map<WeldCell, std::vector<int> >::iterator found = grid.find(neighbour);
+					if (found == grid.end())
+					{
+						continue;
+					}
+
+					for (unsigned int j = 0; j < found->second.size(); j++)
+					{
+						float d[3];
+						sub(p, &positions[found->second[j] * 3], d);
+						if (dot(d, d) <= weldDistanceSq)
+						{
+							match = found->second[j];
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match < 0)
+		{
+			match = positions.size() / 3;
+			positions.push_back(p[0]);
+			positions.push_back(p[1]);
+			positions.push_back(p[2]);
+			grid[cell].push_back(match);
+		}
+
+		welded[i] = match;
+	}
+
+	// Keep only triangles that have area, face the right way and aren't repeats
+	std::set<std::vector<unsigned long> > seen;
+	for (int i = 0; i + 2 < numIndices; i += 3)
+	{
+		unsigned long a = welded[indexData[i]];
+		unsigned long b = welded[indexData[i + 1]];
+		unsigned long c = welded[indexData[i + 2]];
+
+		float n[3];
+		faceNormal(&positions[a * 3], &positions[b * 3], &positions[c * 3], n);
+
+		if (a == b || b == c || a == c || normalize(n) * 0.5f < params.minArea)
+		{
+			droppedDegenerate++;
+			continue;
+		}
+
+		// Orient by the authored vertex normals so the test doesn't depend on winding
+		float authored[3] = { 0.0f, 0.0f, 0.0f };
+		for (int k = 0; k < 3; k++)
+		{
+			const float* v = vertexData + indexData[i + k] * stride;
+			authored[0] += v[3];
+			authored[1] += v[4];
+			authored[2] += v[5];
+		}
+		float up = dot(n, authored) < 0.0f ? -n[1] : n[1];
+
+		if (up < params.minNormalY)
+		{
+			droppedNonDrivable++;
+			continue;
+		}
+
+		std::vector<unsigned long> key(3);
+		key[0] = a; key[1] = b; key[2] = c;
+		std::sort(key.begin(), key.end());
+		if (!seen.insert(key).second)
+		{
+			droppedDegenerate++;
+			continue;
+		}
+
+		tris.push_back(a);
+		tris.push_back(b);
+		tris.push_back(c);
+	}
+}
+
+// Collapses interior vertices of flat regions onto a neighbour, as long as no
+// face flips or tilts out of the region and the removed vertex stays within
+// maxError of the triangles that replace it. Returns the number of collapses.
+int CollisionMesh::decimate(std::vector<float>& positions, std::vector<unsigned long>& tris,
+	const CollisionMeshParams& params)
+{
+	float cosFlat = cos(params.flatAngle);
+	int numVertices = positions.size() / 3;
+	int totalCollapsed = 0;
+
+	for (int pass = 0; pass < params.maxPasses; pass++)
+	{
+		int numTris = tris.size() / 3;
+
+		std::vector<std::vector<int> > vertexFaces(numVertices);
+		std::vector<float> normals(numTris * 3);
+		std::vector<bool> alive(numTris, true);
+		std::vector<bool> locked(numVertices, false);
+
+		for (int f = 0; f < numTris; f++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				vertexFaces[tris[f * 3 + k]].push_back(f);
+			}
+			faceNormal(&positions[tris[f * 3] * 3], &positions[tris[f * 3 + 1] * 3],
+				&positions[tris[f * 3 + 2] * 3], &normals[f * 3]);
+			normalize(&normals[f * 3]);
+		}
+
+		int collapsed = 0;
+
+		for (int v = 0; v < numVertices; v++)
+		{
+			std::vector<int>& faces = vertexFaces[v];
+			if (locked[v] || faces.size() < 3)
+			{
+				continue;
+			}
+
+			// Every face around v must lie in one plane (within flatAngle)
+			const float* reference = &normals[faces[0] * 3];
+			bool flat = true;
+			for (unsigned int i = 1; i < faces.size() && flat; i++)
+			{
+				flat = dot(reference, &normals[faces[i] * 3]) >= cosFlat;
+			}
+			if (!flat)
+			{
+				continue;
+			}
+
+			// v must be interior: each neighbour shares exactly two of v's faces
+			std::map<unsigned long, int> ring;
+			for (unsigned int i = 0; i < faces.size(); i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned long w = tris[faces[i] * 3 + k];
+					if (w != (unsigned long) v)
+					{
+						ring[w]++;
+					}
+				}
+			}
+
+			bool interior = true;
+			for (std::map<unsigned long, int>::iterator it = ring.begin(); it != ring.end(); it++)
+			{
+				if (it->second != 2)
+				{
+					interior = false;
+					break;
+				}
+			}
+			if (!interior)
+			{
+				continue;
+			}
+
+			// Try the shortest edges first
+			std::vector<std::pair<float, unsigned long> > candidates;
+			for (std::map<unsigned long, int>::iterator it = ring.begin(); it != ring.end(); it++)
+			{
+				float d[3];
+				sub(&positions[v * 3], &positions[it->first * 3], d);
+				candidates.push_back(std::make_pair(dot(d, d), it->first));
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			for (unsigned int c = 0; c < candidates.size(); c++)
+			{
+				unsigned long u = candidates[c].second;
+				if (locked[u])
+				{
+					continue;
+				}
+
+				// Link condition: v and u may only share the two vertices opposite their edge
+				int shared = 0;
+				std::set<unsigned long> uRing;
+				for (unsigned int i = 0; i < vertexFaces[u].size(); i++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						uRing.insert(tris[vertexFaces[u][i] * 3 + k]);
+					}
+				}
+				for (std::map<unsigned long, int>::iterator it = ring.begin(); it != ring.end(); it++)
+				{
+					if (it->first != u && uRing.count(it->first))
+					{
+						shared++;
+					}
+				}
+				if (shared != 2)
+				{
+					continue;
+				}
+
+				bool valid = true;
+				for (unsigned int i = 0; i < faces.size() && valid; i++)
+				{
+					unsigned long* t = &tris[faces[i] * 3];
+					if (t[0] == u || t[1] == u || t[2] == u)
+					{
+						continue;
+					}
+
+					const float* p[3];
+					for (int k = 0; k < 3; k++)
+					{
+						p[k] = &positions[(t[k] == (unsigned long) v ? u : t[k]) * 3];
+					}
+
+					float n[3];
+					faceNormal(p[0], p[1], p[2], n);
+					float area = normalize(n) * 0.5f;
+
+					float offset[3];
+					sub(&positions[v * 3], p[0], offset);
+
+					valid = area >= params.minArea &&
+						dot(n, &normals[faces[i] * 3]) >= cosFlat &&
+						dot(n, reference) >= cosFlat &&
+						fabs(dot(offset, n)) <= params.maxError;
+				}
+
+				if (!valid)
+				{
+					continue;
+				}
+
+				for (unsigned int i = 0; i < faces.size(); i++)
+				{
+					unsigned long* t = &tris[faces[i] * 3];
+					if (t[0] == u || t[1] == u || t[2] == u)
+					{
+						alive[faces[i]] = false;
+					}
+					else
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							if (t[k] == (unsigned long) v)
+							{
+								t[k] = u;
+							}
+						}
+					}
+
+					// Face lists around here are now stale until the next pass
+					locked[t[0]] = true;
+					locked[t[1]] = true;
+					locked[t[2]] = true;
+				}
+				locked[v] = true;
+
+				collapsed++;
+				break;
+			}
+		}
+
+		if (collapsed == 0)
+		{
+			break;
+		}
+
+		std::vector<unsigned long> remaining;
+		remaining.reserve(tris.size());
+		for (int f = 0; f < numTris; f++)
+		{
+			if (alive[f])
+			{
+				remaining.push_back(tris[f * 3]);
+				remaining.push_back(tris[f * 3 + 1]);
+				remaining.push_back(tris[f * 3 + 2]);
+			}
+		}
+		tris.swap(remaining);
+
+		totalCollapsed += collapsed;
+	}
+
+	return totalCollapsed;
+}
+
+bool CollisionMesh::load(std::string filename)
+{
+	std::ifstream filestream(filename.c_str(), std::ifstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	CollisionMeshHeader header;
+	filestream.read((char*)&header, sizeof(header));
+
+	if (!filestream.good() ||
+		header.magic[0] != 'C' || header.magic[1] != 'O' ||
+		header.magic[2] != 'L' || header.magic[3] != 'M' ||
+		header.version != COLLISION_MESH_VERSION || header.indexSize != sizeof(unsigned int) ||
+		header.vertexCount <= 0 || header.triangleCount <= 0)
+	{
+		return false;
+	}
+
+	release();
+
+	vertexCount = header.vertexCount;
+	triangleCount = header.triangleCount;
+	vertices = new float[vertexCount * 3];
+	indices = new unsigned int[triangleCount * 3];
+
+	filestream.read((char*)vertices, sizeof(float) * vertexCount * 3);
+	filestream.read((char*)indices, sizeof(unsigned int) * triangleCount * 3);
+
+	if (!filestream.good())
+	{
+		release();
+		return false;
+	}
+
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		if (indices[i] >= (unsigned int) vertexCount)
+		{
+			release();
+			return false;
+		}
+	}
+
+	filestream.close();
+
+	buildAdjacency();
+	buildNearby();
+
+	return true;
+}
+
+bool CollisionMesh::save(std::string filename)
+{
+	std::ofstream filestream(filename.c_str(), std::ofstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	CollisionMeshHeader header;
+	header.magic[0] = 'C';
+	header.magic[1] = 'O';
+	header.magic[2] = 'L';
+	header.magic[3] = 'M';
+	header.version = COLLISION_MESH_VERSION;
+	header.indexSize = sizeof(unsigned int);
+	header.vertexCount = vertexCount;
+	header.triangleCount = triangleCount;
+
+	filestream.write((const char*)&header, sizeof(header));
+	filestream.write((const char*)vertices, sizeof(float) * vertexCount * 3);
+	filestream.write((const char*)indices, sizeof(unsigned int) * triangleCount * 3);
+
+	bool ok = filestream.good();
+	filestream.close();
+
+	return ok;
+}
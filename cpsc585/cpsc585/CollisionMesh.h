@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#define COLLISION_MESH_VERSION 2
+#define COLLISION_TRACK_MIN_NORMAL_Y -1.0f		// The track keeps its downward faces, for overhangs hit from below
+#define COLLISION_NEARBY_MARGIN 1.5f		// Reach of the nearby lists: a wheel ray from its start to the road, with room to spare
+
+// Tunables for turning a render mesh into a collision mesh
+struct CollisionMeshParams
+{
+	CollisionMeshParams();
+
+	float weldDistance;		// Vertices closer than this are merged
+	float minArea;			// Triangles smaller than this are dropped
+	float minNormalY;		// Triangles facing further down than this are dropped (-1 keeps everything)
+	float flatAngle;		// Max angle (radians) between faces that count as one flat region
+	float maxError;			// Max distance a removed vertex may sit from the simplified surface
+	int maxPasses;			// Upper bound on decimation passes
+};
+
+// Welded, position-only triangle soup used as static collision geometry.
+// Built offline by the tools project (models/*.col) or at load time as a fallback.
+class CollisionMesh
+{
+public:
+	CollisionMesh();
+	~CollisionMesh();
+
+	// Positions are read from the first three floats of every vertex, normals
+	// (used to orient faces) from the next three; stride is in floats.
+	void build(const float* vertexData, int stride, int numVertices,
+		const unsigned int* indexData, int numIndices, const CollisionMeshParams& params);
+
+	bool load(std::string filename);
+	bool save(std::string filename);
+
+private:
+	void release();
+	void buildAdjacency();
+	void buildNearby();
+	void weld(const float* vertexData, int stride, int numVertices,
+		const unsigned int* indexData, int numIndices, const CollisionMeshParams& params,
+		std::vector<float>& positions, std::vector<unsigned long>& tris);
+	int decimate(std::vector<float>& positions, std::vector<unsigned long>& tris,
+		const CollisionMeshParams& params);
+
+public:
+	float* vertices;			// xyz per vertex
+	unsigned int* indices;		// 3 per triangle; 32 bits on every platform, as in the file
+
+	int vertexCount;
+	int triangleCount;
+
+	// Derived at load/build time, not stored in the file
+	long* neighbours;			// 3 per triangle: the triangle across each edge, or -1
+	float* planes;				// Unit normal and distance (n.p = d) per triangle
+
+	// Every other triangle whose bounding box comes within COLLISION_NEARBY_MARGIN of triangle t's
+	// is nearby[nearbyStart[t]] up to nearby[nearbyStart[t + 1]]. A segment whose box stays that
+	// close to t's can only hit t or those.
+	int* nearbyStart;
+	long* nearby;
+
+	// Stats from the last build
+	int sourceTriangleCount;
+	int droppedDegenerate;
+	int droppedNonDrivable;
+	int collapsedVertices;
+};
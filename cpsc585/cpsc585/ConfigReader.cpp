@@ -18,6 +18,7 @@ ConfigReader::ConfigReader()
 	topSpeed = 100;
 	grip = 2.0;
 	inverse = false;
+	batchForces = true;
 
 
 	file.open("config.txt");
@@ -53,7 +54,8 @@ ConfigReader::ConfigReader()
 			<< "SERVERIP " << serverIP << "\n"
 			<< "TOPSPEED " << topSpeed << "\n"
 			<< "GRIP " << grip
-			<< "INVERSE " << (int) inverse;
+			<< "INVERSE " << (int) inverse << "\n"
+			<< "BATCHFORCES " << (int) batchForces;
 
 
 			outFile.close();
@@ -130,5 +132,9 @@ void ConfigReader::parseLine(std::string line)
 		{
 			ss >> inverse; //Convert to bool
 		}
+		else if(key == "BATCHFORCES")
+		{
+			ss >> batchForces; //Convert to bool
+		}
 	}
 }
@@ -24,6 +24,7 @@ public:
 	float topSpeed;
 	std::string serverIP;
 	bool inverse;
+	bool batchForces;	// Racer springs, friction and drag through the SSE SuspensionBatch (default), 0 for one racer at a time
 
 private:
 	std::ifstream file;
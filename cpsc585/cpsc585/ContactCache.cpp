@@ -0,0 +1,266 @@
+#include "ContactCache.h"
+#include "World.h"
+
+int ContactCache::hits = 0;
+int ContactCache::misses = 0;
+int ContactCache::frameHits = 0;
+int ContactCache::frameMisses = 0;
+
+
+ContactCache::ContactCache()
+{
+	invalidate();
+}
+
+
+ContactCache::~ContactCache()
+{
+}
+
+void ContactCache::invalidate()
+{
+	triangle = -1;
+	key = HK_INVALID_SHAPE_KEY;
+	plane[0] = plane[1] = plane[2] = plane[3] = 0.0f;
+}
+
+void ContactCache::endFrame()
+{
+	hits = frameHits;
+	misses = frameMisses;
+
+	HK_MONITOR_ADD_VALUE("ContactCache hits", (float) hits, HK_MONITOR_TYPE_INT);
+	HK_MONITOR_ADD_VALUE("ContactCache misses", (float) misses, HK_MONITOR_TYPE_INT);
+
+	frameHits = 0;
+	frameMisses = 0;
+}
+
+void ContactCache::castRay(const hkpWorldRayCastInput& input, hkpWorldRayCastOutput& output)
+{
+	World* world = World::world;
+
+	if (triangle >= 0 && world)
+	{
+		// Work in the world body's space, where the collision mesh lives
+		const hkTransform& transform = world->body->getTransform();
+		hkVector4 localFrom, localTo;
+		localFrom.setTransformedInversePos(transform, input.m_from);
+		localTo.setTransformedInversePos(transform, input.m_to);
+
+		float from[3] = { localFrom(0), localFrom(1), localFrom(2) };
+		float to[3] = { localTo(0), localTo(1), localTo(2) };
+
+		// Cached triangle first (its plane is already on hand), then everything near it
+		CollisionMesh* mesh = world->collisionMesh;
+		int best = -1;
+		float bestFraction = 1.0f;
+		float bestNormal[3];
+		float fraction;
+		float normal[3];
+
+		if (testTriangle(triangle, from, to, fraction, normal))
+		{
+			best = triangle;
+			bestFraction = fraction;
+			bestNormal[0] = normal[0]; bestNormal[1] = normal[1]; bestNormal[2] = normal[2];
+		}
+
+		for (int i = mesh->nearbyStart[triangle]; i < mesh->nearbyStart[triangle + 1]; i++)
+		{
+			long other = mesh->nearby[i];
+			if (testTriangle(other, from, to, fraction, normal) && fraction < bestFraction)
+			{
+				best = other;
+				bestFraction = fraction;
+				bestNormal[0] = normal[0]; bestNormal[1] = normal[1]; bestNormal[2] = normal[2];
+			}
+		}
+
+		// Only trusted when the ray stays close enough for that list to hold everything it
+		// could hit; anywhere else an overhang, ramp lip or wall edge could be in the way
+		if (best >= 0 && segmentNearby(from, to, bestFraction))
+		{
+			frameHits++;
+
+			if (best != triangle)
+			{
+				// Same subpart as the cached key, different terminal
+				int subPart = world->meshShape->getSubPartIndex(key);
+				key = (subPart << (32 - world->meshShape->getNumBitsForSubpartIndex())) | best;
+				triangle = best;
+
+				const float* bestPlane = &mesh->planes[best * 4];
+				plane[0] = bestPlane[0]; plane[1] = bestPlane[1]; plane[2] = bestPlane[2]; plane[3] = bestPlane[3];
+			}
+
+			// Something closer than the track, the triangle stays cached for next tick
+			if (castBodies(input, output, bestFraction))
+			{
+				return;
+			}
+
+			hkVector4 localNormal(bestNormal[0], bestNormal[1], bestNormal[2]);
+			output.m_normal.setRotatedDir(transform.getRotation(), localNormal);
+			output.m_hitFraction = bestFraction;
+			output.m_rootCollidable = world->body->getCollidable();
+			output.m_shapeKeys[0] = key;
+			output.m_shapeKeys[1] = HK_INVALID_SHAPE_KEY;
+			return;
+		}
+	}
+
+	frameMisses++;
+	Physics::world->castRay(input, output);
+
+	// Only world hits can be cached
+	if (world && output.hasHit() && output.m_rootCollidable == world->body->getCollidable())
+	{
+		key = output.m_shapeKeys[0];
+		triangle = world->meshShape->getTerminalIndexInSubPart(key);
+
+		const float* hitPlane = &world->collisionMesh->planes[triangle * 4];
+		plane[0] = hitPlane[0]; plane[1] = hitPlane[1]; plane[2] = hitPlane[2]; plane[3] = hitPlane[3];
+	}
+	else
+	{
+		invalidate();
+	}
+}
+
+// Casts against every body but the track that the ray's filter allows,
+// keeping only hits closer than maxFraction. Only bodies the broadphase
+// finds around the segment are looked at.
+bool ContactCache::castBodies(const hkpWorldRayCastInput& input, hkpWorldRayCastOutput& output, float maxFraction)
+{
+	hkpWorld* physicsWorld = Physics::world;
+	const hkpCollisionFilter* filter = physicsWorld->getCollisionFilter();
+	const hkpCollidable* track = World::world->body->getCollidable();
+
+	hkVector4 end;
+	end.setInterpolate4(input.m_from, input.m_to, maxFraction);
+	hkAabb segment;
+	segment.m_min.setMin4(input.m_from, end);
+	segment.m_max.setMax4(input.m_from, end);
+
+	hkInplaceArray<hkpBroadPhaseHandlePair, 16> overlaps;
+	physicsWorld->getBroadPhase()->querySingleAabb(segment, overlaps);
+
+	output.reset();
+	output.m_hitFraction = maxFraction;		// Shapes only report hits closer than this
+	bool hit = false;
+
+	for (int i = 0; i < overlaps.getSize(); i++)
+	{
+		const hkpTypedBroadPhaseHandle* handle = static_cast<const hkpTypedBroadPhaseHandle*>(overlaps[i].m_b);
+		if (handle->getType() != hkpWorldObject::BROAD_PHASE_ENTITY)
+		{
+			continue;
+		}
+
+		const hkpCollidable* collidable = static_cast<const hkpCollidable*>(handle->getOwner());
+		if (collidable == track || !filter->isCollisionEnabled(input, *collidable))
+		{
+			continue;
+		}
+
+		const hkpShape* shape = collidable->getShape();
+		const hkTransform& transform = collidable->getTransform();
+
+		hkpShapeRayCastInput shapeInput;
+		shapeInput.m_from.setTransformedInversePos(transform, input.m_from);
+		shapeInput.m_to.setTransformedInversePos(transform, input.m_to);
+		shapeInput.m_filterInfo = input.m_filterInfo;
+
+		if (shape->castRay(shapeInput, output))
+		{
+			hkVector4 localNormal = output.m_normal;
+			output.m_normal.setRotatedDir(transform.getRotation(), localNormal);
+			output.m_rootCollidable = collidable;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+// Whether the segment from the start of the ray to the hit at fraction stays
+// within COLLISION_NEARBY_MARGIN of the cached triangle, in collision mesh space
+bool ContactCache::segmentNearby(const float* from, const float* to, float fraction)
+{
+	CollisionMesh* mesh = World::world->collisionMesh;
+	const float margin = COLLISION_NEARBY_MARGIN;
+
+	for (int k = 0; k < 3; k++)
+	{
+		float end = from[k] + (to[k] - from[k]) * fraction;
+		float low = from[k] < end ? from[k] : end;
+		float high = from[k] < end ? end : from[k];
+
+		float boxMin = mesh->vertices[mesh->indices[triangle * 3] * 3 + k];
+		float boxMax = boxMin;
+		for (int c = 1; c < 3; c++)
+		{
+			float p = mesh->vertices[mesh->indices[triangle * 3 + c] * 3 + k];
+			boxMin = p < boxMin ? p : boxMin;
+			boxMax = p > boxMax ? p : boxMax;
+		}
+
+		if (low <= boxMin - margin || high >= boxMax + margin)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Two-sided segment/triangle test in collision mesh space
+bool ContactCache::testTriangle(int tri, const float* from, const float* to, float& fraction, float* normal)
+{
+	CollisionMesh* mesh = World::world->collisionMesh;
+	const float* n = (tri == triangle) ? plane : &mesh->planes[tri * 4];
+
+	float distFrom = n[0] * from[0] + n[1] * from[1] + n[2] * from[2] - n[3];
+	float distTo = n[0] * to[0] + n[1] * to[1] + n[2] * to[2] - n[3];
+
+	// Segment has to cross the plane
+	if ((distFrom > 0.0f && distTo > 0.0f) || (distFrom < 0.0f && distTo < 0.0f) || distFrom == distTo)
+	{
+		return false;
+	}
+
+	fraction = distFrom / (distFrom - distTo);
+
+	float hit[3];
+	hit[0] = from[0] + (to[0] - from[0]) * fraction;
+	hit[1] = from[1] + (to[1] - from[1]) * fraction;
+	hit[2] = from[2] + (to[2] - from[2]) * fraction;
+
+	// Inside if the hit is on the inner side of all three edges
+	for (int e = 0; e < 3; e++)
+	{
+		const float* a = &mesh->vertices[mesh->indices[tri * 3 + e] * 3];
+		const float* b = &mesh->vertices[mesh->indices[tri * 3 + (e + 1) % 3] * 3];
+
+		float edge[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float toHit[3] = { hit[0] - a[0], hit[1] - a[1], hit[2] - a[2] };
+
+		float c0 = edge[1] * toHit[2] - edge[2] * toHit[1];
+		float c1 = edge[2] * toHit[0] - edge[0] * toHit[2];
+		float c2 = edge[0] * toHit[1] - edge[1] * toHit[0];
+
+		if (c0 * n[0] + c1 * n[1] + c2 * n[2] < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	// Like Havok, report the normal facing back along the ray
+	float sign = distFrom >= 0.0f ? 1.0f : -1.0f;
+	normal[0] = n[0] * sign;
+	normal[1] = n[1] * sign;
+	normal[2] = n[2] * sign;
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Physics.h"
+
+#include <Physics/Internal/Collide/BroadPhase/hkpBroadPhase.h>
+#include <Physics/Internal/Collide/BroadPhase/hkpBroadPhaseHandlePair.h>
+#include <Physics/Collide/Dispatch/BroadPhase/hkpTypedBroadPhaseHandle.h>
+
+
+// Remembers which world triangle a wheel's ray hit last tick. The next ray is
+// tested against that triangle and every triangle near it first (see
+// CollisionMesh::nearby), and only goes out to a full world raycast when none
+// of them are hit, or when the ray reaches further from the triangle than
+// those lists cover.
+//
+// The triangle only stands in for the track. Every other body the ray's
+// filter lets it hit (racers, rockets, landmines) is still tested, up to the
+// track hit, so something between the wheel and the road stops it as before.
+class ContactCache
+{
+public:
+	ContactCache();
+	~ContactCache();
+
+	// Drop-in replacement for Physics::world->castRay
+	void castRay(const hkpWorldRayCastInput& input, hkpWorldRayCastOutput& output);
+	void invalidate();
+
+	// Publishes this frame's counters to the Havok monitor stream and resets them
+	static void endFrame();
+
+private:
+	bool testTriangle(int tri, const float* from, const float* to, float& fraction, float* normal);
+	bool castBodies(const hkpWorldRayCastInput& input, hkpWorldRayCastOutput& output, float maxFraction);
+	bool segmentNearby(const float* from, const float* to, float fraction);
+
+	int triangle;			// Last hit triangle in the world collision mesh, -1 if none
+	hkpShapeKey key;
+	float plane[4];
+
+public:
+	// Counters for the last complete frame
+	static int hits;
+	static int misses;
+
+private:
+	static int frameHits;
+	static int frameMisses;
+};
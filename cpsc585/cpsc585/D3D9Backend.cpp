@@ -0,0 +1,197 @@
+#include "D3D9Backend.h"
+#include "Renderer.h"
+
+
+D3D9Backend::D3D9Backend(IDirect3DDevice9* device, IDirect3DVertexBuffer9* shadowQuad, bool twoSidedStencils)
+{
+	this->device = device;
+	this->shadowQuad = shadowQuad;
+	this->twoSidedStencils = twoSidedStencils;
+	instancer = NULL;
+}
+
+
+void D3D9Backend::setInstancer(D3D9Instancer* instancer)
+{
+	this->instancer = instancer;
+}
+
+
+void D3D9Backend::beginPass(int pass)
+{
+	switch (pass)
+	{
+	case RENDER_PASS_OPAQUE:
+		StateCache::cache->setRenderState(D3DRS_FOGENABLE, TRUE);
+		break;
+	case RENDER_PASS_SHADOW:
+		beginShadows();
+		break;
+	case RENDER_PASS_SHADOW_BACK:
+		// Now reverse cull order so back sides of shadow volume are written.
+		StateCache::cache->setRenderState(D3DRS_CULLMODE, D3DCULL_CW);
+
+		// Decrement stencil buffer value
+		StateCache::cache->setRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_DECR);
+		break;
+	}
+}
+
+
+void D3D9Backend::endPass(int pass)
+{
+	switch (pass)
+	{
+	case RENDER_PASS_OPAQUE:
+		StateCache::cache->setRenderState(D3DRS_FOGENABLE, FALSE);
+		break;
+	case RENDER_PASS_SHADOW:
+		if (twoSidedStencils)
+		{
+			StateCache::cache->setRenderState(D3DRS_TWOSIDEDSTENCILMODE, FALSE);
+			finishShadows();
+		}
+		break;
+	case RENDER_PASS_SHADOW_BACK:
+		finishShadows();
+		break;
+	}
+}
+
+
+void D3D9Backend::setTexture(void* texture)
+{
+	StateCache::cache->setTexture(0, (IDirect3DTexture9*) texture);
+}
+
+void D3D9Backend::setTransform(const float* transform)
+{
+	StateCache::cache->setTransform(D3DTS_WORLD, transform);
+
+	// Packed meshes are transformed in the shader
+	if (D3D9MeshShader::shader)
+	{
+		D3D9MeshShader::shader->setWorld(transform);
+	}
+}
+
+void D3D9Backend::setGeometry(int kind, void* geometry)
+{
+	if (kind == RENDER_DRAW_MESH || kind == RENDER_DRAW_CHUNKS)
+	{
+		((Mesh*) geometry)->bind(device);
+	}
+	else if (kind == RENDER_DRAW_INSTANCES)
+	{
+		instancer->bind((InstanceGroup*) geometry);
+	}
+	else
+	{
+		((Drawable*) geometry)->bindShadowVolume(device);
+	}
+}
+
+void D3D9Backend::draw(int kind, void* geometry)
+{
+	if (kind == RENDER_DRAW_MESH)
+	{
+		((Mesh*) geometry)->draw(device);
+	}
+	else if (kind == RENDER_DRAW_CHUNKS)
+	{
+		((Mesh*) geometry)->drawChunks(device);
+	}
+	else if (kind == RENDER_DRAW_INSTANCES)
+	{
+		instancer->draw((InstanceGroup*) geometry);
+	}
+	else
+	{
+		((Drawable*) geometry)->drawShadowVolume(device);
+	}
+}
+
+
+void D3D9Backend::beginShadows()
+{
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	
+	// Disable lighting
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
+
+	// Disable writing to depth-buffer
+	StateCache::cache->setRenderState(D3DRS_ZWRITEENABLE, FALSE);
+    StateCache::cache->setRenderState(D3DRS_STENCILENABLE, TRUE);
+	
+	// Got most of this (and the addEdge() function) from some
+	// sample source code online, which said it got most of
+	// the code in turn from the DirectX SDK
+	StateCache::cache->setRenderState(D3DRS_SHADEMODE, D3DSHADE_FLAT);
+
+	StateCache::cache->setRenderState(D3DRS_STENCILFUNC, D3DCMP_ALWAYS);
+    StateCache::cache->setRenderState(D3DRS_STENCILZFAIL, D3DSTENCILOP_KEEP);
+    StateCache::cache->setRenderState(D3DRS_STENCILFAIL, D3DSTENCILOP_KEEP);
+
+    // If z-test passes, inc/decrement stencil buffer value
+    StateCache::cache->setRenderState(D3DRS_STENCILMASK, 0xffffffff);
+    StateCache::cache->setRenderState(D3DRS_STENCILWRITEMASK, 0xffffffff);
+    StateCache::cache->setRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_INCR);
+
+    // Make sure that no pixels get drawn to the frame buffer
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_ZERO);
+    StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_ONE);
+
+
+	// Two-sided stencil functionality makes shadows faster
+	// (one pass instead of two)
+	if (twoSidedStencils)
+	{
+		StateCache::cache->setRenderState(D3DRS_TWOSIDEDSTENCILMODE, TRUE);
+		StateCache::cache->setRenderState(D3DRS_CCW_STENCILFUNC, D3DCMP_ALWAYS);
+		StateCache::cache->setRenderState(D3DRS_CCW_STENCILZFAIL, D3DSTENCILOP_KEEP);
+		StateCache::cache->setRenderState(D3DRS_CCW_STENCILFAIL, D3DSTENCILOP_KEEP);
+		StateCache::cache->setRenderState(D3DRS_CCW_STENCILPASS, D3DSTENCILOP_DECR);
+		StateCache::cache->setRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+	}
+}
+
+
+void D3D9Backend::finishShadows()
+{
+	StateCache::cache->setRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
+	StateCache::cache->setRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
+	StateCache::cache->setRenderState(D3DRS_ZWRITEENABLE, TRUE);
+
+
+
+    StateCache::cache->setRenderState(D3DRS_ZENABLE, FALSE);
+
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
+    StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+    StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+    StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+
+
+	// Only write where stencil value >= 1 (count indicates # of shadows that
+    // overlap that pixel)
+    StateCache::cache->setRenderState(D3DRS_STENCILREF, 1);
+	StateCache::cache->setRenderState(D3DRS_STENCILFUNC, D3DCMP_LESSEQUAL);
+    StateCache::cache->setRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_KEEP);
+
+	// Draw big dark square
+	StateCache::cache->setStreamSource(0, shadowQuad, 0, sizeof(ShadowPoint));
+	StateCache::cache->setFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE);
+	device->DrawPrimitive(D3DPT_TRIANGLESTRIP, 0, 2);
+
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, TRUE);
+	StateCache::cache->setRenderState(D3DRS_STENCILENABLE, FALSE);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+#include "RenderBackend.h"
+#include "Drawable.h"
+#include "D3D9Instancer.h"
+
+
+// Plays a RenderQueue back on the device. Passes own their render states:
+// the opaque pass draws with fog, the shadow passes write the stencil buffer
+// and the last of them darkens the stenciled area.
+class D3D9Backend : public RenderBackend
+{
+public:
+	D3D9Backend(IDirect3DDevice9* device, IDirect3DVertexBuffer9* shadowQuad, bool twoSidedStencils);
+	void setInstancer(D3D9Instancer* instancer);	// NULL when instancing isn't supported
+
+	void beginPass(int pass);
+	void endPass(int pass);
+	void setTexture(void* texture);
+	void setTransform(const float* transform);
+	void setGeometry(int kind, void* geometry);
+	void draw(int kind, void* geometry);
+
+private:
+	void beginShadows();
+	void finishShadows();
+
+	IDirect3DDevice9* device;
+	IDirect3DVertexBuffer9* shadowQuad;		// Owned by the Renderer
+	bool twoSidedStencils;
+	D3D9Instancer* instancer;				// Owned by the Renderer
+};
@@ -0,0 +1,123 @@
+#include "D3D9BlobRenderer.h"
+#include "StateCache.h"
+
+#include <string.h>
+
+#define BLOB_TEXTURE_SIZE	64
+
+
+D3D9BlobRenderer::D3D9BlobRenderer(IDirect3DDevice9* device)
+{
+	this->device = device;
+	texture = NULL;
+	vertexBuffer = NULL;
+}
+
+
+D3D9BlobRenderer::~D3D9BlobRenderer()
+{
+	if (vertexBuffer)
+	{
+		vertexBuffer->Release();
+		vertexBuffer = NULL;
+	}
+
+	if (texture)
+	{
+		texture->Release();
+		texture = NULL;
+	}
+}
+
+
+bool D3D9BlobRenderer::initialize()
+{
+	if (FAILED(device->CreateTexture(BLOB_TEXTURE_SIZE, BLOB_TEXTURE_SIZE, 1, 0, D3DFMT_A8R8G8B8,
+		D3DPOOL_MANAGED, &texture, NULL)))
+	{
+		texture = NULL;
+		return false;
+	}
+
+	// Black, opaque in the middle and falling off smoothly to nothing at the edge
+	D3DLOCKED_RECT locked;
+	if (FAILED(texture->LockRect(0, &locked, NULL, 0)))
+	{
+		texture->Release();
+		texture = NULL;
+		return false;
+	}
+
+	for (int y = 0; y < BLOB_TEXTURE_SIZE; y++)
+	{
+		unsigned int* row = (unsigned int*) ((char*) locked.pBits + y * locked.Pitch);
+		for (int x = 0; x < BLOB_TEXTURE_SIZE; x++)
+		{
+			float u = (x + 0.5f) / BLOB_TEXTURE_SIZE * 2.0f - 1.0f;
+			float v = (y + 0.5f) / BLOB_TEXTURE_SIZE * 2.0f - 1.0f;
+			float falloff = 1.0f - (u * u + v * v);
+			falloff = falloff > 0.0f ? falloff * falloff : 0.0f;
+
+			row[x] = (unsigned int) (falloff * 255.0f + 0.5f) << 24;
+		}
+	}
+	texture->UnlockRect(0);
+
+	if (FAILED(device->CreateVertexBuffer(sizeof(BlobVertex) * SHADOW_MAX_BLOBS * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC,
+		D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1, D3DPOOL_DEFAULT, &vertexBuffer, NULL)))
+	{
+		vertexBuffer = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+
+void D3D9BlobRenderer::draw(ShadowTiers* blobs)
+{
+	int vertexCount = blobs->getVertexCount();
+	if (!texture || !vertexBuffer || vertexCount == 0)
+	{
+		return;
+	}
+
+	void* vertices;
+	if (FAILED(vertexBuffer->Lock(0, sizeof(BlobVertex) * vertexCount, &vertices, D3DLOCK_DISCARD)))
+	{
+		return;
+	}
+	memcpy(vertices, blobs->getVertices(), sizeof(BlobVertex) * vertexCount);
+	vertexBuffer->Unlock();
+
+	// Tested against the depth buffer but not written to it, both sides
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_ZWRITEENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, FALSE);
+	StateCache::cache->setRenderState(D3DRS_FOGENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+
+	StateCache::cache->setSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
+	StateCache::cache->setSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+
+	StateCache::cache->setTexture(0, texture);
+	StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(BlobVertex));
+	StateCache::cache->setFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+	device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, vertexCount / 3);
+
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ZWRITEENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, TRUE);
+}
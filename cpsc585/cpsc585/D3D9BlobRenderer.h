@@ -0,0 +1,23 @@
+#pragma once
+
+#include <d3d9.h>
+
+#include "ShadowTiers.h"
+
+
+// Draws the blobs laid out by ShadowTiers with a round, soft edged texture made at startup,
+// darkening whatever they lie on. Call with the world transform set to identity.
+class D3D9BlobRenderer
+{
+public:
+	D3D9BlobRenderer(IDirect3DDevice9* device);
+	~D3D9BlobRenderer();
+
+	bool initialize();
+	void draw(ShadowTiers* blobs);
+
+private:
+	IDirect3DDevice9* device;
+	IDirect3DTexture9* texture;
+	IDirect3DVertexBuffer9* vertexBuffer;	// Room for SHADOW_MAX_BLOBS
+};
@@ -0,0 +1,156 @@
+#include "D3D9Instancer.h"
+
+#include <string.h>
+
+
+D3D9Instancer::D3D9Instancer(IDirect3DDevice9* device)
+{
+	this->device = device;
+	declaration = NULL;
+	packedDeclaration = NULL;
+	instanceBuffer = NULL;
+	capacity = 0;
+}
+
+
+D3D9Instancer::~D3D9Instancer()
+{
+	if (instanceBuffer)
+	{
+		instanceBuffer->Release();
+		instanceBuffer = NULL;
+	}
+
+	if (packedDeclaration)
+	{
+		packedDeclaration->Release();
+		packedDeclaration = NULL;
+	}
+
+	if (declaration)
+	{
+		declaration->Release();
+		declaration = NULL;
+	}
+}
+
+
+bool D3D9Instancer::initialize()
+{
+	if (!D3D9MeshShader::shader || !D3D9MeshShader::shader->getShader(MESH_SHADER_INSTANCED))
+	{
+		return false;
+	}
+
+	D3DVERTEXELEMENT9 elements[] =
+	{
+		{ 0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+		{ 0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+		{ 0, 24, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+		{ 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+		{ 1, 16, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+		{ 1, 32, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3 },
+		{ 1, 48, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0 },
+		D3DDECL_END()
+	};
+
+	if (FAILED(device->CreateVertexDeclaration(elements, &declaration)))
+	{
+		return false;
+	}
+
+	// The same with stream 0 as PackedVertex
+	if (D3D9MeshShader::shader->getShader(MESH_SHADER_INSTANCED | MESH_SHADER_PACKED))
+	{
+		D3DVERTEXELEMENT9 packedElements[] =
+		{
+			{ 0, 0, D3DDECLTYPE_SHORT4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+			{ 0, 8, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+			{ 0, 12, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+			{ 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+			{ 1, 16, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+			{ 1, 32, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3 },
+			{ 1, 48, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0 },
+			D3DDECL_END()
+		};
+
+		if (FAILED(device->CreateVertexDeclaration(packedElements, &packedDeclaration)))
+		{
+			packedDeclaration = NULL;
+		}
+	}
+
+	return true;
+}
+
+
+bool D3D9Instancer::upload(InstanceBatch* batch)
+{
+	int count = batch->getInstanceCount();
+	if (count == 0)
+	{
+		return true;
+	}
+
+	// Grow to fit; the buffer is refilled every frame
+	if (count > capacity)
+	{
+		if (instanceBuffer)
+		{
+			instanceBuffer->Release();
+			instanceBuffer = NULL;
+		}
+
+		capacity = count * 2;
+		if (FAILED(device->CreateVertexBuffer(sizeof(InstanceData) * capacity, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+			0, D3DPOOL_DEFAULT, &instanceBuffer, NULL)))
+		{
+			capacity = 0;
+			return false;
+		}
+	}
+
+	void* data;
+	if (FAILED(instanceBuffer->Lock(0, sizeof(InstanceData) * count, &data, D3DLOCK_DISCARD)))
+	{
+		return false;
+	}
+
+	memcpy(data, batch->getInstances(), sizeof(InstanceData) * count);
+	instanceBuffer->Unlock();
+
+	return true;
+}
+
+
+bool D3D9Instancer::canDraw(InstanceGroup* group)
+{
+	return !((Mesh*) group->geometry)->packed || packedDeclaration;
+}
+
+
+void D3D9Instancer::bind(InstanceGroup* group)
+{
+	Mesh* mesh = (Mesh*) group->geometry;
+	mesh->bind(device);
+
+	StateCache::cache->setVertexDeclaration(mesh->packed ? packedDeclaration : declaration);
+	StateCache::cache->setStreamSource(1, instanceBuffer, group->first * sizeof(InstanceData), sizeof(InstanceData));
+}
+
+
+void D3D9Instancer::draw(InstanceGroup* group)
+{
+	Mesh* mesh = (Mesh*) group->geometry;
+
+	device->SetVertexShader(D3D9MeshShader::shader->getShader(MESH_SHADER_INSTANCED | (mesh->packed ? MESH_SHADER_PACKED : 0)));
+	device->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | group->count);
+	device->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1);
+
+	device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, mesh->vertexCount, 0, mesh->indexCount / 3);
+
+	// Back to the fixed function pipeline for everything else
+	device->SetStreamSourceFreq(0, 1);
+	device->SetStreamSourceFreq(1, 1);
+	device->SetVertexShader(NULL);
+}
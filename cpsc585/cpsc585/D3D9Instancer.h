@@ -0,0 +1,35 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+#include "D3D9MeshShader.h"
+#include "InstanceBatch.h"
+#include "Mesh.h"
+
+
+// Draws an InstanceBatch group with one DrawIndexedPrimitive: the mesh on
+// stream 0 repeated once per instance, the packed instance data on stream 1,
+// and the instanced D3D9MeshShader variants. Needs vs_3_0; initialize()
+// fails without it and the renderer keeps drawing one by one.
+class D3D9Instancer
+{
+public:
+	D3D9Instancer(IDirect3DDevice9* device);
+	~D3D9Instancer();
+
+	bool initialize();		// After D3D9MeshShader::shader
+	bool upload(InstanceBatch* batch);	// Once a frame, after build()
+
+	bool canDraw(InstanceGroup* group);		// False for packed meshes without the packed variant
+	void bind(InstanceGroup* group);
+	void draw(InstanceGroup* group);
+
+private:
+	IDirect3DDevice9* device;
+	IDirect3DVertexDeclaration9* declaration;
+	IDirect3DVertexDeclaration9* packedDeclaration;		// NULL when packed meshes can't be instanced
+
+	IDirect3DVertexBuffer9* instanceBuffer;
+	int capacity;			// Instances instanceBuffer holds
+};
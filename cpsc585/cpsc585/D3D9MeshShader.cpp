@@ -0,0 +1,245 @@
+#include "D3D9MeshShader.h"
+
+#include <string.h>
+
+
+D3D9MeshShader* D3D9MeshShader::shader = NULL;
+
+// Matches the fixed function pipeline's directional light and linear vertex fog
+static const char* meshShader =
+	"float4x4 viewProjection : register(c0);\n"
+	"float4 viewZ : register(c4);\n"			// Third column of the view matrix, for the fog depth
+	"float4 lightDirection : register(c5);\n"	// Towards the light
+	"float4 ambient : register(c6);\n"
+	"float4 diffuse : register(c7);\n"
+	"float4 fog : register(c8);\n"				// Start, end
+	"float4 world[3] : register(c9);\n"			// Columns
+	"float4 quantization[3] : register(c12);\n"	// Position centre, position scale, uv centre and scale
+	"\n"
+	"struct Input\n"
+	"{\n"
+	"	float4 position : POSITION;\n"
+	"	float4 normal : NORMAL;\n"
+	"	float2 uv : TEXCOORD0;\n"
+	"#ifdef INSTANCED\n"
+	"	float4 column0 : TEXCOORD1;\n"
+	"	float4 column1 : TEXCOORD2;\n"
+	"	float4 column2 : TEXCOORD3;\n"
+	"	float4 colour : COLOR0;\n"
+	"#endif\n"
+	"};\n"
+	"\n"
+	"struct Output\n"
+	"{\n"
+	"	float4 position : POSITION;\n"
+	"	float4 colour : COLOR0;\n"
+	"	float2 uv : TEXCOORD0;\n"
+	"	float fog : FOG;\n"
+	"};\n"
+	"\n"
+	"Output main(Input input)\n"
+	"{\n"
+	"#ifdef PACKED\n"
+	"	float4 local = float4(quantization[0].xyz + input.position.xyz * quantization[1].xyz, 1.0f);\n"
+	"	float3 octahedral = float3(input.normal.xy, 1.0f - abs(input.normal.x) - abs(input.normal.y));\n"
+	"	if (octahedral.z < 0.0f)\n"
+	"	{\n"
+	"		octahedral.xy = (1.0f - abs(octahedral.yx)) * (octahedral.xy >= 0.0f ? 1.0f : -1.0f);\n"
+	"	}\n"
+	"	float3 localNormal = octahedral;\n"
+	"	float2 uv = quantization[2].xy + input.uv * quantization[2].zw;\n"
+	"#else\n"
+	"	float4 local = float4(input.position.xyz, 1.0f);\n"
+	"	float3 localNormal = input.normal.xyz;\n"
+	"	float2 uv = input.uv;\n"
+	"#endif\n"
+	"\n"
+	"#ifdef INSTANCED\n"
+	"	float4 column0 = input.column0, column1 = input.column1, column2 = input.column2;\n"
+	"	float4 colour = input.colour;\n"
+	"#else\n"
+	"	float4 column0 = world[0], column1 = world[1], column2 = world[2];\n"
+	"	float4 colour = 1.0f;\n"
+	"#endif\n"
+	"\n"
+	"	float4 position = float4(dot(local, column0), dot(local, column1), dot(local, column2), 1.0f);\n"
+	"	float3 normal = normalize(float3(dot(localNormal, column0.xyz), dot(localNormal, column1.xyz), dot(localNormal, column2.xyz)));\n"
+	"\n"
+	"	Output output;\n"
+	"	output.position = mul(position, viewProjection);\n"
+	"	output.colour = saturate(ambient + diffuse * max(dot(normal, lightDirection.xyz), 0.0f)) * colour;\n"
+	"	output.uv = uv;\n"
+	"	output.fog = saturate((fog.y - dot(position, viewZ)) / (fog.y - fog.x));\n"
+	"	return output;\n"
+	"}\n";
+
+
+D3D9MeshShader::D3D9MeshShader(IDirect3DDevice9* device)
+{
+	this->device = device;
+	for (int i = 0; i < MESH_SHADER_VARIANTS; i++)
+	{
+		shaders[i] = NULL;
+	}
+	packedDeclaration = NULL;
+
+	shader = this;
+}
+
+
+D3D9MeshShader::~D3D9MeshShader()
+{
+	if (packedDeclaration)
+	{
+		packedDeclaration->Release();
+		packedDeclaration = NULL;
+	}
+
+	for (int i = 0; i < MESH_SHADER_VARIANTS; i++)
+	{
+		if (shaders[i])
+		{
+			shaders[i]->Release();
+			shaders[i] = NULL;
+		}
+	}
+
+	if (shader == this)
+	{
+		shader = NULL;
+	}
+}
+
+
+bool D3D9MeshShader::initialize(D3DXCOLOR ambient, D3DXCOLOR diffuse, D3DXVECTOR3 lightDirection, float fogStart, float fogEnd)
+{
+	D3DCAPS9 caps;
+	device->GetDeviceCaps(&caps);
+	if (caps.VertexShaderVersion < D3DVS_VERSION(2, 0))
+	{
+		return false;
+	}
+
+	// Stream frequencies only work from vs_3_0
+	bool instancing = caps.VertexShaderVersion >= D3DVS_VERSION(3, 0);
+	bool packing = (caps.DeclTypes & D3DDTCAPS_SHORT2N) && (caps.DeclTypes & D3DDTCAPS_SHORT4N);
+
+	for (int variant = 0; variant < MESH_SHADER_VARIANTS; variant++)
+	{
+		// Without either there's nothing the fixed function pipeline can't do
+		if (variant == 0 ||
+			((variant & MESH_SHADER_INSTANCED) && !instancing) ||
+			((variant & MESH_SHADER_PACKED) && !packing))
+		{
+			continue;
+		}
+
+		D3DXMACRO defines[3];
+		int count = 0;
+		if (variant & MESH_SHADER_INSTANCED)
+		{
+			defines[count].Name = "INSTANCED";
+			defines[count++].Definition = "1";
+		}
+		if (variant & MESH_SHADER_PACKED)
+		{
+			defines[count].Name = "PACKED";
+			defines[count++].Definition = "1";
+		}
+		defines[count].Name = NULL;
+		defines[count].Definition = NULL;
+
+		ID3DXBuffer* code = NULL;
+		if (FAILED(D3DXCompileShader(meshShader, strlen(meshShader), defines, NULL, "main",
+			(variant & MESH_SHADER_INSTANCED) ? "vs_3_0" : "vs_2_0", 0, &code, NULL, NULL)))
+		{
+			continue;
+		}
+
+		if (FAILED(device->CreateVertexShader((const DWORD*) code->GetBufferPointer(), &shaders[variant])))
+		{
+			shaders[variant] = NULL;
+		}
+		code->Release();
+	}
+
+	if (shaders[MESH_SHADER_PACKED])
+	{
+		D3DVERTEXELEMENT9 elements[] =
+		{
+			{ 0, 0, D3DDECLTYPE_SHORT4N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+			{ 0, 8, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+			{ 0, 12, D3DDECLTYPE_SHORT2N, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+			D3DDECL_END()
+		};
+
+		if (FAILED(device->CreateVertexDeclaration(elements, &packedDeclaration)))
+		{
+			packedDeclaration = NULL;
+		}
+	}
+
+	// The light points along its direction; the shader wants the way back to it
+	D3DXVECTOR4 towardsLight(-lightDirection.x, -lightDirection.y, -lightDirection.z, 0.0f);
+	D3DXVECTOR4 ambientColour(ambient.r, ambient.g, ambient.b, 1.0f);
+	D3DXVECTOR4 diffuseColour(diffuse.r, diffuse.g, diffuse.b, 0.0f);
+	D3DXVECTOR4 fog(fogStart, fogEnd, 0.0f, 0.0f);
+
+	device->SetVertexShaderConstantF(MESH_SHADER_LIGHT, (const float*) &towardsLight, 1);
+	device->SetVertexShaderConstantF(MESH_SHADER_AMBIENT, (const float*) &ambientColour, 1);
+	device->SetVertexShaderConstantF(MESH_SHADER_DIFFUSE, (const float*) &diffuseColour, 1);
+	device->SetVertexShaderConstantF(MESH_SHADER_FOG, (const float*) &fog, 1);
+
+	return true;
+}
+
+
+void D3D9MeshShader::setCamera(D3DXMATRIX* view, D3DXMATRIX* projection)
+{
+	// Registers hold columns
+	D3DXMATRIX viewProjection = *view * *projection;
+	D3DXMatrixTranspose(&viewProjection, &viewProjection);
+	D3DXVECTOR4 viewZ(view->_13, view->_23, view->_33, view->_43);
+
+	device->SetVertexShaderConstantF(MESH_SHADER_VIEW_PROJECTION, (const float*) &viewProjection, 4);
+	device->SetVertexShaderConstantF(MESH_SHADER_VIEW_Z, (const float*) &viewZ, 1);
+}
+
+
+void D3D9MeshShader::setWorld(const float* transform)
+{
+	float columns[12];
+	for (int c = 0; c < 3; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			columns[c * 4 + r] = transform[r * 4 + c];
+		}
+	}
+
+	device->SetVertexShaderConstantF(MESH_SHADER_WORLD, columns, 3);
+}
+
+
+void D3D9MeshShader::setQuantization(const float* constants)
+{
+	device->SetVertexShaderConstantF(MESH_SHADER_QUANTIZATION, constants, 3);
+}
+
+
+IDirect3DVertexShader9* D3D9MeshShader::getShader(int variant)
+{
+	return shaders[variant];
+}
+
+
+IDirect3DVertexDeclaration9* D3D9MeshShader::getPackedDeclaration()
+{
+	return packedDeclaration;
+}
+
+
+bool D3D9MeshShader::canDrawPacked()
+{
+	return shaders[MESH_SHADER_PACKED] && packedDeclaration;
+}
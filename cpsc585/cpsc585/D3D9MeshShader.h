@@ -0,0 +1,50 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+#include "VertexPacking.h"
+
+// Variants, as flags
+#define MESH_SHADER_INSTANCED	0x1		// World matrix columns and colour per instance on stream 1
+#define MESH_SHADER_PACKED		0x2		// PackedVertex on stream 0
+#define MESH_SHADER_VARIANTS	4
+
+// Constant registers, the same in every variant (the source spells them out)
+#define MESH_SHADER_VIEW_PROJECTION	0	// 4 registers
+#define MESH_SHADER_VIEW_Z			4
+#define MESH_SHADER_LIGHT			5
+#define MESH_SHADER_AMBIENT			6
+#define MESH_SHADER_DIFFUSE			7
+#define MESH_SHADER_FOG				8
+#define MESH_SHADER_WORLD			9	// 3 registers, columns; not instanced
+#define MESH_SHADER_QUANTIZATION	12	// 3 registers, VertexPacker::getShaderConstants(); packed
+
+
+// The vertex shader for meshes the fixed function pipeline can't draw:
+// instanced ones, and ones with packed vertices it can't read. It lights
+// and fogs like the fixed function light and material, so they look the
+// same as the rest. Variants the card can't run are left NULL, and the
+// meshes needing them are drawn the ordinary way.
+class D3D9MeshShader
+{
+public:
+	D3D9MeshShader(IDirect3DDevice9* device);
+	~D3D9MeshShader();
+
+	bool initialize(D3DXCOLOR ambient, D3DXCOLOR diffuse, D3DXVECTOR3 lightDirection, float fogStart, float fogEnd);
+	void setCamera(D3DXMATRIX* view, D3DXMATRIX* projection);
+	void setWorld(const float* transform);		// 4x4, D3D layout
+	void setQuantization(const float* constants);
+
+	IDirect3DVertexShader9* getShader(int variant);
+	IDirect3DVertexDeclaration9* getPackedDeclaration();	// Stream 0 only
+	bool canDrawPacked();
+
+	static D3D9MeshShader* shader;		// NULL without vs_2_0
+
+private:
+	IDirect3DDevice9* device;
+	IDirect3DVertexShader9* shaders[MESH_SHADER_VARIANTS];
+	IDirect3DVertexDeclaration9* packedDeclaration;
+};
@@ -0,0 +1,134 @@
+#include "D3D9ParticleRenderer.h"
+#include "StateCache.h"
+
+
+D3D9ParticleRenderer::D3D9ParticleRenderer(IDirect3DDevice9* device)
+{
+	this->device = device;
+	vertexBuffer = NULL;
+	indexBuffer = NULL;
+	vertices = NULL;
+	quadCount = 0;
+	dropped = 0;
+}
+
+
+D3D9ParticleRenderer::~D3D9ParticleRenderer()
+{
+	if (indexBuffer)
+	{
+		indexBuffer->Release();
+		indexBuffer = NULL;
+	}
+
+	if (vertexBuffer)
+	{
+		vertexBuffer->Release();
+		vertexBuffer = NULL;
+	}
+}
+
+
+bool D3D9ParticleRenderer::initialize()
+{
+	if (FAILED(device->CreateVertexBuffer(sizeof(ParticleVertex) * PARTICLE_MAX_QUADS * PARTICLE_VERTICES,
+		D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC, D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1, D3DPOOL_DEFAULT, &vertexBuffer, NULL)))
+	{
+		vertexBuffer = NULL;
+		return false;
+	}
+
+	if (FAILED(device->CreateIndexBuffer(sizeof(unsigned short) * PARTICLE_MAX_QUADS * PARTICLE_INDICES, D3DUSAGE_WRITEONLY,
+		D3DFMT_INDEX16, D3DPOOL_MANAGED, &indexBuffer, NULL)))
+	{
+		indexBuffer = NULL;
+		return false;
+	}
+
+	unsigned short* indices;
+	if (FAILED(indexBuffer->Lock(0, 0, (void**) &indices, 0)))
+	{
+		return false;
+	}
+
+	// Two clockwise triangles per quad, in the vertex order ParticlePool writes
+	for (int q = 0; q < PARTICLE_MAX_QUADS; q++)
+	{
+		unsigned short first = (unsigned short) (q * PARTICLE_VERTICES);
+		unsigned short* quad = &indices[q * PARTICLE_INDICES];
+		quad[0] = first;
+		quad[1] = first + 1;
+		quad[2] = first + 2;
+		quad[3] = first + 2;
+		quad[4] = first + 1;
+		quad[5] = first + 3;
+	}
+	indexBuffer->Unlock();
+
+	return true;
+}
+
+
+void D3D9ParticleRenderer::begin(const D3DXMATRIX* view)
+{
+	quadCount = 0;
+	dropped = 0;
+
+	if (!vertexBuffer || !indexBuffer ||
+		FAILED(vertexBuffer->Lock(0, 0, (void**) &vertices, D3DLOCK_DISCARD)))
+	{
+		vertices = NULL;
+		return;
+	}
+
+	// The camera's axes are the view matrix's columns
+	right[0] = view->_11;
+	right[1] = view->_21;
+	right[2] = view->_31;
+	up[0] = view->_12;
+	up[1] = view->_22;
+	up[2] = view->_32;
+}
+
+
+ParticleRange D3D9ParticleRenderer::add(const ParticlePool* pool)
+{
+	ParticleRange range = { quadCount, 0 };
+	if (!vertices)
+	{
+		return range;
+	}
+
+	range.count = pool->expand(&vertices[quadCount * PARTICLE_VERTICES], PARTICLE_MAX_QUADS - quadCount, right, up);
+	quadCount += range.count;
+	dropped += pool->count - range.count;
+
+	return range;
+}
+
+
+void D3D9ParticleRenderer::end()
+{
+	if (vertices)
+	{
+		vertexBuffer->Unlock();
+		vertices = NULL;
+	}
+}
+
+
+void D3D9ParticleRenderer::draw(ParticleRange range, IDirect3DTexture9* texture)
+{
+	if (range.count == 0)
+	{
+		return;
+	}
+
+	StateCache::cache->setTexture(0, texture);
+	StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(ParticleVertex));
+	StateCache::cache->setIndices(indexBuffer);
+	StateCache::cache->setFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+
+	device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, range.first * PARTICLE_VERTICES, 0, range.count * PARTICLE_VERTICES,
+		0, range.count * 2);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+#include "ParticlePool.h"
+
+#define PARTICLE_MAX_QUADS	8192	// Every particle system's together, per frame; anything past this isn't drawn
+
+
+// Where one pool's quads went in the shared buffer this frame
+struct ParticleRange
+{
+	int first;
+	int count;
+};
+
+// Billboards every particle pool into one dynamic vertex buffer, locked once a
+// frame, then draws each range with its own texture. Quads share a static index buffer.
+class D3D9ParticleRenderer
+{
+public:
+	D3D9ParticleRenderer(IDirect3DDevice9* device);
+	~D3D9ParticleRenderer();
+
+	bool initialize();
+
+	// The buffer is locked from begin to end; add every pool in between. If it
+	// can't be locked, every range comes back empty.
+	void begin(const D3DXMATRIX* view);
+	ParticleRange add(const ParticlePool* pool);
+	void end();
+
+	// Call with the world transform set to identity, and blending set up
+	void draw(ParticleRange range, IDirect3DTexture9* texture);
+
+private:
+	IDirect3DDevice9* device;
+	IDirect3DVertexBuffer9* vertexBuffer;
+	IDirect3DIndexBuffer9* indexBuffer;
+
+	ParticleVertex* vertices;		// While locked
+	int quadCount;
+	float right[3];
+	float up[3];
+
+public:
+	int dropped;		// Quads that didn't fit last frame
+};
@@ -0,0 +1,53 @@
+#include "D3D9StateDevice.h"
+
+
+D3D9StateDevice::D3D9StateDevice(IDirect3DDevice9* device)
+{
+	this->device = device;
+}
+
+
+void D3D9StateDevice::setRenderState(unsigned int state, unsigned int value)
+{
+	device->SetRenderState((D3DRENDERSTATETYPE) state, value);
+}
+
+void D3D9StateDevice::setSamplerState(unsigned int sampler, unsigned int type, unsigned int value)
+{
+	device->SetSamplerState(sampler, (D3DSAMPLERSTATETYPE) type, value);
+}
+
+void D3D9StateDevice::setTextureStageState(unsigned int stage, unsigned int type, unsigned int value)
+{
+	device->SetTextureStageState(stage, (D3DTEXTURESTAGESTATETYPE) type, value);
+}
+
+void D3D9StateDevice::setTexture(unsigned int stage, void* texture)
+{
+	device->SetTexture(stage, (IDirect3DBaseTexture9*) texture);
+}
+
+void D3D9StateDevice::setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride)
+{
+	device->SetStreamSource(stream, (IDirect3DVertexBuffer9*) buffer, offset, stride);
+}
+
+void D3D9StateDevice::setFVF(unsigned int fvf)
+{
+	device->SetFVF(fvf);
+}
+
+void D3D9StateDevice::setVertexDeclaration(void* declaration)
+{
+	device->SetVertexDeclaration((IDirect3DVertexDeclaration9*) declaration);
+}
+
+void D3D9StateDevice::setIndices(void* indices)
+{
+	device->SetIndices((IDirect3DIndexBuffer9*) indices);
+}
+
+void D3D9StateDevice::setTransform(unsigned int type, const float* matrix)
+{
+	device->SetTransform((D3DTRANSFORMSTATETYPE) type, (const D3DMATRIX*) matrix);
+}
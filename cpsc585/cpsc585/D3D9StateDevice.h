@@ -0,0 +1,26 @@
+#pragma once
+
+#include <d3d9.h>
+
+#include "StateDevice.h"
+
+
+// Forwards the StateCache's surviving sets to the device
+class D3D9StateDevice : public StateDevice
+{
+public:
+	D3D9StateDevice(IDirect3DDevice9* device);
+
+	void setRenderState(unsigned int state, unsigned int value);
+	void setSamplerState(unsigned int sampler, unsigned int type, unsigned int value);
+	void setTextureStageState(unsigned int stage, unsigned int type, unsigned int value);
+	void setTexture(unsigned int stage, void* texture);
+	void setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride);
+	void setFVF(unsigned int fvf);
+	void setVertexDeclaration(void* declaration);
+	void setIndices(void* indices);
+	void setTransform(unsigned int type, const float* matrix);
+
+private:
+	IDirect3DDevice9* device;
+};
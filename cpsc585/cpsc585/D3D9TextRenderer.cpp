@@ -0,0 +1,171 @@
+#include "D3D9TextRenderer.h"
+#include "StateCache.h"
+
+#include <string.h>
+
+
+D3D9TextRenderer::D3D9TextRenderer(IDirect3DDevice9* device)
+{
+	this->device = device;
+	atlas = NULL;
+	vertexBuffer = NULL;
+}
+
+
+D3D9TextRenderer::~D3D9TextRenderer()
+{
+	if (vertexBuffer)
+	{
+		vertexBuffer->Release();
+		vertexBuffer = NULL;
+	}
+
+	if (atlas)
+	{
+		atlas->Release();
+		atlas = NULL;
+	}
+}
+
+
+bool D3D9TextRenderer::initialize(TextBatch* batch, const char* fontName, int width, int weight)
+{
+	HDC dc = CreateCompatibleDC(NULL);
+	HFONT font = CreateFontA(0, width, 0, 0, weight, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+		CLIP_DEFAULT_PRECIS, DRAFT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, fontName);
+	HGDIOBJ oldFont = SelectObject(dc, font);
+
+	TEXTMETRIC metrics;
+	GetTextMetrics(dc, &metrics);
+
+	int widths[TEXT_CHAR_COUNT];
+	for (int c = 0; c < TEXT_CHAR_COUNT; c++)
+	{
+		char character = (char) (TEXT_FIRST_CHAR + c);
+		SIZE size;
+		GetTextExtentPoint32A(dc, &character, 1, &size);
+		widths[c] = size.cx;
+	}
+
+	bool packed = batch->packGlyphs(widths, metrics.tmHeight);
+
+	// White glyphs on black into a top down DIB, which becomes the alpha
+	unsigned int* bits = NULL;
+	HBITMAP bitmap = NULL;
+	HGDIOBJ oldBitmap = NULL;
+	if (packed)
+	{
+		BITMAPINFO info;
+		memset(&info, 0, sizeof(info));
+		info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		info.bmiHeader.biWidth = batch->atlasWidth;
+		info.bmiHeader.biHeight = -batch->atlasHeight;
+		info.bmiHeader.biPlanes = 1;
+		info.bmiHeader.biBitCount = 32;
+		info.bmiHeader.biCompression = BI_RGB;
+
+		bitmap = CreateDIBSection(dc, &info, DIB_RGB_COLORS, (void**) &bits, NULL, 0);
+	}
+
+	if (bitmap)
+	{
+		oldBitmap = SelectObject(dc, bitmap);
+		memset(bits, 0, batch->atlasWidth * batch->atlasHeight * 4);
+
+		SetTextColor(dc, RGB(255, 255, 255));
+		SetBkMode(dc, TRANSPARENT);
+		for (int c = 1; c < TEXT_CHAR_COUNT; c++)
+		{
+			char character = (char) (TEXT_FIRST_CHAR + c);
+			TextOutA(dc, batch->glyphX[c], batch->glyphY[c], &character, 1);
+		}
+		GdiFlush();
+
+		if (SUCCEEDED(device->CreateTexture(batch->atlasWidth, batch->atlasHeight, 1, 0, D3DFMT_A8R8G8B8,
+			D3DPOOL_MANAGED, &atlas, NULL)))
+		{
+			D3DLOCKED_RECT locked;
+			if (SUCCEEDED(atlas->LockRect(0, &locked, NULL, 0)))
+			{
+				for (int y = 0; y < batch->atlasHeight; y++)
+				{
+					unsigned int* row = (unsigned int*) ((char*) locked.pBits + y * locked.Pitch);
+					for (int x = 0; x < batch->atlasWidth; x++)
+					{
+						row[x] = ((bits[y * batch->atlasWidth + x] & 0xFF) << 24) | 0x00FFFFFF;
+					}
+				}
+				atlas->UnlockRect(0);
+			}
+		}
+		else
+		{
+			atlas = NULL;
+		}
+
+		SelectObject(dc, oldBitmap);
+		DeleteObject(bitmap);
+	}
+
+	SelectObject(dc, oldFont);
+	DeleteObject(font);
+	DeleteDC(dc);
+
+	if (!atlas)
+	{
+		return false;
+	}
+
+	if (FAILED(device->CreateVertexBuffer(sizeof(TextVertex) * TEXT_MAX_GLYPHS * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC,
+		D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1, D3DPOOL_DEFAULT, &vertexBuffer, NULL)))
+	{
+		vertexBuffer = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+
+void D3D9TextRenderer::draw(TextBatch* batch)
+{
+	int vertexCount = batch->getVertexCount();
+	if (!atlas || !vertexBuffer || vertexCount == 0)
+	{
+		return;
+	}
+
+	void* vertices;
+	if (FAILED(vertexBuffer->Lock(0, sizeof(TextVertex) * vertexCount, &vertices, D3DLOCK_DISCARD)))
+	{
+		return;
+	}
+	memcpy(vertices, batch->getVertices(), sizeof(TextVertex) * vertexCount);
+	vertexBuffer->Unlock();
+
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_FOGENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+
+	// Glyphs are drawn at their own size, texel for pixel
+	StateCache::cache->setSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+	StateCache::cache->setSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+
+	StateCache::cache->setTexture(0, atlas);
+	StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(TextVertex));
+	StateCache::cache->setFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+	device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, vertexCount / 3);
+
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
+}
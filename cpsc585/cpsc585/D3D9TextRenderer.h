@@ -0,0 +1,24 @@
+#pragma once
+
+#include <d3d9.h>
+
+#include "TextBatch.h"
+
+
+// Rasterizes a GDI font into TextBatch's glyph atlas and draws a whole batch
+// with one DrawPrimitive, in place of ID3DXFont's per-string draws.
+class D3D9TextRenderer
+{
+public:
+	D3D9TextRenderer(IDirect3DDevice9* device);
+	~D3D9TextRenderer();
+
+	// Width and weight as CreateFont takes them; the height is the font's own
+	bool initialize(TextBatch* batch, const char* fontName, int width, int weight);
+	void draw(TextBatch* batch);
+
+private:
+	IDirect3DDevice9* device;
+	IDirect3DTexture9* atlas;
+	IDirect3DVertexBuffer9* vertexBuffer;	// Room for TEXT_MAX_GLYPHS
+};
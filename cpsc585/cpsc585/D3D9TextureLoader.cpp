@@ -0,0 +1,29 @@
+#include "D3D9TextureLoader.h"
+
+
+D3D9TextureLoader::D3D9TextureLoader(IDirect3DDevice9* device)
+{
+	this->device = device;
+}
+
+
+void* D3D9TextureLoader::create(const std::string& path, const char* data, unsigned int size, const TextureInfo& info)
+{
+	IDirect3DTexture9* texture = NULL;
+
+	if (FAILED(D3DXCreateTextureFromFileInMemory(device, data, size, &texture)))
+	{
+		return NULL;
+	}
+
+	return texture;
+}
+
+
+void D3D9TextureLoader::destroy(void* texture)
+{
+	if (texture)
+	{
+		((IDirect3DTexture9*) texture)->Release();
+	}
+}
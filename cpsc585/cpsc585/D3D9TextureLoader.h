@@ -0,0 +1,20 @@
+#pragma once
+
+#include <d3d9.h>
+#include <d3dx9.h>
+
+#include "TextureLoader.h"
+
+
+// Creates IDirect3DTexture9s from files already read into memory
+class D3D9TextureLoader : public TextureLoader
+{
+public:
+	D3D9TextureLoader(IDirect3DDevice9* device);
+
+	void* create(const std::string& path, const char* data, unsigned int size, const TextureInfo& info);
+	void destroy(void* texture);
+
+private:
+	IDirect3DDevice9* device;
+};
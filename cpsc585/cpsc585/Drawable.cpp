@@ -1,15 +1,25 @@
 #include "Drawable.h"
 
-unsigned long** Drawable::racerConnectivityTable = NULL;
-unsigned long** Drawable::frontWheelConnectivityTable = NULL;
-unsigned long** Drawable::rearWheelConnectivityTable = NULL;
-unsigned long** Drawable::gunConnectivityTable = NULL;
-unsigned long** Drawable::gunMountConnectivityTable = NULL;
-
-
 Drawable::Drawable(void)
 {
 	texture = NULL;
+	cachedTexture = NULL;
+	mesh = NULL;
+	shadowVertexBuffer = NULL;
+	shadowVertCount = 0;
+	shadowPoints = NULL;
+	shadowFaceFlags = NULL;
+	shadowValid = false;
+	lod = 0;
+	shadowLod = 0;
+	shadowOwner = NULL;
+	shadowTier = SHADOW_TIER_VOLUME;
+	onGround = false;
+	groundPoint = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	groundNormal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+	D3DXMatrixIdentity(&renderTransform);
+	publishedTick = 0;
+	references = 1;
 }
 
 
@@ -19,612 +29,153 @@ Drawable::Drawable(MeshType type, std::string textureName, IDirect3DDevice9* dev
 	meshType = type;
 	shadowVertexBuffer = NULL;
 	shadowVertCount = 0;
-	initialize(type, textureName, device);
+	shadowPoints = NULL;
+	shadowFaceFlags = NULL;
+	shadowValid = false;
+	lod = 0;
+	shadowLod = 0;
+	shadowOwner = NULL;
+	shadowTier = SHADOW_TIER_VOLUME;
+	onGround = false;
+	groundPoint = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	groundNormal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+	D3DXMatrixIdentity(&renderTransform);
+	publishedTick = 0;
+	references = 1;
+	initialize(type, getMeshName(type), textureName, device);
+}
+
+
+Drawable::Drawable(std::string meshName, std::string textureName, IDirect3DDevice9* device)
+{
+	D3DXMatrixIdentity(&transform);
+	meshType = NAMEDMESH;
+	shadowVertexBuffer = NULL;
+	shadowVertCount = 0;
+	shadowPoints = NULL;
+	shadowFaceFlags = NULL;
+	shadowValid = false;
+	lod = 0;
+	shadowLod = 0;
+	shadowOwner = NULL;
+	shadowTier = SHADOW_TIER_VOLUME;
+	onGround = false;
+	groundPoint = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	groundNormal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+	D3DXMatrixIdentity(&renderTransform);
+	publishedTick = 0;
+	references = 1;
+	initialize(NAMEDMESH, meshName, textureName, device);
 }
 
 
 Drawable::~Drawable(void)
 {
-	if (texture)
+	// Textures are shared through the cache, which may already be gone at shutdown
+	if (cachedTexture)
+	{
+		if (TextureCache::cache)
+		{
+			TextureCache::cache->release(cachedTexture);
+		}
+		cachedTexture = NULL;
+		texture = NULL;
+	}
+	else if (texture)
 	{
 		texture->Release();
 		texture = NULL;
 	}
+
+	if (shadowVertexBuffer)
+	{
+		shadowVertexBuffer->Release();
+		shadowVertexBuffer = NULL;
+	}
+
+	if (shadowPoints)
+	{
+		delete [] shadowPoints;
+		shadowPoints = NULL;
+	}
+
+	if (shadowFaceFlags)
+	{
+		delete [] shadowFaceFlags;
+		shadowFaceFlags = NULL;
+	}
+
+	// The registry may already be gone at shutdown, and takes its meshes with it
+	if (mesh && MeshRegistry::registry)
+	{
+		MeshRegistry::registry->release(mesh);
+		mesh = NULL;
+	}
+}
+
+
+// Asset names of the built in mesh types (models/<name>.mesh)
+std::string Drawable::getMeshName(MeshType type)
+{
+	switch (type)
+	{
+	case RACER:			return "racer";
+	case WORLD:			return "world";
+	case FRONTWHEEL:	return "frontTire";
+	case REARWHEEL:		return "rearTire";
+	case WAYPOINT:		return "waypoint";
+	case ROCKETMESH:	return "rocket";
+	case LANDMINEMESH:	return "landmine";
+	case GUNMOUNTMESH:	return "gunmount";
+	case GUNMESH:		return "gun";
+	default:			return "";
+	}
 }
 
 
-void Drawable::initialize(MeshType type, std::string textureName, IDirect3DDevice9* device)
+void Drawable::initialize(MeshType type, std::string meshName, std::string textureName, IDirect3DDevice9* device)
 {
+	// Textures come from the cache when there is one, so each is only loaded once
+	cachedTexture = NULL;
 	texture = NULL;
+	if (TextureCache::cache)
+	{
+		cachedTexture = TextureCache::cache->acquire(textureName);
+		texture = (IDirect3DTexture9*) cachedTexture->texture;
+	}
+	else
+	{
+		texture = getTextureFromFile(device, textureName);
+	}
 
-	D3DXCreateTextureFromFile(device, textureName.c_str(), &texture);
+	mesh = MeshRegistry::registry->acquire(meshName);
 
 	switch (type)
 	{
 	case RACER:
-		{
-			mesh = RacerMesh::getInstance(device);
-
-			// Racers have shadows: set up vertex & index buffers
-			device->CreateVertexBuffer(sizeof(D3DXVECTOR3) * mesh->indexCount * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC, D3DFVF_XYZ,
-				D3DPOOL_DEFAULT, &shadowVertexBuffer, NULL);
-
-			if (!racerConnectivityTable)
-			{
-				int numFaces = mesh->indexCount / 3;
-				racerConnectivityTable = new unsigned long*[numFaces];
-
-				for (int i = 0; i < numFaces; i++)
-				{
-					racerConnectivityTable[i] = new unsigned long[3];
-					ZeroMemory(racerConnectivityTable[i], sizeof(unsigned long) * 3);
-				}
-
-				Vertex* vertices = mesh->vertices;
-				unsigned long* indices = mesh->indices;
-				unsigned long indexCount = mesh->indexCount;
-
-				unsigned long v0, v1, v2;
-
-				// Now set up connectivity table
-				// (MUCH faster than classical approach for stencil shadows!)
-
-				// For each triangle...
-				for (int i = 0; i < numFaces; i++)
-				{
-					// For each edge:
-					// Search index list. Add triangle index to connectivity table when the edge in reverse order is found
-					v0 = indices[i * 3];
-					v1 = indices[i * 3 + 1];
-					v2 = indices[i * 3 + 2];
-
-					// First edge = (v0, v1). Searching for (v1, v0) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-								{
-									racerConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-								{
-									racerConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v0].position)
-								{
-									racerConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-					// Second edge = (v1, v2). Searching for (v2, v1) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-								{
-									racerConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-								{
-									racerConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v1].position)
-								{
-									racerConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-					
-					// Third edge = (v2, v0). Searching for (v0, v2) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-								{
-									racerConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-								{
-									racerConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v2].position)
-								{
-									racerConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-				}
-			}
-
-			break;
-		}
-	case WORLD:
-		{
-			mesh = WorldMesh::getInstance(device);
-			break;
-		}
 	case FRONTWHEEL:
-		{
-			mesh = FrontWheelMesh::getInstance(device);
-			
-			// Wheels have shadows: set up vertex & index buffers
-			device->CreateVertexBuffer(sizeof(D3DXVECTOR3) * mesh->indexCount * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC, D3DFVF_XYZ,
-				D3DPOOL_DEFAULT, &shadowVertexBuffer, NULL);
-
-			if (!frontWheelConnectivityTable)
-			{
-				int numFaces = mesh->indexCount / 3;
-				frontWheelConnectivityTable = new unsigned long*[numFaces];
-
-				for (int i = 0; i < numFaces; i++)
-				{
-					frontWheelConnectivityTable[i] = new unsigned long[3];
-					ZeroMemory(frontWheelConnectivityTable[i], sizeof(unsigned long) * 3);
-				}
-
-				Vertex* vertices = mesh->vertices;
-				unsigned long* indices = mesh->indices;
-				unsigned long indexCount = mesh->indexCount;
-
-				unsigned long v0, v1, v2;
-
-				// Now set up connectivity table
-				// (MUCH faster than classical approach for stencil shadows!)
-
-				// For each triangle...
-				for (int i = 0; i < numFaces; i++)
-				{
-					if (i == 44)
-					{
-						int jkfldfjsd = 0;
-					}
-
-					// For each edge:
-					// Search index list. Add triangle index to connectivity table when the edge in reverse order is found
-					v0 = indices[i * 3];
-					v1 = indices[i * 3 + 1];
-					v2 = indices[i * 3 + 2];
-
-					// First edge = (v0, v1). Searching for (v1, v0) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-								{
-									frontWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-								{
-									frontWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v0].position)
-								{
-									frontWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-
-					// Second edge = (v1, v2). Searching for (v2, v1) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-								{
-									frontWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-								{
-									frontWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v1].position)
-								{
-									frontWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-					
-					// Third edge = (v2, v0). Searching for (v0, v2) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-								{
-									frontWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-								{
-									frontWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v2].position)
-								{
-									frontWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-				}
-			}
-
-			break;
-		}
 	case REARWHEEL:
-		{
-			mesh = RearWheelMesh::getInstance(device);
-			
-			// Wheels have shadows: set up vertex & index buffers
-			device->CreateVertexBuffer(sizeof(D3DXVECTOR3) * mesh->indexCount * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC, D3DFVF_XYZ,
-				D3DPOOL_DEFAULT, &shadowVertexBuffer, NULL);
-
-			if (!rearWheelConnectivityTable)
-			{
-				int numFaces = mesh->indexCount / 3;
-				rearWheelConnectivityTable = new unsigned long*[numFaces];
-
-				for (int i = 0; i < numFaces; i++)
-				{
-					rearWheelConnectivityTable[i] = new unsigned long[3];
-					ZeroMemory(rearWheelConnectivityTable[i], sizeof(unsigned long) * 3);
-				}
-
-				Vertex* vertices = mesh->vertices;
-				unsigned long* indices = mesh->indices;
-				unsigned long indexCount = mesh->indexCount;
-
-				unsigned long v0, v1, v2;
-
-				// Now set up connectivity table
-				// (MUCH faster than classical approach for stencil shadows!)
-
-				// For each triangle...
-				for (int i = 0; i < numFaces; i++)
-				{
-					// For each edge:
-					// Search index list. Add triangle index to connectivity table when the edge in reverse order is found
-					v0 = indices[i * 3];
-					v1 = indices[i * 3 + 1];
-					v2 = indices[i * 3 + 2];
-
-					// First edge = (v0, v1). Searching for (v1, v0) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-								{
-									rearWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-								{
-									rearWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v0].position)
-								{
-									rearWheelConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-					// Second edge = (v1, v2). Searching for (v2, v1) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-								{
-									rearWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-								{
-									rearWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v1].position)
-								{
-									rearWheelConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-					
-					// Third edge = (v2, v0). Searching for (v0, v2) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-								{
-									rearWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-								{
-									rearWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v2].position)
-								{
-									rearWheelConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-				}
-			}
-
-			break;
-		}
-	case WAYPOINT:
-		{
-			mesh = WaypointMesh::getInstance(device);
-			break;
-		}
-	case ROCKETMESH:
-		{
-			mesh = RocketMesh::getInstance(device);
-			break;
-		}
-	case LANDMINEMESH:
-		{
-			mesh = LandmineMesh::getInstance(device);
-			break;
-		}
-	case GUNMESH:
-		{
-			mesh = GunMesh::getInstance(device);
-			break;
-		}
 	case GUNMOUNTMESH:
 		{
-			mesh = GunMountMesh::getInstance(device);
-
+			// These have shadows: set up buffers for the extruded silhouette. The face
+			// normals and edge connectivity it is found with are shared through the mesh.
 			device->CreateVertexBuffer(sizeof(D3DXVECTOR3) * mesh->indexCount * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC, D3DFVF_XYZ,
 				D3DPOOL_DEFAULT, &shadowVertexBuffer, NULL);
 
-			if (!gunMountConnectivityTable)
+			ShadowSilhouette* silhouette = mesh->getSilhouette();
+			shadowPoints = new float[silhouette->getMaxPoints() * 3];
+			shadowFaceFlags = new unsigned char[silhouette->faceCount];
+
+			// The simplified levels cast from their own, smaller silhouettes; build
+			// them now while the CPU data is there and before extraction goes parallel
+			for (int i = 1; i < mesh->lodCount; i++)
 			{
-				int numFaces = mesh->indexCount / 3;
-				gunMountConnectivityTable = new unsigned long*[numFaces];
-
-				for (int i = 0; i < numFaces; i++)
-				{
-					gunMountConnectivityTable[i] = new unsigned long[3];
-					ZeroMemory(gunMountConnectivityTable[i], sizeof(unsigned long) * 3);
-				}
-				
-				Vertex* vertices = mesh->vertices;
-				unsigned long* indices = mesh->indices;
-				unsigned long indexCount = mesh->indexCount;
-
-				unsigned long v0, v1, v2;
-
-				// Now set up connectivity table
-				// (MUCH faster than classical approach for stencil shadows!)
-
-				// For each triangle...
-				for (int i = 0; i < numFaces; i++)
-				{
-					// For each edge:
-					// Search index list. Add triangle index to connectivity table when the edge in reverse order is found
-					v0 = indices[i * 3];
-					v1 = indices[i * 3 + 1];
-					v2 = indices[i * 3 + 2];
-
-					// First edge = (v0, v1). Searching for (v1, v0) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-								{
-									gunMountConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-								{
-									gunMountConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v0].position)
-								{
-									gunMountConnectivityTable[i][0] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-					// Second edge = (v1, v2). Searching for (v2, v1) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v1].position)
-								{
-									gunMountConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v1].position)
-								{
-									gunMountConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v1].position)
-								{
-									gunMountConnectivityTable[i][1] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-					
-					// Third edge = (v2, v0). Searching for (v0, v2) in index list
-					for (int j = 0; j < numFaces; j++)
-					{
-						if (j != i)
-						{
-							if (vertices[indices[j*3]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 1]].position == vertices[v2].position)
-								{
-									gunMountConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 1]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3 + 2]].position == vertices[v2].position)
-								{
-									gunMountConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-							else if (vertices[indices[j*3 + 2]].position == vertices[v0].position)
-							{
-								if (vertices[indices[j*3]].position == vertices[v2].position)
-								{
-									gunMountConnectivityTable[i][2] = (unsigned long) j;
-									break;
-								}
-							}
-						}
-					}
-
-				}
+				mesh->lods[i]->getSilhouette();
 			}
-
 			break;
 		}
 	default:
-		mesh = NULL;
+		break;
 	}
 
 }
@@ -652,10 +203,14 @@ void Drawable::setPosAndRot(float posX, float posY, float posZ,
 void Drawable::render(IDirect3DDevice9* device)
 {
 	// Apply transforms, THEN call render on the mesh
-	device->SetTransform(D3DTS_WORLD, &transform);
-	device->SetTexture(0, texture);
+	StateCache::cache->setTransform(D3DTS_WORLD, (const float*) &renderTransform);
+	StateCache::cache->setTexture(0, texture);
+	if (D3D9MeshShader::shader)
+	{
+		D3D9MeshShader::shader->setWorld((const float*) &renderTransform);
+	}
 
-	mesh->render(device);
+	getLodMesh()->render(device);
 }
 
 void Drawable::setTransform(D3DXMATRIX* input)
@@ -685,6 +240,21 @@ D3DXVECTOR3 Drawable::getPosition()
 	return D3DXVECTOR3(transform._41, transform._42, transform._43);
 }
 
+D3DXMATRIX* Drawable::getRenderTransform()
+{
+	return &renderTransform;
+}
+
+D3DXVECTOR3 Drawable::getRenderZVector()
+{
+	return D3DXVECTOR3(renderTransform._31, renderTransform._32, renderTransform._33);
+}
+
+D3DXVECTOR3 Drawable::getRenderPosition()
+{
+	return D3DXVECTOR3(renderTransform._41, renderTransform._42, renderTransform._43);
+}
+
 hkVector4 Drawable::getXhkVector()
 {
 	return hkVector4(transform._11, transform._12, transform._13);
@@ -722,39 +292,21 @@ IDirect3DTexture9* Drawable::getTextureFromFile(IDirect3DDevice9* device, std::s
 
 void Drawable::buildShadowVolume(D3DXVECTOR3 light)
 {
-	// Use connectivity table to determine silhouette edges
-	unsigned long** connectivityTable;
-
-	switch (meshType)
+	if (prepareShadowVolume(light))
 	{
-	case (RACER):
-		{
-			connectivityTable = racerConnectivityTable;
-			break;
-		}
-	case (FRONTWHEEL):
-		{
-			connectivityTable = frontWheelConnectivityTable;
-			break;
-		}
-	case (REARWHEEL):
-		{
-			connectivityTable = rearWheelConnectivityTable;
-			break;
-		}
-	case (GUNMOUNTMESH):
-		{
-			connectivityTable = gunMountConnectivityTable;
-			break;
-		}
-	default:
-		connectivityTable = racerConnectivityTable;
+		extractShadowVolume();
+		uploadShadowVolume();
 	}
+}
+
 
+bool Drawable::prepareShadowVolume(D3DXVECTOR3 light)
+{
+	// Bring the light into mesh space
 	D3DXMATRIX invTrans;
 	D3DXQUATERNION rot;
 	D3DXVECTOR3 scale, translate;
-	D3DXMatrixDecompose(&scale, &rot, &scale, &transform);
+	D3DXMatrixDecompose(&scale, &rot, &scale, &renderTransform);
 	D3DXQuaternionInverse(&rot, &rot);
 	D3DXVECTOR4 temp;
 	D3DXMatrixRotationQuaternion(&invTrans, &rot);
@@ -763,134 +315,120 @@ void Drawable::buildShadowVolume(D3DXVECTOR3 light)
 	light.y = -temp.y;
 	light.z = -temp.z;
 
-	Vertex* vertices = mesh->vertices;
-	unsigned long* indices = mesh->indices;
-	int vertexCount = mesh->vertexCount;
-	int indexCount = mesh->indexCount;
+	// Same orientation relative to the light and same level as last time: the old silhouette is still in the buffer
+	if (shadowValid && lod == shadowLod && fabs(light.x - shadowLight.x) < SHADOW_REUSE_TOLERANCE &&
+		fabs(light.y - shadowLight.y) < SHADOW_REUSE_TOLERANCE && fabs(light.z - shadowLight.z) < SHADOW_REUSE_TOLERANCE)
+	{
+		return false;
+	}
 
-	int numFaces = indexCount / 3;
+	shadowLight = light;
+	shadowLod = lod;
+	return true;
+}
 
-	unsigned long index0, index1, index2, neighbourTri;
 
+void Drawable::extractShadowVolume()
+{
+	// Use the mesh's face normals and connectivity to find the silhouette edges.
+	// Levels without CPU data to build one from fall back to the full mesh's.
+	ShadowSilhouette* silhouette = mesh->getLod(shadowLod)->silhouette;
+	if (!silhouette)
+	{
+		silhouette = mesh->silhouette;
+	}
+	shadowVertCount = silhouette->extract(&shadowLight.x, shadowPoints, shadowFaceFlags);
+}
 
-	D3DXVECTOR3* points;
-	int numVertices = 0;
-	D3DXVECTOR3 newV0, newV1;
-	D3DXVECTOR3 v0, v1, v2;
-	D3DXVECTOR3 norm;
 
+void Drawable::uploadShadowVolume()
+{
+	D3DXVECTOR3* points;
 
-	shadowVertexBuffer->Lock(0, sizeof(D3DXVECTOR3) * mesh->indexCount * 6, (void**) &points, NULL);
-	
-	for (int i = 0; i < numFaces; i++)
+	if (SUCCEEDED(shadowVertexBuffer->Lock(0, sizeof(D3DXVECTOR3) * shadowVertCount, (void**) &points, D3DLOCK_DISCARD)))
 	{
-		index0 = indices[3*i];
-		index1 = indices[3*i+1];
-		index2 = indices[3*i+2];
+		memcpy(points, shadowPoints, sizeof(D3DXVECTOR3) * shadowVertCount);
+		shadowVertexBuffer->Unlock();
+		shadowValid = true;
+	}
+}
 
-		norm = vertices[index0].normal + vertices[index1].normal + vertices[index2].normal;
-		norm /= 3.0f;
 
-		// The current face is lit. Must check neighbours now
-		if (D3DXVec3Dot(&norm, &light) > 0.0f)
-		{
-			v0 = vertices[index0].position;
-			v1 = vertices[index1].position;
-			v2 = vertices[index2].position;
-			
-			// For each edge, check if neighbour tri is lit. If it's not, add this edge
-
-			// EDGE 0
-			neighbourTri = connectivityTable[i][0];
-			index0 = indices[3*neighbourTri];
-			index1 = indices[3*neighbourTri+1];
-			index2 = indices[3*neighbourTri+2];
-
-			norm = vertices[index0].normal + vertices[index1].normal + vertices[index2].normal;
-			norm /= 3.0f;
-			
-			if (D3DXVec3Dot(&norm, &light) < 0.0f)
-			{
-				// Neighbour is not lit! Add this edge!
-				newV0 = v0 - light*200;
-				newV1 = v1 - light*200;
-
-				points[numVertices++] = v1;
-				points[numVertices++] = v0;
-				points[numVertices++] = newV0;
-				
-				points[numVertices++] = newV0;
-				points[numVertices++] = newV1;
-				points[numVertices++] = v1;
+void Drawable::renderShadowVolume(IDirect3DDevice9* device)
+{
+	StateCache::cache->setTransform(D3DTS_WORLD, (const float*) &renderTransform);
+	bindShadowVolume(device);
+	drawShadowVolume(device);
+}
 
-			}
-			
-			// EDGE 1
-			neighbourTri = connectivityTable[i][1];
-			index0 = indices[3*neighbourTri];
-			index1 = indices[3*neighbourTri+1];
-			index2 = indices[3*neighbourTri+2];
-
-			norm = vertices[index0].normal + vertices[index1].normal + vertices[index2].normal;
-			norm /= 3.0f;
-			
-			if (D3DXVec3Dot(&norm, &light) < 0.0f)
-			{
-				// Neighbour is not lit! Add this edge!
-				newV0 = v1 - light*200;
-				newV1 = v2 - light*200;
-
-				points[numVertices++] = v2;
-				points[numVertices++] = v1;
-				points[numVertices++] = newV0;
-				
-				points[numVertices++] = newV0;
-				points[numVertices++] = newV1;
-				points[numVertices++] = v2;
-			}
+void Drawable::bindShadowVolume(IDirect3DDevice9* device)
+{
+	StateCache::cache->setStreamSource(0, shadowVertexBuffer, 0, sizeof(D3DXVECTOR3));
+	StateCache::cache->setFVF(D3DFVF_XYZ);
+}
 
-			// EDGE 2
-			neighbourTri = connectivityTable[i][2];
-			index0 = indices[3*neighbourTri];
-			index1 = indices[3*neighbourTri+1];
-			index2 = indices[3*neighbourTri+2];
+void Drawable::drawShadowVolume(IDirect3DDevice9* device)
+{
+	device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, shadowVertCount / 3);
+}
 
-			norm = vertices[index0].normal + vertices[index1].normal + vertices[index2].normal;
-			norm /= 3.0f;
-			
-			if (D3DXVec3Dot(&norm, &light) < 0.0f)
-			{
-				// Neighbour is not lit! Add this edge!
-				newV0 = v2 - light*200;
-				newV1 = v0 - light*200;
-
-				points[numVertices++] = v0;
-				points[numVertices++] = v2;
-				points[numVertices++] = newV0;
-				
-				points[numVertices++] = newV0;
-				points[numVertices++] = newV1;
-				points[numVertices++] = v0;
-			}
-			
-		}
-	}
-	
-	shadowVertexBuffer->Unlock();
+bool Drawable::hasShadowVolume()
+{
+	return shadowVertexBuffer != NULL;
+}
 
-	shadowVertCount = numVertices;
+D3DXMATRIX* Drawable::getTransform()
+{
+	return &transform;
 }
 
+void Drawable::getBoundingSphere(D3DXVECTOR3& center, float& radius)
+{
+	D3DXVec3TransformCoord(&center, &mesh->boundsCenter, &renderTransform);
 
-void Drawable::renderShadowVolume(IDirect3DDevice9* device)
+	// Grow the radius by the largest scale in the transform
+	D3DXVECTOR3 axisX(renderTransform._11, renderTransform._12, renderTransform._13);
+	D3DXVECTOR3 axisY(renderTransform._21, renderTransform._22, renderTransform._23);
+	D3DXVECTOR3 axisZ(renderTransform._31, renderTransform._32, renderTransform._33);
+
+	float scale = D3DXVec3LengthSq(&axisX);
+	if (D3DXVec3LengthSq(&axisY) > scale) scale = D3DXVec3LengthSq(&axisY);
+	if (D3DXVec3LengthSq(&axisZ) > scale) scale = D3DXVec3LengthSq(&axisZ);
+
+	radius = mesh->boundsRadius * sqrt(scale);
+}
+
+int Drawable::updateLod(float screenSize)
 {
-	device->SetTransform(D3DTS_WORLD, &transform);
-	device->SetStreamSource(0, shadowVertexBuffer, 0, sizeof(D3DXVECTOR3));
-	device->SetFVF(D3DFVF_XYZ);
-	device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, shadowVertCount / 3);
+	lod = selectLod(mesh->lodErrors, mesh->lodCount, screenSize, lod);
+	return lod;
 }
 
-D3DXMATRIX* Drawable::getTransform()
+Mesh* Drawable::getLodMesh()
 {
-	return &transform;
+	return mesh->getLod(lod);
+}
+
+void Drawable::setGround(bool onGround, D3DXVECTOR3 point, D3DXVECTOR3 normal)
+{
+	this->onGround = onGround;
+	if (onGround)
+	{
+		groundPoint = point;
+		groundNormal = normal;
+	}
+}
+
+void Drawable::addReference()
+{
+	references++;
+}
+
+void Drawable::removeReference()
+{
+	references--;
+	if (references == 0)
+	{
+		delete this;
+	}
 }
\ No newline at end of file
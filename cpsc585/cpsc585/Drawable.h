@@ -6,27 +6,26 @@
 #include "Physics.h"
 
 #include "Mesh.h"
-#include "RacerMesh.h"
-#include "WorldMesh.h"
-#include "FrontWheelMesh.h"
-#include "RearWheelMesh.h"
-#include "WaypointMesh.h"
-#include "RocketMesh.h"
-#include "LandmineMesh.h"
-#include "GunMesh.h"
-#include "GunMountMesh.h"
+#include "MeshRegistry.h"
+#include "ShadowTiers.h"
+#include "TextureCache.h"
 
 #include <string>
 
+// A caster whose mesh space light direction moved less than this (per component)
+// keeps its last silhouette
+#define SHADOW_REUSE_TOLERANCE 0.0001f
+
 
 enum MeshType { RACER, TRAFFIC, WORLD, FRONTWHEEL, REARWHEEL, WAYPOINT, ROCKETMESH, LANDMINEMESH,
-	GUNMOUNTMESH, GUNMESH };
+	GUNMOUNTMESH, GUNMESH, NAMEDMESH };
 
 class Drawable
 {
 public:
 	Drawable(void);
 	Drawable(MeshType type, std::string textureName, IDirect3DDevice9* device);
+	Drawable(std::string meshName, std::string textureName, IDirect3DDevice9* device);	// Any model in models/
 	virtual ~Drawable();
 	virtual void render(IDirect3DDevice9* device);
 	void setPosAndRot(float posX, float posY, float posZ,
@@ -38,26 +37,67 @@ public:
 	D3DXVECTOR3 getZVector();
 	D3DXVECTOR3 getPosition();
 
+	// Where the renderer draws it, between the last two published ticks;
+	// everything on the render side uses these instead
+	D3DXMATRIX* getRenderTransform();
+	D3DXVECTOR3 getRenderZVector();
+	D3DXVECTOR3 getRenderPosition();
+
 	hkVector4 getXhkVector();
 	hkVector4 getYhkVector();
 	hkVector4 getZhkVector();
 
 	IDirect3DTexture9* getTexture();
-	void setTexture(IDirect3DTexture9* tex);
+	void setTexture(IDirect3DTexture9* tex);	// Not owned; the cached texture is still released on destruction
 	IDirect3DTexture9* getTextureFromFile(IDirect3DDevice9* device, std::string textureName);
 
-	void buildShadowVolume(D3DXVECTOR3 light);
+	void buildShadowVolume(D3DXVECTOR3 light);		// prepare, extract and upload in one go
+	bool prepareShadowVolume(D3DXVECTOR3 light);	// False when the last silhouette still holds
+	void extractShadowVolume();						// CPU only, safe to run for several casters at once
+	void uploadShadowVolume();
 	void renderShadowVolume(IDirect3DDevice9* device);
+	void bindShadowVolume(IDirect3DDevice9* device);
+	void drawShadowVolume(IDirect3DDevice9* device);
 
 	D3DXMATRIX* getTransform();
+	bool hasShadowVolume();
+	void getBoundingSphere(D3DXVECTOR3& center, float& radius);	// World space, for culling
+
+	// screenSize is the projected radius of the bounding sphere in pixels; returns the level picked
+	int updateLod(float screenSize);
+	Mesh* getLodMesh();		// The level picked by the last updateLod
+
+	void setGround(bool onGround, D3DXVECTOR3 point, D3DXVECTOR3 normal);	// For its blob shadow
+
+	// Starts at 1 for whoever made it, and the renderer's transform snapshot holds one
+	// per frame it is in, so give it up with removeReference instead of deleting it.
+	// Only the simulation side takes and gives them up.
+	void addReference();
+	void removeReference();		// Deletes it at 0
 
 private:
-	void initialize(MeshType type, std::string textureName, IDirect3DDevice9* device);
+	void initialize(MeshType type, std::string meshName, std::string textureName, IDirect3DDevice9* device);
+	static std::string getMeshName(MeshType type);
 
 
 public:
 	Mesh* mesh;
 	MeshType meshType;
+
+	// Casters that are parts of another (wheels, gun mounts) take its shadow tier; NULL otherwise
+	Drawable* shadowOwner;
+	unsigned char shadowTier;		// SHADOW_TIER_*, picked by the Renderer each frame
+
+	// Under it, from the last ground query; only racers set them. The renderer
+	// reads the copies published with its transform instead.
+	bool onGround;
+	D3DXVECTOR3 groundPoint;
+	D3DXVECTOR3 groundNormal;
+
+	// Set by the Renderer: its transform at the last tick it was published for (0 for never)
+	D3DXMATRIX publishedTransform;
+	unsigned int publishedTick;
+	D3DXMATRIX renderTransform;
 	
 
 protected:
@@ -65,13 +105,18 @@ protected:
 
 private:
 	IDirect3DTexture9* texture;
+	CachedTexture* cachedTexture;
 
 	IDirect3DVertexBuffer9* shadowVertexBuffer;
 	int shadowVertCount;
-	
-	static unsigned long** racerConnectivityTable; // Array, access with Table[triangleIndex][edge#], returns new triangle index
-	static unsigned long** frontWheelConnectivityTable;
-	static unsigned long** rearWheelConnectivityTable;
-	static unsigned long** gunConnectivityTable;
-	static unsigned long** gunMountConnectivityTable;
+
+	float* shadowPoints;				// CPU copy of the silhouette, xyz per vertex
+	unsigned char* shadowFaceFlags;
+	D3DXVECTOR3 shadowLight;			// Mesh space light the silhouette was extracted for
+	int shadowLod;						// And the level it came from
+	bool shadowValid;
+
+	int lod;
+
+	int references;
 };
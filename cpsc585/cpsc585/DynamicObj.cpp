@@ -3,7 +3,9 @@
 
 DynamicObj::DynamicObj(void)
 {
-	
+	destroyed = false;
+	handle = 0;
+	drawable = NULL;
 }
 
 
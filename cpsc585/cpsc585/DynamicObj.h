@@ -10,6 +10,7 @@ public:
 	virtual ~DynamicObj(void);
 	virtual void update(float seconds) = 0;
 	bool destroyed;
+	unsigned int handle;	// In DynamicObjManager's pool for its kind
 
 	Drawable* drawable;
 };
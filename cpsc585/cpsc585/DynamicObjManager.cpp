@@ -1,12 +1,23 @@
 #include "DynamicObjManager.h"
+#include "Rocket.h"
+#include "Landmine.h"
 
 DynamicObjManager* DynamicObjManager::manager = NULL;
 
+static void updateObject(DynamicObj* object, float seconds)
+{
+	if (!object->destroyed)
+	{
+		Renderer::renderer->addDynamicDrawable(object->drawable);
+		object->update(seconds);
+	}
+}
+
+
 DynamicObjManager::DynamicObjManager()
 {
-	objList = NULL;
-	objList = new std::list<DynamicObj*>();
-	objList->clear();
+	rockets = new HandlePool<Rocket>(MAX_ROCKETS);
+	landmines = new HandlePool<Landmine>(MAX_LANDMINES);
 	manager = this;
 }
 
@@ -15,51 +26,88 @@ DynamicObjManager::~DynamicObjManager()
 {
 	manager = NULL;
 
-	if (objList)
+	if (rockets)
 	{
-		objList->clear();
-		delete objList;
+		delete rockets;
+		rockets = NULL;
 	}
+
+	if (landmines)
+	{
+		delete landmines;
+		landmines = NULL;
+	}
+}
+
+
+Rocket* DynamicObjManager::addRocket(Racer* owner)
+{
+	unsigned int handle;
+	void* memory = rockets->allocate(handle);
+	if (!memory)
+		return NULL;
+
+	return new (memory) Rocket(Renderer::device, owner, handle);
+}
+
+
+Landmine* DynamicObjManager::addLandmine()
+{
+	unsigned int handle;
+	void* memory = landmines->allocate(handle);
+	if (!memory)
+		return NULL;
+
+	return new (memory) Landmine(Renderer::device, handle);
+}
+
+
+Rocket* DynamicObjManager::getRocket(unsigned int handle)
+{
+	return rockets->get(handle);
+}
+
+
+Landmine* DynamicObjManager::getLandmine(unsigned int handle)
+{
+	return landmines->get(handle);
 }
 
 
 void DynamicObjManager::update(float seconds)
 {
-	if (!(objList->empty()))
+	for (int i = 0; i < rockets->count; i++)
 	{
-		std::list<DynamicObj*>::iterator iter = objList->begin();
-		
-		DynamicObj* currentObj = NULL;
+		updateObject(rockets->at(i), seconds);
+	}
 
-		while (iter != objList->end())
-		{
-			currentObj = (*iter);
-
-			if (currentObj && currentObj->destroyed)
-			{
-				delete currentObj;
-				iter = objList->erase(iter);
-			}
-			else if (currentObj && !(currentObj->destroyed))
-			{
-				Renderer::renderer->addDynamicDrawable(currentObj->drawable);
-				currentObj->update(seconds);
-
-				++iter;
-			}
-			else
-			{
-				++iter;
-			}
-		}
+	for (int i = 0; i < landmines->count; i++)
+	{
+		updateObject(landmines->at(i), seconds);
 	}
 }
 
 
-void DynamicObjManager::addObject(DynamicObj* object)
+// Before the tick's transforms are published, so anything destroyed is taken
+// out of the renderer's list for the tick first. Backwards, so whatever a
+// release swaps into place has already been looked at.
+void DynamicObjManager::endFrame()
 {
-	if (!object)
-		return;
+	for (int i = rockets->count - 1; i >= 0; i--)
+	{
+		if (rockets->at(i)->destroyed)
+		{
+			Renderer::renderer->removeDynamicDrawable(rockets->at(i)->drawable);
+			rockets->release(rockets->handleAt(i));
+		}
+	}
 
-	objList->push_back(object);
+	for (int i = landmines->count - 1; i >= 0; i--)
+	{
+		if (landmines->at(i)->destroyed)
+		{
+			Renderer::renderer->removeDynamicDrawable(landmines->at(i)->drawable);
+			landmines->release(landmines->handleAt(i));
+		}
+	}
 }
@@ -1,18 +1,41 @@
 #pragma once
 
-#include <list>
 #include "DynamicObj.h"
+#include "HandlePool.h"
 #include "Renderer.h"
 
+#define MAX_ROCKETS 128
+#define MAX_LANDMINES 128
+
+class Racer;
+class Rocket;
+class Landmine;
+
+// Rockets and landmines, each kind in its own HandlePool. Objects mark
+// themselves destroyed whenever they like; they are only released at
+// endFrame, which also takes their drawables back out of the renderer's list
+// for the tick. Their Drawables live on while a published tick still has them.
+// Anything that holds on to one past the frame (their contact listeners, the
+// landmine's body) keeps its handle and looks it up again.
 class DynamicObjManager
 {
 public:
 	DynamicObjManager(void);
 	~DynamicObjManager(void);
-	void addObject(DynamicObj* object);
+
+	// NULL when the pool is full
+	Rocket* addRocket(Racer* owner);
+	Landmine* addLandmine();
+
+	// NULL once the object has been released
+	Rocket* getRocket(unsigned int handle);
+	Landmine* getLandmine(unsigned int handle);
+
 	void update(float seconds);
+	void endFrame();
 
 	static DynamicObjManager* manager;
 private:
-	std::list<DynamicObj*>* objList;
+	HandlePool<Rocket>* rockets;
+	HandlePool<Landmine>* landmines;
 };
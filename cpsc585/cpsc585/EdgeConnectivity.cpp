@@ -0,0 +1,246 @@
+#include "EdgeConnectivity.h"
+
+#include <math.h>
+#include <string.h>
+
+
+static unsigned int hashInts(unsigned int a, unsigned int b, unsigned int c)
+{
+	unsigned int h = a * 0x8DA6B343u ^ b * 0xD8163841u ^ c * 0xCB1AB31Fu;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+// Power of two at least twice count, so the tables stay at most half full
+static unsigned int tableSize(int count)
+{
+	unsigned int size = 16;
+	while (size < (unsigned int) count * 2)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+// Bit pattern of a float, with -0 folded into 0 so they weld like == does
+static int floatKey(float value)
+{
+	if (value == 0.0f)
+	{
+		return 0;
+	}
+
+	int key;
+	memcpy(&key, &value, sizeof(key));
+	return key;
+}
+
+
+EdgeConnectivity::EdgeConnectivity()
+{
+	weldedVertexCount = 0;
+	uniqueEdgeCount = 0;
+	openEdgeCount = 0;
+}
+
+
+int EdgeConnectivity::findCell(int x, int y, int z)
+{
+	unsigned int mask = cells.size() - 1;
+	unsigned int slot = hashInts(x, y, z) & mask;
+
+	while (cells[slot].first != -1)
+	{
+		if (cells[slot].x == x && cells[slot].y == y && cells[slot].z == z)
+		{
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+
+int EdgeConnectivity::findEdge(unsigned int low, unsigned int high)
+{
+	unsigned int mask = edges.size() - 1;
+	unsigned int slot = hashInts(low, high, 0) & mask;
+
+	while (edges[slot].first != -1)
+	{
+		if (edges[slot].low == low && edges[slot].high == high)
+		{
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+
+void EdgeConnectivity::weld(const float* vertexData, int stride, int numVertices, float weldDistance)
+{
+	Cell empty = { 0, 0, 0, -1 };
+	cells.assign(tableSize(numVertices), empty);
+	nextInCell.resize(numVertices);
+	weldedPositions.resize(numVertices * 3);
+	welded.resize(numVertices);
+	weldedVertexCount = 0;
+
+	bool exact = weldDistance <= 0.0f;
+	float weldSquared = weldDistance * weldDistance;
+
+	for (int i = 0; i < numVertices; i++)
+	{
+		const float* p = &vertexData[i * stride];
+
+		int cx, cy, cz;
+		if (exact)
+		{
+			cx = floatKey(p[0]);
+			cy = floatKey(p[1]);
+			cz = floatKey(p[2]);
+		}
+		else
+		{
+			cx = (int) floor(p[0] / weldDistance);
+			cy = (int) floor(p[1] / weldDistance);
+			cz = (int) floor(p[2] / weldDistance);
+		}
+
+		// Look for an existing vertex close enough. With a grid the size of the weld
+		// distance it can only be in this cell or one of its neighbours.
+		int match = -1;
+		int range = exact ? 0 : 1;
+		for (int dx = -range; dx <= range && match == -1; dx++)
+		{
+			for (int dy = -range; dy <= range && match == -1; dy++)
+			{
+				for (int dz = -range; dz <= range && match == -1; dz++)
+				{
+					int slot = findCell(cx + dx, cy + dy, cz + dz);
+
+					for (int v = cells[slot].first; v != -1; v = nextInCell[v])
+					{
+						const float* q = &weldedPositions[v * 3];
+						if (exact)
+						{
+							if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2])
+							{
+								match = v;
+								break;
+							}
+						}
+						else
+						{
+							float x = p[0] - q[0], y = p[1] - q[1], z = p[2] - q[2];
+							if (x * x + y * y + z * z <= weldSquared)
+							{
+								match = v;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (match == -1)
+		{
+			match = weldedVertexCount++;
+			weldedPositions[match * 3] = p[0];
+			weldedPositions[match * 3 + 1] = p[1];
+			weldedPositions[match * 3 + 2] = p[2];
+
+			int slot = findCell(cx, cy, cz);
+			if (cells[slot].first == -1)
+			{
+				cells[slot].x = cx;
+				cells[slot].y = cy;
+				cells[slot].z = cz;
+			}
+			nextInCell[match] = cells[slot].first;
+			cells[slot].first = match;
+		}
+
+		welded[i] = match;
+	}
+}
+
+
+void EdgeConnectivity::build(const float* vertexData, int stride, int numVertices,
+	const unsigned int* indexData, int numIndices, float weldDistance, unsigned int* adjacency)
+{
+	int numFaces = numIndices / 3;
+
+	weld(vertexData, stride, numVertices, weldDistance);
+
+	// Bucket every half edge under its sorted vertex pair. Faces go in in order
+	// and are appended, so each bucket lists its faces lowest first.
+	Edge empty = { 0, 0, -1, -1 };
+	edges.assign(tableSize(numFaces * 3), empty);
+	nextHalfEdge.resize(numFaces * 3);
+	uniqueEdgeCount = 0;
+
+	for (int h = 0; h < numFaces * 3; h++)
+	{
+		unsigned int from = welded[indexData[h]];
+		unsigned int to = welded[indexData[h - h % 3 + (h + 1) % 3]];
+		unsigned int low = from < to ? from : to;
+		unsigned int high = from < to ? to : from;
+
+		int slot = findEdge(low, high);
+		nextHalfEdge[h] = -1;
+		if (edges[slot].first == -1)
+		{
+			edges[slot].low = low;
+			edges[slot].high = high;
+			edges[slot].first = h;
+			uniqueEdgeCount++;
+		}
+		else
+		{
+			nextHalfEdge[edges[slot].last] = h;
+		}
+		edges[slot].last = h;
+	}
+
+	// The neighbour across (from, to) is the first other face running (to, from)
+	openEdgeCount = 0;
+
+	for (int h = 0; h < numFaces * 3; h++)
+	{
+		int face = h / 3;
+		unsigned int from = welded[indexData[h]];
+		unsigned int to = welded[indexData[h - h % 3 + (h + 1) % 3]];
+		unsigned int low = from < to ? from : to;
+		unsigned int high = from < to ? to : from;
+
+		adjacency[h] = EDGE_NO_NEIGHBOUR;
+
+		for (int other = edges[findEdge(low, high)].first; other != -1; other = nextHalfEdge[other])
+		{
+			if (other / 3 == face)
+			{
+				continue;
+			}
+
+			unsigned int otherFrom = welded[indexData[other]];
+			unsigned int otherTo = welded[indexData[other - other % 3 + (other + 1) % 3]];
+			if (otherFrom == to && otherTo == from)
+			{
+				adjacency[h] = other / 3;
+				break;
+			}
+		}
+
+		if (adjacency[h] == EDGE_NO_NEIGHBOUR)
+		{
+			openEdgeCount++;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#define EDGE_NO_NEIGHBOUR	0xFFFFFFFF
+
+// Finds the face across every edge of an indexed triangle list in O(F).
+// Positions within weldDistance of each other count as the same corner, so
+// split vertices (seams in normals/uvs) still connect. The result matches
+// the old pairwise search: for face f and edge (a, b), the lowest numbered
+// other face that has the edge (b, a), or EDGE_NO_NEIGHBOUR.
+class EdgeConnectivity
+{
+public:
+	EdgeConnectivity();
+
+	// Positions are the first three floats of every vertex; stride is in floats.
+	// adjacency must hold numIndices entries (3 per face, edge e runs from corner e to e+1).
+	void build(const float* vertexData, int stride, int numVertices,
+		const unsigned int* indexData, int numIndices, float weldDistance, unsigned int* adjacency);
+
+private:
+	struct Cell
+	{
+		int x, y, z;
+		int first;			// First welded vertex in this cell, -1 when the slot is empty
+	};
+
+	struct Edge
+	{
+		unsigned int low, high;		// Welded vertex ids, sorted
+		int first, last;			// Half edges using this edge, in face order; -1 when empty
+	};
+
+	void weld(const float* vertexData, int stride, int numVertices, float weldDistance);
+	int findCell(int x, int y, int z);
+	int findEdge(unsigned int low, unsigned int high);
+
+	// Reused between builds
+	std::vector<Cell> cells;
+	std::vector<int> nextInCell;
+	std::vector<float> weldedPositions;
+	std::vector<unsigned int> welded;		// Vertex -> welded id
+
+	std::vector<Edge> edges;
+	std::vector<int> nextHalfEdge;
+
+public:
+	// Stats from the last build
+	int weldedVertexCount;
+	int uniqueEdgeCount;
+	int openEdgeCount;
+};
@@ -1,6 +1,9 @@
 #include "Explosion.h"
 #include "Landmine.h"
 
+hkpShape* Explosion::blastShape = NULL;
+hkpShapePhantom* Explosion::blastPhantom = NULL;
+
 Explosion::Explosion(hkTransform* trans, Racer* owns)
 {
 	owner = owns;
@@ -15,10 +18,33 @@ Explosion::~Explosion(void)
 }
 
 
+void Explosion::shutdown()
+{
+	if (blastPhantom)
+	{
+		blastPhantom->removeReference();
+		blastPhantom = NULL;
+	}
+
+	if (blastShape)
+	{
+		blastShape->removeReference();
+		blastShape = NULL;
+	}
+}
+
+
 void Explosion::doDamage()
 {
-	hkpShape* blastShape =  new hkpSphereShape(BLAST_RADIUS);
-	hkpShapePhantom* blastPhantom = new hkpSimpleShapePhantom(blastShape, *transform);
+	if (!blastPhantom)
+	{
+		blastShape = new hkpSphereShape(BLAST_RADIUS);
+		blastPhantom = new hkpSimpleShapePhantom(blastShape, *transform);
+	}
+	else
+	{
+		blastPhantom->setTransform(*transform);
+	}
 
 	hkpCollisionInput inp = *(Physics::world->getCollisionInput());
 	inp.setTolerance(BLAST_RADIUS);
@@ -27,13 +53,12 @@ void Explosion::doDamage()
 	
 	Physics::world->getPenetrations(blastPhantom->getCollidable(), inp, collector);
 
-	hkArray<hkpRootCdBodyPair> hits;
-	hits = collector.getHits();
+	const hkArray<hkpRootCdBodyPair>& hits = collector.getHits();
 	
 	hkpRigidBody* body;
 	Racer* racer;
 
-	hkArrayBase<hkpRootCdBodyPair>::iterator iter = hits.begin();
+	hkArrayBase<hkpRootCdBodyPair>::const_iterator iter = hits.begin();
 
 	hkVector4 pos, racerPos;
 	pos.set(0, -3.0, 0);
@@ -99,13 +124,14 @@ void Explosion::doDamage()
 				}
 			}
 		}
-		else if (((hkpRigidBody*) iter->m_rootCollidableB->getOwner())->getProperty(1).getPtr())
+		else
 		{
+			// Landmines keep their handle on their body; NULL for anything else
 			body = (hkpRigidBody*) iter->m_rootCollidableB->getOwner();
 			Landmine* mine;
-			mine = (Landmine*) body->getProperty(1).getPtr();
+			mine = DynamicObjManager::manager->getLandmine((unsigned int) body->getProperty(1).getInt());
 
-			if (!mine->triggered && !mine->destroyed)
+			if (mine && !mine->triggered && !mine->destroyed)
 				mine->trigger();
 		}
 
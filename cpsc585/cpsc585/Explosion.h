@@ -14,6 +14,8 @@ public:
 	~Explosion(void);
 	void doDamage();
 
+	static void shutdown();		// Before the physics world goes
+
 private:
 	
 
@@ -23,4 +25,8 @@ public:
 
 private:
 	hkVector4 pos;
+
+	// Made on the first explosion and moved to each one after
+	static hkpShape* blastShape;
+	static hkpShapePhantom* blastPhantom;
 };
@@ -0,0 +1,161 @@
+#include "FrameArena.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+FrameArena* FrameArena::arena = NULL;
+
+
+FrameArena::FrameArena(unsigned int capacity)
+{
+	this->capacity = capacity;
+	used = 0;
+	highWater = 0;
+	overflows = 0;
+	heapFallbacks = 0;
+	outstanding = 0;
+	escapes = 0;
+
+	buffer = (char*) malloc(capacity);
+	if (!buffer)
+	{
+		this->capacity = 0;
+	}
+
+	arena = this;
+}
+
+
+FrameArena::~FrameArena()
+{
+	if (buffer)
+	{
+		free(buffer);
+		buffer = NULL;
+	}
+
+	if (arena == this)
+	{
+		arena = NULL;
+	}
+}
+
+
+void* FrameArena::allocate(unsigned int size)
+{
+	unsigned int start = (used + FRAME_ARENA_ALIGNMENT - 1) & ~(FRAME_ARENA_ALIGNMENT - 1);
+	if (start > capacity || size > capacity - start)
+	{
+		overflows++;
+		return NULL;
+	}
+
+	used = start + size;
+	if (used > highWater)
+	{
+		highWater = used;
+	}
+
+	return buffer + start;
+}
+
+
+const char* FrameArena::format(const char* format, ...)
+{
+	// Strings don't need aligning, so they go straight after whatever came last
+	unsigned int room = capacity - used;
+	if (room < 2)
+	{
+		overflows++;
+		return "";
+	}
+
+	char* start = buffer + used;
+
+	va_list args;
+	va_start(args, format);
+#ifdef _WIN32
+	int length = _vsnprintf_s(start, room, _TRUNCATE, format, args);
+#else
+	int length = vsnprintf(start, room, format, args);
+#endif
+	va_end(args);
+
+	// Truncated: give the space back rather than show half a line
+	if (length < 0 || (unsigned int) length >= room)
+	{
+		overflows++;
+		return "";
+	}
+
+	used += length + 1;
+	if (used > highWater)
+	{
+		highWater = used;
+	}
+
+	return start;
+}
+
+
+void FrameArena::reset()
+{
+	// A scratch container still alive here would go on using memory the next frame hands out again
+	if (outstanding > 0)
+	{
+		escapes += outstanding;
+		outstanding = 0;
+	}
+
+#ifdef FRAME_ARENA_CHECKS
+	assert(escapes == 0);
+
+	// So anything still pointing in here reads garbage, not what was there last frame
+	if (buffer)
+	{
+		memset(buffer, FRAME_ARENA_POISON, used);
+	}
+#endif
+
+	used = 0;
+}
+
+
+bool FrameArena::contains(const void* pointer)
+{
+	return buffer && (const char*) pointer >= buffer && (const char*) pointer < buffer + capacity;
+}
+
+
+void* FrameArena::allocateScratch(unsigned int size)
+{
+	void* block = allocate(size);
+	if (!block)
+	{
+		heapFallbacks++;
+		block = malloc(size > 0 ? size : 1);
+	}
+
+	outstanding++;
+	return block;
+}
+
+
+void FrameArena::releaseScratch(void* pointer)
+{
+	if (!pointer)
+		return;
+
+	// Not below 0 for one that escaped and was counted at a reset already
+	if (outstanding > 0)
+	{
+		outstanding--;
+	}
+	if (!contains(pointer))
+	{
+		free(pointer);
+	}
+}
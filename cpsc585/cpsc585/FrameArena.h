@@ -0,0 +1,105 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+
+#define FRAME_ARENA_ALIGNMENT	16
+#define FRAME_ARENA_POISON		0xDD	// What reset leaves behind, in debug builds
+
+#ifdef _DEBUG
+#define FRAME_ARENA_CHECKS		// Poison on reset, and stop on scratch containers that outlive their frame
+#endif
+
+
+// Scratch memory that lives for one frame. Allocating bumps a pointer and
+// reset() frees everything at once, so per-frame strings and lists never
+// touch the heap. The block is allocated once, up front.
+class FrameArena
+{
+public:
+	FrameArena(unsigned int capacity);
+	~FrameArena();
+
+	void* allocate(unsigned int size);		// NULL when the arena is full
+
+	// printf into the arena. Returns "" when it doesn't fit, never NULL.
+	const char* format(const char* format, ...);
+
+	void reset();		// Everything allocated since the last reset is gone
+
+	bool contains(const void* pointer);
+
+	// For FrameAllocator: from the arena, or from the heap when it is full, so a
+	// container never gets NULL. Every block has to be given back before reset.
+	void* allocateScratch(unsigned int size);
+	void releaseScratch(void* pointer);
+
+	static FrameArena* arena;
+
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int highWater;		// Most used in any frame
+	int overflows;				// Allocations refused since creation
+	int heapFallbacks;			// Scratch blocks that had to come from the heap
+	int outstanding;			// Scratch blocks not given back yet
+	int escapes;				// Scratch blocks still out at a reset
+
+private:
+	char* buffer;
+};
+
+
+// Lets a standard container keep its memory in FrameArena::arena, for scratch
+// lists built and thrown away within a frame:
+//
+//	std::vector<Waypoint*, FrameAllocator<Waypoint*> > passed;
+//
+// Giving memory back does nothing but count (the arena only frees at reset), so
+// a container that grows a lot wastes arena. It must be gone by the end of the
+// frame; one that isn't is counted in escapes, and stops a debug build.
+template <class T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef FrameAllocator<U> other;
+	};
+
+	FrameAllocator() {}
+	template <class U>
+	FrameAllocator(const FrameAllocator<U>&) {}
+
+	pointer address(reference value) const { return &value; }
+	const_pointer address(const_reference value) const { return &value; }
+
+	pointer allocate(size_type count, const void* = 0)
+	{
+		return (pointer) FrameArena::arena->allocateScratch((unsigned int) (count * sizeof(T)));
+	}
+
+	void deallocate(pointer block, size_type)
+	{
+		FrameArena::arena->releaseScratch(block);
+	}
+
+	size_type max_size() const { return (size_type) -1 / sizeof(T); }		// Past the arena comes from the heap
+
+	void construct(pointer block, const T& value) { new ((void*) block) T(value); }
+	void destroy(pointer block) { block->~T(); }
+};
+
+template <class T, class U>
+bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&) { return true; }
+
+template <class T, class U>
+bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&) { return false; }
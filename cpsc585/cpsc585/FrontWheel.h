@@ -2,6 +2,7 @@
 
 #include "Drawable.h"
 #include "Physics.h"
+#include "ContactCache.h"
 
 
 class FrontWheel
@@ -20,6 +21,7 @@ public:
 	Drawable* drawable;
 	hkpRigidBody* body;
 	bool touchingGround;
+	ContactCache groundContact;
 	hkVector4 lastPos;
 	double rotation;
 
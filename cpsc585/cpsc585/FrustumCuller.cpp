@@ -0,0 +1,159 @@
+#include "FrustumCuller.h"
+
+#include <math.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+
+FrustumCuller::FrustumCuller()
+{
+	memset(planes, 0, sizeof(planes));
+	memset(eye, 0, sizeof(eye));
+	maxDistance = 0.0f;
+	visibleCount = 0;
+	culledCount = 0;
+}
+
+
+void FrustumCuller::setViewProjection(const float* m)
+{
+	// Planes straight from the matrix columns (Gribb & Hartmann), for
+	// clip = (x, y, z, 1) * M with 0 <= z <= w
+	for (int k = 0; k < 4; k++)
+	{
+		float column0 = m[k * 4], column1 = m[k * 4 + 1], column2 = m[k * 4 + 2], column3 = m[k * 4 + 3];
+
+		planes[0][k] = column3 + column0;	// Left
+		planes[1][k] = column3 - column0;	// Right
+		planes[2][k] = column3 + column1;	// Bottom
+		planes[3][k] = column3 - column1;	// Top
+		planes[4][k] = column2;				// Near
+		planes[5][k] = column3 - column2;	// Far
+	}
+
+	for (int p = 0; p < 6; p++)
+	{
+		float length = sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		if (length > 0.0f)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				planes[p][k] /= length;
+			}
+		}
+	}
+}
+
+
+void FrustumCuller::setDistanceLimit(const float* eye, float maxDistance)
+{
+	memcpy(this->eye, eye, sizeof(this->eye));
+	this->maxDistance = maxDistance;
+}
+
+
+int FrustumCuller::cull(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* visible)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 eyeX = _mm_set1_ps(eye[0]), eyeY = _mm_set1_ps(eye[1]), eyeZ = _mm_set1_ps(eye[2]);
+	__m128 limit = _mm_set1_ps(maxDistance);
+
+	visibleCount = 0;
+
+	for (int i = 0; i < count; i += 4)
+	{
+		int lanes = count - i < 4 ? count - i : 4;
+
+		__m128 sx, sy, sz, sr;
+		if (lanes == 4)
+		{
+			sx = _mm_loadu_ps(&x[i]);
+			sy = _mm_loadu_ps(&y[i]);
+			sz = _mm_loadu_ps(&z[i]);
+			sr = _mm_loadu_ps(&radius[i]);
+		}
+		else
+		{
+			// Pad the tail with copies of the last sphere
+			float px[4], py[4], pz[4], pr[4];
+			for (int k = 0; k < 4; k++)
+			{
+				int source = i + (k < lanes ? k : lanes - 1);
+				px[k] = x[source];
+				py[k] = y[source];
+				pz[k] = z[source];
+				pr[k] = radius[source];
+			}
+			sx = _mm_loadu_ps(px);
+			sy = _mm_loadu_ps(py);
+			sz = _mm_loadu_ps(pz);
+			sr = _mm_loadu_ps(pr);
+		}
+
+		// Outside when n.c + d < -r for any plane
+		__m128 outside = zero;
+		__m128 negativeRadius = _mm_sub_ps(zero, sr);
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(sx, _mm_set1_ps(planes[p][0])),
+				_mm_mul_ps(sy, _mm_set1_ps(planes[p][1]))),
+				_mm_add_ps(_mm_mul_ps(sz, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		if (maxDistance > 0.0f)
+		{
+			__m128 dx = _mm_sub_ps(sx, eyeX), dy = _mm_sub_ps(sy, eyeY), dz = _mm_sub_ps(sz, eyeZ);
+			__m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 reach = _mm_add_ps(limit, sr);
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(distanceSq, _mm_mul_ps(reach, reach)));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < lanes; k++)
+		{
+			visible[i + k] = ((mask >> k) & 1) ? 0 : 1;
+			visibleCount += visible[i + k];
+		}
+	}
+
+	culledCount = count - visibleCount;
+	return visibleCount;
+}
+
+
+int FrustumCuller::cullReference(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* visible)
+{
+	visibleCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		bool inside = true;
+
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			float distance = (x[i] * planes[p][0] + y[i] * planes[p][1]) + (z[i] * planes[p][2] + planes[p][3]);
+			if (distance < -radius[i])
+			{
+				inside = false;
+			}
+		}
+
+		if (inside && maxDistance > 0.0f)
+		{
+			float dx = x[i] - eye[0], dy = y[i] - eye[1], dz = z[i] - eye[2];
+			float reach = maxDistance + radius[i];
+			if ((dx * dx + dy * dy) + dz * dz > reach * reach)
+			{
+				inside = false;
+			}
+		}
+
+		visible[i] = inside ? 1 : 0;
+		visibleCount += visible[i];
+	}
+
+	culledCount = count - visibleCount;
+	return visibleCount;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Tests bounding spheres against the view frustum, 4 at a time with SSE.
+// Spheres are passed as separate x, y, z and radius arrays; a sphere is
+// culled when it is entirely behind one of the six planes, or further than
+// maxDistance from the eye.
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	// Row-vector view * projection matrix in D3D layout (clip z from 0 to w)
+	void setViewProjection(const float* matrix);
+	void setDistanceLimit(const float* eye, float maxDistance);		// maxDistance 0 turns it off
+
+	// visible gets 1 or 0 per sphere. Returns the number visible.
+	int cull(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* visible);
+	int cullReference(const float* x, const float* y, const float* z, const float* radius, int count, unsigned char* visible);
+
+	float planes[6][4];		// Normalized, inside when n.p + d >= 0
+	float eye[3];
+	float maxDistance;
+
+	// From the last cull
+	int visibleCount;
+	int culledCount;
+};
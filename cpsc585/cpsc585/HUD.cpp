@@ -1,4 +1,7 @@
 #include "HUD.h"
+#include "StateCache.h"
+
+#include <string.h>
 
 
 HUD::~HUD(void)
@@ -12,85 +15,14 @@ HUD::HUD(int width, int height)
 
 	radialEnabled = false;
 	selectedAbility = LASER;
-	sprite = NULL;
-	radialMenuTexture = NULL;
-	reticuleTexture = NULL;
-	numbersTexture = NULL;
-	healthBarBorderTexture = NULL;
-	healthBarTexture = NULL;
-	lapPositionsTexture = NULL;
-	countdownTexture = NULL;
-	iconsTexture = NULL;
-
-	laserRect = new RECT();
-	mineRect = new RECT();
-	rocketRect = new RECT();
-	speedRect = new RECT();
-
-	rocketIconRect = new RECT();
-	landmineIconRect = new RECT();
-	speedIconRect = new RECT();
-
-	laserRect->top = 0;
-	laserRect->bottom = 256;
-	laserRect->right = 256;
-	laserRect->left = 0;
-
-	mineRect->top = 0;
-	mineRect->bottom = 256;
-	mineRect->right = 512;
-	mineRect->left = 256;
-
-	rocketRect->top = 256;
-	rocketRect->bottom = 512;
-	rocketRect->right = 256;
-	rocketRect->left = 0;
-
-	speedRect->top = 256;
-	speedRect->bottom = 512;
-	speedRect->right = 512;
-	speedRect->left = 256;
-
-	currentRect = laserRect;
-
-	rocketIconRect->top = 0;
-	rocketIconRect->bottom = 128;
-	rocketIconRect->right = 128;
-	rocketIconRect->left = 0;
-
-	landmineIconRect->top = 128;
-	landmineIconRect->bottom = 256;
-	landmineIconRect->right = 256;
-	landmineIconRect->left = 0;
-
-	speedIconRect->top = 0;
-	speedIconRect->bottom = 128;
-	speedIconRect->right = 256;
-	speedIconRect->left = 128;
-
-
-	radialPos = new D3DXVECTOR3();
-	radialPos->x = 50.0f;
-	radialPos->y = 20.0f;
-	radialPos->z = 0.0f;
-
-	centre = new D3DXVECTOR3();
-	centre->x = width / 2.0f;
-	centre->y = height / 2.0f;
-	centre->z = 0.0f;
-
-
-	speedoPos = new D3DXVECTOR3();
-	speedoPos->x = width - 180.0f;
-	speedoPos->y = height - 180.0f;
-	speedoPos->z = 0.0f;
-
-	ammoPos = new D3DXVECTOR3();
-	ammoPos->x = width / 2.0f;
-	ammoPos->y = height - 80.0f;
-	ammoPos->z = 0.0f;
-
-	D3DXMatrixIdentity(&needleTrans);
+
+	device = NULL;
+	atlas = NULL;
+	vertexBuffer = NULL;
+	layout = new HUDLayout(width, height);
+	vertexCount = 0;
+
+	needleAngle = -0.7f;
 
 	currentSpeed = 0;
 	currentHealth = 100;
@@ -112,154 +44,106 @@ HUD::HUD(int width, int height)
 
 void HUD::initialize(IDirect3DDevice9* device)
 {
-	D3DXCreateTextureFromFile(device, "textures/radialMenu.dds", &radialMenuTexture);
-	D3DXCreateTextureFromFile(device, "textures/reticule.dds", &reticuleTexture);
-	D3DXCreateTextureFromFile(device, "textures/speedometer.dds", &speedoTexture);
-	D3DXCreateTextureFromFile(device, "textures/needle.dds", &needleTexture);
-	D3DXCreateTextureFromFile(device, "textures/numbers.dds", &numbersTexture);
-	D3DXCreateTextureFromFile(device, "textures/healthBar.dds", &healthBarTexture);
-	D3DXCreateTextureFromFile(device, "textures/healthBarBorder.dds", &healthBarBorderTexture);
-	D3DXCreateTextureFromFile(device, "textures/lapPositions.dds", &lapPositionsTexture);
-	D3DXCreateTextureFromFile(device, "textures/countdown.dds", &countdownTexture);
-	D3DXCreateTextureFromFile(device, "textures/icons.dds", &iconsTexture);
-	D3DXCreateSprite(device, &sprite);
-}
-
-void HUD::shutdown()
-{
-	currentRect = NULL;
-
-	if (radialPos)
-	{
-		delete radialPos;
-		radialPos = NULL;
-	}
-
-	if (speedoPos)
-	{
-		delete speedoPos;
-		speedoPos = NULL;
-	}
-
-	if (ammoPos)
-	{
-		delete ammoPos;
-		ammoPos = NULL;
-	}
+	this->device = device;
 
-	if (centre)
-	{
-		delete centre;
-		centre = NULL;
-	}
+	loadAtlas(device);
 
-	if (laserRect)
-	{
-		delete laserRect;
-		laserRect = NULL;
-	}
+	device->CreateVertexBuffer(sizeof(HUDVertex) * HUD_MAX_QUADS * 6, D3DUSAGE_WRITEONLY | D3DUSAGE_DYNAMIC,
+		D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1, D3DPOOL_DEFAULT, &vertexBuffer, NULL);
+}
 
-	if (mineRect)
-	{
-		delete mineRect;
-		mineRect = NULL;
-	}
+// Packs the HUD textures into one, so the whole HUD is a single draw
+bool HUD::loadAtlas(IDirect3DDevice9* device)
+{
+	int widths[HUD_TEXTURE_COUNT], heights[HUD_TEXTURE_COUNT];
 
-	if (rocketRect)
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
 	{
-		delete rocketRect;
-		rocketRect = NULL;
-	}
+		D3DXIMAGE_INFO info;
+		if (FAILED(D3DXGetImageInfoFromFile(HUDLayout::getTextureFile(i), &info)))
+		{
+			return false;
+		}
 
-	if (speedRect)
-	{
-		delete speedRect;
-		speedRect = NULL;
+		widths[i] = info.Width;
+		heights[i] = info.Height;
 	}
 
-	if (rocketIconRect)
-	{
-		delete rocketIconRect;
-		rocketIconRect = NULL;
-	}
+	// Any height is fine where the card allows it with clamping and no mips, which is all the HUD uses
+	D3DCAPS9 caps;
+	device->GetDeviceCaps(&caps);
+	bool anyHeight = !(caps.TextureCaps & D3DPTEXTURECAPS_POW2) || (caps.TextureCaps & D3DPTEXTURECAPS_NONPOW2CONDITIONAL);
 
-	if (landmineIconRect)
+	if (!layout->packAtlas(widths, heights, anyHeight))
 	{
-		delete landmineIconRect;
-		landmineIconRect = NULL;
+		return false;
 	}
 
-	if (speedIconRect)
+	if (FAILED(device->CreateTexture(layout->atlasWidth, layout->atlasHeight, 1, 0, D3DFMT_A8R8G8B8,
+		D3DPOOL_MANAGED, &atlas, NULL)))
 	{
-		delete speedIconRect;
-		speedIconRect = NULL;
+		atlas = NULL;
+		return false;
 	}
 
-	if (radialMenuTexture)
+	// The padding has to be clear, or filtering bleeds it into the edges
+	D3DLOCKED_RECT locked;
+	if (SUCCEEDED(atlas->LockRect(0, &locked, NULL, 0)))
 	{
-		radialMenuTexture->Release();
-		radialMenuTexture = NULL;
+		for (int y = 0; y < layout->atlasHeight; y++)
+		{
+			memset((char*) locked.pBits + y * locked.Pitch, 0, layout->atlasWidth * 4);
+		}
+		atlas->UnlockRect(0);
 	}
 
-	if (reticuleTexture)
-	{
-		reticuleTexture->Release();
-		reticuleTexture = NULL;
-	}
+	IDirect3DSurface9* surface = NULL;
+	atlas->GetSurfaceLevel(0, &surface);
 
-	if (speedoTexture)
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
 	{
-		speedoTexture->Release();
-		speedoTexture = NULL;
-	}
+		RECT dest;
+		dest.left = layout->atlasX[i];
+		dest.top = layout->atlasY[i];
+		dest.right = dest.left + layout->textureWidth[i];
+		dest.bottom = dest.top + layout->textureHeight[i];
 
-	if (needleTexture)
-	{
-		needleTexture->Release();
-		needleTexture = NULL;
-	}
+		// Only the part the HUD draws from
+		RECT source;
+		source.left = 0;
+		source.top = 0;
+		source.right = layout->textureWidth[i];
+		source.bottom = layout->textureHeight[i];
 
-	if (numbersTexture)
-	{
-		numbersTexture->Release();
-		numbersTexture = NULL;
+		D3DXLoadSurfaceFromFile(surface, NULL, &dest, HUDLayout::getTextureFile(i), &source, D3DX_FILTER_NONE, 0, NULL);
 	}
 
-	if (healthBarTexture)
-	{
-		healthBarTexture->Release();
-		healthBarTexture = NULL;
-	}
+	surface->Release();
 
-	if (healthBarBorderTexture)
-	{
-		healthBarBorderTexture->Release();
-		healthBarBorderTexture = NULL;
-	}
+	return true;
+}
 
-	if (lapPositionsTexture)
+void HUD::shutdown()
+{
+	if (vertexBuffer)
 	{
-		lapPositionsTexture->Release();
-		lapPositionsTexture = NULL;
+		vertexBuffer->Release();
+		vertexBuffer = NULL;
 	}
 
-	if (countdownTexture)
+	if (atlas)
 	{
-		countdownTexture->Release();
-		countdownTexture = NULL;
+		atlas->Release();
+		atlas = NULL;
 	}
 
-	if (iconsTexture)
+	if (layout)
 	{
-		iconsTexture->Release();
-		iconsTexture = NULL;
+		delete layout;
+		layout = NULL;
 	}
 
-	if (sprite)
-	{
-		sprite->Release();
-		sprite = NULL;
-	}
+	device = NULL;
 }
 
 
@@ -276,24 +160,6 @@ void HUD::setSelectedAbility(AbilityType ability)
 	Sound::sound->playSoundEffect(SFX_SELECT, Sound::sound->playerEmitter);
 
 	selectedAbility = ability;
-
-	switch (ability)
-	{
-	case LASER:
-		currentRect = laserRect;
-		break;
-	case SPEED:
-		currentRect = speedRect;
-		break;
-	case ROCKET:
-		currentRect = rocketRect;
-		break;
-	case LANDMINE:
-		currentRect = mineRect;
-		break;
-	default:
-		currentRect = laserRect;
-	}
 }
 
 void HUD::update(Intention intention)
@@ -326,122 +192,82 @@ void HUD::update(Intention intention)
 
 void HUD::render()
 {
-	D3DXMATRIX origTrans;
-	sprite->GetTransform(&origTrans);
-	
-	sprite->Begin(D3DXSPRITE_ALPHABLEND);
-
-	// Draw reticule
-	if (!showOne && !showTwo && !showThree)
-		sprite->Draw(reticuleTexture, NULL, &(D3DXVECTOR3(16,16,0)), centre, D3DXCOLOR(1.0f, 0.0f, 0.0f, 0.4f));
+	if (!atlas || !vertexBuffer)
+		return;
 
-	// Draw speedometer
-	IDirect3DDevice9* device;
-	sprite->GetDevice(&device);
-	device->SetRenderState(D3DRS_ZENABLE, FALSE);
+	// Only as many as the numbers texture can show
+	if (rocketAmmo > 9)
+		rocketAmmo = 9;
 	
-	sprite->Draw(speedoTexture, NULL, &(D3DXVECTOR3(256,256,0)), speedoPos,  0xCFFFFFFF);
-	sprite->SetTransform(&needleTrans);
-	sprite->Draw(needleTexture, NULL, &(D3DXVECTOR3(155,64,0)), speedoPos,  0xCFFFFFFF);
-	sprite->SetTransform(&origTrans);
-
-
-	// Draw radial menu
-	if (radialEnabled)
-	{
-		sprite->Draw(radialMenuTexture, currentRect, NULL, radialPos, 0xFFFFFFFF);
-	}
-	else
-	{
-		sprite->Draw(radialMenuTexture, currentRect, NULL, radialPos, D3DCOLOR_ARGB(120, 255, 255, 255));
-	}
-
-
-	// Draw position
-	drawPosition();
-
-	// Draw health
-	drawHealth();
-
-	// Draw lap
-	drawLap();
-
-
-
-	// Draw countdown numbers
-	if (showOne)
-	{
-		RECT rect;
-		rect.top = 0;
-		rect.bottom = 512;
-		rect.left = 256;
-		rect.right = 512;
-
-
-		sprite->Draw(countdownTexture, &rect, &(D3DXVECTOR3(128.0f, 256.0f, 0)),
-			&(D3DXVECTOR3(screenWidth / 2.0f, screenHeight / 2.0f + 10.0f, 0)), 0xFFFFFFFF);
-	}
-	else if (showTwo)
-	{
-		RECT rect;
-		rect.top = 0;
-		rect.bottom = 256;
-		rect.left = 0;
-		rect.right = 256;
-
-
-		sprite->Draw(countdownTexture, &rect, &(D3DXVECTOR3(128.0f, 128.0f, 0)),
-			&(D3DXVECTOR3(screenWidth / 2.0f, screenHeight / 2.0f - 20.0f, 0)), 0xFFFFFFFF);
-	}
-	else if (showThree)
-	{
-		RECT rect;
-		rect.top = 256;
-		rect.bottom = 512;
-		rect.left = 0;
-		rect.right = 256;
-
-
-		sprite->Draw(countdownTexture, &rect, &(D3DXVECTOR3(128.0f, 128.0f, 0)),
-			&(D3DXVECTOR3(screenWidth / 2.0f, screenHeight / 2.0f, 0)), 0xFFFFFFFF);
-	}
+	if (speedAmmo > 9)
+		speedAmmo = 9;
 
-	if (showAmmo)
-	{
-		RECT* iconRect = NULL;
+	if (landmineAmmo > 9)
+		landmineAmmo = 9;
 
-		switch (ammoIconType)
+	HUDState state;
+	state.needleAngle = needleAngle;
+	state.health = currentHealth;
+	state.position = position;
+	state.lap = currentLap;
+	state.numLaps = numLapsToWin;
+	state.rocketAmmo = rocketAmmo;
+	state.speedAmmo = speedAmmo;
+	state.landmineAmmo = landmineAmmo;
+	state.radialEnabled = radialEnabled;
+	state.selectedAbility = selectedAbility;
+	state.countdown = showOne ? 1 : (showTwo ? 2 : (showThree ? 3 : 0));
+	state.showAmmo = showAmmo;
+	state.ammoIconType = ammoIconType;
+
+	// Only touch the vertex buffer when something shown has changed
+	if (layout->update(state))
+	{
+		vertexCount = layout->getVertexCount();
+
+		void* vertices;
+		if (vertexCount > 0 && SUCCEEDED(vertexBuffer->Lock(0, 0, &vertices, D3DLOCK_DISCARD)))
 		{
-		case ROCKET:
-			{
-				iconRect = rocketIconRect;
-				break;
-			}
-		case LANDMINE:
-			{
-				iconRect = landmineIconRect;
-				break;
-			}
-		case SPEED:
-			{
-				iconRect = speedIconRect;
-				break;
-			}
-		default:
-			{
-				iconRect = rocketIconRect;
-				break;
-			}
+			memcpy(vertices, layout->getVertices(), sizeof(HUDVertex) * vertexCount);
+			vertexBuffer->Unlock();
 		}
-
-		sprite->Draw(iconsTexture, iconRect, &(D3DXVECTOR3(64.0f, 64.0f, 0)),
-			ammoPos, 0xFFFFFFFF);
 	}
 
-	// Draw ammo counts
-	drawAmmo();
+	if (vertexCount == 0)
+		return;
 
-	sprite->End();
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_FOGENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+
+	// Filtered like the sprite did; the world is drawn with the default point filtering.
+	// Clamped, which a non power of two atlas needs, and mirrored again afterwards for the world.
+	StateCache::cache->setSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
+	StateCache::cache->setSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+
+	StateCache::cache->setTexture(0, atlas);
+	StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(HUDVertex));
+	StateCache::cache->setFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+	device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, vertexCount / 3);
+
+	StateCache::cache->setSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+	StateCache::cache->setSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_MIRROR);
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_MIRROR);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
 }
 
 
@@ -459,17 +285,8 @@ void HUD::setSpeed(float speed)
 	// going as fast as you actually are)
 	currentSpeed = (speed * 60.0f * 60.0f / 1000.0f) / 2.0f;
 
-	float angle = currentSpeed * 0.0175f - 0.7f;
-
-	// Code for updating the speedometer
-	D3DXMATRIX transToCentre, transToPos, rotate;
-
-	D3DXMatrixTranslation(&transToCentre, -speedoPos->x, -speedoPos->y, 0.0f);
-	D3DXMatrixRotationZ(&rotate, angle);
-	D3DXMatrixTranslation(&transToPos, speedoPos->x, speedoPos->y, 0.0f);
-
-	D3DXMatrixMultiply(&needleTrans, &transToCentre, &rotate);
-	D3DXMatrixMultiply(&needleTrans, &needleTrans, &transToPos);
+	// The needle is turned about the speedometer's centre when the layout is built
+	needleAngle = currentSpeed * 0.0175f - 0.7f;
 }
 
 void HUD::setHealth(int health)
@@ -477,118 +294,6 @@ void HUD::setHealth(int health)
 	currentHealth = health;
 }
 
-void HUD::drawHealth()
-{
-	char healthString[4];
-	_itoa_s(currentHealth, healthString, 4, 10);
-
-	D3DXVECTOR3 drawPos;
-	drawPos.x = 64.0f;
-	drawPos.y = screenHeight - 300.0f;
-	drawPos.z = 0.0f;
-
-	D3DXVECTOR3 actualCenter, currCenter;
-	actualCenter.x = 16.0f;
-	actualCenter.y = 256.0f;
-	actualCenter.z = 0.0f;
-
-	RECT current;
-	
-	current.top = (LONG) hkMath::ceil(((100 - currentHealth) / 100.0f) * 512.0f);
-	current.bottom = 512;
-	current.left = 0;
-	current.right = 32;
-
-	currCenter.x = 16.0f;
-	currCenter.y = 256.0f - current.top;
-	currCenter.z = 0.0f;
-
-
-	sprite->Draw(healthBarTexture, &current, &currCenter, &drawPos, 0x8FFFFFFF);
-	sprite->Draw(healthBarBorderTexture, NULL, &actualCenter, &drawPos, 0x8FFFFFFF);
-}
-
-void HUD::drawPosition()
-{
-	D3DXVECTOR3 drawPos;
-	drawPos.x = screenWidth - 80.0f;
-	drawPos.y = 128.0f;
-	drawPos.z = 0.0f;
-
-	D3DXVECTOR3 currCenter;
-	currCenter.x = 32.0f;
-	currCenter.y = 32.0f;
-	currCenter.z = 0.0f;
-
-	RECT current;
-
-	current.top = 0;
-	current.bottom = 64;
-	current.left = 0;
-	current.right = 64;
-
-	switch (position) {
-	case 1:
-		{
-			current.left += 64;
-			current.right += 64;
-			break;
-		}
-	case 2:
-		{
-			current.left += 128;
-			current.right += 128;
-			break;
-		}
-	case 3:
-		{
-			current.left += 192;
-			current.right += 192;
-			break;
-		}
-	case 4:
-		{
-			current.top += 64;
-			current.bottom += 64;
-			break;
-		}
-	case 5:
-		{
-			current.top += 64;
-			current.bottom += 64;
-			current.left += 64;
-			current.right += 64;
-			break;
-		}
-	case 6:
-		{
-			current.top += 64;
-			current.bottom += 64;
-			current.left += 128;
-			current.right += 128;
-			break;
-		}
-	case 7:
-		{
-			current.top += 64;
-			current.bottom += 64;
-			current.left += 192;
-			current.right += 192;
-			break;
-		}
-	case 8:
-		{
-			current.top += 128;
-			current.bottom += 128;
-			break;
-		}
-	default:
-		break;
-	}
-	
-	sprite->Draw(lapPositionsTexture, &current, &currCenter, &drawPos, 0xFFFFFFFF);
-}
-
 
 void HUD::setPosition(int pos)
 {
@@ -600,146 +305,3 @@ void HUD::setLap(int lap, int numToWin)
 	currentLap = lap;
 	numLapsToWin = numToWin;
 }
-
-
-void HUD::drawLap()
-{
-	char lapString[3];
-	
-	// This assumes that we will never be doing more than 9 laps
-	lapString[0] = (char) currentLap + '0';
-	lapString[1] = '/';
-	lapString[2] = (char) numLapsToWin + '0';
-
-	D3DXVECTOR3 drawPos;
-	drawPos.x = screenWidth - 192.0f;
-	drawPos.y = 45.0f;
-	drawPos.z = 0.0f;
-
-	D3DXVECTOR3 currCenter;
-	currCenter.x = 16.0f;
-	currCenter.y = 32.0f;
-	currCenter.z = 0.0f;
-
-	RECT current;
-
-	current.top = 0;
-	current.bottom = 64;
-	current.left = 0;
-	current.right = 64;
-
-	sprite->Draw(lapPositionsTexture, &current, &currCenter, &drawPos, 0xFFFFFFFF);
-	drawPos.x += 80.0f;
-
-	current.right = 32;
-
-
-	for (int i = 0; i < 5; i++)
-	{
-		if (lapString[i] == '/')
-		{
-			current.left = 32 * 11;
-			current.right = 32 * 12;
-
-			sprite->Draw(numbersTexture, &current, &currCenter, &drawPos, 0xFFFFFFFF);
-
-			drawPos.x += 32.0f;
-		}
-		else if ((lapString[i] >= '0') && (lapString[i] <= ':'))
-		{
-			int num = (int) lapString[i] - '0';
-
-			current.left = 32 * num;
-			current.right = 32 * (num + 1);
-
-			sprite->Draw(numbersTexture, &current, &currCenter, &drawPos, 0xFFFFFFFF);
-
-			drawPos.x += 32.0f;
-		}
-		else
-		{
-			break;
-		}
-	}
-	
-}
-
-void HUD::drawAmmo()
-{
-	char ammoString[3];
-
-	int alpha = 0;
-
-	if (radialEnabled)
-		alpha = 150;
-	else
-		alpha = 50;
-	
-	if (rocketAmmo > 9)
-		rocketAmmo = 9;
-	
-	if (speedAmmo > 9)
-		speedAmmo = 9;
-
-	if (landmineAmmo > 9)
-		landmineAmmo = 9;
-
-	ammoString[0] = (char) rocketAmmo + '0';
-	ammoString[1] = (char) speedAmmo + '0';
-	ammoString[2] = (char) landmineAmmo + '0';
-
-	D3DXVECTOR3 drawPos = *radialPos;
-	drawPos.x += 128;
-	drawPos.y += 128;
-
-
-	drawPos.x -= 75;
-	drawPos.y += 35;
-
-	D3DXVECTOR3 currCenter;
-	currCenter.x = 16.0f;
-	currCenter.y = 32.0f;
-	currCenter.z = 0.0f;
-
-	RECT current;
-
-	current.top = 0;
-	current.bottom = 64;
-	current.left = 0;
-	current.right = 32;
-
-	if ((ammoString[0] >= '0') && (ammoString[0] <= '9'))
-	{
-		int num = (int) ammoString[0] - '0';
-
-		current.left = 32 * num;
-		current.right = 32 * (num + 1);
-
-		sprite->Draw(numbersTexture, &current, &currCenter, &drawPos, D3DCOLOR_ARGB(alpha, 255, 100, 0));
-
-		drawPos.x += 150.0f;
-	}
-	
-	if ((ammoString[1] >= '0') && (ammoString[1] <= '9'))
-	{
-		int num = (int) ammoString[1] - '0';
-
-		current.left = 32 * num;
-		current.right = 32 * (num + 1);
-
-		sprite->Draw(numbersTexture, &current, &currCenter, &drawPos, D3DCOLOR_ARGB((int)hkMath::floor(alpha * 1.7f), 0, 100, 255));
-
-		drawPos.x -= 75.0f;
-		drawPos.y += 75.0f;
-	}
-
-	if ((ammoString[2] >= '0') && (ammoString[2] <= '9'))
-	{
-		int num = (int) ammoString[2] - '0';
-
-		current.left = 32 * num;
-		current.right = 32 * (num + 1);
-
-		sprite->Draw(numbersTexture, &current, &currCenter, &drawPos, D3DCOLOR_ARGB(alpha, 0, 255, 100));
-	}
-}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Intention.h"
 #include "Drawable.h"
 #include "Sound.h"
+#include "HUDLayout.h"
 
 enum AbilityType { LASER, SPEED, LANDMINE, ROCKET };
 
@@ -32,43 +33,20 @@ public:
 
 private:
 	void showRadial(bool enabled);
-	void drawHealth();
-	void drawPosition();
-	void drawLap();
-	void drawAmmo();
+	bool loadAtlas(IDirect3DDevice9* device);
 
 	AbilityType selectedAbility;
-	ID3DXSprite* sprite;
-	IDirect3DTexture9* radialMenuTexture;
-	IDirect3DTexture9* reticuleTexture;
-	IDirect3DTexture9* speedoTexture;
-	IDirect3DTexture9* needleTexture;
-	IDirect3DTexture9* numbersTexture;
-	IDirect3DTexture9* healthBarTexture;
-	IDirect3DTexture9* healthBarBorderTexture;
-	IDirect3DTexture9* lapPositionsTexture;
-	IDirect3DTexture9* countdownTexture;
-	IDirect3DTexture9* iconsTexture;
 
-	RECT* laserRect;
-	RECT* speedRect;
-	RECT* rocketRect;
-	RECT* mineRect;
-
-	RECT* rocketIconRect;
-	RECT* landmineIconRect;
-	RECT* speedIconRect;
-	
-	RECT* currentRect;
-
-	D3DXVECTOR3* radialPos;
-	D3DXVECTOR3* centre;
-	D3DXVECTOR3* speedoPos;
-	D3DXVECTOR3* ammoPos;
+	// Every HUD texture in one, and the quads drawn from it
+	IDirect3DDevice9* device;
+	IDirect3DTexture9* atlas;
+	IDirect3DVertexBuffer9* vertexBuffer;
+	HUDLayout* layout;
+	int vertexCount;
 
 	bool radialEnabled;
 
-	D3DXMATRIX needleTrans;
+	float needleAngle;
 
 	float currentSpeed;
 	int currentHealth;
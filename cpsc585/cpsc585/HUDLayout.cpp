@@ -0,0 +1,417 @@
+#include "HUDLayout.h"
+
+#include <math.h>
+#include <string.h>
+
+#define ARGB(a, r, g, b) (((unsigned int) (a) << 24) | ((unsigned int) (r) << 16) | ((unsigned int) (g) << 8) | (unsigned int) (b))
+
+
+// Same order as the HUD_TEXTURE_* numbers
+static const char* textureFiles[HUD_TEXTURE_COUNT] = {
+	"textures/radialMenu.dds",
+	"textures/reticule.dds",
+	"textures/speedometer.dds",
+	"textures/needle.dds",
+	"textures/numbers.dds",
+	"textures/healthBar.dds",
+	"textures/healthBarBorder.dds",
+	"textures/lapPositions.dds",
+	"textures/countdown.dds",
+	"textures/icons.dds"
+};
+
+// How much of each texture the HUD draws from, from the top left; 0 for all of it.
+// The numbers texture has 12 cells of 16, and the placement grid uses 3 rows of 4.
+static const int usedWidth[HUD_TEXTURE_COUNT] = { 0, 0, 0, 0, 12 * 32, 0, 0, 0, 0, 0 };
+static const int usedHeight[HUD_TEXTURE_COUNT] = { 0, 0, 0, 0, 0, 0, 0, 3 * 64, 0, 0 };
+
+// Field by field, since memcmp would also compare the padding
+static bool sameState(const HUDState& a, const HUDState& b)
+{
+	return a.needleAngle == b.needleAngle && a.health == b.health && a.position == b.position &&
+		a.lap == b.lap && a.numLaps == b.numLaps && a.rocketAmmo == b.rocketAmmo &&
+		a.speedAmmo == b.speedAmmo && a.landmineAmmo == b.landmineAmmo &&
+		a.radialEnabled == b.radialEnabled && a.selectedAbility == b.selectedAbility &&
+		a.countdown == b.countdown && a.showAmmo == b.showAmmo && a.ammoIconType == b.ammoIconType;
+}
+
+
+HUDLayout::HUDLayout(int screenWidth, int screenHeight)
+{
+	this->screenWidth = screenWidth;
+	this->screenHeight = screenHeight;
+
+	atlasWidth = 0;
+	atlasHeight = 0;
+	memset(atlasX, 0, sizeof(atlasX));
+	memset(atlasY, 0, sizeof(atlasY));
+	memset(textureWidth, 0, sizeof(textureWidth));
+	memset(textureHeight, 0, sizeof(textureHeight));
+
+	rebuilds = 0;
+	updates = 0;
+
+	memset(&last, 0, sizeof(last));
+	valid = false;
+}
+
+
+bool HUDLayout::packAtlas(const int* widths, const int* heights, bool anyHeight)
+{
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+	{
+		textureWidth[i] = (usedWidth[i] > 0 && usedWidth[i] < widths[i]) ? usedWidth[i] : widths[i];
+		textureHeight[i] = (usedHeight[i] > 0 && usedHeight[i] < heights[i]) ? usedHeight[i] : heights[i];
+	}
+
+	// Every power of two width, keeping the one with the fewest texels
+	int bestWidth = 0, bestHeight = 0;
+	for (int width = 64; width <= HUD_ATLAS_MAX_SIZE; width *= 2)
+	{
+		int height = tryPack(width);
+		if (height < 0)
+		{
+			continue;
+		}
+
+		if (!anyHeight)
+		{
+			int power = 1;
+			while (power < height)
+			{
+				power *= 2;
+			}
+			height = power;
+		}
+
+		if (height <= HUD_ATLAS_MAX_SIZE && (bestWidth == 0 || width * height < bestWidth * bestHeight))
+		{
+			bestWidth = width;
+			bestHeight = height;
+		}
+	}
+
+	if (bestWidth == 0)
+	{
+		atlasWidth = 0;
+		atlasHeight = 0;
+		return false;
+	}
+
+	tryPack(bestWidth);
+	atlasWidth = bestWidth;
+	atlasHeight = bestHeight;
+	return true;
+}
+
+
+// Skyline: tallest textures first, each where it sits lowest on top of the ones
+// already placed, so short textures fill in beside tall ones instead of starting
+// a new shelf. The candidates are the left edge and the right of each placed texture.
+int HUDLayout::tryPack(int width)
+{
+	int order[HUD_TEXTURE_COUNT];
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+	{
+		order[i] = i;
+	}
+
+	for (int i = 1; i < HUD_TEXTURE_COUNT; i++)
+	{
+		for (int j = i; j > 0; j--)
+		{
+			int a = order[j - 1], b = order[j];
+			if (textureHeight[a] > textureHeight[b] || (textureHeight[a] == textureHeight[b] && textureWidth[a] >= textureWidth[b]))
+			{
+				break;
+			}
+			order[j - 1] = b;
+			order[j] = a;
+		}
+	}
+
+	// How far down each column is taken, padding included
+	int skyline[HUD_ATLAS_MAX_SIZE];
+	memset(skyline, 0, sizeof(int) * width);
+
+	int candidates[HUD_TEXTURE_COUNT + 1];
+	int numCandidates = 1;
+	candidates[0] = 0;
+
+	int usedHeight = 0;
+
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+	{
+		int texture = order[i];
+		int w = textureWidth[texture], h = textureHeight[texture];
+
+		int bestX = -1, bestY = 0;
+		for (int c = 0; c < numCandidates; c++)
+		{
+			int x = candidates[c];
+			if (x + w > width)
+			{
+				continue;
+			}
+
+			// The padding on the right has to be clear as well, or something could be right up against it
+			int right = x + w + HUD_ATLAS_PADDING < width ? x + w + HUD_ATLAS_PADDING : width;
+			int y = 0;
+			for (int column = x; column < right; column++)
+			{
+				if (skyline[column] > y)
+				{
+					y = skyline[column];
+				}
+			}
+
+			if (bestX < 0 || y < bestY || (y == bestY && x < bestX))
+			{
+				bestX = x;
+				bestY = y;
+			}
+		}
+
+		if (bestX < 0)
+		{
+			return -1;
+		}
+
+		atlasX[texture] = bestX;
+		atlasY[texture] = bestY;
+
+		int right = bestX + w + HUD_ATLAS_PADDING < width ? bestX + w + HUD_ATLAS_PADDING : width;
+		for (int column = bestX; column < right; column++)
+		{
+			skyline[column] = bestY + h + HUD_ATLAS_PADDING;
+		}
+		if (right < width)
+		{
+			candidates[numCandidates++] = right;
+		}
+
+		if (bestY + h > usedHeight)
+		{
+			usedHeight = bestY + h;
+		}
+	}
+
+	return usedHeight;
+}
+
+
+void HUDLayout::invalidate()
+{
+	valid = false;
+}
+
+
+bool HUDLayout::update(const HUDState& state)
+{
+	updates++;
+
+	if (valid && sameState(state, last))
+	{
+		return false;
+	}
+
+	last = state;
+	valid = true;
+	build(state);
+	rebuilds++;
+
+	return true;
+}
+
+
+const HUDVertex* HUDLayout::getVertices()
+{
+	return vertices.empty() ? NULL : &vertices[0];
+}
+
+int HUDLayout::getVertexCount()
+{
+	return vertices.size();
+}
+
+const char* HUDLayout::getTextureFile(int texture)
+{
+	return textureFiles[texture];
+}
+
+
+void HUDLayout::addQuad(int texture, const int* rect, float centreX, float centreY, float x, float y, unsigned int colour, float angle)
+{
+	int left = 0, top = 0, right = textureWidth[texture], bottom = textureHeight[texture];
+	if (rect)
+	{
+		left = rect[0];
+		top = rect[1];
+		right = rect[2];
+		bottom = rect[3];
+	}
+
+	float cosAngle = cos(angle), sinAngle = sin(angle);
+
+	// Corners in the order top left, top right, bottom left, bottom right
+	HUDVertex corners[4];
+	for (int c = 0; c < 4; c++)
+	{
+		float cornerX = (float) ((c & 1) ? right - left : 0);
+		float cornerY = (float) ((c & 2) ? bottom - top : 0);
+
+		// Relative to where the centre lands, rotated like a row vector times RotationZ
+		float dx = cornerX - centreX, dy = cornerY - centreY;
+
+		HUDVertex& vertex = corners[c];
+		vertex.x = x + dx * cosAngle - dy * sinAngle - 0.5f;		// Half a pixel puts texels on pixels
+		vertex.y = y + dx * sinAngle + dy * cosAngle - 0.5f;
+		vertex.z = 0.0f;
+		vertex.rhw = 1.0f;
+		vertex.colour = colour;
+		vertex.u = (atlasX[texture] + left + cornerX) / atlasWidth;
+		vertex.v = (atlasY[texture] + top + cornerY) / atlasHeight;
+	}
+
+	// Clockwise, so the default cull mode keeps them
+	vertices.push_back(corners[0]);
+	vertices.push_back(corners[1]);
+	vertices.push_back(corners[2]);
+	vertices.push_back(corners[2]);
+	vertices.push_back(corners[1]);
+	vertices.push_back(corners[3]);
+}
+
+
+// Digits are 32 wide in a row of the numbers texture; 10 is the ':' cell and 11 the '/'
+void HUDLayout::addDigit(int digit, float x, float y, unsigned int colour)
+{
+	int rect[4] = { 32 * digit, 0, 32 * (digit + 1), 64 };
+	addQuad(HUD_TEXTURE_NUMBERS, rect, 16.0f, 32.0f, x, y, colour, 0.0f);
+}
+
+
+void HUDLayout::build(const HUDState& state)
+{
+	vertices.clear();
+
+	float width = (float) screenWidth, height = (float) screenHeight;
+
+	// Reticule, hidden during the countdown
+	if (state.countdown == 0)
+	{
+		addQuad(HUD_TEXTURE_RETICULE, NULL, 16.0f, 16.0f, width / 2.0f, height / 2.0f, ARGB(102, 255, 0, 0), 0.0f);
+	}
+
+	// Speedometer, with the needle turned about its centre
+	addQuad(HUD_TEXTURE_SPEEDOMETER, NULL, 256.0f, 256.0f, width - 180.0f, height - 180.0f, 0xCFFFFFFF, 0.0f);
+	addQuad(HUD_TEXTURE_NEEDLE, NULL, 155.0f, 64.0f, width - 180.0f, height - 180.0f, 0xCFFFFFFF, state.needleAngle);
+
+	// Radial menu, one quarter per ability
+	int radialRect[4] = { 0, 0, 256, 256 };
+	switch (state.selectedAbility)
+	{
+	case HUD_ABILITY_LANDMINE:
+		radialRect[0] = 256;
+		radialRect[2] = 512;
+		break;
+	case HUD_ABILITY_ROCKET:
+		radialRect[1] = 256;
+		radialRect[3] = 512;
+		break;
+	case HUD_ABILITY_SPEED:
+		radialRect[0] = 256;
+		radialRect[1] = 256;
+		radialRect[2] = 512;
+		radialRect[3] = 512;
+		break;
+	}
+	addQuad(HUD_TEXTURE_RADIAL_MENU, radialRect, 0.0f, 0.0f, 50.0f, 20.0f,
+		state.radialEnabled ? 0xFFFFFFFF : ARGB(120, 255, 255, 255), 0.0f);
+
+	// Placement, from a 4 wide grid of 64 pixel cells
+	int cell = (state.position >= 1 && state.position <= 8) ? state.position : 0;
+	int positionRect[4] = { (cell % 4) * 64, (cell / 4) * 64, (cell % 4) * 64 + 64, (cell / 4) * 64 + 64 };
+	addQuad(HUD_TEXTURE_LAP_POSITIONS, positionRect, 32.0f, 32.0f, width - 80.0f, 128.0f, 0xFFFFFFFF, 0.0f);
+
+	// Health bar, cut down from the top, under its border
+	int health = state.health < 0 ? 0 : (state.health > 100 ? 100 : state.health);
+	int healthTop = (int) ceil(((100 - health) / 100.0f) * 512.0f);
+	int healthRect[4] = { 0, healthTop, 32, 512 };
+	addQuad(HUD_TEXTURE_HEALTH_BAR, healthRect, 16.0f, 256.0f - healthTop, 64.0f, height - 300.0f, 0x8FFFFFFF, 0.0f);
+	addQuad(HUD_TEXTURE_HEALTH_BAR_BORDER, NULL, 16.0f, 256.0f, 64.0f, height - 300.0f, 0x8FFFFFFF, 0.0f);
+
+	// "Lap" and lap/laps. This assumes that we will never be doing more than 9 laps.
+	int lapRect[4] = { 0, 0, 64, 64 };
+	addQuad(HUD_TEXTURE_LAP_POSITIONS, lapRect, 16.0f, 32.0f, width - 192.0f, 45.0f, 0xFFFFFFFF, 0.0f);
+
+	int lapDigits[3] = { state.lap, 11, state.numLaps };
+	float lapX = width - 112.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		if (lapDigits[i] < 0 || lapDigits[i] > 11)
+		{
+			break;
+		}
+
+		addDigit(lapDigits[i], lapX, 45.0f, 0xFFFFFFFF);
+		lapX += 32.0f;
+	}
+
+	// Countdown numbers
+	if (state.countdown == 1)
+	{
+		int rect[4] = { 256, 0, 512, 512 };
+		addQuad(HUD_TEXTURE_COUNTDOWN, rect, 128.0f, 256.0f, width / 2.0f, height / 2.0f + 10.0f, 0xFFFFFFFF, 0.0f);
+	}
+	else if (state.countdown == 2)
+	{
+		int rect[4] = { 0, 0, 256, 256 };
+		addQuad(HUD_TEXTURE_COUNTDOWN, rect, 128.0f, 128.0f, width / 2.0f, height / 2.0f - 20.0f, 0xFFFFFFFF, 0.0f);
+	}
+	else if (state.countdown == 3)
+	{
+		int rect[4] = { 0, 256, 256, 512 };
+		addQuad(HUD_TEXTURE_COUNTDOWN, rect, 128.0f, 128.0f, width / 2.0f, height / 2.0f, 0xFFFFFFFF, 0.0f);
+	}
+
+	// Icon of the ammo just picked up
+	if (state.showAmmo)
+	{
+		int iconRect[4] = { 0, 0, 128, 128 };
+		if (state.ammoIconType == HUD_ABILITY_LANDMINE)
+		{
+			iconRect[1] = 128;
+			iconRect[2] = 256;
+			iconRect[3] = 256;
+		}
+		else if (state.ammoIconType == HUD_ABILITY_SPEED)
+		{
+			iconRect[0] = 128;
+			iconRect[2] = 256;
+		}
+		addQuad(HUD_TEXTURE_ICONS, iconRect, 64.0f, 64.0f, width / 2.0f, height - 80.0f, 0xFFFFFFFF, 0.0f);
+	}
+
+	// Ammo counts around the radial menu, brighter while it is open
+	int alpha = state.radialEnabled ? 150 : 50;
+	float ammoX = 50.0f + 128.0f - 75.0f, ammoY = 20.0f + 128.0f + 35.0f;
+
+	if (state.rocketAmmo >= 0 && state.rocketAmmo <= 9)
+	{
+		addDigit(state.rocketAmmo, ammoX, ammoY, ARGB(alpha, 255, 100, 0));
+		ammoX += 150.0f;
+	}
+
+	if (state.speedAmmo >= 0 && state.speedAmmo <= 9)
+	{
+		addDigit(state.speedAmmo, ammoX, ammoY, ARGB((int) floor(alpha * 1.7f), 0, 100, 255));
+		ammoX -= 75.0f;
+		ammoY += 75.0f;
+	}
+
+	if (state.landmineAmmo >= 0 && state.landmineAmmo <= 9)
+	{
+		addDigit(state.landmineAmmo, ammoX, ammoY, ARGB(alpha, 0, 255, 100));
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+
+// The HUD's textures, packed into one atlas
+#define HUD_TEXTURE_RADIAL_MENU			0
+#define HUD_TEXTURE_RETICULE			1
+#define HUD_TEXTURE_SPEEDOMETER			2
+#define HUD_TEXTURE_NEEDLE				3
+#define HUD_TEXTURE_NUMBERS				4
+#define HUD_TEXTURE_HEALTH_BAR			5
+#define HUD_TEXTURE_HEALTH_BAR_BORDER	6
+#define HUD_TEXTURE_LAP_POSITIONS		7
+#define HUD_TEXTURE_COUNTDOWN			8
+#define HUD_TEXTURE_ICONS				9
+#define HUD_TEXTURE_COUNT				10
+
+#define HUD_ATLAS_PADDING	2		// Empty texels around every texture, so filtering never picks up a neighbour
+#define HUD_ATLAS_MAX_SIZE	2048
+
+#define HUD_MAX_QUADS	32		// The most the HUD draws at once is 16
+
+// Ability numbers match AbilityType
+#define HUD_ABILITY_LASER		0
+#define HUD_ABILITY_SPEED		1
+#define HUD_ABILITY_LANDMINE	2
+#define HUD_ABILITY_ROCKET		3
+
+
+// Pre-transformed vertex: D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1
+struct HUDVertex
+{
+	float x, y, z, rhw;
+	unsigned int colour;
+	float u, v;
+};
+
+// Everything the HUD shows. Two equal states draw the same quads.
+struct HUDState
+{
+	float needleAngle;		// Radians
+	int health;
+	int position;			// Race placement, 1 to 8 (0 draws the blank cell)
+	int lap;
+	int numLaps;
+	int rocketAmmo;
+	int speedAmmo;
+	int landmineAmmo;
+	bool radialEnabled;
+	int selectedAbility;	// HUD_ABILITY_*
+	int countdown;			// 3, 2 or 1 while counting down, else 0
+	bool showAmmo;
+	int ammoIconType;		// HUD_ABILITY_*
+};
+
+// Lays the HUD out as a list of quads over one texture atlas. The quads are
+// only rebuilt when something shown changes, and are drawn in one call.
+// Nothing here touches the device, so it can be tested on its own.
+class HUDLayout
+{
+public:
+	HUDLayout(int screenWidth, int screenHeight);
+
+	// Places the textures (sizes in texels, HUD_TEXTURE_COUNT of each) in the
+	// smallest atlas they fit, with a power of two height unless anyHeight.
+	// False if they don't fit in HUD_ATLAS_MAX_SIZE.
+	bool packAtlas(const int* widths, const int* heights, bool anyHeight);
+
+	// Rebuilds the quads if the state differs from the last one. True if it did.
+	bool update(const HUDState& state);
+	void invalidate();		// The next update rebuilds whatever the state
+
+	const HUDVertex* getVertices();
+	int getVertexCount();	// 6 per quad, as a triangle list
+
+	static const char* getTextureFile(int texture);		// "textures/....dds"
+
+	int atlasWidth, atlasHeight;
+	int atlasX[HUD_TEXTURE_COUNT], atlasY[HUD_TEXTURE_COUNT];
+	int textureWidth[HUD_TEXTURE_COUNT], textureHeight[HUD_TEXTURE_COUNT];	// The part in the atlas, from the top left
+
+	int rebuilds;			// Stats
+	int updates;
+
+private:
+	int tryPack(int width);		// Height used, or -1 if something is wider than width
+	void build(const HUDState& state);
+
+	// Draws like ID3DXSprite::Draw: rect (left, top, right, bottom) of the texture, NULL for all of it,
+	// with centre placed at (x, y), then rotated by angle around (x, y)
+	void addQuad(int texture, const int* rect, float centreX, float centreY, float x, float y, unsigned int colour, float angle);
+	void addDigit(int digit, float x, float y, unsigned int colour);
+
+	int screenWidth, screenHeight;
+
+	HUDState last;
+	bool valid;
+
+	std::vector<HUDVertex> vertices;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+#include <xmmintrin.h>
+
+#define HANDLE_INDEX_BITS	16
+#define HANDLE_INDEX_MASK	0xFFFF
+#define HANDLE_NONE			0		// Never given out: generations start at 1
+
+
+// A fixed number of T in one block, allocated once, addressed by 32-bit
+// handles: the slot in the low 16 bits and the slot's generation in the high
+// 16. Releasing a slot bumps its generation, so a handle kept past its
+// object's release no longer resolves (get returns NULL) instead of pointing
+// at whatever took the slot next.
+//
+// Objects never move once made, since Havok bodies and contact listeners keep
+// pointers to them. The live slots are listed in live[0, count) for iterating;
+// releasing swaps the last one into the gap, so their order isn't kept.
+//
+// allocate only hands out the memory; the caller constructs into it with
+// placement new. release runs the destructor.
+template <class T>
+class HandlePool
+{
+public:
+	HandlePool(int capacity);
+	~HandlePool();		// Releases whatever is still alive
+
+	// NULL when the pool is full (counted in refused)
+	void* allocate(unsigned int& handle);
+	void release(unsigned int handle);
+
+	// NULL for HANDLE_NONE, and for handles whose object has been released
+	T* get(unsigned int handle);
+
+	T* at(int i);			// The i'th live object, i < count
+	unsigned int handleAt(int i);
+
+private:
+	T* slot(int index);
+
+	unsigned char* storage;		// capacity * sizeof(T)
+	unsigned short* generations;
+	int* freeSlots;				// Stack of unused slots
+	int freeCount;
+	int* live;					// Live slots, first count
+	int* livePosition;			// Slot -> its place in live
+
+public:
+	int capacity;
+	int count;
+
+	// Since startup
+	int allocated;
+	int released;
+	int refused;
+	int staleLookups;	// get with a released handle
+};
+
+
+template <class T>
+HandlePool<T>::HandlePool(int capacity)
+{
+	if (capacity > HANDLE_INDEX_MASK + 1)
+	{
+		capacity = HANDLE_INDEX_MASK + 1;
+	}
+	this->capacity = capacity;
+
+	storage = (unsigned char*) _mm_malloc(sizeof(T) * capacity, 16);
+	generations = new unsigned short[capacity];
+	freeSlots = new int[capacity];
+	live = new int[capacity];
+	livePosition = new int[capacity];
+
+	// Lowest slots first
+	for (int i = 0; i < capacity; i++)
+	{
+		generations[i] = 1;
+		freeSlots[i] = capacity - 1 - i;
+		livePosition[i] = -1;
+	}
+	freeCount = capacity;
+
+	count = 0;
+	allocated = 0;
+	released = 0;
+	refused = 0;
+	staleLookups = 0;
+}
+
+
+template <class T>
+HandlePool<T>::~HandlePool()
+{
+	while (count > 0)
+	{
+		release(handleAt(count - 1));
+	}
+
+	_mm_free(storage);
+	delete [] generations;
+	delete [] freeSlots;
+	delete [] live;
+	delete [] livePosition;
+}
+
+
+template <class T>
+void* HandlePool<T>::allocate(unsigned int& handle)
+{
+	if (freeCount == 0)
+	{
+		handle = HANDLE_NONE;
+		refused++;
+		return NULL;
+	}
+
+	int index = freeSlots[--freeCount];
+	livePosition[index] = count;
+	live[count++] = index;
+	allocated++;
+
+	handle = ((unsigned int) generations[index] << HANDLE_INDEX_BITS) | index;
+	return slot(index);
+}
+
+
+template <class T>
+void HandlePool<T>::release(unsigned int handle)
+{
+	T* object = get(handle);
+	if (!object)
+	{
+		return;
+	}
+
+	object->~T();
+
+	int index = handle & HANDLE_INDEX_MASK;
+	generations[index]++;
+	if (generations[index] == 0)
+	{
+		generations[index] = 1;
+	}
+
+	// The last live slot takes this one's place in the list
+	int position = livePosition[index];
+	int last = live[--count];
+	live[position] = last;
+	livePosition[last] = position;
+	livePosition[index] = -1;
+
+	freeSlots[freeCount++] = index;
+	released++;
+}
+
+
+template <class T>
+T* HandlePool<T>::get(unsigned int handle)
+{
+	if (handle == HANDLE_NONE)
+	{
+		return NULL;
+	}
+
+	int index = handle & HANDLE_INDEX_MASK;
+	if (index >= capacity || livePosition[index] < 0 ||
+		generations[index] != (handle >> HANDLE_INDEX_BITS))
+	{
+		staleLookups++;
+		return NULL;
+	}
+
+	return slot(index);
+}
+
+
+template <class T>
+T* HandlePool<T>::at(int i)
+{
+	return slot(live[i]);
+}
+
+
+template <class T>
+unsigned int HandlePool<T>::handleAt(int i)
+{
+	return ((unsigned int) generations[live[i]] << HANDLE_INDEX_BITS) | live[i];
+}
+
+
+template <class T>
+T* HandlePool<T>::slot(int index)
+{
+	return (T*) (storage + sizeof(T) * index);
+}
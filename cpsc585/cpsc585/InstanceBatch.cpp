@@ -0,0 +1,127 @@
+#include "InstanceBatch.h"
+
+#include <stddef.h>
+
+
+InstanceBatch::InstanceBatch()
+{
+}
+
+
+void InstanceBatch::clear()
+{
+	pending.clear();
+	groups.clear();
+	instances.clear();
+	owners.clear();
+}
+
+
+void InstanceBatch::add(void* geometry, void* texture, const float* transform, unsigned int colour, float depth, void* owner)
+{
+	PendingInstance instance = { geometry, texture, transform, colour, depth, owner, -1 };
+	pending.push_back(instance);
+}
+
+
+void InstanceBatch::build()
+{
+	groups.clear();
+
+	// Find each instance's group. There are only a handful of meshes, and
+	// drawables of one kind tend to be added together, so try the last one first.
+	int last = -1;
+	for (unsigned int i = 0; i < pending.size(); i++)
+	{
+		PendingInstance& instance = pending[i];
+
+		if (last == -1 || groups[last].geometry != instance.geometry || groups[last].texture != instance.texture)
+		{
+			last = -1;
+			for (unsigned int g = 0; g < groups.size(); g++)
+			{
+				if (groups[g].geometry == instance.geometry && groups[g].texture == instance.texture)
+				{
+					last = g;
+					break;
+				}
+			}
+
+			if (last == -1)
+			{
+				InstanceGroup group = { instance.geometry, instance.texture, 0, 0, instance.depth };
+				groups.push_back(group);
+				last = groups.size() - 1;
+			}
+		}
+
+		instance.group = last;
+		groups[last].count++;
+		if (instance.depth < groups[last].depth)
+		{
+			groups[last].depth = instance.depth;
+		}
+	}
+
+	// Lay the groups out one after another, then drop every instance into its slot
+	next.resize(groups.size());
+	int first = 0;
+	for (unsigned int g = 0; g < groups.size(); g++)
+	{
+		groups[g].first = first;
+		next[g] = first;
+		first += groups[g].count;
+	}
+
+	instances.resize(pending.size());
+	owners.resize(pending.size());
+
+	for (unsigned int i = 0; i < pending.size(); i++)
+	{
+		const PendingInstance& instance = pending[i];
+		int slot = next[instance.group]++;
+
+		// Row vectors: world.x = (x, y, z, 1) . (_11, _21, _31, _41)
+		const float* m = instance.transform;
+		InstanceData& data = instances[slot];
+		for (int k = 0; k < 3; k++)
+		{
+			float* column = k == 0 ? data.column0 : (k == 1 ? data.column1 : data.column2);
+			column[0] = m[k];
+			column[1] = m[4 + k];
+			column[2] = m[8 + k];
+			column[3] = m[12 + k];
+		}
+		data.colour = instance.colour;
+
+		owners[slot] = instance.owner;
+	}
+
+	pending.clear();
+}
+
+
+int InstanceBatch::getGroupCount()
+{
+	return groups.size();
+}
+
+InstanceGroup* InstanceBatch::getGroup(int group)
+{
+	return &groups[group];
+}
+
+const InstanceData* InstanceBatch::getInstances()
+{
+	return instances.empty() ? NULL : &instances[0];
+}
+
+int InstanceBatch::getInstanceCount()
+{
+	return instances.size();
+}
+
+void* InstanceBatch::getOwner(int instance)
+{
+	return owners[instance];
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+// Groups smaller than this are drawn the ordinary way
+#define INSTANCE_MIN_COUNT 2
+
+
+// One instance in the stream 1 vertex buffer
+struct InstanceData
+{
+	float column0[4];		// World matrix columns, so the shader does three dot products
+	float column1[4];
+	float column2[4];
+	unsigned int colour;	// D3DCOLOR, multiplies the lit colour
+};
+
+struct InstanceGroup
+{
+	void* geometry;			// The Mesh every instance draws
+	void* texture;
+	int first;				// Into getInstances()
+	int count;
+	float depth;			// Of the nearest instance
+};
+
+// Collects a frame's drawables and packs them, grouped by mesh and texture,
+// into the per-instance data the instanced draw reads. Only plain memory is
+// touched, so it can be checked and timed without a device.
+class InstanceBatch
+{
+public:
+	InstanceBatch();
+
+	void clear();
+	// transform is 4x4 in D3D layout and must stay valid until build(); owner comes back from getOwner()
+	void add(void* geometry, void* texture, const float* transform, unsigned int colour, float depth, void* owner);
+	void build();
+
+	int getGroupCount();
+	InstanceGroup* getGroup(int group);
+	const InstanceData* getInstances();
+	int getInstanceCount();
+	void* getOwner(int instance);	// In packed order
+
+private:
+	struct PendingInstance
+	{
+		void* geometry;
+		void* texture;
+		const float* transform;
+		unsigned int colour;
+		float depth;
+		void* owner;
+		int group;
+	};
+
+	std::vector<PendingInstance> pending;
+	std::vector<InstanceGroup> groups;
+	std::vector<InstanceData> instances;
+	std::vector<void*> owners;
+	std::vector<int> next;		// Per group, the next free slot while packing
+};
@@ -1,8 +1,9 @@
 #include "Landmine.h"
 
 
-Landmine::Landmine(IDirect3DDevice9* device)
+Landmine::Landmine(IDirect3DDevice9* device, unsigned int handle)
 {
+	this->handle = handle;
 	drawable = new Drawable(LANDMINEMESH, "textures/landmine.dds", device);
 
 	hkVector4 startAxis;
@@ -25,12 +26,13 @@ Landmine::Landmine(IDirect3DDevice9* device)
 	body->setAngularVelocity(hkVector4(0, 0, 0));
 	info.m_shape->removeReference();
 
+	// Its handle, for whatever hits the body (lasers, explosions) to look it up with
 	hkpPropertyValue val;
-	val.setPtr(this);
+	val.setInt((int) handle);
 	body->setProperty(1, val);
 	
 	
-	listener = new LandmineListener(this);
+	listener = new LandmineListener(handle);
 	body->addContactListener(listener);
 
 	Physics::physics->addRigidBody(body);
@@ -64,9 +66,10 @@ Landmine::~Landmine(void)
 		Physics::world->removeEntity(body);
 	}
 
+	// The renderer may still have it in a tick it is drawing
 	if (drawable)
 	{
-		delete drawable;
+		drawable->removeReference();
 	}
 
 	Sound::sound->returnEmitter();
@@ -139,19 +142,14 @@ void Landmine::explode()
 	destroyed = true;
 
 	Sound::sound->playSoundEffect(SFX_EXPLOSION, emitter);
-	Explosion* explosion = new Explosion((hkTransform*) &(body->getTransform()), owner);
+	Explosion explosion((hkTransform*) &(body->getTransform()), owner);
 
-	explosion->doDamage();
-	explosion = NULL;
-
-	SmokeParticle* smoke = new SmokeParticle();
+	explosion.doDamage();
 
 	hkVector4 pos;
 	pos.setXYZ(body->getPosition());
 
-	smoke->setPosition(&pos);
-	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, smoke);
-	smoke = NULL;
+	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, &pos);
 }
 
 
@@ -164,14 +162,15 @@ void Landmine::trigger()
 	}
 }
 
-LandmineListener::LandmineListener(Landmine* l)
+LandmineListener::LandmineListener(unsigned int handle)
 {
-	landmine = l;
+	this->handle = handle;
 }
 
 void LandmineListener::collisionAddedCallback(const hkpCollisionEvent& ev)
 {
-	if (!(landmine->triggered) && (landmine->activated) && !(landmine->destroyed)) {
+	Landmine* landmine = DynamicObjManager::manager->getLandmine(handle);
+	if (landmine && !(landmine->triggered) && (landmine->activated) && !(landmine->destroyed)) {
 		landmine->trigger();
 	}
 }
@@ -12,7 +12,7 @@ class Landmine :
 	public DynamicObj
 {
 public:
-	Landmine(IDirect3DDevice9* device);
+	Landmine(IDirect3DDevice9* device, unsigned int handle);
 	~Landmine(void);
 	void setPosAndRot(float posX, float posY, float posZ,
 		float rotX, float rotY, float rotZ);	// In Radians
@@ -40,9 +40,9 @@ private:
 class LandmineListener : public hkpContactListener
 {
 public:
-	LandmineListener(Landmine* r);
+	LandmineListener(unsigned int handle);
 	void collisionAddedCallback(const hkpCollisionEvent& ev);
 
 private:
-	Landmine* landmine;
+	unsigned int handle;	// Of its landmine
 };
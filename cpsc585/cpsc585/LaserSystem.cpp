@@ -5,17 +5,17 @@ LaserSystem* LaserSystem::system = NULL;
 
 LaserSystem::LaserSystem()
 {
-	ballLaserBuffer = NULL;
-	fireLaserBuffer = NULL;
 	beamLaserBuffer = NULL;
 
-	laserParticleList = NULL;
-	laserParticleList = new std::list<LaserParticle*>();
-	laserParticleList->clear();
+	ballLaser = new ParticlePool(MAX_LASER_BALL_PARTICLES);
+	fireLaser = new ParticlePool(MAX_LASER_FIRE_PARTICLES);
+	beams.reserve(MAX_LASER_BEAM_PARTICLES);
 
-	laserBeamList = NULL;
-	laserBeamList = new std::list<LaserBeam*>();
-	laserBeamList->clear();
+	ballLaserRange.first = 0;
+	ballLaserRange.count = 0;
+	fireLaserRange.first = 0;
+	fireLaserRange.count = 0;
+	numBeamLaser = 0;
 
 	system = this;
 
@@ -24,14 +24,6 @@ LaserSystem::LaserSystem()
 	D3DXCreateTextureFromFile(Renderer::device, "textures/laser.dds", &beamLaserTexture);
 
 
-	Renderer::device->CreateVertexBuffer(MAX_LASER_BALL_PARTICLES * sizeof(ParticlePoint),
-		D3DUSAGE_DYNAMIC | D3DUSAGE_POINTS | D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT,
-		&ballLaserBuffer, NULL);
-
-	Renderer::device->CreateVertexBuffer(MAX_LASER_FIRE_PARTICLES * sizeof(ParticlePoint),
-		D3DUSAGE_DYNAMIC | D3DUSAGE_POINTS | D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT,
-		&fireLaserBuffer, NULL);
-
 	Renderer::device->CreateVertexBuffer(MAX_LASER_BEAM_PARTICLES * NUM_VERTICES_PER_BEAM * sizeof(Vertex),
 		D3DUSAGE_DYNAMIC | D3DUSAGE_POINTS | D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT,
 		&beamLaserBuffer, NULL);
@@ -42,112 +34,55 @@ LaserSystem::~LaserSystem()
 {
 	system = NULL;
 
-	if (laserBeamList)
+	if (ballLaser)
+	{
+		delete ballLaser;
+		ballLaser = NULL;
+	}
+
+	if (fireLaser)
 	{
-		laserBeamList->clear();
-		delete laserBeamList;
+		delete fireLaser;
+		fireLaser = NULL;
 	}
 
-	if (laserParticleList)
+	if (beamLaserBuffer)
 	{
-		laserParticleList->clear();
-		delete laserParticleList;
+		beamLaserBuffer->Release();
+		beamLaserBuffer = NULL;
 	}
 }
 
 
 void LaserSystem::update(float seconds)
 {
-	numBallLaser = 0;
-	numFireLaser = 0;
-	numBeamLaser = 0;
+	ballLaser->update(seconds);
+	fireLaser->update(seconds);
 
-	// Do particles
-	if (!(laserParticleList->empty()))
+	for (unsigned int i = 0; i < beams.size();)
 	{
-		ParticlePoint* ballLaserParticles = NULL;
-		ParticlePoint* fireLaserParticles = NULL;
-
-		ballLaserBuffer->Lock(0, MAX_LASER_BALL_PARTICLES * sizeof(ParticlePoint), (void**) &ballLaserParticles, D3DLOCK_DISCARD);
-		fireLaserBuffer->Lock(0, MAX_LASER_FIRE_PARTICLES * sizeof(ParticlePoint), (void**) &fireLaserParticles, D3DLOCK_DISCARD);
-		
-		LaserParticle* currentParticle = NULL;
+		beams[i].update(seconds);
 
-		for (std::list<LaserParticle*>::iterator iter = laserParticleList->begin(); iter != laserParticleList->end();)
+		if (beams[i].destroyed)
 		{
-			currentParticle = (*iter);
-			
-			if (currentParticle && currentParticle->destroyed)
-			{
-				delete currentParticle;
-				iter = laserParticleList->erase(iter);
-			}
-			else if (currentParticle && !(currentParticle->destroyed))
-			{
-				// Write this out to the vertex buffer for drawing
-				if ((currentParticle->typeOfLaser == LASER_BALL) && (numBallLaser <= MAX_LASER_BALL_PARTICLES))
-				{
-					ballLaserParticles[numBallLaser].pos = currentParticle->position;
-
-					++numBallLaser;
-				}
-				else if (numFireLaser <= MAX_LASER_FIRE_PARTICLES)
-				{
-					fireLaserParticles[numFireLaser].pos = currentParticle->position;
-						
-					++numFireLaser;
-				}
-
-				currentParticle->update(seconds);
-
-				++iter;
-			}
+			beams[i] = beams.back();
+			beams.pop_back();
 		}
-
-		ballLaserBuffer->Unlock();
-		fireLaserBuffer->Unlock();
-	}
-
-
-	// Do beams
-	if (!(laserBeamList->empty()))
-	{
-		Vertex* beamLaserVertices = NULL;
-
-		beamLaserBuffer->Lock(0, MAX_LASER_BEAM_PARTICLES * NUM_VERTICES_PER_BEAM * sizeof(Vertex),
-			(void**) &beamLaserVertices, D3DLOCK_DISCARD);
-		
-		LaserBeam* currentBeam = NULL;
-
-		for (std::list<LaserBeam*>::iterator iter = laserBeamList->begin(); iter != laserBeamList->end();)
+		else
 		{
-			currentBeam = (*iter);
-			
-			if (currentBeam && currentBeam->destroyed)
-			{
-				delete currentBeam;
-				iter = laserBeamList->erase(iter);
-			}
-			else if (currentBeam && !(currentBeam->destroyed) && (numBeamLaser <= MAX_LASER_BEAM_PARTICLES))
-			{
-				// Write this out to the vertex buffer for drawing
-				currentBeam->writeVertices(&beamLaserVertices[numBeamLaser * NUM_VERTICES_PER_BEAM]);
-						
-				++numBeamLaser;
-
-				currentBeam->update(seconds);
-
-				++iter;
-			}
+			++i;
 		}
-
-		beamLaserBuffer->Unlock();
 	}
 }
 
 
+// A beam from the gun to what it hit, a flash at both ends and a ball running
+// along the beam as it vanishes. Shots past the beam limit are dropped.
 void LaserSystem::addLaser(hkVector4* startPoint, hkVector4* endPoint)
 {
+	if (beams.size() >= MAX_LASER_BEAM_PARTICLES)
+		return;
+
 	// Add a beam
 	D3DXVECTOR3 start;
 	start.x = (*startPoint)(0);
@@ -159,87 +94,103 @@ void LaserSystem::addLaser(hkVector4* startPoint, hkVector4* endPoint)
 	end.y = (*endPoint)(1);
 	end.z = (*endPoint)(2);
 
-	LaserBeam* beam = new LaserBeam(start, end);
+	beams.push_back(LaserBeam(start, end));
+
+	D3DXVECTOR3 vel = end - start;
+	float distance = D3DXVec3Length(&vel);
+	vel *= distance > 0.0f ? LaserBeam::vanishingSpeed / distance : 0.0f;
+
+	float still[3] = { 0.0f, 0.0f, 0.0f };
+	unsigned int white = D3DCOLOR_ARGB(255, 255, 255, 255);
+
+	// The flashes before the ball, if the particle budget can't take all three
+	int allowed = ParticleBudget::budget->take(3);
+
+	if (allowed > 0)
+	{
+		fireLaser->spawn((const float*) &start, still, LASER_FIRE_SIZE, 0.2f, 0.2f, white);
+	}
+	if (allowed > 1)
+	{
+		fireLaser->spawn((const float*) &end, still, LASER_FIRE_SIZE, distance / LaserBeam::vanishingSpeed,
+			distance / LaserBeam::vanishingSpeed, white);
+	}
+	if (allowed > 2)
+	{
+		ballLaser->spawn((const float*) &start, (const float*) &vel, LASER_BALL_SIZE, distance / LaserBeam::vanishingSpeed,
+			distance / LaserBeam::vanishingSpeed, white);
+	}
+}
 
-	laserBeamList->push_back(beam);
 
-	hkVector4 vel;
-	vel.setXYZ(*endPoint);
-	vel.sub(*startPoint);
+int LaserSystem::getCount()
+{
+	return ballLaser->count + fireLaser->count;
+}
 
-	float distance = vel.length3();
-	vel.div(hkVector4(distance, distance, distance));
 
-	vel.mul(LaserBeam::vanishingSpeed);
+void LaserSystem::expand(D3D9ParticleRenderer* particles)
+{
+	fireLaserRange = particles->add(fireLaser);
+	ballLaserRange = particles->add(ballLaser);
 
-	LaserParticle* particle = new LaserParticle();
-	particle->initialize(Renderer::device, &(hkVector4(0,0,0)), LASER_FIRE, 0.2f);
-	particle->setPosition(startPoint);
-	laserParticleList->push_back(particle);
+	numBeamLaser = 0;
+	if (!beams.empty() && beamLaserBuffer)
+	{
+		Vertex* beamLaserVertices = NULL;
 
-	particle = new LaserParticle();
-	particle->initialize(Renderer::device, &(hkVector4(0,0,0)), LASER_FIRE, distance / LaserBeam::vanishingSpeed);
-	particle->setPosition(endPoint);
-	laserParticleList->push_back(particle);
+		if (SUCCEEDED(beamLaserBuffer->Lock(0, MAX_LASER_BEAM_PARTICLES * NUM_VERTICES_PER_BEAM * sizeof(Vertex),
+			(void**) &beamLaserVertices, D3DLOCK_DISCARD)))
+		{
+			for (unsigned int i = 0; i < beams.size(); i++)
+			{
+				beams[i].writeVertices(&beamLaserVertices[i * NUM_VERTICES_PER_BEAM]);
+			}
+			numBeamLaser = beams.size();
 
-	particle = new LaserParticle();
-	particle->initialize(Renderer::device, &vel, LASER_BALL, distance / LaserBeam::vanishingSpeed);
-	particle->setPosition(startPoint);
-	laserParticleList->push_back(particle);
+			beamLaserBuffer->Unlock();
+		}
+	}
 }
 
 
-void LaserSystem::render()
+void LaserSystem::render(D3D9ParticleRenderer* particles)
 {
 
 	IDirect3DDevice9* device = Renderer::device;
 
 	// Render beams
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-	device->SetRenderState(D3DRS_ALPHATESTENABLE, TRUE);
-	device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-	device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-	device->SetRenderState(D3DRS_LIGHTING, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, FALSE);
 
-	device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
 
 
 	if (numBeamLaser > 0)
 	{
-		device->SetFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2);
-		device->SetTexture(0, beamLaserTexture);
+		StateCache::cache->setFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2);
+		StateCache::cache->setTexture(0, beamLaserTexture);
 
-		device->SetStreamSource(0, beamLaserBuffer, 0, sizeof(Vertex));
+		StateCache::cache->setStreamSource(0, beamLaserBuffer, 0, sizeof(Vertex));
 		device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, numBeamLaser * NUM_VERTICES_PER_BEAM / 3);
 	}
 
 
 	// Render particles
-	device->SetRenderState(D3DRS_ALPHAREF, (unsigned long) 50);
-	device->SetRenderState(D3DRS_ALPHAFUNC, D3DCMP_GREATER);
-
-	device->SetFVF(D3DFVF_XYZ);
-
-	if (numFireLaser > 0)
-	{
-		device->SetRenderState(D3DRS_POINTSIZE, FtoDw(0.5f));
-		device->SetTexture(0, fireLaserTexture);
-
-		device->SetStreamSource(0, fireLaserBuffer, 0, sizeof(ParticlePoint));
-		device->DrawPrimitive(D3DPT_POINTLIST, 0, numFireLaser);
-	}
+	StateCache::cache->setRenderState(D3DRS_ALPHAREF, (unsigned long) 50);
+	StateCache::cache->setRenderState(D3DRS_ALPHAFUNC, D3DCMP_GREATER);
 
-	if (numBallLaser > 0)
+	if (particles)
 	{
-		device->SetRenderState(D3DRS_POINTSIZE, FtoDw(1));
-		device->SetTexture(0, ballLaserTexture);
-	
-		device->SetStreamSource(0, ballLaserBuffer, 0, sizeof(ParticlePoint));
-		device->DrawPrimitive(D3DPT_POINTLIST, 0, numBallLaser);
+		particles->draw(fireLaserRange, fireLaserTexture);
+		particles->draw(ballLaserRange, ballLaserTexture);
 	}
 
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-	device->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
 }
@@ -1,14 +1,20 @@
 #pragma once
 
-#include <list>
+#include <vector>
+#include "Physics.h"
 #include "LaserBeam.h"
-#include "LaserParticle.h"
+#include "D3D9ParticleRenderer.h"
+#include "ParticleBudget.h"
 
 #define MAX_LASER_BALL_PARTICLES 50
 #define MAX_LASER_FIRE_PARTICLES 100
 #define MAX_LASER_BEAM_PARTICLES 50
 #define NUM_VERTICES_PER_BEAM 18
 
+// World units across: what the old point sprites covered at the game's field of view
+#define LASER_BALL_SIZE 1.45f
+#define LASER_FIRE_SIZE 0.73f
+
 class LaserSystem
 {
 public:
@@ -16,30 +22,25 @@ public:
 	~LaserSystem();
 	void addLaser(hkVector4* startPoint, hkVector4* endPoint);
 	void update(float seconds);
-	void render();
+	int getCount();
+	void expand(D3D9ParticleRenderer* particles);
+	void render(D3D9ParticleRenderer* particles);
 
 	static LaserSystem* system;
 
 
-	inline DWORD FtoDw(float f)
-	{
-	    return *((DWORD*)&f);
-	}
-
-
 private:
-	std::list<LaserParticle*>* laserParticleList;
-	std::list<LaserBeam*>* laserBeamList;
+	ParticlePool* ballLaser;
+	ParticlePool* fireLaser;
+	std::vector<LaserBeam> beams;		// At most MAX_LASER_BEAM_PARTICLES, removed by swapping in the last
 
 	IDirect3DTexture9* ballLaserTexture;
 	IDirect3DTexture9* fireLaserTexture;
 	IDirect3DTexture9* beamLaserTexture;
 
-	int numBallLaser;
-	int numFireLaser;
+	ParticleRange ballLaserRange;
+	ParticleRange fireLaserRange;
 	int numBeamLaser;
 
-	IDirect3DVertexBuffer9* ballLaserBuffer;
-	IDirect3DVertexBuffer9* fireLaserBuffer;
 	IDirect3DVertexBuffer9* beamLaserBuffer;
 };
@@ -12,6 +12,8 @@ bool initialize()
 	quit = false;
 
 	prevTime = 0;
+	accumulator = 0.0f;
+	simTick = 0;
 
 	// TO DO: Load config.ini file to set up resolution and input settings
 
@@ -102,7 +104,11 @@ bool initialize()
 		return false;
 	}
 
-	ai->initialize(renderer, input, sound);
+	if (!ai->initialize(renderer, input, sound))
+	{
+		errorPopup("Loading the track failed! [models/world.col, models/world.mesh]");
+		return false;
+	}
 	
 	if (!sound->initialized)
 	{
@@ -297,10 +303,17 @@ bool mainLoop()
 
 	ULONGLONG currentTime(largeInt.QuadPart / 10000);
 
+	// Sampled once per rendered frame, whether or not a tick runs; every tick in
+	// the frame reads the same state, and latched presses go to the first one
+	if (input->update())
+	{
+		quit = true;
+	}
+
 	if (currentTime == prevTime)
 	{
-		renderer->render();
-		return false;
+		renderer->render(accumulator / SIM_TICK);
+		return quit;
 	}
 	
 	float deltaTime = (currentTime - prevTime) / 1000.0f;
@@ -309,9 +322,17 @@ bool mainLoop()
 		deltaTime = 0.05f;
 
 
-	quit = input->update();
-	ai->simulate(deltaTime);
-	renderer->render();
+	// Each tick hands its transforms to the renderer, which draws between the last two
+	accumulator += deltaTime;
+	while (accumulator >= SIM_TICK)
+	{
+		ai->simulate(SIM_TICK);
+		renderer->publishTransforms(++simTick);
+
+		accumulator -= SIM_TICK;
+	}
+
+	renderer->render(accumulator / SIM_TICK);
 
 	prevTime = currentTime;
 
@@ -29,4 +29,10 @@ bool quit;
 
 ULONGLONG prevTime;
 
+// The simulation steps a fixed time, as many times as have passed; what's
+// left over (less than a tick) carries on to the next frame
+#define SIM_TICK (1.0f / 60.0f)
+float accumulator;
+unsigned int simTick;		// Ticks simulated so far
+
 DEVMODE initialScreenSettings;
@@ -1,47 +1,265 @@
 #include "Mesh.h"
 
 
-Mesh::Mesh(void)
+Mesh::Mesh(std::string name)
 {
+	this->name = name;
+	vertexBuffer = NULL;
+	indexBuffer = NULL;
+	vertices = NULL;
+	indices = NULL;
+	adjacency = NULL;
+	silhouette = NULL;
+	vertexCount = 0;
+	indexCount = 0;
+	packed = false;
+	boundsCenter = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	boundsRadius = 0.0f;
+	lods[0] = this;
+	lodErrors[0] = 0.0f;
+	lodCount = 1;
+	lodError = 0.0f;
+	chunks = NULL;
+	refCount = 0;
+	pinned = false;
 }
 
 
 Mesh::~Mesh(void)
 {
+	if (vertexBuffer)
+	{
+		vertexBuffer->Release();
+		vertexBuffer = NULL;
+	}
+
+	if (indexBuffer)
+	{
+		indexBuffer->Release();
+		indexBuffer = NULL;
+	}
+
+	if (silhouette)
+	{
+		delete silhouette;
+		silhouette = NULL;
+	}
+
+	if (chunks)
+	{
+		delete chunks;
+		chunks = NULL;
+	}
+
+	for (int i = 1; i < lodCount; i++)
+	{
+		delete lods[i];
+		lods[i] = NULL;
+	}
+	lodCount = 1;
 }
 
-void Mesh::loadMesh(std::string filename)
+bool Mesh::load(IDirect3DDevice9* device, std::string filename)
+{
+	void* verts;
+	void* inds;
+
+	loadMesh(filename);
+
+	if (vertexCount == 0)
+	{
+		return false;
+	}
+
+	packed = file.packedVertices && D3D9MeshShader::shader && D3D9MeshShader::shader->canDrawPacked();
+
+	if (packed)
+	{
+		VertexPacker packer;
+		packer.setBounds(file.header.aabbMin, file.header.aabbMax, file.header.uvMin, file.header.uvMax);
+		packer.getShaderConstants(quantization);
+
+		device->CreateVertexBuffer(sizeof(PackedVertex) * vertexCount, D3DUSAGE_WRITEONLY, 0,
+			D3DPOOL_MANAGED, &vertexBuffer, NULL);
+
+		vertexBuffer->Lock(0, sizeof(PackedVertex) * vertexCount, (void**) &verts, NULL);
+		memcpy(verts, file.packedVertices, sizeof(PackedVertex) * vertexCount);
+		vertexBuffer->Unlock();
+	}
+	else
+	{
+		device->CreateVertexBuffer(sizeof(Vertex) * vertexCount, D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2,
+			D3DPOOL_MANAGED, &vertexBuffer, NULL);
+
+
+		vertexBuffer->Lock(0, sizeof(Vertex) * vertexCount, (void**) &verts, NULL);
+
+		memcpy(verts, vertices, sizeof(Vertex) * vertexCount);
+
+		vertexBuffer->Unlock();
+	}
+
+	// 16 bit on the GPU too when the file was written that way and every index fits
+	if ((file.header.flags & MESH_FILE_INDEX16) && vertexCount < 65536)
+	{
+		device->CreateIndexBuffer(sizeof(unsigned short) * indexCount, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16,
+			D3DPOOL_MANAGED, &indexBuffer, NULL);
+
+		indexBuffer->Lock(0, sizeof(unsigned short) * indexCount, &inds, NULL);
+
+		unsigned short* shortInds = (unsigned short*) inds;
+		for (int i = 0; i < indexCount; i++)
+		{
+			shortInds[i] = (unsigned short) indices[i];
+		}
+
+		indexBuffer->Unlock();
+	}
+	else
+	{
+		device->CreateIndexBuffer(sizeof(unsigned long) * indexCount, D3DUSAGE_WRITEONLY, D3DFMT_INDEX32,
+			D3DPOOL_MANAGED, &indexBuffer, NULL);
+
+		indexBuffer->Lock(0, sizeof(unsigned long) * indexCount, &inds, NULL);
+
+		memcpy(inds, indices, sizeof(unsigned long) * indexCount);
+
+		indexBuffer->Unlock();
+	}
+
+	return true;
+}
+
+void Mesh::render(IDirect3DDevice9* device)
+{
+	bind(device);
+	draw(device);
+}
+
+void Mesh::bind(IDirect3DDevice9* device)
+{
+	if (packed)
+	{
+		StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(PackedVertex));
+		StateCache::cache->setVertexDeclaration(D3D9MeshShader::shader->getPackedDeclaration());
+		D3D9MeshShader::shader->setQuantization(quantization);
+	}
+	else
+	{
+		StateCache::cache->setStreamSource(0, vertexBuffer, 0, sizeof(Vertex));
+		StateCache::cache->setFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2);
+	}
+	StateCache::cache->setIndices(indexBuffer);
+}
+
+void Mesh::draw(IDirect3DDevice9* device)
+{
+	if (packed)
+	{
+		// Back to the fixed function pipeline straight after, like the instancer
+		device->SetVertexShader(D3D9MeshShader::shader->getShader(MESH_SHADER_PACKED));
+		device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, vertexCount, 0, indexCount / 3);
+		device->SetVertexShader(NULL);
+	}
+	else
+	{
+		device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, vertexCount, 0, indexCount / 3);
+	}
+}
+
+void Mesh::drawChunks(IDirect3DDevice9* device)
 {
-	// Set vertexCount and indexCount
-	std::ifstream filestream(filename, std::ifstream::binary);
-	
-	filestream.read((char*)&vertexCount, 4);
-	filestream.read((char*)&indexCount, 4);
+	if (packed)
+	{
+		device->SetVertexShader(D3D9MeshShader::shader->getShader(MESH_SHADER_PACKED));
+	}
 
-	vertices = new Vertex[vertexCount];
-	indices = new unsigned long[indexCount];
+	for (unsigned int i = 0; i < chunks->visibleRuns.size(); i++)
+	{
+		const WorldChunkRun& run = chunks->visibleRuns[i];
+		device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, run.minVertex, run.vertexCount, run.firstIndex, run.indexCount / 3);
+	}
 
-	// Populate vertex buffer and index buffer
-	for (int i = 0; i < vertexCount; i++)
+	if (packed)
 	{
-		filestream.read((char*)&vertices[i].position.x, 4);
-		filestream.read((char*)&vertices[i].position.y, 4);
-		filestream.read((char*)&vertices[i].position.z, 4);
+		device->SetVertexShader(NULL);
+	}
+}
 
-		filestream.read((char*)&vertices[i].normal.x, 4);
-		filestream.read((char*)&vertices[i].normal.y, 4);
-		filestream.read((char*)&vertices[i].normal.z, 4);
+void Mesh::releaseCPUData()
+{
+	// Counts stay valid for rendering
+	file.release();
+	vertices = NULL;
+	indices = NULL;
+	adjacency = NULL;
 
-		filestream.read((char*)&vertices[i].u, 4);
-		filestream.read((char*)&vertices[i].v, 4);
+	for (int i = 1; i < lodCount; i++)
+	{
+		lods[i]->releaseCPUData();
 	}
+}
+
+ShadowSilhouette* Mesh::getSilhouette()
+{
+	if (!silhouette && vertices)
+	{
+		silhouette = new ShadowSilhouette();
+		silhouette->initialize((const float*) vertices, sizeof(Vertex) / sizeof(float), vertexCount,
+			(const unsigned int*) indices, indexCount, adjacency);
+	}
+
+	return silhouette;
+}
+
+void Mesh::addLod(Mesh* lod)
+{
+	if (lodCount >= LOD_MAX_LEVELS)
+	{
+		delete lod;
+		return;
+	}
+
+	lods[lodCount] = lod;
+	lodErrors[lodCount] = boundsRadius > 0.0f ? lod->lodError / boundsRadius : 0.0f;
+	lodCount++;
+}
+
+Mesh* Mesh::getLod(int level)
+{
+	return level < lodCount ? lods[level] : this;
+}
+
+void Mesh::loadMesh(std::string filename)
+{
+	// One read for the whole file (v2 .mesh, or an original .ese)
+	if (!file.load(filename))
+	{
+		vertices = NULL;
+		indices = NULL;
+		adjacency = NULL;
+		vertexCount = 0;
+		indexCount = 0;
+		return;
+	}
+
+	// MeshFileVertex matches Vertex, and unsigned long is 32 bit on Win32
+	vertices = (Vertex*) file.vertices;
+	indices = (unsigned long*) file.indices;
+	vertexCount = file.vertexCount;
+	indexCount = file.indexCount;
+
+	// Bounds come from the header (or are computed when an .ese is loaded)
+	boundsCenter = D3DXVECTOR3(file.header.sphereCenter[0], file.header.sphereCenter[1], file.header.sphereCenter[2]);
+	boundsRadius = file.header.sphereRadius;
+	lodError = file.header.lodError;
 
-	for (int i = 0; i < indexCount; i++)
+	// Converted files carry the shadow volume edge connectivity; work it out for any that don't
+	if (!file.adjacency)
 	{
-		filestream.read((char*)&indices[i], 4);
+		file.computeAdjacency(MESH_ADJACENCY_WELD);
 	}
+	adjacency = file.adjacency;
 
-	filestream.close();
-	
 	return;
 }
@@ -5,6 +5,13 @@
 #include <iostream>
 #include <fstream>
 
+#include "D3D9MeshShader.h"
+#include "MeshFile.h"
+#include "MeshLod.h"
+#include "ShadowSilhouette.h"
+#include "StateCache.h"
+#include "WorldChunks.h"
+
 
 struct Vertex
 {
@@ -13,12 +20,23 @@ struct Vertex
 	float u, v; // Texture coordinates
 };
 
+// A model loaded from a .mesh file and uploaded to the GPU. Meshes are
+// shared between drawables and owned by the MeshRegistry, so get them from
+// MeshRegistry::registry->acquire() instead of creating them directly.
 class Mesh
 {
 public:
-	Mesh();
+	Mesh(std::string name);
 	~Mesh();
-	virtual void render(IDirect3DDevice9* device) = 0;
+	bool load(IDirect3DDevice9* device, std::string filename);
+	void render(IDirect3DDevice9* device);
+	void bind(IDirect3DDevice9* device);	// render() is bind() then draw()
+	void draw(IDirect3DDevice9* device);
+	void drawChunks(IDirect3DDevice9* device);	// Only chunks->visibleRuns, from its last cull
+	void releaseCPUData();	// vertices/indices/adjacency become NULL, the GPU copy stays
+	ShadowSilhouette* getSilhouette();	// Built on first use, from the CPU data
+	void addLod(Mesh* lod);		// Takes ownership; levels are added coarser each time
+	Mesh* getLod(int level);
 	
 protected:
 	IDirect3DVertexBuffer9* vertexBuffer;
@@ -26,10 +44,38 @@ protected:
 
 	void loadMesh(std::string filename);
 
+	MeshFile file;
+
 public:
 	Vertex* vertices;
 	unsigned long* indices;
+	unsigned int* adjacency;	// 3 per face, the face across each edge (MESH_FILE_NO_NEIGHBOUR if open)
 
 	int vertexCount;
 	int indexCount;
+
+	// Drawn from PackedVertex with D3D9MeshShader's packed variant; otherwise
+	// the vertices (decoded, if the file was packed) go to the fixed function pipeline
+	bool packed;
+	float quantization[VERTEX_PACKING_CONSTANTS];
+
+	// Model space bounding sphere, kept when the CPU data is released
+	D3DXVECTOR3 boundsCenter;
+	float boundsRadius;
+
+	ShadowSilhouette* silhouette;
+
+	// Simplified levels from models/<name>_lodN.mesh; lods[0] is this mesh.
+	// lodErrors are each level's error as a fraction of boundsRadius, for selectLod().
+	Mesh* lods[LOD_MAX_LEVELS];
+	float lodErrors[LOD_MAX_LEVELS];
+	int lodCount;
+	float lodError;		// This level's own error, in model units
+
+	// From models/<name>.chunks, for big static meshes (the track); NULL otherwise
+	WorldChunks* chunks;
+
+	std::string name;
+	int refCount;
+	bool pinned;		// Preloaded from the manifest, stays resident when nothing uses it
 };
@@ -0,0 +1,368 @@
+#include "MeshFile.h"
+#include "EdgeConnectivity.h"
+
+#include <fstream>
+#include <vector>
+#include <string.h>
+#include <math.h>
+
+
+#define ALIGN16(x) (((x) + 15) & ~15)
+
+MeshFile::MeshFile()
+{
+	vertices = NULL;
+	packedVertices = NULL;
+	indices = NULL;
+	adjacency = NULL;
+	vertexCount = 0;
+	indexCount = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+
+MeshFile::~MeshFile()
+{
+	release();
+}
+
+void MeshFile::release()
+{
+	if (vertices)
+	{
+		delete [] vertices;
+		vertices = NULL;
+	}
+
+	if (packedVertices)
+	{
+		delete [] packedVertices;
+		packedVertices = NULL;
+	}
+
+	if (indices)
+	{
+		delete [] indices;
+		indices = NULL;
+	}
+
+	if (adjacency)
+	{
+		delete [] adjacency;
+		adjacency = NULL;
+	}
+
+	vertexCount = 0;
+	indexCount = 0;
+}
+
+bool MeshFile::load(std::string filename)
+{
+	std::ifstream filestream(filename.c_str(), std::ifstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	filestream.seekg(0, std::ios::end);
+	unsigned int size = (unsigned int) filestream.tellg();
+	filestream.seekg(0, std::ios::beg);
+
+	if (size < 8)
+	{
+		return false;
+	}
+
+	// The whole file in one read
+	char* data = new char[size];
+	filestream.read(data, size);
+	bool ok = filestream.good();
+	filestream.close();
+
+	if (ok)
+	{
+		release();
+
+		if (size >= sizeof(MeshFileHeader) && memcmp(data, "ESE2", 4) == 0)
+		{
+			ok = loadVersion2(data, size);
+		}
+		else
+		{
+			ok = loadLegacy(data, size);
+		}
+
+		if (!ok)
+		{
+			release();
+		}
+	}
+
+	delete [] data;
+
+	return ok;
+}
+
+bool MeshFile::loadLegacy(const char* data, unsigned int size)
+{
+	int counts[2];
+	memcpy(counts, data, 8);
+
+	// Counts are checked by division so a huge count can't wrap the size check
+	if (counts[0] <= 0 || counts[1] <= 0 || counts[1] % 3 != 0 ||
+		(unsigned int) counts[0] > (size - 8) / sizeof(MeshFileVertex) ||
+		(unsigned int) counts[1] > (size - 8 - counts[0] * sizeof(MeshFileVertex)) / 4)
+	{
+		return false;
+	}
+
+	vertexCount = counts[0];
+	indexCount = counts[1];
+
+	vertices = new MeshFileVertex[vertexCount];
+	indices = new unsigned int[indexCount];
+	memcpy(vertices, data + 8, vertexCount * sizeof(MeshFileVertex));
+	memcpy(indices, data + 8 + vertexCount * sizeof(MeshFileVertex), indexCount * 4);
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (indices[i] >= (unsigned int) vertexCount)
+		{
+			return false;
+		}
+	}
+
+	computeBounds();
+
+	return true;
+}
+
+bool MeshFile::loadVersion2(const char* data, unsigned int size)
+{
+	memcpy(&header, data, sizeof(header));
+
+	unsigned int indexSize = (header.flags & MESH_FILE_INDEX16) ? 2 : 4;
+	unsigned int vertexSize = (header.flags & MESH_FILE_PACKED) ? sizeof(PackedVertex) : sizeof(MeshFileVertex);
+
+	// Validate every section against the real file size before touching it.
+	// Counts are compared against the room left after their offset, since
+	// count * element size can wrap around in 32 bits.
+	if (header.version != MESH_FILE_VERSION ||
+		header.headerSize != sizeof(MeshFileHeader) ||
+		header.fileSize != size ||
+		header.vertexStride != vertexSize ||
+		header.vertexCount == 0 || header.indexCount == 0 || header.indexCount % 3 != 0 ||
+		header.vertexOffset < header.headerSize || header.vertexOffset > size ||
+		header.vertexCount > (size - header.vertexOffset) / header.vertexStride)
+	{
+		return false;
+	}
+
+	unsigned int vertexEnd = header.vertexOffset + header.vertexCount * header.vertexStride;
+	if (header.indexOffset < vertexEnd || header.indexOffset > size ||
+		header.indexCount > (size - header.indexOffset) / indexSize)
+	{
+		return false;
+	}
+
+	unsigned int indexEnd = header.indexOffset + header.indexCount * indexSize;
+	if ((header.flags & MESH_FILE_ADJACENCY) &&
+		(header.adjacencyOffset < indexEnd || header.adjacencyOffset > size ||
+		header.indexCount > (size - header.adjacencyOffset) / 4))
+	{
+		return false;
+	}
+
+	vertexCount = header.vertexCount;
+	indexCount = header.indexCount;
+
+	vertices = new MeshFileVertex[vertexCount];
+	if (header.flags & MESH_FILE_PACKED)
+	{
+		packedVertices = new PackedVertex[vertexCount];
+		memcpy(packedVertices, data + header.vertexOffset, vertexCount * sizeof(PackedVertex));
+
+		// The CPU side (shadow silhouettes) works from what the GPU will draw
+		VertexPacker packer;
+		packer.setBounds(header.aabbMin, header.aabbMax, header.uvMin, header.uvMax);
+		packer.unpack(packedVertices, vertexCount, vertices[0].position, sizeof(MeshFileVertex) / sizeof(float));
+	}
+	else
+	{
+		memcpy(vertices, data + header.vertexOffset, vertexCount * sizeof(MeshFileVertex));
+	}
+
+	indices = new unsigned int[indexCount];
+	if (indexSize == 2)
+	{
+		const unsigned short* shortIndices = (const unsigned short*) (data + header.indexOffset);
+		for (int i = 0; i < indexCount; i++)
+		{
+			indices[i] = shortIndices[i];
+		}
+	}
+	else
+	{
+		memcpy(indices, data + header.indexOffset, indexCount * 4);
+	}
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (indices[i] >= (unsigned int) vertexCount)
+		{
+			return false;
+		}
+	}
+
+	if (header.flags & MESH_FILE_ADJACENCY)
+	{
+		adjacency = new unsigned int[indexCount];
+		memcpy(adjacency, data + header.adjacencyOffset, indexCount * 4);
+
+		// Entries are used as face indices by the shadow silhouettes
+		unsigned int faceCount = indexCount / 3;
+		for (int i = 0; i < indexCount; i++)
+		{
+			if (adjacency[i] >= faceCount && adjacency[i] != 0xFFFFFFFF)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool MeshFile::save(std::string filename, bool index16, bool packed)
+{
+	if (!vertices || !indices)
+	{
+		return false;
+	}
+
+	if (vertexCount > 65535)
+	{
+		index16 = false;
+	}
+
+	unsigned int indexSize = index16 ? 2 : 4;
+	unsigned int vertexSize = packed ? sizeof(PackedVertex) : sizeof(MeshFileVertex);
+
+	memcpy(header.magic, "ESE2", 4);
+	header.version = MESH_FILE_VERSION;
+	header.headerSize = sizeof(MeshFileHeader);
+	header.flags = (index16 ? MESH_FILE_INDEX16 : 0) | (adjacency ? MESH_FILE_ADJACENCY : 0) | (packed ? MESH_FILE_PACKED : 0);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.vertexStride = vertexSize;
+	header.vertexOffset = ALIGN16(header.headerSize);
+	header.indexOffset = ALIGN16(header.vertexOffset + vertexCount * vertexSize);
+	header.adjacencyOffset = adjacency ? ALIGN16(header.indexOffset + indexCount * indexSize) : 0;
+	header.fileSize = adjacency ? header.adjacencyOffset + indexCount * 4 : header.indexOffset + indexCount * indexSize;
+	memset(header.reserved, 0, sizeof(header.reserved));
+
+	std::vector<char> data(header.fileSize, 0);
+	memcpy(&data[0], &header, sizeof(header));
+	if (packed)
+	{
+		VertexPacker packer;
+		packer.setBounds(header.aabbMin, header.aabbMax, header.uvMin, header.uvMax);
+		packer.pack(vertices[0].position, sizeof(MeshFileVertex) / sizeof(float), vertexCount, (PackedVertex*) &data[header.vertexOffset]);
+	}
+	else
+	{
+		memcpy(&data[header.vertexOffset], vertices, vertexCount * sizeof(MeshFileVertex));
+	}
+
+	if (index16)
+	{
+		unsigned short* shortIndices = (unsigned short*) &data[header.indexOffset];
+		for (int i = 0; i < indexCount; i++)
+		{
+			shortIndices[i] = (unsigned short) indices[i];
+		}
+	}
+	else
+	{
+		memcpy(&data[header.indexOffset], indices, indexCount * 4);
+	}
+
+	if (adjacency)
+	{
+		memcpy(&data[header.adjacencyOffset], adjacency, indexCount * 4);
+	}
+
+	std::ofstream filestream(filename.c_str(), std::ofstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	filestream.write(&data[0], data.size());
+	bool ok = filestream.good();
+	filestream.close();
+
+	return ok;
+}
+
+void MeshFile::computeBounds()
+{
+	for (int k = 0; k < 3; k++)
+	{
+		header.aabbMin[k] = vertexCount > 0 ? vertices[0].position[k] : 0.0f;
+		header.aabbMax[k] = header.aabbMin[k];
+	}
+
+	header.uvMin[0] = header.uvMax[0] = vertexCount > 0 ? vertices[0].u : 0.0f;
+	header.uvMin[1] = header.uvMax[1] = vertexCount > 0 ? vertices[0].v : 0.0f;
+
+	for (int i = 1; i < vertexCount; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			if (vertices[i].position[k] < header.aabbMin[k]) header.aabbMin[k] = vertices[i].position[k];
+			if (vertices[i].position[k] > header.aabbMax[k]) header.aabbMax[k] = vertices[i].position[k];
+		}
+
+		if (vertices[i].u < header.uvMin[0]) header.uvMin[0] = vertices[i].u;
+		if (vertices[i].u > header.uvMax[0]) header.uvMax[0] = vertices[i].u;
+		if (vertices[i].v < header.uvMin[1]) header.uvMin[1] = vertices[i].v;
+		if (vertices[i].v > header.uvMax[1]) header.uvMax[1] = vertices[i].v;
+	}
+
+	// Sphere around the box centre, sized to the furthest vertex
+	float radiusSq = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		header.sphereCenter[k] = (header.aabbMin[k] + header.aabbMax[k]) * 0.5f;
+	}
+
+	for (int i = 0; i < vertexCount; i++)
+	{
+		float dx = vertices[i].position[0] - header.sphereCenter[0];
+		float dy = vertices[i].position[1] - header.sphereCenter[1];
+		float dz = vertices[i].position[2] - header.sphereCenter[2];
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+		if (distanceSq > radiusSq)
+		{
+			radiusSq = distanceSq;
+		}
+	}
+
+	header.sphereRadius = sqrt(radiusSq);
+}
+
+// For each face edge (a, b), the first other face containing the edge (b, a)
+// by position. Same matching rule as the old shadow volume connectivity tables.
+void MeshFile::computeAdjacency(float weldDistance)
+{
+	if (adjacency)
+	{
+		delete [] adjacency;
+	}
+	adjacency = new unsigned int[indexCount];
+
+	EdgeConnectivity connectivity;
+	connectivity.build((const float*) vertices, sizeof(MeshFileVertex) / sizeof(float), vertexCount,
+		indices, indexCount, weldDistance, adjacency);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+
+#include "VertexPacking.h"
+
+#define MESH_FILE_VERSION 3
+
+#define MESH_FILE_INDEX16		0x1		// Indices are stored as 16 bit
+#define MESH_FILE_ADJACENCY		0x2		// Per-face edge neighbours follow the indices
+#define MESH_FILE_PACKED		0x4		// Vertices are PackedVertex, quantized across the bounds
+
+#define MESH_FILE_NO_NEIGHBOUR	0xFFFFFFFF	// Same as EDGE_NO_NEIGHBOUR
+#define MESH_ADJACENCY_WELD		0.0f		// Corners closer than this share edges
+
+
+// Same layout as Vertex in Mesh.h (32 bytes), without the D3DX types
+struct MeshFileVertex
+{
+	float position[3];
+	float normal[3];
+	float u, v;
+};
+
+// Everything is 4 byte fields so the layout is the same on every compiler.
+// Sections start on 16 byte boundaries and are addressed by byte offset.
+struct MeshFileHeader
+{
+	char magic[4];				// "ESE2"
+	unsigned int version;
+	unsigned int headerSize;
+	unsigned int flags;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int vertexStride;
+	unsigned int vertexOffset;
+	unsigned int indexOffset;
+	unsigned int adjacencyOffset;	// 0 when there is no adjacency block
+	unsigned int fileSize;
+
+	float aabbMin[3];
+	float aabbMax[3];
+	float sphereCenter[3];
+	float sphereRadius;
+
+	float uvMin[2];
+	float uvMax[2];
+
+	float lodError;				// Simplified levels (<name>_lodN.mesh): how far they are from the full mesh; 0 otherwise
+
+	unsigned int reserved[2];
+};
+
+// Loads v2 mesh files with a single read, and the original .ese format
+// (vertex count, index count, vertices, 32 bit indices) for conversion.
+class MeshFile
+{
+public:
+	MeshFile();
+	~MeshFile();
+
+	bool load(std::string filename);		// Either format, picked by the magic number
+	bool save(std::string filename, bool index16, bool packed);	// packed quantizes across computeBounds()'s box
+	void release();
+
+	void computeBounds();		// Positions and uvs
+	void computeAdjacency(float weldDistance);
+
+private:
+	bool loadLegacy(const char* data, unsigned int size);
+	bool loadVersion2(const char* data, unsigned int size);
+
+public:
+	MeshFileHeader header;
+
+	MeshFileVertex* vertices;		// Decoded when the file is packed
+	PackedVertex* packedVertices;	// As stored, for the GPU; NULL unless the file is packed
+	unsigned int* indices;			// Always 32 bit in memory
+	unsigned int* adjacency;		// 3 per face, MESH_FILE_NO_NEIGHBOUR on open edges; NULL if not present
+
+	int vertexCount;
+	int indexCount;
+};
@@ -0,0 +1,17 @@
+#include "MeshLod.h"
+
+
+int selectLod(const float* errors, int levelCount, float screenSize, int current)
+{
+	// The coarsest level whose error is small enough on screen
+	for (int level = levelCount - 1; level > 0; level--)
+	{
+		float limit = LOD_PIXEL_ERROR * (level > current ? 1.0f - LOD_HYSTERESIS : 1.0f + LOD_HYSTERESIS);
+		if (errors[level] * screenSize <= limit)
+		{
+			return level;
+		}
+	}
+
+	return 0;
+}
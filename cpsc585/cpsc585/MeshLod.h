@@ -0,0 +1,14 @@
+#pragma once
+
+#define LOD_MAX_LEVELS		4		// The full mesh and up to three simplified ones
+#define LOD_PIXEL_ERROR		1.0f	// A level is drawn once its error covers less than this many pixels
+#define LOD_HYSTERESIS		0.25f	// Fraction past that the error has to go before the level changes again
+
+
+// Level of detail for a mesh whose bounding sphere has a projected radius of
+// screenSize pixels. errors[i] is level i's simplification error as a
+// fraction of the bounding radius (errors[0] is 0), coarsest level last.
+// current is the level picked last frame: moving to a coarser level needs the
+// error LOD_HYSTERESIS under the limit, and a level is kept until its error
+// is that far over, so a mesh sitting at a threshold doesn't flicker.
+int selectLod(const float* errors, int levelCount, float screenSize, int current);
@@ -0,0 +1,488 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+// Forsyth's scoring constants
+#define CACHE_DECAY_POWER		1.5f
+#define LAST_TRIANGLE_SCORE		0.75f
+#define VALENCE_BOOST_SCALE		2.0f
+#define VALENCE_BOOST_POWER		0.5f
+
+
+static unsigned int hashBytes(const unsigned char* data, int size)
+{
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < size; i++)
+	{
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+
+// Sorts cluster numbers by key, largest first; equal keys keep their order
+struct ClusterKeyGreater
+{
+	const float* keys;
+
+	bool operator()(int a, int b) const
+	{
+		return keys[a] > keys[b];
+	}
+};
+
+
+MeshOptimizer::MeshOptimizer()
+{
+	transformedCount = 0;
+	acmr = 0.0f;
+	atvr = 0.0f;
+	clusterCount = 0;
+}
+
+
+float MeshOptimizer::vertexScore(int vertex)
+{
+	if (activeCount[vertex] == 0)
+	{
+		return -1.0f;
+	}
+
+	float result = 0.0f;
+	int position = cachePosition[vertex];
+
+	if (position >= 0)
+	{
+		if (position < 3)
+		{
+			// Used by the last triangle: a fixed score, so the order doesn't just go back and forth
+			result = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scaled = 1.0f - (position - 3) * (1.0f / (MESH_OPTIMIZER_CACHE_SIZE - 3));
+			result = powf(scaled, CACHE_DECAY_POWER);
+		}
+	}
+
+	// Finish off vertices with few triangles left, so they can leave the cache for good
+	result += VALENCE_BOOST_SCALE * powf((float) activeCount[vertex], -VALENCE_BOOST_POWER);
+
+	return result;
+}
+
+
+int MeshOptimizer::weldVertices(void* vertexData, int vertexSize, int vertexCount, unsigned int* indices, int indexCount)
+{
+	unsigned char* vertices = (unsigned char*) vertexData;
+
+	// Power of two at least twice the count, so the table stays at most half full
+	unsigned int size = 16;
+	while (size < (unsigned int) vertexCount * 2)
+	{
+		size <<= 1;
+	}
+	buckets.assign(size, -1);
+	remap.resize(vertexCount);
+
+	int unique = 0;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		const unsigned char* vertex = &vertices[v * vertexSize];
+		unsigned int slot = hashBytes(vertex, vertexSize) & (size - 1);
+
+		while (buckets[slot] != -1 && memcmp(&vertices[buckets[slot] * vertexSize], vertex, vertexSize) != 0)
+		{
+			slot = (slot + 1) & (size - 1);
+		}
+
+		if (buckets[slot] == -1)
+		{
+			// Kept vertices move down in place, never past one still to be read
+			memmove(&vertices[unique * vertexSize], vertex, vertexSize);
+			buckets[slot] = unique++;
+		}
+		remap[v] = buckets[slot];
+	}
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		indices[i] = remap[indices[i]];
+	}
+
+	return unique;
+}
+
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles per vertex, as one list with a start per vertex
+	activeCount.assign(vertexCount, 0);
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		activeCount[indices[i]]++;
+	}
+
+	triangleStart.resize(vertexCount + 1);
+	triangleStart[0] = 0;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		triangleStart[v + 1] = triangleStart[v] + activeCount[v];
+	}
+
+	std::vector<int> filled(triangleStart.begin(), triangleStart.end() - 1);
+	vertexTriangles.resize(triangleCount * 3);
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		vertexTriangles[filled[indices[i]]++] = i / 3;
+	}
+
+	cachePosition.assign(vertexCount, -1);
+	score.resize(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		score[v] = vertexScore(v);
+	}
+
+	triangleScore.resize(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+	}
+
+	emitted.assign(triangleCount, 0);
+	output.resize(triangleCount * 3);
+
+	// The cache, with room for the three vertices pushed in front before the end falls off
+	int cache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+	int cacheUsed = 0;
+
+	int best = -1;
+	int nextUnemitted = 0;
+
+	for (int out = 0; out < triangleCount; out++)
+	{
+		// Nothing in the cache has triangles left: start again from the first
+		// one not drawn yet, which keeps this linear
+		if (best == -1)
+		{
+			while (emitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+			best = nextUnemitted;
+		}
+
+		emitted[best] = 1;
+		memcpy(&output[out * 3], &indices[best * 3], sizeof(unsigned int) * 3);
+
+		// Its vertices go to the front of the cache, and it leaves their lists
+		int newCache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+		int newUsed = 0;
+
+		for (int k = 0; k < 3; k++)
+		{
+			int v = indices[best * 3 + k];
+			newCache[newUsed++] = v;
+
+			int* list = &vertexTriangles[triangleStart[v]];
+			int count = activeCount[v];
+			for (int i = 0; i < count; i++)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[count - 1];
+					list[count - 1] = best;
+					break;
+				}
+			}
+			activeCount[v]--;
+		}
+
+		for (int i = 0; i < cacheUsed; i++)
+		{
+			int v = cache[i];
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+			{
+				newCache[newUsed++] = v;
+			}
+		}
+
+		// Rescore what is in the cache, and what fell out of it
+		for (int i = 0; i < newUsed; i++)
+		{
+			cachePosition[newCache[i]] = i < MESH_OPTIMIZER_CACHE_SIZE ? i : -1;
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+
+		for (int i = 0; i < newUsed; i++)
+		{
+			int v = newCache[i];
+			float newScore = vertexScore(v);
+			float change = newScore - score[v];
+			score[v] = newScore;
+
+			const int* list = &vertexTriangles[triangleStart[v]];
+			for (int j = 0; j < activeCount[v]; j++)
+			{
+				int t = list[j];
+				triangleScore[t] += change;
+
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheUsed = newUsed < MESH_OPTIMIZER_CACHE_SIZE ? newUsed : MESH_OPTIMIZER_CACHE_SIZE;
+		memcpy(cache, newCache, sizeof(int) * cacheUsed);
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * triangleCount * 3);
+}
+
+
+// FIFO cache by timestamps: a vertex is cached if it went in within the last cacheSize misses.
+// Returns the misses for the triangle.
+int MeshOptimizer::updateCache(unsigned int a, unsigned int b, unsigned int c, int cacheSize, unsigned int& timestamp)
+{
+	int misses = 0;
+	unsigned int corners[3] = { a, b, c };
+
+	for (int k = 0; k < 3; k++)
+	{
+		if (timestamp - cacheTimestamp[corners[k]] > (unsigned int) cacheSize)
+		{
+			cacheTimestamp[corners[k]] = timestamp++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+// Moves time on far enough that everything counts as evicted
+void MeshOptimizer::resetCache(int cacheSize, unsigned int& timestamp)
+{
+	timestamp += cacheSize + 1;
+}
+
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* indices, int indexCount, const float* vertexData, int stride,
+	int vertexCount, float threshold)
+{
+	int triangleCount = indexCount / 3;
+	clusterCount = 0;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	cacheTimestamp.assign(vertexCount, 0);
+	unsigned int timestamp = MESH_ANALYZE_CACHE_SIZE + 1;
+
+	// Hard boundaries: a triangle missing on all three corners starts a new
+	// patch anyway, so nothing is lost by moving it
+	std::vector<int> hard;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int misses = updateCache(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2], MESH_ANALYZE_CACHE_SIZE, timestamp);
+		if (t == 0 || misses == 3)
+		{
+			hard.push_back(t);
+		}
+	}
+	hard.push_back(triangleCount);
+
+	// Soft boundaries: split a patch again wherever the part so far already
+	// gets within threshold of the whole patch's ACMR
+	clusters.clear();
+	for (unsigned int h = 0; h + 1 < hard.size(); h++)
+	{
+		int start = hard[h], end = hard[h + 1];
+
+		resetCache(MESH_ANALYZE_CACHE_SIZE, timestamp);
+		int patchMisses = 0;
+		for (int t = start; t < end; t++)
+		{
+			patchMisses += updateCache(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2], MESH_ANALYZE_CACHE_SIZE, timestamp);
+		}
+		float target = threshold * patchMisses / (end - start);
+
+		resetCache(MESH_ANALYZE_CACHE_SIZE, timestamp);
+		clusters.push_back(start);
+		int misses = 0, faces = 0;
+		for (int t = start; t < end; t++)
+		{
+			misses += updateCache(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2], MESH_ANALYZE_CACHE_SIZE, timestamp);
+			faces++;
+
+			if (t + 1 < end && (float) misses / faces <= target)
+			{
+				clusters.push_back(t + 1);
+				resetCache(MESH_ANALYZE_CACHE_SIZE, timestamp);
+				misses = 0;
+				faces = 0;
+			}
+		}
+	}
+	clusterCount = clusters.size();
+	clusters.push_back(triangleCount);
+
+	// Centre of the mesh, by area
+	float meshCentre[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	std::vector<float> clusterData(clusterCount * 7);		// Area weighted centre and normal, and area
+	for (int c = 0; c < clusterCount; c++)
+	{
+		float* data = &clusterData[c * 7];
+		memset(data, 0, sizeof(float) * 7);
+
+		for (int t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const float* p0 = &vertexData[indices[t * 3] * stride];
+			const float* p1 = &vertexData[indices[t * 3 + 1] * stride];
+			const float* p2 = &vertexData[indices[t * 3 + 2] * stride];
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int k = 0; k < 3; k++)
+			{
+				data[k] += (p0[k] + p1[k] + p2[k]) * (1.0f / 3.0f) * area;
+				data[3 + k] += normal[k];
+			}
+			data[6] += area;
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			meshCentre[k] += data[k];
+		}
+		meshArea += data[6];
+	}
+
+	if (meshArea > 0.0f)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			meshCentre[k] /= meshArea;
+		}
+	}
+
+	// How far out along its own normal a cluster sits: the further, the more
+	// likely it covers others, so it goes first
+	clusterKey.resize(clusterCount);
+	clusterOrder.resize(clusterCount);
+	for (int c = 0; c < clusterCount; c++)
+	{
+		const float* data = &clusterData[c * 7];
+		float length = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+
+		clusterKey[c] = 0.0f;
+		if (data[6] > 0.0f && length > 0.0f)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				clusterKey[c] += (data[k] / data[6] - meshCentre[k]) * data[3 + k] / length;
+			}
+		}
+		clusterOrder[c] = c;
+	}
+
+	ClusterKeyGreater greater;
+	greater.keys = &clusterKey[0];
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), greater);
+
+	output.resize(triangleCount * 3);
+	int out = 0;
+	for (int i = 0; i < clusterCount; i++)
+	{
+		int c = clusterOrder[i];
+		int count = (clusters[c + 1] - clusters[c]) * 3;
+		memcpy(&output[out], &indices[clusters[c] * 3], sizeof(unsigned int) * count);
+		out += count;
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * triangleCount * 3);
+}
+
+
+int MeshOptimizer::optimizeVertexFetch(void* vertexData, int vertexSize, int vertexCount, unsigned int* indices, int indexCount)
+{
+	remap.assign(vertexCount, -1);
+	int next = 0;
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (remap[indices[i]] == -1)
+		{
+			remap[indices[i]] = next++;
+		}
+		indices[i] = remap[indices[i]];
+	}
+
+	int used = next;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] == -1)
+		{
+			remap[v] = next++;
+		}
+	}
+
+	char* vertices = (char*) vertexData;
+	vertexCopy.assign(vertices, vertices + vertexCount * vertexSize);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		memcpy(&vertices[remap[v] * vertexSize], &vertexCopy[v * vertexSize], vertexSize);
+	}
+
+	return used;
+}
+
+
+void MeshOptimizer::analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	int triangleCount = indexCount / 3;
+
+	cacheTimestamp.assign(vertexCount, 0);
+	unsigned int timestamp = cacheSize + 1;
+
+	transformedCount = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		transformedCount += updateCache(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2], cacheSize, timestamp);
+	}
+
+	// ATVR counts against the vertices actually drawn
+	std::vector<unsigned char> used(vertexCount, 0);
+	int usedCount = 0;
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = 1;
+			usedCount++;
+		}
+	}
+
+	acmr = triangleCount ? (float) transformedCount / triangleCount : 0.0f;
+	atvr = usedCount ? (float) transformedCount / usedCount : 0.0f;
+}
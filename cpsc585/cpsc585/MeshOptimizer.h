@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#define MESH_OPTIMIZER_CACHE_SIZE	32		// LRU entries the triangle order is tuned for
+#define MESH_ANALYZE_CACHE_SIZE		16		// FIFO entries of the cache ACMR is measured against
+#define MESH_OVERDRAW_THRESHOLD		1.05f	// How much worse ACMR may get for better overdraw
+
+
+// Offline reordering of indexed triangle lists, for the converter:
+//  - weldVertices: the exporter writes three vertices per triangle, so
+//    corners that are identical down to the bit are merged first
+//  - optimizeVertexCache: Forsyth's linear speed post-transform cache order
+//  - optimizeOverdraw: splits that order into clusters and draws outward
+//    facing ones first, so less is shaded and then covered
+//  - optimizeVertexFetch: vertices in the order the indices first use them
+// Working storage is kept between calls, like EdgeConnectivity.
+class MeshOptimizer
+{
+public:
+	MeshOptimizer();
+
+	// Merges byte for byte identical vertices, compacting vertexData and
+	// remapping the indices. Returns the new vertex count.
+	int weldVertices(void* vertexData, int vertexSize, int vertexCount, unsigned int* indices, int indexCount);
+
+	void optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount);
+
+	// Run after optimizeVertexCache. Positions are the first three floats of
+	// every vertex; stride is in floats. threshold is MESH_OVERDRAW_THRESHOLD.
+	void optimizeOverdraw(unsigned int* indices, int indexCount, const float* vertexData, int stride,
+		int vertexCount, float threshold);
+
+	// Reorders vertexSize byte vertices and remaps the indices. Vertices no
+	// index uses keep their relative order after the rest; returns how many are used.
+	int optimizeVertexFetch(void* vertexData, int vertexSize, int vertexCount, unsigned int* indices, int indexCount);
+
+	// Simulates a FIFO post-transform cache over the triangles
+	void analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize);
+
+private:
+	float vertexScore(int vertex);
+	int updateCache(unsigned int a, unsigned int b, unsigned int c, int cacheSize, unsigned int& timestamp);
+	void resetCache(int cacheSize, unsigned int& timestamp);
+
+	// Reused between runs
+	std::vector<int> triangleStart;		// Per vertex, into vertexTriangles
+	std::vector<int> vertexTriangles;	// Triangles using each vertex, unprocessed ones first
+	std::vector<int> activeCount;		// Unprocessed triangles per vertex
+	std::vector<int> cachePosition;		// Per vertex, -1 when not in the cache
+	std::vector<float> score;			// Per vertex
+	std::vector<float> triangleScore;
+	std::vector<unsigned char> emitted;
+	std::vector<unsigned int> output;
+
+	// FIFO simulation: the time each vertex went into the cache
+	std::vector<unsigned int> cacheTimestamp;
+
+	// Overdraw clusters
+	std::vector<int> clusters;			// First triangle of each
+	std::vector<float> clusterKey;
+	std::vector<int> clusterOrder;
+
+	std::vector<int> remap;
+	std::vector<int> buckets;			// Open addressed, vertex numbers or -1
+	std::vector<char> vertexCopy;
+
+public:
+	// From the last analyzeVertexCache
+	int transformedCount;	// Cache misses
+	float acmr;				// Misses per triangle: 0.5 is ideal, 3 is no reuse at all
+	float atvr;				// Misses per vertex used: 1 is ideal
+
+	int clusterCount;		// From the last optimizeOverdraw
+};
@@ -0,0 +1,156 @@
+#include "MeshRegistry.h"
+
+#include <stdio.h>
+
+MeshRegistry* MeshRegistry::registry = NULL;
+
+
+MeshRegistry::MeshRegistry(IDirect3DDevice9* device)
+{
+	this->device = device;
+	registry = this;
+}
+
+
+MeshRegistry::~MeshRegistry()
+{
+	for (std::map<std::string, Mesh*>::iterator it = meshes.begin(); it != meshes.end(); it++)
+	{
+		delete it->second;
+	}
+	meshes.clear();
+
+	if (registry == this)
+	{
+		registry = NULL;
+	}
+}
+
+Mesh* MeshRegistry::load(std::string name)
+{
+	Mesh* mesh = new Mesh(name);
+
+	if (!mesh->load(device, "models/" + name + ".mesh"))
+	{
+		delete mesh;
+		return NULL;
+	}
+
+	// Simplified levels, if the converter made any, ride along with the full mesh
+	for (int level = 1; level < LOD_MAX_LEVELS; level++)
+	{
+		char suffix[16];
+		sprintf_s(suffix, sizeof(suffix), "_lod%d", level);
+
+		Mesh* lod = new Mesh(name + suffix);
+		if (!lod->load(device, "models/" + name + suffix + ".mesh"))
+		{
+			delete lod;
+			break;
+		}
+		mesh->addLod(lod);
+	}
+
+	// Chunks for culling big meshes piece by piece, only if they were built for this index buffer
+	WorldChunks* chunks = new WorldChunks();
+	if (chunks->load("models/" + name + ".chunks") && chunks->indexCount == mesh->indexCount)
+	{
+		mesh->chunks = chunks;
+	}
+	else
+	{
+		delete chunks;
+	}
+
+	meshes[name] = mesh;
+
+	return mesh;
+}
+
+Mesh* MeshRegistry::acquire(std::string name)
+{
+	Mesh* mesh = NULL;
+
+	std::map<std::string, Mesh*>::iterator found = meshes.find(name);
+	if (found != meshes.end())
+	{
+		mesh = found->second;
+	}
+	else
+	{
+		mesh = load(name);
+	}
+
+	if (mesh)
+	{
+		mesh->refCount++;
+	}
+
+	return mesh;
+}
+
+void MeshRegistry::release(Mesh* mesh)
+{
+	if (!mesh)
+	{
+		return;
+	}
+
+	mesh->refCount--;
+
+	if (mesh->refCount <= 0 && !mesh->pinned)
+	{
+		meshes.erase(mesh->name);
+		delete mesh;
+	}
+}
+
+int MeshRegistry::preload(std::string manifest)
+{
+	std::ifstream filestream(manifest.c_str());
+	if (!filestream.is_open())
+	{
+		return 0;
+	}
+
+	int loaded = 0;
+	std::string name, policy;
+
+	while (filestream >> name >> policy)
+	{
+		Mesh* mesh = NULL;
+
+		std::map<std::string, Mesh*>::iterator found = meshes.find(name);
+		if (found != meshes.end())
+		{
+			mesh = found->second;
+		}
+		else
+		{
+			mesh = load(name);
+			if (mesh)
+			{
+				loaded++;
+			}
+		}
+
+		if (mesh)
+		{
+			mesh->pinned = true;
+
+			if (policy == "release")
+			{
+				mesh->releaseCPUData();
+			}
+		}
+	}
+
+	filestream.close();
+
+	return loaded;
+}
+
+int MeshRegistry::getResidentCount()
+{
+	return meshes.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "Mesh.h"
+
+
+// Owns every Mesh, keyed by asset name ("racer" -> models/racer.mesh).
+// Meshes are loaded on first acquire and refcounted by their users; the
+// ones listed in the manifest are loaded up front and stay resident.
+// models/racer_lod1.mesh and so on are loaded as the racer's simplified levels.
+class MeshRegistry
+{
+public:
+	MeshRegistry(IDirect3DDevice9* device);
+	~MeshRegistry();
+
+	Mesh* acquire(std::string name);
+	void release(Mesh* mesh);
+
+	// Manifest lines are "<name> keep" or "<name> release"; release drops the
+	// CPU copy once the mesh is on the GPU. Returns the number of meshes loaded.
+	int preload(std::string manifest);
+
+	int getResidentCount();
+
+	static MeshRegistry* registry;
+
+private:
+	Mesh* load(std::string name);
+
+	IDirect3DDevice9* device;
+	std::map<std::string, Mesh*> meshes;
+};
@@ -0,0 +1,634 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#define KIND_MANIFOLD	0		// Free to collapse onto any neighbour
+#define KIND_BORDER		1		// On an open edge: only collapses along it
+#define KIND_LOCKED		2		// On an edge with more than two faces: never moves
+
+
+static unsigned int hashInts(unsigned int a, unsigned int b, unsigned int c)
+{
+	unsigned int h = a * 0x8DA6B343u ^ b * 0xD8163841u ^ c * 0xCB1AB31Fu;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+// Power of two at least twice count, so the tables stay at most half full
+static unsigned int tableSize(int count)
+{
+	unsigned int size = 16;
+	while (size < (unsigned int) count * 2)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+// Bit pattern of a float, with -0 folded into 0 so they weld like == does
+static unsigned int floatKey(float value)
+{
+	if (value == 0.0f)
+	{
+		return 0;
+	}
+
+	unsigned int key;
+	memcpy(&key, &value, sizeof(key));
+	return key;
+}
+
+static void cross(const float* a, const float* b, const float* c, float* normal)
+{
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+	normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+	normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+	normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+// Squared distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static float triangleDistanceSquared(const float* p, const float* a, const float* b, const float* c)
+{
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+	float closest[3];
+
+	float d1 = ab[0] * ap[0] + ab[1] * ap[1] + ab[2] * ap[2];
+	float d2 = ac[0] * ap[0] + ac[1] * ap[1] + ac[2] * ap[2];
+
+	float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	float d3 = ab[0] * bp[0] + ab[1] * bp[1] + ab[2] * bp[2];
+	float d4 = ac[0] * bp[0] + ac[1] * bp[1] + ac[2] * bp[2];
+
+	float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	float d5 = ab[0] * cp[0] + ab[1] * cp[1] + ab[2] * cp[2];
+	float d6 = ac[0] * cp[0] + ac[1] * cp[1] + ac[2] * cp[2];
+
+	float vc = d1 * d4 - d3 * d2;
+	float vb = d5 * d2 - d1 * d6;
+	float va = d3 * d6 - d5 * d4;
+
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		memcpy(closest, a, sizeof(closest));
+	}
+	else if (d3 >= 0.0f && d4 <= d3)
+	{
+		memcpy(closest, b, sizeof(closest));
+	}
+	else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float t = d1 / (d1 - d3);
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + ab[k] * t;
+	}
+	else if (d6 >= 0.0f && d5 <= d6)
+	{
+		memcpy(closest, c, sizeof(closest));
+	}
+	else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float t = d2 / (d2 - d6);
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + ac[k] * t;
+	}
+	else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for (int k = 0; k < 3; k++) closest[k] = b[k] + (c[k] - b[k]) * t;
+	}
+	else
+	{
+		float denominator = 1.0f / (va + vb + vc);
+		float v = vb * denominator;
+		float w = vc * denominator;
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + ab[k] * v + ac[k] * w;
+	}
+
+	float x = p[0] - closest[0], y = p[1] - closest[1], z = p[2] - closest[2];
+	return x * x + y * y + z * z;
+}
+
+// Sorts collapses cheapest first; equal costs keep their order
+struct CollapseCheaper
+{
+	template <class T>
+	bool operator()(const T& a, const T& b) const
+	{
+		return a.cost < b.cost;
+	}
+};
+
+
+MeshSimplifier::MeshSimplifier()
+{
+	resultError = 0.0f;
+	passCount = 0;
+}
+
+
+void MeshSimplifier::addPlane(Quadric& q, const double* n, double d, double weight, double area)
+{
+	q.a00 += weight * n[0] * n[0];
+	q.a01 += weight * n[0] * n[1];
+	q.a02 += weight * n[0] * n[2];
+	q.a11 += weight * n[1] * n[1];
+	q.a12 += weight * n[1] * n[2];
+	q.a22 += weight * n[2] * n[2];
+	q.b0 += weight * n[0] * d;
+	q.b1 += weight * n[1] * d;
+	q.b2 += weight * n[2] * d;
+	q.c += weight * d * d;
+	q.weight += area;
+}
+
+
+void MeshSimplifier::weldPositions(const float* vertexData, int stride, int vertexCount)
+{
+	unsigned int size = tableSize(vertexCount);
+	buckets.assign(size, -1);
+	position.resize(vertexCount);
+	nextCorner.resize(vertexCount);
+
+	for (int v = 0; v < vertexCount; v++)
+	{
+		const float* p = &vertexData[v * stride];
+		unsigned int slot = hashInts(floatKey(p[0]), floatKey(p[1]), floatKey(p[2])) & (size - 1);
+
+		while (buckets[slot] != -1)
+		{
+			const float* q = &vertexData[buckets[slot] * stride];
+			if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2])
+			{
+				break;
+			}
+			slot = (slot + 1) & (size - 1);
+		}
+
+		if (buckets[slot] == -1)
+		{
+			buckets[slot] = v;
+			position[v] = v;
+			nextCorner[v] = v;
+		}
+		else
+		{
+			// Into the first vertex's ring
+			unsigned int first = buckets[slot];
+			position[v] = first;
+			nextCorner[v] = nextCorner[first];
+			nextCorner[first] = v;
+		}
+	}
+}
+
+
+int MeshSimplifier::findEdge(unsigned int from, unsigned int to)
+{
+	unsigned int mask = edges.size() - 1;
+	unsigned int slot = hashInts(from, to, 0) & mask;
+
+	while (edges[slot].count != 0)
+	{
+		if (edges[slot].from == from && edges[slot].to == to)
+		{
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+
+void MeshSimplifier::classifyVertices(int indexCount)
+{
+	Edge empty = { 0, 0, 0 };
+	edges.assign(tableSize(indexCount), empty);
+
+	for (int h = 0; h < indexCount; h++)
+	{
+		unsigned int from = position[result[h]];
+		unsigned int to = position[result[h - h % 3 + (h + 1) % 3]];
+
+		int slot = findEdge(from, to);
+		edges[slot].from = from;
+		edges[slot].to = to;
+		edges[slot].count++;
+	}
+
+	kind.assign(position.size(), KIND_MANIFOLD);
+
+	for (int h = 0; h < indexCount; h++)
+	{
+		unsigned int from = position[result[h]];
+		unsigned int to = position[result[h - h % 3 + (h + 1) % 3]];
+
+		if (edges[findEdge(from, to)].count > 1)
+		{
+			kind[from] = KIND_LOCKED;
+			kind[to] = KIND_LOCKED;
+		}
+		else if (edges[findEdge(to, from)].count == 0)
+		{
+			if (kind[from] != KIND_LOCKED) kind[from] = KIND_BORDER;
+			if (kind[to] != KIND_LOCKED) kind[to] = KIND_BORDER;
+		}
+	}
+}
+
+
+void MeshSimplifier::computeQuadrics(const float* vertexData, int stride, int indexCount)
+{
+	Quadric zero;
+	memset(&zero, 0, sizeof(zero));
+	quadrics.assign(position.size(), zero);
+
+	for (int f = 0; f < indexCount / 3; f++)
+	{
+		unsigned int corners[3] = { position[result[f * 3]], position[result[f * 3 + 1]], position[result[f * 3 + 2]] };
+		const float* p[3] = { &vertexData[corners[0] * stride], &vertexData[corners[1] * stride], &vertexData[corners[2] * stride] };
+
+		float normal[3];
+		cross(p[0], p[1], p[2], normal);
+		double length = sqrt((double) normal[0] * normal[0] + (double) normal[1] * normal[1] + (double) normal[2] * normal[2]);
+		if (length == 0.0)
+		{
+			continue;
+		}
+
+		double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+		double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+		double area = length * 0.5;
+
+		for (int k = 0; k < 3; k++)
+		{
+			addPlane(quadrics[corners[k]], n, d, area, area);
+		}
+
+		// Open edges get a plane through them at right angles to the face, so
+		// the outline of an opening stays put
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int from = corners[e];
+			unsigned int to = corners[(e + 1) % 3];
+			if (edges[findEdge(to, from)].count != 0)
+			{
+				continue;
+			}
+
+			double edge[3] = { p[(e + 1) % 3][0] - p[e][0], p[(e + 1) % 3][1] - p[e][1], p[(e + 1) % 3][2] - p[e][2] };
+			double m[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+			double edgeLength = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+			if (edgeLength == 0.0)
+			{
+				continue;
+			}
+
+			m[0] /= edgeLength;
+			m[1] /= edgeLength;
+			m[2] /= edgeLength;
+			double md = -(m[0] * p[e][0] + m[1] * p[e][1] + m[2] * p[e][2]);
+			double weight = edgeLength * edgeLength * MESH_SIMPLIFY_BORDER_WEIGHT;
+
+			addPlane(quadrics[from], m, md, weight, 0.0);
+			addPlane(quadrics[to], m, md, weight, 0.0);
+		}
+	}
+}
+
+
+void MeshSimplifier::buildTriangleLists(int indexCount, int vertexCount)
+{
+	triangleStart.assign(vertexCount + 1, 0);
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		triangleStart[position[result[i]] + 1]++;
+	}
+	for (int v = 0; v < vertexCount; v++)
+	{
+		triangleStart[v + 1] += triangleStart[v];
+	}
+
+	vertexTriangles.resize(indexCount);
+	remap.assign(triangleStart.begin(), triangleStart.end() - 1);	// Fill positions
+	for (int i = 0; i < indexCount; i++)
+	{
+		vertexTriangles[remap[position[result[i]]]++] = i / 3;
+	}
+}
+
+
+float MeshSimplifier::collapseCost(unsigned int from, unsigned int to, const float* vertexData, int stride)
+{
+	const Quadric& a = quadrics[from];
+	const Quadric& b = quadrics[to];
+	const float* p = &vertexData[to * stride];
+	double x = p[0], y = p[1], z = p[2];
+
+	// p'Ap + 2b.p + c for the sum of both quadrics
+	double error =
+		(a.a00 + b.a00) * x * x + (a.a11 + b.a11) * y * y + (a.a22 + b.a22) * z * z +
+		2.0 * ((a.a01 + b.a01) * x * y + (a.a02 + b.a02) * x * z + (a.a12 + b.a12) * y * z) +
+		2.0 * ((a.b0 + b.b0) * x + (a.b1 + b.b1) * y + (a.b2 + b.b2) * z) +
+		(a.c + b.c);
+
+	double weight = a.weight + b.weight;
+	if (weight > 0.0)
+	{
+		error /= weight;
+	}
+
+	return error > 0.0 ? (float) error : 0.0f;
+}
+
+
+bool MeshSimplifier::flips(unsigned int from, unsigned int to, const float* vertexData, int stride)
+{
+	const float* moved = &vertexData[to * stride];
+
+	for (int t = triangleStart[from]; t < triangleStart[from + 1]; t++)
+	{
+		int face = vertexTriangles[t];
+		unsigned int corners[3] = { position[result[face * 3]], position[result[face * 3 + 1]], position[result[face * 3 + 2]] };
+
+		// Faces on the edge itself disappear
+		if (corners[0] == to || corners[1] == to || corners[2] == to)
+		{
+			continue;
+		}
+
+		const float* before[3];
+		const float* after[3];
+		for (int k = 0; k < 3; k++)
+		{
+			before[k] = &vertexData[corners[k] * stride];
+			after[k] = corners[k] == from ? moved : before[k];
+		}
+
+		float oldNormal[3], newNormal[3];
+		cross(before[0], before[1], before[2], oldNormal);
+		cross(after[0], after[1], after[2], newNormal);
+
+		if (oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] + oldNormal[2] * newNormal[2] <= 0.0f)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+unsigned int MeshSimplifier::closestCorner(unsigned int vertex, unsigned int target, const float* vertexData, int stride)
+{
+	const float* attributes = &vertexData[vertex * stride + 3];
+	unsigned int best = target;
+	float bestDistance = 0.0f;
+
+	unsigned int corner = target;
+	do
+	{
+		const float* other = &vertexData[corner * stride + 3];
+		float distance = 0.0f;
+		for (int k = 0; k < 5; k++)
+		{
+			distance += (attributes[k] - other[k]) * (attributes[k] - other[k]);
+		}
+
+		if (corner == target || distance < bestDistance)
+		{
+			best = corner;
+			bestDistance = distance;
+		}
+
+		corner = nextCorner[corner];
+	} while (corner != target);
+
+	return best;
+}
+
+
+int MeshSimplifier::simplify(unsigned int* destination, const unsigned int* indices, int indexCount,
+	const float* vertexData, int stride, int vertexCount, int targetIndexCount, float targetError)
+{
+	result.assign(indices, indices + indexCount);
+	resultError = 0.0f;
+	passCount = 0;
+
+	weldPositions(vertexData, stride, vertexCount);
+	classifyVertices(result.size());
+	computeQuadrics(vertexData, stride, result.size());
+
+	float errorLimit = targetError * targetError;
+	float worst = 0.0f;
+
+	while ((int) result.size() > targetIndexCount)
+	{
+		int count = result.size();
+		if (passCount > 0)
+		{
+			classifyVertices(count);
+		}
+		buildTriangleLists(count, vertexCount);
+
+		// Every edge, the cheaper way round it is allowed to go
+		collapses.clear();
+		for (int h = 0; h < count; h++)
+		{
+			unsigned int a = position[result[h]];
+			unsigned int b = position[result[h - h % 3 + (h + 1) % 3]];
+			if (a == b)
+			{
+				continue;
+			}
+
+			bool open = edges[findEdge(b, a)].count == 0;
+
+			bool aToB = kind[a] == KIND_MANIFOLD || (kind[a] == KIND_BORDER && open && kind[b] != KIND_MANIFOLD);
+			bool bToA = kind[b] == KIND_MANIFOLD || (kind[b] == KIND_BORDER && open && kind[a] != KIND_MANIFOLD);
+
+			Collapse collapse = { a, b, 0.0f };
+			if (aToB)
+			{
+				collapse.cost = collapseCost(a, b, vertexData, stride);
+			}
+			if (bToA)
+			{
+				float cost = collapseCost(b, a, vertexData, stride);
+				if (!aToB || cost < collapse.cost)
+				{
+					collapse.from = b;
+					collapse.to = a;
+					collapse.cost = cost;
+				}
+			}
+			if (aToB || bToA)
+			{
+				collapses.push_back(collapse);
+			}
+		}
+
+		std::stable_sort(collapses.begin(), collapses.end(), CollapseCheaper());
+
+		// Take the cheapest collapses that don't touch each other's faces
+		collapseTarget.resize(vertexCount);
+		for (int v = 0; v < vertexCount; v++)
+		{
+			collapseTarget[v] = v;
+		}
+		locked.assign(vertexCount, 0);
+
+		int triangles = count / 3;
+		int collapsed = 0;
+
+		for (unsigned int i = 0; i < collapses.size(); i++)
+		{
+			const Collapse& collapse = collapses[i];
+			if (collapse.cost > errorLimit || triangles <= targetIndexCount / 3)
+			{
+				break;
+			}
+
+			if (locked[collapse.from] || locked[collapse.to] || flips(collapse.from, collapse.to, vertexData, stride))
+			{
+				continue;
+			}
+
+			// The flip test read the positions around from; they stay put for the rest of the pass
+			int removed = 0;
+			for (int t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1]; t++)
+			{
+				int face = vertexTriangles[t];
+				bool onEdge = false;
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int corner = position[result[face * 3 + k]];
+					locked[corner] = 1;
+					onEdge = onEdge || corner == collapse.to;
+				}
+				removed += onEdge ? 1 : 0;
+			}
+
+			collapseTarget[collapse.from] = collapse.to;
+
+			Quadric& to = quadrics[collapse.to];
+			const Quadric& from = quadrics[collapse.from];
+			to.a00 += from.a00; to.a01 += from.a01; to.a02 += from.a02;
+			to.a11 += from.a11; to.a12 += from.a12; to.a22 += from.a22;
+			to.b0 += from.b0; to.b1 += from.b1; to.b2 += from.b2;
+			to.c += from.c;
+			to.weight += from.weight;
+
+			worst = std::max(worst, collapse.cost);
+			triangles -= removed;
+			collapsed++;
+		}
+
+		if (collapsed == 0)
+		{
+			break;
+		}
+		passCount++;
+
+		// Move the corners, then drop the faces that collapsed to nothing
+		remap.resize(vertexCount);
+		for (int v = 0; v < vertexCount; v++)
+		{
+			unsigned int target = collapseTarget[position[v]];
+			remap[v] = target == position[v] ? v : closestCorner(v, target, vertexData, stride);
+		}
+
+		int kept = 0;
+		for (int f = 0; f < count / 3; f++)
+		{
+			unsigned int a = remap[result[f * 3]];
+			unsigned int b = remap[result[f * 3 + 1]];
+			unsigned int c = remap[result[f * 3 + 2]];
+
+			if (position[a] != position[b] && position[b] != position[c] && position[c] != position[a])
+			{
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+	}
+
+	resultError = sqrt(worst);
+
+	if (!result.empty())
+	{
+		memcpy(destination, &result[0], sizeof(unsigned int) * result.size());
+	}
+	return result.size();
+}
+
+
+float MeshSimplifier::measureError(const float* vertexData, int stride, const unsigned int* original, int originalCount,
+	const unsigned int* simplified, int simplifiedCount)
+{
+	float worst = 0.0f;
+
+	// Both ways round: where the original stands out of the simplified mesh, and the other way
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const unsigned int* samples = pass == 0 ? original : simplified;
+		int sampleCount = pass == 0 ? originalCount : simplifiedCount;
+		const unsigned int* surface = pass == 0 ? simplified : original;
+		int surfaceCount = pass == 0 ? simplifiedCount : originalCount;
+
+		if (surfaceCount == 0)
+		{
+			continue;
+		}
+
+		for (int f = 0; f < sampleCount / 3; f++)
+		{
+			const float* corners[3];
+			for (int k = 0; k < 3; k++)
+			{
+				corners[k] = &vertexData[samples[f * 3 + k] * stride];
+			}
+
+			float points[7][3];
+			for (int k = 0; k < 3; k++)
+			{
+				const float* next = corners[(k + 1) % 3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					points[k][axis] = corners[k][axis];
+					points[k + 3][axis] = (corners[k][axis] + next[axis]) * 0.5f;
+				}
+			}
+			for (int axis = 0; axis < 3; axis++)
+			{
+				points[6][axis] = (corners[0][axis] + corners[1][axis] + corners[2][axis]) * (1.0f / 3.0f);
+			}
+
+			for (int s = 0; s < 7; s++)
+			{
+				float closest = -1.0f;
+				for (int g = 0; g < surfaceCount / 3 && closest != 0.0f; g++)
+				{
+					float distance = triangleDistanceSquared(points[s], &vertexData[surface[g * 3] * stride],
+						&vertexData[surface[g * 3 + 1] * stride], &vertexData[surface[g * 3 + 2] * stride]);
+					if (closest < 0.0f || distance < closest)
+					{
+						closest = distance;
+					}
+				}
+				worst = std::max(worst, closest);
+			}
+		}
+	}
+
+	return sqrt(worst);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#define MESH_SIMPLIFY_BORDER_WEIGHT	10.0f	// How hard open edges hold their shape, against the faces' quadrics
+
+
+// Offline level of detail generation for the converter: Garland and
+// Heckbert's quadric error edge collapse, in passes of independent
+// collapses cheapest first (so each pass is a sort, not a heap).
+//
+// Vertices only ever collapse onto another vertex, so every simplified
+// vertex is one of the originals and the vertex buffer can be shared or
+// compacted afterwards. Corners split by normal or uv seams move together:
+// each split copy is remapped to the copy at the destination with the
+// closest normal and uv. Open edges only collapse along themselves, and
+// edges used by more than two faces are left alone.
+class MeshSimplifier
+{
+public:
+	MeshSimplifier();
+
+	// Positions, normals and uvs are the first eight floats of every vertex;
+	// stride is in floats. Writes at most indexCount indices to destination
+	// and returns how many. Stops at targetIndexCount, or before any collapse
+	// that would move the surface by more than targetError (model units).
+	int simplify(unsigned int* destination, const unsigned int* indices, int indexCount,
+		const float* vertexData, int stride, int vertexCount, int targetIndexCount, float targetError);
+
+	// Largest distance between the two surfaces, sampled at the corners, edge
+	// midpoints and centres of the faces of each. Brute force; offline only.
+	float measureError(const float* vertexData, int stride, const unsigned int* original, int originalCount,
+		const unsigned int* simplified, int simplifiedCount);
+
+private:
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;		// Face area, so the error is a mean squared distance
+	};
+
+	struct Collapse
+	{
+		unsigned int from, to;		// Position ids
+		float cost;
+	};
+
+	struct Edge
+	{
+		unsigned int from, to;
+		int count;			// Faces using it in this direction; 0 when the slot is empty
+	};
+
+	// Adds weight * (n.p + d)^2; area goes towards the quadric's weight
+	static void addPlane(Quadric& q, const double* n, double d, double weight, double area);
+
+	void weldPositions(const float* vertexData, int stride, int vertexCount);
+	void classifyVertices(int indexCount);
+	void computeQuadrics(const float* vertexData, int stride, int indexCount);
+	void buildTriangleLists(int indexCount, int vertexCount);
+	bool flips(unsigned int from, unsigned int to, const float* vertexData, int stride);
+	int findEdge(unsigned int from, unsigned int to);
+	float collapseCost(unsigned int from, unsigned int to, const float* vertexData, int stride);
+	unsigned int closestCorner(unsigned int vertex, unsigned int target, const float* vertexData, int stride);
+
+	// Reused between runs
+	std::vector<unsigned int> result;
+	std::vector<unsigned int> position;		// Vertex -> first vertex with the same position
+	std::vector<unsigned int> nextCorner;	// Circular list of the vertices sharing a position
+	std::vector<int> buckets;
+	std::vector<unsigned char> kind;		// Per position id
+	std::vector<Edge> edges;
+	std::vector<Quadric> quadrics;			// Per position id
+
+	std::vector<int> triangleStart;			// Per position id, into vertexTriangles
+	std::vector<int> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> collapseTarget;
+	std::vector<unsigned char> locked;		// Moved, or next to a move, this pass
+	std::vector<unsigned int> remap;
+
+public:
+	// From the last simplify
+	float resultError;		// Largest collapse error, sqrt of its mean squared distance
+	int passCount;
+};
@@ -0,0 +1,99 @@
+#include "NullAudioBackend.h"
+
+#include <stddef.h>
+
+
+NullAudioBackend::NullAudioBackend()
+{
+	for (int i = 0; i < NULL_AUDIO_MAX_VOICES; i++)
+	{
+		remaining[i] = 0.0f;
+		formats[i] = -1;
+		alive[i] = false;
+	}
+
+	created = 0;
+	destroyed = 0;
+	stopped = 0;
+	started = 0;
+}
+
+
+// Voices are just 1 + their index, so they are never NULL
+void* NullAudioBackend::createVoice(int format)
+{
+	if (created >= NULL_AUDIO_MAX_VOICES)
+	{
+		return NULL;
+	}
+
+	int index = created++;
+	alive[index] = true;
+	formats[index] = format;
+	remaining[index] = 0.0f;
+
+	return (void*) (size_t) (index + 1);
+}
+
+
+void NullAudioBackend::destroyVoice(void* voice)
+{
+	int index = indexOf(voice);
+	if (index >= 0)
+	{
+		alive[index] = false;
+		destroyed++;
+	}
+}
+
+
+void NullAudioBackend::stopVoice(void* voice)
+{
+	int index = indexOf(voice);
+	if (index >= 0)
+	{
+		remaining[index] = 0.0f;
+		stopped++;
+	}
+}
+
+
+bool NullAudioBackend::isPlaying(void* voice)
+{
+	int index = indexOf(voice);
+	return index >= 0 && remaining[index] > 0.0f;
+}
+
+
+void NullAudioBackend::start(void* voice, float seconds)
+{
+	int index = indexOf(voice);
+	if (index >= 0)
+	{
+		remaining[index] = seconds;
+		started++;
+	}
+}
+
+
+void NullAudioBackend::advance(float seconds)
+{
+	for (int i = 0; i < created; i++)
+	{
+		remaining[i] = remaining[i] > seconds ? remaining[i] - seconds : 0.0f;
+	}
+}
+
+
+int NullAudioBackend::getFormat(void* voice)
+{
+	int index = indexOf(voice);
+	return index >= 0 ? formats[index] : -1;
+}
+
+
+int NullAudioBackend::indexOf(void* voice)
+{
+	int index = (int) (size_t) voice - 1;
+	return index >= 0 && index < created && alive[index] ? index : -1;
+}
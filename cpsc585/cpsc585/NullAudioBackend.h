@@ -0,0 +1,38 @@
+#pragma once
+
+#include "AudioBackend.h"
+
+#define NULL_AUDIO_MAX_VOICES	1024
+
+
+// Backend that plays nothing, for checking VoicePool without a sound card.
+// A voice plays for however long start was told, counted down by advance.
+class NullAudioBackend : public AudioBackend
+{
+public:
+	NullAudioBackend();
+
+	void* createVoice(int format);
+	void destroyVoice(void* voice);
+	void stopVoice(void* voice);
+	bool isPlaying(void* voice);
+
+	// What Sound does with a voice once it has one
+	void start(void* voice, float seconds);
+	void advance(float seconds);
+
+	int getFormat(void* voice);
+
+private:
+	int indexOf(void* voice);
+
+	float remaining[NULL_AUDIO_MAX_VOICES];
+	int formats[NULL_AUDIO_MAX_VOICES];
+	bool alive[NULL_AUDIO_MAX_VOICES];
+
+public:
+	int created;
+	int destroyed;
+	int stopped;
+	int started;
+};
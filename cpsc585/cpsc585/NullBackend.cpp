@@ -0,0 +1,53 @@
+#include "NullBackend.h"
+
+
+NullBackend::NullBackend()
+{
+	reset();
+}
+
+
+void NullBackend::reset()
+{
+	passChanges = 0;
+	textureChanges = 0;
+	transformChanges = 0;
+	geometryChanges = 0;
+	drawCalls = 0;
+}
+
+
+void NullBackend::beginPass(int /*pass*/)
+{
+	passChanges++;
+}
+
+void NullBackend::endPass(int /*pass*/)
+{
+}
+
+void NullBackend::setTexture(void* /*texture*/)
+{
+	textureChanges++;
+}
+
+void NullBackend::setTransform(const float* /*transform*/)
+{
+	transformChanges++;
+}
+
+void NullBackend::setGeometry(int /*kind*/, void* /*geometry*/)
+{
+	geometryChanges++;
+}
+
+void NullBackend::draw(int /*kind*/, void* /*geometry*/)
+{
+	drawCalls++;
+}
+
+
+int NullBackend::getStateChanges()
+{
+	return passChanges + textureChanges + transformChanges + geometryChanges;
+}
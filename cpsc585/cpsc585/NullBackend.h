@@ -0,0 +1,29 @@
+#pragma once
+
+#include "RenderBackend.h"
+
+
+// Backend that draws nothing and counts what it is asked to do, for
+// measuring how well a frame batches without a device
+class NullBackend : public RenderBackend
+{
+public:
+	NullBackend();
+
+	void reset();
+
+	void beginPass(int pass);
+	void endPass(int pass);
+	void setTexture(void* texture);
+	void setTransform(const float* transform);
+	void setGeometry(int kind, void* geometry);
+	void draw(int kind, void* geometry);
+
+	int getStateChanges();
+
+	int passChanges;
+	int textureChanges;
+	int transformChanges;
+	int geometryChanges;
+	int drawCalls;
+};
@@ -0,0 +1,84 @@
+#include "ParticleBudget.h"
+
+#include <math.h>
+#include <string.h>
+
+ParticleBudget* ParticleBudget::budget = NULL;
+
+
+ParticleBudget::ParticleBudget(int capacity)
+{
+	this->capacity = capacity;
+	viewer[0] = viewer[1] = viewer[2] = 0.0f;
+
+	live = 0;
+	throttled = 0;
+	refused = 0;
+	totalSpawned = 0;
+	totalRefused = 0;
+
+	budget = this;
+}
+
+
+ParticleBudget::~ParticleBudget()
+{
+	if (budget == this)
+	{
+		budget = NULL;
+	}
+}
+
+
+void ParticleBudget::startTick(int liveParticles, const float* viewer)
+{
+	live = liveParticles;
+	memcpy(this->viewer, viewer, sizeof(this->viewer));
+
+	throttled = 0;
+	refused = 0;
+}
+
+
+float ParticleBudget::throttle(float priority, const float* position)
+{
+	float soft = capacity * PARTICLE_BUDGET_SOFT;
+	if (live <= soft)
+	{
+		return 1.0f;
+	}
+
+	// 1 at the soft limit, down to 0 at the limit
+	float headroom = (capacity - live) / (capacity - soft);
+	headroom = headroom > 0.0f ? headroom : 0.0f;
+
+	float x = position[0] - viewer[0], y = position[1] - viewer[1], z = position[2] - viewer[2];
+	float distance = sqrt(x * x + y * y + z * z);
+	float nearness = 1.0f - (distance - PARTICLE_NEAR_DISTANCE) / (PARTICLE_FAR_DISTANCE - PARTICLE_NEAR_DISTANCE);
+	nearness = nearness < 0.0f ? 0.0f : (nearness > 1.0f ? 1.0f : nearness);
+
+	// The less it matters, the sooner it slows: an emitter that matters half as
+	// much as it could is at full rate until the headroom is half gone
+	float importance = priority * nearness;
+	if (headroom >= 1.0f - importance)
+	{
+		return 1.0f;
+	}
+
+	throttled++;
+	return headroom / (1.0f - importance);
+}
+
+
+int ParticleBudget::take(int wanted)
+{
+	int granted = capacity - live;
+	granted = granted < 0 ? 0 : (granted < wanted ? granted : wanted);
+
+	live += granted;
+	refused += wanted - granted;
+	totalSpawned += granted;
+	totalRefused += wanted - granted;
+
+	return granted;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#define PARTICLE_BUDGET			600		// Live particles across every system
+#define PARTICLE_BUDGET_SOFT	0.6f	// Past this fraction of the budget, emitters start being throttled
+#define PARTICLE_NEAR_DISTANCE	50.0f	// Emitters closer than this to the viewer keep their full priority
+#define PARTICLE_FAR_DISTANCE	400.0f	// and past this have none left
+
+
+// Keeps the particles alive across every system under one limit. Below the
+// soft limit every emitter runs at its full rate. Past it, emitters are slowed
+// by how far they are from the viewer and by their priority, the far and the
+// unimportant first, until at the limit only the most important still spawn.
+// Nothing spawns past the limit at all.
+class ParticleBudget
+{
+public:
+	ParticleBudget(int capacity);
+	~ParticleBudget();
+
+	// What is alive going into the tick, and where it is being watched from
+	void startTick(int liveParticles, const float* viewer);
+
+	// From 0 to 1: how much of its rate an emitter at position should spawn at this tick
+	float throttle(float priority, const float* position);
+
+	// How many of wanted particles can spawn; they count as live from then on
+	int take(int wanted);
+
+	static ParticleBudget* budget;
+
+private:
+	float viewer[3];
+
+public:
+	int capacity;
+
+	// This tick
+	int live;
+	int throttled;		// Emitters slowed down
+	int refused;		// Particles that would have gone past the limit
+
+	// Since startup
+	int totalSpawned;
+	int totalRefused;
+};
@@ -0,0 +1,113 @@
+#include "ParticleEmitter.h"
+
+#include <math.h>
+
+
+ParticleEmitter::ParticleEmitter()
+{
+	rate = 0.0f;
+	burst = 0;
+	duration = 0.0f;
+	priority = 0.0f;
+
+	active = false;
+	moved = false;
+	burstDue = false;
+	elapsed = 0.0;
+	accumulator = 0.0;
+	last[0] = last[1] = last[2] = 0.0f;
+
+	spawned = 0;
+	wanted = 0.0f;
+}
+
+
+void ParticleEmitter::initialize(float rate, int burst, float duration, float priority)
+{
+	this->rate = rate;
+	this->burst = burst;
+	this->duration = duration;
+	this->priority = priority;
+}
+
+
+void ParticleEmitter::start()
+{
+	active = true;
+	moved = false;
+	burstDue = burst > 0;
+	elapsed = 0.0;
+	accumulator = 0.0;
+
+	spawned = 0;
+	wanted = 0.0f;
+}
+
+
+void ParticleEmitter::stop()
+{
+	active = false;
+}
+
+
+bool ParticleEmitter::isActive()
+{
+	return active;
+}
+
+
+int ParticleEmitter::emit(float seconds, float scale, const float* position, float* positions, int maxCount)
+{
+	if (!active)
+	{
+		return 0;
+	}
+
+	// Only the part of the step before it runs out counts
+	double step = seconds;
+	if (duration > 0.0f && elapsed + step >= duration)
+	{
+		step = duration - elapsed;
+		active = false;
+	}
+	elapsed += step;
+
+	int count = 0;
+	if (burstDue)
+	{
+		count = burst;
+		wanted += burst;
+		burstDue = false;
+	}
+
+	wanted += (float) (rate * step);
+	accumulator += rate * step * scale;
+
+	// A little slack, so rounding can't leave the last particle a hair short
+	int due = (int) floor(accumulator + 1e-6);
+	accumulator -= due;
+	count += due;
+
+	if (count > maxCount)
+	{
+		count = maxCount;
+	}
+
+	// Evenly along the way, the last one where it is now
+	for (int i = 0; i < count; i++)
+	{
+		float t = moved ? (float) (i + 1) / count : 1.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			positions[i * 3 + k] = last[k] + (position[k] - last[k]) * t;
+		}
+	}
+
+	last[0] = position[0];
+	last[1] = position[1];
+	last[2] = position[2];
+	moved = true;
+
+	spawned += count;
+	return count;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#define PARTICLE_EMIT_MAX	16		// Most particles one emitter spawns in a tick
+
+
+// Spawns particles at a steady rate against simulation time, however long the
+// steps are: the fraction of a particle left over from one step carries on to
+// the next, so a rate of 60 a second is 60 a second at any frame rate. A burst
+// comes out all at once on the first step after start. The particles
+// themselves are spawned by whoever owns the emitter, into a ParticlePool.
+class ParticleEmitter
+{
+public:
+	ParticleEmitter();
+
+	// rate is particles a second; duration is how long it runs once started, 0
+	// for until stopped. priority is from 0 to 1: how long it holds out against
+	// the ParticleBudget.
+	void initialize(float rate, int burst, float duration, float priority);
+	void start();
+	void stop();
+	bool isActive();
+
+	// Advances seconds at scale times the rate (see ParticleBudget::throttle) and
+	// returns how many particles are due. Their positions (xyz each, at most
+	// maxCount) are spread along the way from the last step's position, so a
+	// moving emitter leaves an even trail.
+	int emit(float seconds, float scale, const float* position, float* positions, int maxCount);
+
+	float rate;
+	int burst;
+	float duration;
+	float priority;
+
+private:
+	bool active;
+	bool moved;				// Whether last is set yet
+	bool burstDue;
+	double elapsed;			// Doubles, so thousands of short steps add up to the whole duration
+	double accumulator;		// Fraction of a particle owed
+	float last[3];
+
+public:
+	// Since start
+	int spawned;
+	float wanted;			// At the full rate, burst included
+};
@@ -0,0 +1,178 @@
+#include "ParticlePool.h"
+
+#include <xmmintrin.h>
+#include <string.h>
+
+#define PARTICLE_ARRAYS	11
+
+
+ParticlePool::ParticlePool(int capacity)
+{
+	this->capacity = capacity;
+	count = 0;
+	dropped = 0;
+
+	// Every array in one block; the padding keeps the 4-wide loops in bounds and each array aligned
+	int padded = (capacity + 3) & ~3;
+	positionX = (float*) _mm_malloc(sizeof(float) * padded * PARTICLE_ARRAYS, 16);
+	memset(positionX, 0, sizeof(float) * padded * PARTICLE_ARRAYS);
+
+	positionY = positionX + padded;
+	positionZ = positionY + padded;
+	velocityX = positionZ + padded;
+	velocityY = velocityX + padded;
+	velocityZ = velocityY + padded;
+	age = velocityZ + padded;
+	life = age + padded;
+	fadeStart = life + padded;
+	size = fadeStart + padded;
+	colour = (unsigned int*) (size + padded);
+}
+
+
+ParticlePool::~ParticlePool()
+{
+	if (positionX)
+	{
+		_mm_free(positionX);
+		positionX = NULL;
+	}
+}
+
+
+bool ParticlePool::spawn(const float* position, const float* velocity, float size, float life, float fadeStart, unsigned int colour)
+{
+	if (count >= capacity)
+	{
+		dropped++;
+		return false;
+	}
+
+	int i = count++;
+	positionX[i] = position[0];
+	positionY[i] = position[1];
+	positionZ[i] = position[2];
+	velocityX[i] = velocity[0];
+	velocityY[i] = velocity[1];
+	velocityZ[i] = velocity[2];
+	age[i] = 0.0f;
+	this->life[i] = life;
+	this->fadeStart[i] = fadeStart < life ? fadeStart : life;
+	this->size[i] = size;
+	this->colour[i] = colour;
+
+	return true;
+}
+
+
+void ParticlePool::clear()
+{
+	count = 0;
+}
+
+
+void ParticlePool::update(float seconds)
+{
+	__m128 step = _mm_set1_ps(seconds);
+
+	for (int i = 0; i < count; i += 4)
+	{
+		_mm_store_ps(&positionX[i], _mm_add_ps(_mm_load_ps(&positionX[i]), _mm_mul_ps(_mm_load_ps(&velocityX[i]), step)));
+		_mm_store_ps(&positionY[i], _mm_add_ps(_mm_load_ps(&positionY[i]), _mm_mul_ps(_mm_load_ps(&velocityY[i]), step)));
+		_mm_store_ps(&positionZ[i], _mm_add_ps(_mm_load_ps(&positionZ[i]), _mm_mul_ps(_mm_load_ps(&velocityZ[i]), step)));
+		_mm_store_ps(&age[i], _mm_add_ps(_mm_load_ps(&age[i]), step));
+	}
+
+	removeExpired();
+}
+
+
+void ParticlePool::updateReference(float seconds)
+{
+	for (int i = 0; i < count; i++)
+	{
+		positionX[i] += velocityX[i] * seconds;
+		positionY[i] += velocityY[i] * seconds;
+		positionZ[i] += velocityZ[i] * seconds;
+		age[i] += seconds;
+	}
+
+	removeExpired();
+}
+
+
+// From the back, so whatever is moved into a gap has already been checked
+void ParticlePool::removeExpired()
+{
+	for (int block = (count - 1) & ~3; block >= 0; block -= 4)
+	{
+		int expired = _mm_movemask_ps(_mm_cmpge_ps(_mm_load_ps(&age[block]), _mm_load_ps(&life[block])));
+		if (count - block < 4)
+		{
+			expired &= (1 << (count - block)) - 1;
+		}
+
+		for (int k = 3; k >= 0 && expired; k--)
+		{
+			if (!(expired & (1 << k)))
+			{
+				continue;
+			}
+			expired &= ~(1 << k);
+
+			int i = block + k;
+			int last = --count;
+			positionX[i] = positionX[last];
+			positionY[i] = positionY[last];
+			positionZ[i] = positionZ[last];
+			velocityX[i] = velocityX[last];
+			velocityY[i] = velocityY[last];
+			velocityZ[i] = velocityZ[last];
+			age[i] = age[last];
+			life[i] = life[last];
+			fadeStart[i] = fadeStart[last];
+			size[i] = size[last];
+			colour[i] = colour[last];
+		}
+	}
+}
+
+
+int ParticlePool::expand(ParticleVertex* vertices, int maxParticles, const float* right, const float* up) const
+{
+	int written = count < maxParticles ? count : maxParticles;
+
+	for (int i = 0; i < written; i++)
+	{
+		float half = size[i] * 0.5f;
+		float rx = right[0] * half, ry = right[1] * half, rz = right[2] * half;
+		float ux = up[0] * half, uy = up[1] * half, uz = up[2] * half;
+
+		// Full alpha until fadeStart, then down to nothing at the end of its life
+		unsigned int c = colour[i];
+		if (age[i] > fadeStart[i])
+		{
+			float fade = (life[i] - age[i]) / (life[i] - fadeStart[i]);
+			unsigned int alpha = (unsigned int) ((c >> 24) * (fade > 0.0f ? fade : 0.0f));
+			c = (c & 0x00FFFFFF) | (alpha << 24);
+		}
+
+		// Top left, top right, bottom left, bottom right
+		ParticleVertex* v = &vertices[i * PARTICLE_VERTICES];
+		float x = positionX[i], y = positionY[i], z = positionZ[i];
+
+		v[0].x = x - rx + ux; v[0].y = y - ry + uy; v[0].z = z - rz + uz;
+		v[1].x = x + rx + ux; v[1].y = y + ry + uy; v[1].z = z + rz + uz;
+		v[2].x = x - rx - ux; v[2].y = y - ry - uy; v[2].z = z - rz - uz;
+		v[3].x = x + rx - ux; v[3].y = y + ry - uy; v[3].z = z + rz - uz;
+
+		v[0].u = 0.0f; v[0].v = 0.0f;
+		v[1].u = 1.0f; v[1].v = 0.0f;
+		v[2].u = 0.0f; v[2].v = 1.0f;
+		v[3].u = 1.0f; v[3].v = 1.0f;
+
+		v[0].colour = v[1].colour = v[2].colour = v[3].colour = c;
+	}
+
+	return written;
+}
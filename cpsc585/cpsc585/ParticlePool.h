@@ -0,0 +1,59 @@
+#pragma once
+
+#define PARTICLE_VERTICES	4		// Per particle, a camera facing quad
+#define PARTICLE_INDICES	6
+
+
+// World space vertex: D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1
+struct ParticleVertex
+{
+	float x, y, z;
+	unsigned int colour;
+	float u, v;
+};
+
+// A fixed number of particles in structure-of-arrays form, allocated once.
+// Each one moves in a straight line, holds its colour until fadeStart then
+// fades out by the end of its life. An expired particle is replaced by the
+// last one, so the live ones are always the first count and their order isn't kept.
+//
+// Nothing here touches the device: D3D9ParticleRenderer draws the quads.
+class ParticlePool
+{
+public:
+	ParticlePool(int capacity);
+	~ParticlePool();
+
+	// Position and velocity are xyz; size is across, in world units. False when
+	// the pool is full (counted in dropped).
+	bool spawn(const float* position, const float* velocity, float size, float life, float fadeStart, unsigned int colour);
+	void clear();
+
+	// Moves and ages everything, 4 at a time, then removes what has expired
+	void update(float seconds);
+	void updateReference(float seconds);	// One at a time, for checking and timing
+
+	// right and up are the camera's, unit length. Writes PARTICLE_VERTICES per
+	// particle, at most maxParticles of them, and returns how many.
+	int expand(ParticleVertex* vertices, int maxParticles, const float* right, const float* up) const;
+
+private:
+	void removeExpired();
+
+	float* positionX;		// Padded to a multiple of 4, 16 byte aligned
+	float* positionY;
+	float* positionZ;
+	float* velocityX;
+	float* velocityY;
+	float* velocityZ;
+	float* age;
+	float* life;
+	float* fadeStart;
+	float* size;
+	unsigned int* colour;
+
+public:
+	int capacity;
+	int count;
+	int dropped;		// Spawns refused since the pool was made
+};
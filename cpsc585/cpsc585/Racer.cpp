@@ -34,6 +34,20 @@ float Racer::dragCoeff = chassisMass*accelerationScale/(topSpeed*topSpeed);
 
 bool Racer::inverse = config.inverse;
 
+bool Racer::batchForces = config.batchForces;
+SuspensionBatch Racer::forceBatch;
+double Racer::forceSeconds = 0.0;
+double Racer::forceMicroseconds = 0.0;
+
+
+static double forceClock()
+{
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / (double) frequency.QuadPart;
+}
+
 
 
 Racer::Racer(IDirect3DDevice9* device, RacerType racerType)
@@ -59,6 +73,22 @@ Racer::Racer(IDirect3DDevice9* device, RacerType racerType)
 
 	respawnTimer = 0.0f;
 	respawned = true;
+	deathSmoke.initialize(DEATH_SMOKE_RATE, 0, DEATH_SMOKE_TIME, DEATH_SMOKE_PRIORITY);
+
+	// Springs, friction and drag go through the shared batch (see queueForces), unless
+	// BATCHFORCES is 0 or the batch is full, when this racer applies its own
+	batchSlot = -1;
+	if (batchForces)
+	{
+		batchSlot = forceBatch.addBody(dragCoeff, this);
+		if (batchSlot >= 0)
+		{
+			forceBatch.setWheel(batchSlot * 4 + 0, frontSpringK, frontDamperC, frontExtents, springForceCap);
+			forceBatch.setWheel(batchSlot * 4 + 1, frontSpringK, frontDamperC, frontExtents, springForceCap);
+			forceBatch.setWheel(batchSlot * 4 + 2, rearSpringK, rearDamperC, rearExtents, springForceCap);
+			forceBatch.setWheel(batchSlot * 4 + 3, rearSpringK, rearDamperC, rearExtents, springForceCap);
+		}
+	}
 
 	index = -1;
 
@@ -150,6 +180,14 @@ Racer::Racer(IDirect3DDevice9* device, RacerType racerType)
 	Renderer::renderer->addDrawable(wheelRR->drawable);
 	Physics::physics->addRigidBody(wheelRR->body);
 
+	// The parts' shadows get as much detail as the chassis'
+	wheelFL->drawable->shadowOwner = drawable;
+	wheelFR->drawable->shadowOwner = drawable;
+	wheelRL->drawable->shadowOwner = drawable;
+	wheelRR->drawable->shadowOwner = drawable;
+	gunMountDraw->shadowOwner = drawable;
+	gunDraw->shadowOwner = drawable;
+
 	// Now constrain the tires
 	hkpGenericConstraintData* constraint;
 	hkpConstraintInstance* constraintInst;
@@ -195,6 +233,18 @@ Racer::~Racer(void)
 	{
 		body->removeReference();
 	}
+
+	if (engineVoice)
+	{
+		Sound::sound->releaseSFXVoice(engineVoice);
+		engineVoice = NULL;
+	}
+
+	if (batchSlot >= 0)
+	{
+		forceBatch.removeBody(batchSlot);
+		batchSlot = -1;
+	}
 }
 
 void Racer::setPosAndRot(float posX, float posY, float posZ,
@@ -962,6 +1012,111 @@ hkVector4 Racer::getForce(hkVector4* up, hkpRigidBody* wheel, hkVector4* attach,
 }
 
 
+// Writes this racer's springs, dampers, friction and drag state straight into
+// its slots in the shared batch. Nothing is applied until applyQueuedForces().
+void Racer::queueForces(bool friction)
+{
+	int b = batchSlot;
+	hkVector4 upVector = drawable->getYhkVector();
+	hkVector4 xVector = drawable->getXhkVector();
+	hkVector4 zVector = drawable->getZhkVector();
+	hkTransform transform = body->getTransform();
+	hkVector4 linearVelocity = body->getLinearVelocity();
+	hkVector4 angularVelocity = body->getAngularVelocity();
+	hkVector4 centerOfMass = body->getCenterOfMassInWorld();
+
+	forceBatch.upX[b] = upVector(0); forceBatch.upY[b] = upVector(1); forceBatch.upZ[b] = upVector(2);
+	forceBatch.velX[b] = linearVelocity(0); forceBatch.velY[b] = linearVelocity(1); forceBatch.velZ[b] = linearVelocity(2);
+	forceBatch.angVelX[b] = angularVelocity(0); forceBatch.angVelY[b] = angularVelocity(1); forceBatch.angVelZ[b] = angularVelocity(2);
+	forceBatch.axisXx[b] = xVector(0); forceBatch.axisXy[b] = xVector(1); forceBatch.axisXz[b] = xVector(2);
+	forceBatch.axisZx[b] = zVector(0); forceBatch.axisZy[b] = zVector(1); forceBatch.axisZz[b] = zVector(2);
+
+	hkpRigidBody* wheels[4] = { wheelFL->body, wheelFR->body, wheelRL->body, wheelRR->body };
+	bool touching[4] = { wheelFL->touchingGround, wheelFR->touchingGround,
+		wheelRL->touchingGround, wheelRR->touchingGround };
+	hkVector4* attach[4] = { &attachFL, &attachFR, &attachRL, &attachRR };
+
+	for (int i = 0; i < 4; i++)
+	{
+		int w = b * 4 + i;
+		if (!touching[i])
+		{
+			forceBatch.grounded[w] = 0.0f;
+			continue;
+		}
+
+		hkVector4 restPos;
+		restPos.setTransformedPos(transform, *attach[i]);
+		hkVector4 offset = wheels[i]->getPosition();
+		offset.sub(restPos);
+		restPos.sub(centerOfMass);
+
+		forceBatch.offsetX[w] = offset(0); forceBatch.offsetY[w] = offset(1); forceBatch.offsetZ[w] = offset(2);
+		forceBatch.leverX[w] = restPos(0); forceBatch.leverY[w] = restPos(1); forceBatch.leverZ[w] = restPos(2);
+		forceBatch.grounded[w] = 1.0f;
+	}
+
+	forceBatch.setFriction(b, upVector(1), grip * accelerationScale * -chassisMass,
+		(grip * 0.02f) * accelerationScale * -chassisMass, friction);
+	forceBatch.queued[b] = true;
+}
+
+
+// Evaluates every queued racer at once and applies the results. Call once per
+// tick after all racers have run applyForces() and BEFORE stepping physics!
+void Racer::applyQueuedForces(float seconds)
+{
+	double start = forceClock();
+	if (batchForces)
+	{
+		scatterQueuedForces(seconds);
+	}
+	forceSeconds += forceClock() - start;
+
+	// Smoothed over a couple of seconds of ticks for the debug text, so either
+	// path can be timed in game against the other
+	forceMicroseconds = forceMicroseconds * 0.98 + forceSeconds * 1000000.0 * 0.02;
+	forceSeconds = 0.0;
+}
+
+
+void Racer::scatterQueuedForces(float seconds)
+{
+	forceBatch.compute();
+
+	for (int b = 0; b < forceBatch.numBodies; b++)
+	{
+		if (!forceBatch.queued[b])
+		{
+			continue;
+		}
+
+		Racer* racer = (Racer*) forceBatch.bodyOwner[b];
+		hkVector4 centerOfMass = racer->body->getCenterOfMassInWorld();
+
+		for (int w = b * 4; w < b * 4 + 4; w++)
+		{
+			if (forceBatch.grounded[w] == 0.0f)
+			{
+				continue;
+			}
+
+			// Spring force acts at the attachment point (center of mass + lever)
+			hkVector4 point = centerOfMass;
+			point.add(hkVector4(forceBatch.leverX[w], forceBatch.leverY[w], forceBatch.leverZ[w]));
+
+			hkVector4 force(forceBatch.forceX[w], forceBatch.forceY[w], forceBatch.forceZ[w]);
+			racer->body->applyForce(seconds, force, point);
+		}
+
+		hkVector4 force(forceBatch.bodyForceX[b], forceBatch.bodyForceY[b], forceBatch.bodyForceZ[b]);
+		racer->body->applyForce(seconds, force);
+
+		forceBatch.queued[b] = false;
+	}
+}
+
+
 void Racer::applyForces(float seconds)
 {
 	hkVector4 aVel, vel = body->getLinearVelocity();
@@ -971,19 +1126,31 @@ void Racer::applyForces(float seconds)
 
 	// Only want to be automatically braking if the player
 	// isn't trying to move or already moving
-	if (((dot > 0.0f) && (dot < 6.0f) && (aDot != 0.0f)) &&
-		(currentAcceleration == 0.0f))
+	bool autoBrake = ((dot > 0.0f) && (dot < 6.0f) && (aDot != 0.0f)) &&
+		(currentAcceleration == 0.0f);
+
+	if (autoBrake)
 	{
 		brake(seconds);
 	}
+
+	applyTireRaycast();
+
+	double start = forceClock();
+	if (batchSlot >= 0)
+	{
+		queueForces(!autoBrake);
+	}
 	else
 	{
-		applyFriction(seconds);
+		if (!autoBrake)
+		{
+			applyFriction(seconds);
+		}
+		applySprings(seconds);
+		applyDrag(seconds);
 	}
-
-	applyTireRaycast();
-	applySprings(seconds);
-	applyDrag(seconds);
+	forceSeconds += forceClock() - start;
 	
 
 	if (laserTime > 0.0f)
@@ -996,11 +1163,8 @@ void Racer::applyForces(float seconds)
 	{
 		respawnTimer -= seconds;
 
-		SmokeParticle* smoke = new SmokeParticle();
 		hkVector4 pos = body->getPosition();
-		smoke->setPosition(&pos);
-		SmokeSystem::system->addSmoke(ROCKET_SMOKE, smoke);
-		smoke = NULL;
+		SmokeSystem::system->emit(&deathSmoke, ROCKET_SMOKE, &pos, seconds);
 	}
 	else if (!respawned && (respawnTimer <= 0.0f))
 	{
@@ -1027,6 +1191,12 @@ void Racer::applyTireRaycast()
 	raycastDir.mul(-1);
 	hkTransform transform = body->getTransform();
 
+	// Where the wheels touch down, averaged for the blob shadow
+	hkVector4 groundPoint, groundNormal;
+	groundPoint.set(0.0f, 0.0f, 0.0f);
+	groundNormal.set(0.0f, 0.0f, 0.0f);
+	int contacts = 0;
+
 	hkUint32 collisionFilterInfo = body->getCollisionFilterInfo();
 
 	// Raycast and reposition each tire
@@ -1047,7 +1217,7 @@ void Racer::applyTireRaycast()
 	input.m_to.setXYZ(to);
 	input.m_filterInfo = collisionFilterInfo;
 	
-	Physics::world->castRay(input, output);
+	wheelFL->groundContact.castRay(input, output);
 	
 	if (output.hasHit())
 	{
@@ -1057,6 +1227,10 @@ void Racer::applyTireRaycast()
 		raycastDir.mul(-0.35f);
 
 		to.add(from);
+		groundPoint.add(to);
+		groundNormal.add(output.m_normal);
+		contacts++;
+
 		to.add(raycastDir);
 
 		wheelFL->body->setPosition(to);
@@ -1094,7 +1268,7 @@ void Racer::applyTireRaycast()
 	input.m_to.setXYZ(to);
 	input.m_filterInfo = collisionFilterInfo;
 
-	Physics::world->castRay(input, output);
+	wheelFR->groundContact.castRay(input, output);
 
 	if (output.hasHit())
 	{
@@ -1104,6 +1278,10 @@ void Racer::applyTireRaycast()
 		raycastDir.mul(-0.35f);
 
 		to.add(from);
+		groundPoint.add(to);
+		groundNormal.add(output.m_normal);
+		contacts++;
+
 		to.add(raycastDir);
 
 		wheelFR->body->setPosition(to);
@@ -1141,7 +1319,7 @@ void Racer::applyTireRaycast()
 	input.m_to.setXYZ(to);
 	input.m_filterInfo = collisionFilterInfo;
 
-	Physics::world->castRay(input, output);
+	wheelRL->groundContact.castRay(input, output);
 
 	if (output.hasHit())
 	{
@@ -1151,6 +1329,10 @@ void Racer::applyTireRaycast()
 		raycastDir.mul(-0.4f);
 
 		to.add(from);
+		groundPoint.add(to);
+		groundNormal.add(output.m_normal);
+		contacts++;
+
 		to.add(raycastDir);
 
 		wheelRL->body->setPosition(to);
@@ -1188,7 +1370,7 @@ void Racer::applyTireRaycast()
 	input.m_to.setXYZ(to);
 	input.m_filterInfo = collisionFilterInfo;
 
-	Physics::world->castRay(input, output);
+	wheelRR->groundContact.castRay(input, output);
 
 	if (output.hasHit())
 	{
@@ -1198,6 +1380,10 @@ void Racer::applyTireRaycast()
 		raycastDir.mul(-0.4f);
 
 		to.add(from);
+		groundPoint.add(to);
+		groundNormal.add(output.m_normal);
+		contacts++;
+
 		to.add(raycastDir);
 
 		wheelRR->body->setPosition(to);
@@ -1214,6 +1400,18 @@ void Racer::applyTireRaycast()
 
 		wheelRR->body->setPosition(to);
 	}
+
+	if (contacts > 0)
+	{
+		groundPoint.mul(1.0f / contacts);
+		groundNormal.normalize3();
+		drawable->setGround(true, D3DXVECTOR3(groundPoint(0), groundPoint(1), groundPoint(2)),
+			D3DXVECTOR3(groundNormal(0), groundNormal(1), groundNormal(2)));
+	}
+	else
+	{
+		drawable->setGround(false, D3DXVECTOR3(0.0f, 0.0f, 0.0f), D3DXVECTOR3(0.0f, 1.0f, 0.0f));
+	}
 }
 
 
@@ -1295,13 +1493,17 @@ void Racer::fireLaser()
 		{
 			attacked->applyDamage(this, LASER_DAMAGE);
 		}
-		else if ((hitBody->getProperty(1)).getPtr())
+		else
 		{
-			Landmine* mine = ((Landmine*)(hitBody->getProperty(1)).getPtr());
-			mine->owner = this;
+			// Landmines keep their handle on their body; NULL for anything else
+			Landmine* mine = DynamicObjManager::manager->getLandmine((unsigned int) hitBody->getProperty(1).getInt());
+			if (mine)
+			{
+				mine->owner = this;
 
-			if (!mine->triggered && !mine->destroyed)
-				mine->trigger();
+				if (!mine->triggered && !mine->destroyed)
+					mine->trigger();
+			}
 		}
 	}
 }
@@ -1395,7 +1597,9 @@ void Racer::fireRocket()
 	// Change this so rocket is facing rocketDir when launched
 					
 	
-	Rocket* currentRocket = new Rocket(Renderer::device, this);
+	Rocket* currentRocket = DynamicObjManager::manager->addRocket(this);
+	if (!currentRocket)
+		return;
 					
 	currentRocket->owner = this;
 
@@ -1415,8 +1619,6 @@ void Racer::fireRocket()
 	to.mul(125.0f);
 	currentRocket->body->setLinearVelocity(to);
 	currentRocket->update(0.0f);
-
-	DynamicObjManager::manager->addObject(currentRocket);
 	currentRocket = NULL;
 }
 
@@ -1425,7 +1627,9 @@ void Racer::dropMine()
 {
 	Sound::sound->playSoundEffect(SFX_DROPMINE, emitter);
 
-	Landmine* currentMine = new Landmine(Renderer::device);
+	Landmine* currentMine = DynamicObjManager::manager->addLandmine();
+	if (!currentMine)
+		return;
 					
 	currentMine->owner = this;
 
@@ -1438,19 +1642,14 @@ void Racer::dropMine()
 	minePos.setTransformedPos(bodyTransform, dropPoint);
 	currentMine->body->setTransform(bodyTransform);
 	currentMine->body->setPosition(minePos);
-
-	DynamicObjManager::manager->addObject(currentMine);
 	currentMine = NULL;
 }
 
 
 void Racer::respawn()
 {
-	SmokeParticle* smoke = new SmokeParticle();
 	hkVector4 pos = body->getPosition();
-	smoke->setPosition(&pos);
-	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, smoke);
-	smoke = NULL;
+	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, &pos);
 
 	Sound::sound->playSoundEffect(SFX_CAREXPLODE, emitter);
 
@@ -1496,6 +1695,7 @@ void Racer::applyDamage(Racer* attacker, int damage)
 
 		respawnTimer = 3.0f;
 		respawned = false;
+		deathSmoke.start();
 
 
 
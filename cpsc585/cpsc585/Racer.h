@@ -8,11 +8,10 @@
 #include "FrontWheel.h"
 #include "RearWheel.h"
 #include "ConfigReader.h"
-#include "GunMesh.h"
-#include "GunMountMesh.h"
 #include "DynamicObjManager.h"
 #include "SmokeSystem.h"
 #include "LaserSystem.h"
+#include "SuspensionBatch.h"
 
 enum RacerType { RACER1, RACER2, RACER3, RACER4, RACER5, RACER6, RACER7, RACER8 };
 enum WheelType { FRONT, REAR };
@@ -37,6 +36,7 @@ public:
 	int getIndex();
 	void reset(hkVector4* resetPos, float rotation);	// Reset position and set velocity/momentum to 0
 	void applyForces(float seconds);	// Call this every frame BEFORE stepping physics!
+	static void applyQueuedForces(float seconds);	// Then this once per tick, after every racer's applyForces
 	void fireLaser();
 	void fireRocket();
 	void dropMine();
@@ -50,6 +50,8 @@ private:
 	void applySprings(float seconds);
 	void applyFriction(float seconds);
 	void applyDrag(float seconds);
+	void queueForces(bool friction);
+	static void scatterQueuedForces(float seconds);
 	void applyTireRaycast();
 	void respawn();
 	hkpWorldRayCastInput fireWeapon();
@@ -98,6 +100,9 @@ private:
 
 	float respawnTimer;
 	bool respawned;
+	ParticleEmitter deathSmoke;
+
+	int batchSlot;		// In forceBatch, -1 when forces are applied one racer at a time
 
 	hkVector4 deathPos;
 	hkQuaternion deathRot;
@@ -126,4 +131,11 @@ private:
 	static float dragCoeff;
 	static float topSpeed;
 	static bool inverse; // Inverted look
+
+	static bool batchForces;
+	static SuspensionBatch forceBatch;
+	static double forceMicroseconds;	// Springs, friction and drag per tick, all racers, smoothed
+
+private:
+	static double forceSeconds;		// This tick so far
 };
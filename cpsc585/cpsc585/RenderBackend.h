@@ -0,0 +1,29 @@
+#pragma once
+
+// What a queued command draws
+#define RENDER_DRAW_MESH			0	// geometry is a Mesh
+#define RENDER_DRAW_SHADOW_VOLUME	1	// geometry is the Drawable owning the volume
+#define RENDER_DRAW_INSTANCES		2	// geometry is an InstanceGroup, drawn in one call
+#define RENDER_DRAW_CHUNKS			3	// geometry is a Mesh with chunks; draws the runs from its last cull
+
+// Passes, in the order they are drawn
+#define RENDER_PASS_OPAQUE			0
+#define RENDER_PASS_SHADOW			1	// Front faces, or both with two-sided stencil
+#define RENDER_PASS_SHADOW_BACK		2	// Back faces, only without two-sided stencil
+#define RENDER_PASS_COUNT			3
+
+
+// Receives the sorted contents of a RenderQueue. Only called when something
+// actually changes, so every call is a state change or a draw on the device.
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	virtual void beginPass(int pass) = 0;
+	virtual void endPass(int pass) = 0;
+	virtual void setTexture(void* texture) = 0;
+	virtual void setTransform(const float* transform) = 0;	// 4x4, D3D layout
+	virtual void setGeometry(int kind, void* geometry) = 0;
+	virtual void draw(int kind, void* geometry) = 0;
+};
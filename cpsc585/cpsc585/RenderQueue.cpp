@@ -0,0 +1,177 @@
+#include "RenderQueue.h"
+
+#include <string.h>
+
+
+// Spreads an address over 20 bits
+static unsigned long long hashPointer(void* pointer)
+{
+	unsigned long long value = (unsigned long long) (size_t) pointer;
+	value ^= value >> 17;
+	value *= 0x9E3779B97F4A7C15ULL;
+	return (value >> 44) & 0xFFFFF;
+}
+
+
+RenderQueue::RenderQueue()
+{
+	commands.reserve(256);
+	keys.reserve(256);
+	order.reserve(256);
+}
+
+
+void RenderQueue::clear()
+{
+	commands.clear();
+	keys.clear();
+	order.clear();
+}
+
+
+unsigned long long RenderQueue::makeKey(int pass, void* texture, void* geometry, float depth)
+{
+	// Positive floats sort the same as their bit patterns, so the exponent and
+	// top of the mantissa make a range free depth key
+	if (depth < 0.0f)
+	{
+		depth = 0.0f;
+	}
+	unsigned int depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	unsigned long long key = (unsigned long long) (pass & 0xF) << 60;
+	key |= hashPointer(texture) << 40;
+	key |= hashPointer(geometry) << 20;
+	key |= (depthBits >> 11) & 0xFFFFF;
+	return key;
+}
+
+
+void RenderQueue::submit(int pass, int kind, void* texture, void* geometry, const float* transform, float depth)
+{
+	RenderCommand command;
+	command.pass = pass;
+	command.kind = kind;
+	command.texture = kind == RENDER_DRAW_MESH || kind == RENDER_DRAW_CHUNKS ? texture : NULL;
+	command.geometry = geometry;
+	command.transform = transform;
+
+	order.push_back(commands.size());
+	keys.push_back(makeKey(pass, command.texture, geometry, depth));
+	commands.push_back(command);
+}
+
+
+void RenderQueue::sort()
+{
+	// keys and order are kept side by side, so sorting twice is harmless
+	unsigned int count = order.size();
+
+	keyScratch.resize(count);
+	orderScratch.resize(count);
+
+	// Least significant byte first, 8 passes. A byte every key shares is skipped.
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		unsigned int histogram[256];
+		memset(histogram, 0, sizeof(histogram));
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			histogram[(keys[i] >> shift) & 0xFF]++;
+		}
+
+		if (count == 0 || histogram[(keys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		unsigned int offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			unsigned int bucket = histogram[b];
+			histogram[b] = offset;
+			offset += bucket;
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int slot = histogram[(keys[i] >> shift) & 0xFF]++;
+			keyScratch[slot] = keys[i];
+			orderScratch[slot] = order[i];
+		}
+
+		keys.swap(keyScratch);
+		order.swap(orderScratch);
+	}
+}
+
+
+void RenderQueue::replay(RenderBackend* backend)
+{
+	int pass = -1;
+	void* texture = NULL;
+	void* geometry = NULL;
+	const float* transform = NULL;
+	bool textureSet = false;
+
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		const RenderCommand& command = commands[order[i]];
+
+		if (command.pass != pass)
+		{
+			if (pass != -1)
+			{
+				backend->endPass(pass);
+			}
+			pass = command.pass;
+			backend->beginPass(pass);
+
+			// Passes set their own states, so start over
+			textureSet = false;
+			geometry = NULL;
+			transform = NULL;
+		}
+
+		if (command.kind != RENDER_DRAW_SHADOW_VOLUME && (!textureSet || command.texture != texture))
+		{
+			texture = command.texture;
+			textureSet = true;
+			backend->setTexture(texture);
+		}
+
+		// Instanced draws carry their transforms in the instance data
+		if (command.transform && command.transform != transform)
+		{
+			transform = command.transform;
+			backend->setTransform(transform);
+		}
+
+		if (command.geometry != geometry)
+		{
+			geometry = command.geometry;
+			backend->setGeometry(command.kind, geometry);
+		}
+
+		backend->draw(command.kind, geometry);
+	}
+
+	if (pass != -1)
+	{
+		backend->endPass(pass);
+	}
+}
+
+
+int RenderQueue::getCount()
+{
+	return commands.size();
+}
+
+
+unsigned long long RenderQueue::getKey(int sortedIndex)
+{
+	return keys[sortedIndex];
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "RenderBackend.h"
+
+
+struct RenderCommand
+{
+	int pass;
+	int kind;				// RENDER_DRAW_*
+	void* texture;			// Ignored by shadow volumes
+	void* geometry;
+	const float* transform;	// NULL for instanced draws
+};
+
+// One frame's draws, recorded as 64 bit sort keys plus payloads, sorted so
+// draws sharing a pass, texture and mesh end up next to each other (near to
+// far within those), then replayed into a backend with redundant state
+// changes dropped.
+//
+// Key layout, high to low: pass (4 bits), texture (20), geometry (20), depth (20).
+// Textures and geometry are keyed by a hash of their address, so a collision
+// costs some batching but never correctness.
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	void clear();
+	void submit(int pass, int kind, void* texture, void* geometry, const float* transform, float depth);
+	void sort();							// Radix sort on the keys; without it replay goes in submission order
+	void replay(RenderBackend* backend);
+
+	static unsigned long long makeKey(int pass, void* texture, void* geometry, float depth);
+
+	int getCount();
+	unsigned long long getKey(int sortedIndex);
+
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<unsigned long long> keys;
+	std::vector<unsigned int> order;		// Indices into commands, sorted by key
+
+	// Reused by sort()
+	std::vector<unsigned long long> keyScratch;
+	std::vector<unsigned int> orderScratch;
+};
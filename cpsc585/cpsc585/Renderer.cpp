@@ -4,20 +4,68 @@ Renderer* Renderer::renderer = NULL;
 IDirect3DDevice9* Renderer::device = NULL;
 D3DXVECTOR3 Renderer::lightDir = D3DXVECTOR3(0,-0.7f,-1);
 
+// The snapshot keeps what it has published alive until the frame is filled again
+static void keepDrawable(void* owner)
+{
+	((Drawable*) owner)->addReference();
+}
+
+static void releaseDrawable(void* owner)
+{
+	((Drawable*) owner)->removeReference();
+}
+
 Renderer::Renderer()
 {
 	d3dObject = NULL;
 	device = NULL;
 	
 	camera = NULL;
-	font = NULL;
+	textBatch = NULL;
+	textRenderer = NULL;
 
-	sentences = NULL;
-	numSentences = 0;
 	numDrawables = 0;
 	drawables = NULL;
+	shadowCasters = NULL;
 	currentDrawable = 0;
 	hud = NULL;
+	meshRegistry = NULL;
+	textureCache = NULL;
+	stateCache = NULL;
+	renderQueue = NULL;
+	backend = NULL;
+	meshShader = NULL;
+	instanceBatch = NULL;
+	instancer = NULL;
+	culler = NULL;
+	chunkCuller = NULL;
+	shadowTiers = NULL;
+	blobRenderer = NULL;
+	particleBudget = NULL;
+	smokeSystem = NULL;
+	laserSystem = NULL;
+	particleRenderer = NULL;
+	snapshot = NULL;
+	frameStatic = 0;
+	frameEntries = NULL;
+
+	visibleCount = 0;
+	culledCount = 0;
+	culledShadowCount = 0;
+	for (int i = 0; i < LOD_MAX_LEVELS; i++)
+	{
+		lodCounts[i] = 0;
+	}
+	lodScale = 0.0f;
+	chunksVisible = 0;
+	chunksTotal = 0;
+	for (int i = 0; i < SHADOW_TIER_COUNT; i++)
+	{
+		shadowTierCounts[i] = 0;
+	}
+	frameCount = 0;
+	drawnTick = 0;
+	transformsDropped = 0;
 
 	shadowQuadVertexBuffer = NULL;
 
@@ -35,9 +83,12 @@ bool Renderer::initialize(int width, int height, HWND hwnd, float zNear, float z
 	useTwoSidedStencils = false;
 
 	drawables = new Drawable*[numToDraw];
+	shadowCasters = new Drawable*[numToDraw];
 	dynamicDrawables = new std::vector<Drawable*>();
 	dynamicDrawables->clear();
 	dynamicDrawables->reserve(100);
+	snapshot = new TransformSnapshot(numToDraw + SNAPSHOT_DYNAMIC_DRAWABLES, keepDrawable, releaseDrawable);
+	frameDrawables.reserve(numToDraw + SNAPSHOT_DYNAMIC_DRAWABLES);
 	
 	hud = new HUD(width, height);
 
@@ -121,8 +172,11 @@ bool Renderer::initialize(int width, int height, HWND hwnd, float zNear, float z
 		return false;
 	}
 
-	device->SetRenderState(D3DRS_ZWRITEENABLE, TRUE);
-	device->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESS);
+	// Every state set from here on goes through the cache, which drops the redundant ones
+	stateCache = new StateCache(new D3D9StateDevice(device));
+
+	StateCache::cache->setRenderState(D3DRS_ZWRITEENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_ZFUNC, D3DCMP_LESS);
 
 	D3DVIEWPORT9 viewport;
 	viewport.Width = width;
@@ -143,14 +197,17 @@ bool Renderer::initialize(int width, int height, HWND hwnd, float zNear, float z
 	// Create the projection matrix for 3D rendering.
 	D3DXMatrixPerspectiveFovLH(&projectionMatrix, fieldOfView, screenAspect, zNear, zFar);
 
+	// Half the screen height covers 1 / _22 units at a distance of 1
+	lodScale = projectionMatrix._22 * height * 0.5f;
+
 	D3DXMatrixIdentity(&worldMatrix);
 	
 	camera = new Camera;
 	
-	device->SetRenderState(D3DRS_LIGHTING, TRUE);
-	device->SetRenderState(D3DRS_AMBIENT, D3DCOLOR_XRGB(100, 100, 100));
-	device->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_MIRROR);
-	device->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_MIRROR);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, TRUE);
+	StateCache::cache->setRenderState(D3DRS_AMBIENT, D3DCOLOR_XRGB(100, 100, 100));
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_MIRROR);
+	StateCache::cache->setSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_MIRROR);
 	
 	
 	D3DLIGHT9 light;    // create the light struct
@@ -174,29 +231,25 @@ bool Renderer::initialize(int width, int height, HWND hwnd, float zNear, float z
 	device->SetMaterial(&material);    // set the globably-used material to &material
 
 	// Set up font stuff
-	D3DXCreateFont(device, 0, 10, FW_BOLD, 1, false, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, DRAFT_QUALITY,
-		DEFAULT_PITCH | FF_DONTCARE, "Terminal", &font);
-
-	device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTOP_SELECTARG1);
-	device->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);	// Just to be safe (ignored)
-	device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
-
-	// Stuff for particle effects
-	device->SetRenderState(D3DRS_POINTSPRITEENABLE, TRUE);
-	device->SetRenderState(D3DRS_POINTSCALEENABLE, TRUE);
-	device->SetRenderState(D3DRS_POINTSCALE_A, FtoDw(0.0f));
-	device->SetRenderState(D3DRS_POINTSCALE_B, FtoDw(0.0f));
-	device->SetRenderState(D3DRS_POINTSCALE_C, FtoDw(1.0f));
-	device->SetRenderState(D3DRS_POINTSIZE_MIN, FtoDw(0.1f));
-	device->SetRenderState(D3DRS_POINTSIZE_MAX, FtoDw(1280.0f));
-	
+	textBatch = new TextBatch();
+	textRenderer = new D3D9TextRenderer(device);
+	if (!textRenderer->initialize(textBatch, "Terminal", 10, FW_BOLD))
+	{
+		delete textRenderer;
+		textRenderer = NULL;
+	}
+
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG1, D3DTOP_SELECTARG1);
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);	// Just to be safe (ignored)
+	StateCache::cache->setTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+
 	// Set fog
 	float startFog = 1.0f;
 	float endFog = 500.0f;
-	device->SetRenderState(D3DRS_FOGCOLOR, D3DCOLOR_ARGB(200,120,120,140));
-	device->SetRenderState(D3DRS_FOGVERTEXMODE, D3DFOG_LINEAR);
-	device->SetRenderState(D3DRS_FOGSTART, *(DWORD *)(&startFog));
-    device->SetRenderState(D3DRS_FOGEND, *(DWORD *)(&endFog));
+	StateCache::cache->setRenderState(D3DRS_FOGCOLOR, D3DCOLOR_ARGB(200,120,120,140));
+	StateCache::cache->setRenderState(D3DRS_FOGVERTEXMODE, D3DFOG_LINEAR);
+	StateCache::cache->setRenderState(D3DRS_FOGSTART, *(DWORD *)(&startFog));
+    StateCache::cache->setRenderState(D3DRS_FOGEND, *(DWORD *)(&endFog));
 
 	// Set up HUD
 	hud->initialize(device);
@@ -223,8 +276,64 @@ bool Renderer::initialize(int width, int height, HWND hwnd, float zNear, float z
 
 	shadowQuadVertexBuffer->Unlock();
 
+	renderQueue = new RenderQueue();
+	backend = new D3D9Backend(device, shadowQuadVertexBuffer, useTwoSidedStencils);
+
+	// Meshes drawn many times (wheels, gun mounts) go out in one call each where the card
+	// can do it, and packed meshes are decoded in a shader. It lights them like the fixed
+	// function light and material above.
+	D3DXCOLOR ambient = D3DXCOLOR(D3DCOLOR_XRGB(100, 100, 100)) + D3DXCOLOR(light.Ambient);
+	D3DXCOLOR materialAmbient = D3DXCOLOR(material.Ambient);
+	D3DXColorModulate(&ambient, &ambient, &materialAmbient);
+
+	D3DXCOLOR diffuse = D3DXCOLOR(light.Diffuse);
+	D3DXCOLOR materialDiffuse = D3DXCOLOR(material.Diffuse);
+	D3DXColorModulate(&diffuse, &diffuse, &materialDiffuse);
+
+	meshShader = new D3D9MeshShader(device);
+	if (!meshShader->initialize(ambient, diffuse, lightDir, startFog, endFog))
+	{
+		delete meshShader;
+		meshShader = NULL;
+	}
+
+	instanceBatch = new InstanceBatch();
+	instancer = new D3D9Instancer(device);
+	if (!instancer->initialize())
+	{
+		delete instancer;
+		instancer = NULL;
+	}
+	backend->setInstancer(instancer);
+
+	culler = new FrustumCuller();
+	chunkCuller = new FrustumCuller();
+
+	shadowTiers = new ShadowTiers();
+	blobRenderer = new D3D9BlobRenderer(device);
+	if (!blobRenderer->initialize())
+	{
+		delete blobRenderer;
+		blobRenderer = NULL;
+	}
+
+	particleBudget = new ParticleBudget(PARTICLE_BUDGET);
 	smokeSystem = new SmokeSystem();
 	laserSystem = new LaserSystem();
+	particleRenderer = new D3D9ParticleRenderer(device);
+	if (!particleRenderer->initialize())
+	{
+		delete particleRenderer;
+		particleRenderer = NULL;
+	}
+
+	// Load every model up front so nothing hits the disk mid-race
+	meshRegistry = new MeshRegistry(device);
+	meshRegistry->preload("models/manifest.txt");
+
+	// Textures for the racers and for what spawns mid-race (rockets, landmines)
+	textureCache = new TextureCache(new D3D9TextureLoader(device));
+	textureCache->preload("textures/manifest.txt");
 
 	return true;
 }
@@ -236,6 +345,12 @@ void Renderer::shutdown()
 		// Clean up drawables
 	}
 
+	if (shadowCasters)
+	{
+		delete [] shadowCasters;
+		shadowCasters = NULL;
+	}
+
 	if (dynamicDrawables)
 	{
 		dynamicDrawables->clear();
@@ -249,6 +364,102 @@ void Renderer::shutdown()
 		smokeSystem = NULL;
 	}
 
+	if (laserSystem)
+	{
+		delete laserSystem;
+		laserSystem = NULL;
+	}
+
+	if (particleRenderer)
+	{
+		delete particleRenderer;
+		particleRenderer = NULL;
+	}
+
+	if (particleBudget)
+	{
+		delete particleBudget;
+		particleBudget = NULL;
+	}
+
+	if (renderQueue)
+	{
+		delete renderQueue;
+		renderQueue = NULL;
+	}
+
+	if (backend)
+	{
+		delete backend;
+		backend = NULL;
+	}
+
+	if (instancer)
+	{
+		delete instancer;
+		instancer = NULL;
+	}
+
+	if (meshShader)
+	{
+		delete meshShader;
+		meshShader = NULL;
+	}
+
+	if (instanceBatch)
+	{
+		delete instanceBatch;
+		instanceBatch = NULL;
+	}
+
+	if (culler)
+	{
+		delete culler;
+		culler = NULL;
+	}
+
+	if (chunkCuller)
+	{
+		delete chunkCuller;
+		chunkCuller = NULL;
+	}
+
+	if (blobRenderer)
+	{
+		delete blobRenderer;
+		blobRenderer = NULL;
+	}
+
+	if (shadowTiers)
+	{
+		delete shadowTiers;
+		shadowTiers = NULL;
+	}
+
+	if (snapshot)
+	{
+		delete snapshot;
+		snapshot = NULL;
+	}
+
+	if (meshRegistry)
+	{
+		delete meshRegistry;
+		meshRegistry = NULL;
+	}
+
+	if (textureCache)
+	{
+		delete textureCache;
+		textureCache = NULL;
+	}
+
+	if (stateCache)
+	{
+		delete stateCache;
+		stateCache = NULL;
+	}
+
 	if (hud)
 	{
 		// Clean up HUD
@@ -262,10 +473,16 @@ void Renderer::shutdown()
 		camera = NULL;
 	}
 
-	if (font)
+	if (textRenderer)
 	{
-		font->Release();
-		font = NULL;
+		delete textRenderer;
+		textRenderer = NULL;
+	}
+
+	if (textBatch)
+	{
+		delete textBatch;
+		textBatch = NULL;
 	}
 
 	if (d3dObject)
@@ -281,43 +498,57 @@ void Renderer::shutdown()
 	}
 }
 
-void Renderer::render()
+void Renderer::render(float alpha)
 {
 	D3DXMATRIX viewMatrix;
-	
-	// Draw skybox
 
-	camera->updateForSkybox();
-
-	// Get view matrix
-	camera->getViewMatrix(viewMatrix);
+	// Everything is drawn where it was alpha of the way between the newest
+	// complete tick and the one before; the simulation's own transforms aren't touched
+	const SnapshotFrame* frame = snapshot->acquire();
 
-	// Build shadow volumes for all racers
-	for (int i = 0; i < currentDrawable; i++)
+	frameDrawables.clear();
+	frameStatic = 0;
+	frameEntries = NULL;
+	if (frame)
 	{
-		if ((drawables[i]->meshType == RACER) || (drawables[i]->meshType == REARWHEEL)
-			|| (drawables[i]->meshType == FRONTWHEEL) || (drawables[i]->meshType == GUNMOUNTMESH))
+		for (int i = 0; i < frame->count; i++)
 		{
-			drawables[i]->buildShadowVolume(lightDir);
+			const SnapshotEntry& entry = frame->entries[i];
+			Drawable* drawable = (Drawable*) entry.owner;
+
+			TransformSnapshot::interpolate(entry.previous, entry.current, alpha, (float*) drawable->getRenderTransform());
+			frameDrawables.push_back(drawable);
 		}
+		frameStatic = frame->staticCount;
+		frameEntries = frame->entries;
+		drawnTick = frame->tick;
 	}
+	frameCount++;
+
+	stateCache->beginFrame();
 	
+	// Draw skybox
+
+	camera->updateForSkybox();
+
+	// Get view matrix
+	camera->getViewMatrix(viewMatrix);
 	
 	device->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL, NULL, 1.0f, 0);
 	
-	device->SetTransform(D3DTS_PROJECTION, &projectionMatrix);
-	device->SetTransform(D3DTS_VIEW, &viewMatrix);
-	device->SetTransform(D3DTS_WORLD, &worldMatrix);
+	StateCache::cache->setTransform(D3DTS_PROJECTION, (const float*) &projectionMatrix);
+	StateCache::cache->setTransform(D3DTS_VIEW, (const float*) &viewMatrix);
+	StateCache::cache->setTransform(D3DTS_WORLD, (const float*) &worldMatrix);
 
-	device->SetRenderState(D3DRS_ZENABLE, FALSE);
-	device->SetRenderState(D3DRS_LIGHTING, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, FALSE);
 	
 	device->BeginScene();
 
 	skybox->render(device);
 
-	device->SetRenderState(D3DRS_LIGHTING, TRUE);
-	device->SetRenderState(D3DRS_ZENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, TRUE);
+	StateCache::cache->setRenderState(D3DRS_ZENABLE, TRUE);
 
 
 	// Now draw rest of the scene
@@ -329,83 +560,116 @@ void Renderer::render()
 	// Get view matrix
 	camera->getViewMatrix(viewMatrix);
 
-	device->SetTransform(D3DTS_VIEW, &viewMatrix);
-	
+	StateCache::cache->setTransform(D3DTS_VIEW, (const float*) &viewMatrix);
 
-	device->SetRenderState(D3DRS_FOGENABLE, TRUE);
+	D3DXVECTOR3 eye = camera->getPosition();
+	D3DXMATRIX viewProjection = viewMatrix * projectionMatrix;
+	cullScene(&viewProjection, eye);
 
-	for (int i = 0; i < currentDrawable; i++)
+	if (meshShader)
 	{
-		drawables[i]->render(device);
+		meshShader->setCamera(&viewMatrix, &projectionMatrix);
 	}
 
-	// Draw dynamic objects that will be removed after this frame (like rockets, lasers, landmines)
-	if (!(dynamicDrawables->empty()))
+	// Build shadow volumes for the racers whose shadows can be seen. Casters that
+	// have turned relative to the light are extracted in parallel into their own
+	// CPU buffers, then copied into their vertex buffers here (the device is single threaded).
+	int numCasters = 0;
+	for (unsigned int i = 0; i < visibleShadows.size(); i++)
 	{
-		for (std::vector<Drawable*>::iterator iter = dynamicDrawables->begin();
-			iter < dynamicDrawables->end(); ++iter)
+		if (visibleShadows[i]->prepareShadowVolume(lightDir))
 		{
-			(*iter)->render(device);
+			shadowCasters[numCasters++] = visibleShadows[i];
 		}
+	}
 
-		dynamicDrawables->clear();
+	#pragma omp parallel for
+	for (int i = 0; i < numCasters; i++)
+	{
+		shadowCasters[i]->extractShadowVolume();
+	}
+
+	for (int i = 0; i < numCasters; i++)
+	{
+		shadowCasters[i]->uploadShadowVolume();
 	}
 	
-	
-	device->SetRenderState(D3DRS_FOGENABLE, FALSE);
-	// Draw stencil shadows
-	drawShadows();
+
+	// Record the scene and its stencil shadows, sort so draws sharing a texture
+	// and mesh are together, and play it back. The passes set fog and stencil states.
+	renderQueue->clear();
+
+	if (instancer)
+	{
+		queueInstances(eye);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < visibleDrawables.size(); i++)
+		{
+			queueDrawable(visibleDrawables[i], eye);
+		}
+	}
+
+	for (unsigned int i = 0; i < visibleShadows.size(); i++)
+	{
+		queueShadowVolume(visibleShadows[i], eye);
+	}
+
+	renderQueue->sort();
+	renderQueue->replay(backend);
 	
 
 
+	StateCache::cache->setTransform(D3DTS_WORLD, (const float*) &worldMatrix);
+
+	// Blob shadows of the racers too far away for volumes
+	if (blobRenderer)
+	{
+		blobRenderer->draw(shadowTiers);
+	}
+
+	// Every particle billboarded into one buffer, then drawn a texture at a time
+	if (particleRenderer)
+	{
+		particleRenderer->begin(&viewMatrix);
+		smokeSystem->expand(particleRenderer);
+		laserSystem->expand(particleRenderer);
+		particleRenderer->end();
+	}
+
 	// Render SmokeSystem particles
-	device->SetTransform(D3DTS_WORLD, &worldMatrix);
-	smokeSystem->render(EXPLOSION_SMOKE);
-	smokeSystem->render(ROCKET_SMOKE);
+	smokeSystem->render(particleRenderer, EXPLOSION_SMOKE);
+	smokeSystem->render(particleRenderer, ROCKET_SMOKE);
 
 	// Render LaserSystem particles (beginning and end points of shots)
-	laserSystem->render();
+	laserSystem->render(particleRenderer);
 
 
-	for (int i = 0; i < numSentences; i++)
+	if (textRenderer)
 	{
-		writeText(sentences[i], i);
+		textRenderer->draw(textBatch);
 	}
-	
-	device->EndScene();
-
 
 	// Now draw HUD
 	hud->render();
+	
+	device->EndScene();
 
 	device->Present(NULL, NULL, NULL, NULL);
 
 	return;
 }
 
-void Renderer::writeText(std::string text, int line)
-{
-	RECT rect;
-	SetRect(&rect, 20, 20 + (line*30), 600, 600);
-	
-	font->DrawText(NULL, text.c_str(), -1, &rect, DT_LEFT|DT_NOCLIP, D3DCOLOR_XRGB(200, 50, 50));
-}
-
-void Renderer::setText(std::string* sentenceArray, int count)
+// Lays the lines out straight away, so they only have to last for the call.
+// They stay on screen until the next setText.
+void Renderer::setText(const char* const* lines, int count)
 {
-	if ((sentences) && (numSentences < count))
-	{
-		delete [] sentences;
-		sentences = NULL;
-	}
-	
-	numSentences = count;
-
-	sentences = new std::string[count];
+	textBatch->clear();
 
 	for (int i = 0; i < count; i++)
 	{
-		sentences[i] = std::string(sentenceArray[i]);
+		textBatch->addLine(lines[i], 20.0f, 20.0f + i * 30.0f, D3DCOLOR_XRGB(200, 50, 50));
 	}
 }
 
@@ -455,7 +719,7 @@ Camera* Renderer::getCamera()
 }
 
 
-// Adds a drawable that will be drawn for only one frame
+// Adds a drawable that will be drawn for only one tick
 void Renderer::addDynamicDrawable(Drawable* drawable)
 {
 	if (!drawable)
@@ -464,122 +728,281 @@ void Renderer::addDynamicDrawable(Drawable* drawable)
 	dynamicDrawables->push_back(drawable);
 }
 
-void Renderer::drawShadows()
+void Renderer::removeDynamicDrawable(Drawable* drawable)
 {
-	device->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
-	
-	// Disable lighting
-	device->SetRenderState(D3DRS_LIGHTING, FALSE);
-	device->SetRenderState(D3DRS_ZENABLE, TRUE);
+	for (unsigned int i = 0; i < dynamicDrawables->size(); i++)
+	{
+		if ((*dynamicDrawables)[i] == drawable)
+		{
+			dynamicDrawables->erase(dynamicDrawables->begin() + i);
+			return;
+		}
+	}
+}
 
-	// Disable writing to depth-buffer
-	device->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-    device->SetRenderState(D3DRS_STENCILENABLE, TRUE);
-	
-	// Got most of this (and the addEdge() function) from some
-	// sample source code online, which said it got most of
-	// the code in turn from the DirectX SDK
-	device->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_FLAT);
-
-	device->SetRenderState(D3DRS_STENCILFUNC, D3DCMP_ALWAYS);
-    device->SetRenderState(D3DRS_STENCILZFAIL, D3DSTENCILOP_KEEP);
-    device->SetRenderState(D3DRS_STENCILFAIL, D3DSTENCILOP_KEEP);
-
-    // If z-test passes, inc/decrement stencil buffer value
-    device->SetRenderState(D3DRS_STENCILMASK, 0xffffffff);
-    device->SetRenderState(D3DRS_STENCILWRITEMASK, 0xffffffff);
-    device->SetRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_INCR);
-
-    // Make sure that no pixels get drawn to the frame buffer
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-    device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_ZERO);
-    device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ONE);
-
-
-	// Two-sided stencil functionality makes shadows faster
-	// (one pass instead of two)
-	if (useTwoSidedStencils)
-	{
-		device->SetRenderState(D3DRS_TWOSIDEDSTENCILMODE, TRUE);
-		device->SetRenderState(D3DRS_CCW_STENCILFUNC, D3DCMP_ALWAYS);
-		device->SetRenderState(D3DRS_CCW_STENCILZFAIL, D3DSTENCILOP_KEEP);
-		device->SetRenderState(D3DRS_CCW_STENCILFAIL, D3DSTENCILOP_KEEP);
-		device->SetRenderState(D3DRS_CCW_STENCILPASS, D3DSTENCILOP_DECR);
-		device->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-
-		// Now render in only one pass!
-		for (int i = 0; i < currentDrawable; i++)
+// Hands the renderer this tick's transforms, with the last tick's to draw from
+void Renderer::publishTransforms(unsigned int tick)
+{
+	snapshot->begin();
+
+	for (int i = 0; i < currentDrawable; i++)
+	{
+		publishDrawable(drawables[i], tick);
+	}
+	snapshot->markStatic();
+
+	for (unsigned int i = 0; i < dynamicDrawables->size(); i++)
+	{
+		publishDrawable((*dynamicDrawables)[i], tick);
+	}
+
+	snapshot->publish(tick);
+	transformsDropped = snapshot->dropped;
+
+	dynamicDrawables->clear();
+}
+
+void Renderer::publishDrawable(Drawable* drawable, unsigned int tick)
+{
+	// Something new (a rocket just fired) has nowhere to be drawn from but where it is
+	bool continuous = drawable->publishedTick != 0 && drawable->publishedTick + 1 == tick;
+
+	SnapshotEntry* entry = snapshot->add(drawable, (const float*) drawable->getTransform(),
+		continuous ? (const float*) &drawable->publishedTransform : NULL);
+
+	// The simulation keeps changing these, so the renderer gets them as they were at the tick
+	if (entry)
+	{
+		entry->onGround = drawable->onGround;
+		memcpy(entry->groundPoint, &drawable->groundPoint, sizeof(entry->groundPoint));
+		memcpy(entry->groundNormal, &drawable->groundNormal, sizeof(entry->groundNormal));
+	}
+
+	drawable->publishedTransform = *drawable->getTransform();
+	drawable->publishedTick = tick;
+}
+
+void Renderer::cullScene(D3DXMATRIX* viewProjection, D3DXVECTOR3 eye)
+{
+	visibleDrawables.clear();
+	visibleShadows.clear();
+
+	// Static drawables, then dynamic objects of the tick being drawn (like rockets, lasers, landmines)
+	int numDrawn = frameDrawables.size();
+
+	sphereX.resize(numDrawn);
+	sphereY.resize(numDrawn);
+	sphereZ.resize(numDrawn);
+	sphereRadius.resize(numDrawn);
+	sphereVisible.resize(numDrawn);
+
+	for (int i = 0; i < numDrawn; i++)
+	{
+		Drawable* drawable = frameDrawables[i];
+
+		D3DXVECTOR3 center;
+		drawable->getBoundingSphere(center, sphereRadius[i]);
+		sphereX[i] = center.x;
+		sphereY[i] = center.y;
+		sphereZ[i] = center.z;
+	}
+
+	culler->setViewProjection((const float*) viewProjection);
+	culler->setDistanceLimit((const float*) &eye, 0.0f);	// The far plane is enough for the meshes
+
+	if (numDrawn > 0)
+	{
+		culler->cull(&sphereX[0], &sphereY[0], &sphereZ[0], &sphereRadius[0], numDrawn, &sphereVisible[0]);
+	}
+	visibleCount = numDrawn > 0 ? culler->visibleCount : 0;
+	culledCount = numDrawn > 0 ? culler->culledCount : 0;
+
+	// Every drawable picks its level of detail, visible or not: casters off
+	// screen still extract their shadow volumes from it
+	for (int i = 0; i < LOD_MAX_LEVELS; i++)
+	{
+		lodCounts[i] = 0;
+	}
+	chunksVisible = 0;
+	chunksTotal = 0;
+
+	for (int i = 0; i < numDrawn; i++)
+	{
+		Drawable* drawable = frameDrawables[i];
+
+		float x = sphereX[i] - eye.x, y = sphereY[i] - eye.y, z = sphereZ[i] - eye.z;
+		float distance = sqrt(x * x + y * y + z * z);
+		float screenSize = distance > sphereRadius[i] ? sphereRadius[i] * lodScale / distance : lodScale;
+		int level = drawable->updateLod(screenSize);
+
+		if (sphereVisible[i])
 		{
-			if ((drawables[i]->meshType == RACER) || (drawables[i]->meshType == REARWHEEL)
-				|| (drawables[i]->meshType == FRONTWHEEL) || (drawables[i]->meshType == GUNMOUNTMESH))
+			visibleDrawables.push_back(drawable);
+			lodCounts[level]++;
+
+			// The track's sphere is always on screen, so its chunks are culled on their
+			// own, with the frustum taken into the mesh's space. The runs stay on the
+			// mesh until it is drawn, so a chunked mesh has to have only one drawable.
+			Mesh* mesh = drawable->getLodMesh();
+			if (mesh && mesh->chunks)
 			{
-				drawables[i]->renderShadowVolume(device);
+				D3DXMATRIX localViewProjection = *drawable->getRenderTransform() * *viewProjection;
+				chunkCuller->setViewProjection((const float*) &localViewProjection);
+
+				chunksVisible += mesh->chunks->cull(chunkCuller->planes);
+				chunksTotal += mesh->chunks->chunks.size();
 			}
 		}
+	}
+
+	// Shadow detail by distance, per racer: its wheels and gun mount follow the
+	// chassis. Far racers get a blob on the ground instead of volumes.
+	shadowOwners.clear();
+	ownerEntries.clear();
+	ownerDistances.clear();
+	ownerTiers.clear();
+	for (int i = 0; i < frameStatic; i++)
+	{
+		if (frameDrawables[i]->hasShadowVolume() && !frameDrawables[i]->shadowOwner)
+		{
+			float x = sphereX[i] - eye.x, y = sphereY[i] - eye.y, z = sphereZ[i] - eye.z;
+			shadowOwners.push_back(frameDrawables[i]);
+			ownerEntries.push_back(&frameEntries[i]);
+			ownerDistances.push_back(sqrt(x * x + y * y + z * z));
+			ownerTiers.push_back(frameDrawables[i]->shadowTier);
+		}
+	}
 
-		device->SetRenderState(D3DRS_TWOSIDEDSTENCILMODE, FALSE);
+	if (!shadowOwners.empty())
+	{
+		shadowTiers->assign(&ownerDistances[0], shadowOwners.size(), &ownerTiers[0]);
+	}
+	for (int i = 0; i < SHADOW_TIER_COUNT; i++)
+	{
+		shadowTierCounts[i] = shadowOwners.empty() ? 0 : shadowTiers->tierCounts[i];
 	}
-	else	// Do two passes for shadows if two-sided stencil unavailable
+
+	shadowTiers->clear();
+	for (unsigned int i = 0; i < shadowOwners.size(); i++)
 	{
-		// Draw front-side of shadow volume in stencil/z only
-		for (int i = 0; i < currentDrawable; i++)
+		Drawable* owner = shadowOwners[i];
+		const SnapshotEntry* entry = ownerEntries[i];
+		owner->shadowTier = ownerTiers[i];
+
+		// Flat on the ground under the chassis; none while it is in the air
+		if (owner->shadowTier == SHADOW_TIER_BLOB && entry->onGround)
 		{
-			if ((drawables[i]->meshType == RACER) || (drawables[i]->meshType == REARWHEEL)
-				|| (drawables[i]->meshType == FRONTWHEEL) || (drawables[i]->meshType == GUNMOUNTMESH))
-			{
-				drawables[i]->renderShadowVolume(device);
-			}
+			D3DXVECTOR3 groundPoint(entry->groundPoint), groundNormal(entry->groundNormal);
+			D3DXVECTOR3 position = owner->getRenderPosition();
+			D3DXVECTOR3 forward = owner->getRenderZVector();
+			D3DXVECTOR3 offset = position - groundPoint;
+			D3DXVECTOR3 point = position - groundNormal * D3DXVec3Dot(&offset, &groundNormal);
+
+			shadowTiers->addBlob((const float*) &point, entry->groundNormal, (const float*) &forward, ownerDistances[i]);
 		}
+	}
 
-		// Now reverse cull order so back sides of shadow volume are written.
-		device->SetRenderState(D3DRS_CULLMODE, D3DCULL_CW);
+	// A shadow volume is the caster pushed SHADOW_EXTRUDE_DISTANCE along the light,
+	// so its sphere is centred halfway along and grown by half the extrusion. Only
+	// racers, wheels and gun mounts have shadow volumes, and a caster off screen
+	// can still throw one onto it.
+	int numShadows = 0;
+	for (int i = 0; i < frameStatic; i++)
+	{
+		Drawable* owner = frameDrawables[i]->shadowOwner ? frameDrawables[i]->shadowOwner : frameDrawables[i];
 
-		// Decrement stencil buffer value
-		device->SetRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_DECR);
+		if (frameDrawables[i]->hasShadowVolume() && owner->shadowTier == SHADOW_TIER_VOLUME)
+		{
+			sphereX[numShadows] = sphereX[i] + lightDir.x * (SHADOW_EXTRUDE_DISTANCE * 0.5f);
+			sphereY[numShadows] = sphereY[i] + lightDir.y * (SHADOW_EXTRUDE_DISTANCE * 0.5f);
+			sphereZ[numShadows] = sphereZ[i] + lightDir.z * (SHADOW_EXTRUDE_DISTANCE * 0.5f);
+			sphereRadius[numShadows] = sphereRadius[i] + SHADOW_EXTRUDE_DISTANCE * 0.5f;
+			shadowCasters[numShadows] = frameDrawables[i];
+			numShadows++;
+		}
+	}
 
-		// Draw back-side of shadow volume in stencil/z only
-		for (int i = 0; i < currentDrawable; i++)
+	culler->setDistanceLimit((const float*) &eye, SHADOW_CULL_DISTANCE);
+
+	culledShadowCount = 0;
+	if (numShadows > 0)
+	{
+		culler->cull(&sphereX[0], &sphereY[0], &sphereZ[0], &sphereRadius[0], numShadows, &sphereVisible[0]);
+		culledShadowCount = culler->culledCount;
+	}
+
+	for (int i = 0; i < numShadows; i++)
+	{
+		if (sphereVisible[i])
 		{
-			if ((drawables[i]->meshType == RACER) || (drawables[i]->meshType == REARWHEEL)
-				|| (drawables[i]->meshType == FRONTWHEEL) || (drawables[i]->meshType == GUNMOUNTMESH))
-			{
-				drawables[i]->renderShadowVolume(device);
-			}
+			visibleShadows.push_back(shadowCasters[i]);
 		}
 	}
+}
 
-	device->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
-	device->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
-	device->SetRenderState(D3DRS_ZWRITEENABLE, TRUE);
+void Renderer::queueDrawable(Drawable* drawable, D3DXVECTOR3 eye)
+{
+	D3DXVECTOR3 offset = drawable->getRenderPosition() - eye;
+	float depth = D3DXVec3Length(&offset);
+	Mesh* mesh = drawable->getLodMesh();
 
+	renderQueue->submit(RENDER_PASS_OPAQUE, mesh->chunks ? RENDER_DRAW_CHUNKS : RENDER_DRAW_MESH, drawable->getTexture(), mesh,
+		(const float*) drawable->getRenderTransform(), depth);
+}
 
+void Renderer::queueInstances(D3DXVECTOR3 eye)
+{
+	// Group the visible drawables by mesh (each level of detail on its own) and texture
+	instanceBatch->clear();
 
-    device->SetRenderState(D3DRS_ZENABLE, FALSE);
+	for (unsigned int i = 0; i < visibleDrawables.size(); i++)
+	{
+		Drawable* drawable = visibleDrawables[i];
+		D3DXVECTOR3 offset = drawable->getRenderPosition() - eye;
 
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-	device->SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
-    device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+		// Only the visible chunks are drawn, so it can't be an instance
+		if (drawable->getLodMesh()->chunks)
+		{
+			queueDrawable(drawable, eye);
+			continue;
+		}
 
-	device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-    device->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
-	device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-    device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+		instanceBatch->add(drawable->getLodMesh(), drawable->getTexture(), (const float*) drawable->getRenderTransform(),
+			D3DCOLOR_XRGB(255, 255, 255), D3DXVec3Length(&offset), drawable);
+	}
 
+	instanceBatch->build();
+	bool uploaded = instancer->upload(instanceBatch);
 
-	// Only write where stencil value >= 1 (count indicates # of shadows that
-    // overlap that pixel)
-    device->SetRenderState(D3DRS_STENCILREF, 1);
-	device->SetRenderState(D3DRS_STENCILFUNC, D3DCMP_LESSEQUAL);
-    device->SetRenderState(D3DRS_STENCILPASS, D3DSTENCILOP_KEEP);
+	// Groups big enough are one draw each; the rest are drawn on their own
+	for (int g = 0; g < instanceBatch->getGroupCount(); g++)
+	{
+		InstanceGroup* group = instanceBatch->getGroup(g);
+
+		if (uploaded && group->count >= INSTANCE_MIN_COUNT && instancer->canDraw(group))
+		{
+			renderQueue->submit(RENDER_PASS_OPAQUE, RENDER_DRAW_INSTANCES, group->texture, group, NULL, group->depth);
+		}
+		else
+		{
+			for (int i = group->first; i < group->first + group->count; i++)
+			{
+				queueDrawable((Drawable*) instanceBatch->getOwner(i), eye);
+			}
+		}
+	}
+}
 
-	// Draw big dark square
-	device->SetStreamSource(0, shadowQuadVertexBuffer, 0, sizeof(ShadowPoint));
-	device->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE);
-	device->DrawPrimitive(D3DPT_TRIANGLESTRIP, 0, 2);
+void Renderer::queueShadowVolume(Drawable* drawable, D3DXVECTOR3 eye)
+{
+	D3DXVECTOR3 offset = drawable->getRenderPosition() - eye;
+	float depth = D3DXVec3Length(&offset);
+	const float* transform = (const float*) drawable->getRenderTransform();
 
-	device->SetRenderState(D3DRS_ZENABLE, TRUE);
-	device->SetRenderState(D3DRS_LIGHTING, TRUE);
-	device->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+	renderQueue->submit(RENDER_PASS_SHADOW, RENDER_DRAW_SHADOW_VOLUME, NULL, drawable, transform, depth);
+
+	if (!useTwoSidedStencils)
+	{
+		renderQueue->submit(RENDER_PASS_SHADOW_BACK, RENDER_DRAW_SHADOW_VOLUME, NULL, drawable, transform, depth);
+	}
 }
@@ -16,6 +16,26 @@
 #include "Skybox.h"
 #include "SmokeSystem.h"
 #include "LaserSystem.h"
+#include "RenderQueue.h"
+#include "D3D9Backend.h"
+#include "D3D9MeshShader.h"
+#include "D3D9TextureLoader.h"
+#include "FrustumCuller.h"
+#include "StateCache.h"
+#include "D3D9StateDevice.h"
+#include "InstanceBatch.h"
+#include "TextBatch.h"
+#include "D3D9TextRenderer.h"
+#include "ShadowTiers.h"
+#include "D3D9BlobRenderer.h"
+#include "D3D9ParticleRenderer.h"
+#include "TransformSnapshot.h"
+
+// Shadow volumes further than this from the camera are skipped; it is where the fog ends
+#define SHADOW_CULL_DISTANCE 500.0f
+
+// Room in each published tick for dynamic drawables (rockets, landmines), on top of the static ones
+#define SNAPSHOT_DYNAMIC_DRAWABLES 256
 
 struct ShadowPoint
 {
@@ -31,10 +51,12 @@ public:
 	~Renderer();
 	bool initialize(int width, int height, HWND hwnd, float zNear, float zFar, int numDrawables, char* msg);
 	void shutdown();
-	void render();
-	void setText(std::string* sentences, int count);
+	void render(float alpha);		// alpha is how far past the last published tick to draw, in ticks
+	void publishTransforms(unsigned int tick);		// Simulation side, after every tick
+	void setText(const char* const* lines, int count);
 	int addDrawable(Drawable* drawable);
 	void addDynamicDrawable(Drawable* drawable);
+	void removeDynamicDrawable(Drawable* drawable);		// Destroyed before this tick was published
 	void setFocus(int drawableIndex);
 	IDirect3DDevice9* getDevice();
 	HUD* getHUD();
@@ -44,9 +66,24 @@ public:
 	static IDirect3DDevice9* device;
 	static D3DXVECTOR3 lightDir;
 
+	// From the last frame
+	int visibleCount;
+	int culledCount;
+	int culledShadowCount;
+	int lodCounts[LOD_MAX_LEVELS];		// Visible drawables at each level of detail
+	int chunksVisible;		// Of the chunked meshes (the track) drawn
+	int chunksTotal;
+	int shadowTierCounts[SHADOW_TIER_COUNT];	// Racers with no shadow, a blob and volumes
+	int frameCount;			// Frames rendered so far
+	unsigned int drawnTick;	// Tick the last frame was drawn up to
+	int transformsDropped;	// That didn't fit in the last published tick
+
 private:
-	void writeText(std::string text, int line);
-	void drawShadows();
+	void cullScene(D3DXMATRIX* viewProjection, D3DXVECTOR3 eye);
+	void queueDrawable(Drawable* drawable, D3DXVECTOR3 eye);
+	void queueShadowVolume(Drawable* drawable, D3DXVECTOR3 eye);
+	void queueInstances(D3DXVECTOR3 eye);
+	void publishDrawable(Drawable* drawable, unsigned int tick);
 
 	inline DWORD FtoDw(float f)
 	{
@@ -56,16 +93,16 @@ private:
 	IDirect3D9* d3dObject;
 	
 	D3DXMATRIX projectionMatrix;
+	float lodScale;			// Pixels covered by one unit at a distance of one unit, for picking levels of detail
 	D3DXMATRIX worldMatrix;
 	
-	ID3DXFont* font;
-	
-	int numSentences;
-	std::string* sentences;
+	TextBatch* textBatch;
+	D3D9TextRenderer* textRenderer;		// NULL if the glyph atlas couldn't be made; no text then
 
 	int numDrawables;
 	int currentDrawable;
 	Drawable** drawables;
+	Drawable** shadowCasters;		// Scratch list for building shadow volumes
 	std::vector<Drawable*>* dynamicDrawables;
 
 	HUD* hud;
@@ -76,6 +113,42 @@ private:
 	IDirect3DVertexBuffer9* shadowQuadVertexBuffer;
 
 	bool useTwoSidedStencils;
+	ParticleBudget* particleBudget;
 	SmokeSystem* smokeSystem;
 	LaserSystem* laserSystem;
+	D3D9ParticleRenderer* particleRenderer;		// NULL if its buffers couldn't be made; no particles then
+	MeshRegistry* meshRegistry;
+	TextureCache* textureCache;
+	StateCache* stateCache;
+
+	RenderQueue* renderQueue;
+	D3D9Backend* backend;
+
+	D3D9MeshShader* meshShader;		// NULL without vs_2_0; packed meshes are uploaded unpacked then
+	InstanceBatch* instanceBatch;
+	D3D9Instancer* instancer;		// NULL without vs_3_0; everything is drawn one at a time then
+
+	// Bounding spheres of everything drawn this frame, then of the shadow volumes,
+	// and what survived the cull
+	FrustumCuller* culler;
+	FrustumCuller* chunkCuller;		// The frustum in a chunked mesh's own space
+	std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<unsigned char> sphereVisible;
+	std::vector<Drawable*> visibleDrawables;
+	std::vector<Drawable*> visibleShadows;
+
+	// Shadow detail per racer (drawables casting shadows that aren't part of another)
+	ShadowTiers* shadowTiers;
+	D3D9BlobRenderer* blobRenderer;		// NULL if its texture couldn't be made; no blobs then
+	std::vector<Drawable*> shadowOwners;
+	std::vector<const SnapshotEntry*> ownerEntries;		// Their ground, as it was at the tick
+	std::vector<float> ownerDistances;
+	std::vector<unsigned char> ownerTiers;
+
+	// Transforms handed over by the simulation, and what is drawn this frame:
+	// the static drawables of the tick, then its dynamic ones
+	TransformSnapshot* snapshot;
+	std::vector<Drawable*> frameDrawables;
+	const SnapshotEntry* frameEntries;		// Of the tick being drawn, in the same order
+	int frameStatic;
 };
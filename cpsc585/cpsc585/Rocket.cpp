@@ -3,8 +3,9 @@
 IXAudio2SourceVoice* Rocket::rocketVoice = NULL;
 
 
-Rocket::Rocket(IDirect3DDevice9* device, Racer* o)
+Rocket::Rocket(IDirect3DDevice9* device, Racer* o, unsigned int handle)
 {
+	this->handle = handle;
 	drawable = new Drawable(ROCKETMESH, "textures/rocket.dds", device);
 
 	owner = o;
@@ -29,7 +30,7 @@ Rocket::Rocket(IDirect3DDevice9* device, Racer* o)
 	info.m_shape->removeReference();
 	
 	
-	listener = new RocketListener(this);
+	listener = new RocketListener(handle);
 	body->addContactListener(listener);
 
 	Physics::physics->addRigidBody(body);
@@ -44,6 +45,9 @@ Rocket::Rocket(IDirect3DDevice9* device, Racer* o)
 	owner = NULL;
 
 	lifetime = 6.0f;
+
+	trail.initialize(ROCKET_TRAIL_RATE, 0, 0.0f, ROCKET_TRAIL_PRIORITY);
+	trail.start();
 }
 
 
@@ -63,9 +67,10 @@ Rocket::~Rocket(void)
 		Physics::world->removeEntity(body);
 	}
 
+	// The renderer may still have it in a tick it is drawing
 	if (drawable)
 	{
-		delete drawable;
+		drawable->removeReference();
 	}
 
 	Sound::sound->returnEmitter();
@@ -120,14 +125,10 @@ void Rocket::update(float seconds)
 		}
 		else
 		{
-			SmokeParticle* smoke = new SmokeParticle();
-
 			hkVector4 pos;
 			pos.setXYZ(body->getPosition());
 
-			smoke->setPosition(&pos);
-			SmokeSystem::system->addSmoke(ROCKET_SMOKE, smoke);
-			smoke = NULL;
+			SmokeSystem::system->emit(&trail, ROCKET_SMOKE, &pos, seconds);
 		}
 	}
 }
@@ -135,34 +136,29 @@ void Rocket::update(float seconds)
 void Rocket::explode()
 {
 	destroyed = true;
-	rocketVoice->Stop();
+	if (rocketVoice)
+		rocketVoice->Stop();
 
 	Sound::sound->playSoundEffect(SFX_EXPLOSION, emitter);
-	Explosion* explosion = new Explosion((hkTransform*) &(body->getTransform()), owner);
-
-	explosion->doDamage();
+	Explosion explosion((hkTransform*) &(body->getTransform()), owner);
 
-	SmokeParticle* smoke = new SmokeParticle();
+	explosion.doDamage();
 
 	hkVector4 pos;
 	pos.setXYZ(body->getPosition());
 
-	smoke->setPosition(&pos);
-	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, smoke);
-	smoke = NULL;
-
-
-	explosion = NULL;
+	SmokeSystem::system->addSmoke(EXPLOSION_SMOKE, &pos);
 }
 
 
-RocketListener::RocketListener(Rocket* r)
+RocketListener::RocketListener(unsigned int handle)
 {
-	rocket = r;
+	this->handle = handle;
 }
 
 void RocketListener::collisionAddedCallback(const hkpCollisionEvent& ev)
 {
-	if (!(rocket->destroyed))
+	Rocket* rocket = DynamicObjManager::manager->getRocket(handle);
+	if (rocket && !(rocket->destroyed))
 		rocket->explode();
 }
@@ -13,7 +13,7 @@ class Rocket :
 	public DynamicObj
 {
 public:
-	Rocket(IDirect3DDevice9* device, Racer* owner);
+	Rocket(IDirect3DDevice9* device, Racer* owner, unsigned int handle);
 	~Rocket(void);
 	void setPosAndRot(float posX, float posY, float posZ,
 		float rotX, float rotY, float rotZ);	// In Radians
@@ -22,6 +22,7 @@ public:
 
 private:
 	X3DAUDIO_EMITTER* emitter;
+	ParticleEmitter trail;
 
 public:
 	Racer* owner;
@@ -37,9 +38,9 @@ private:
 class RocketListener : public hkpContactListener
 {
 public:
-	RocketListener(Rocket* r);
+	RocketListener(unsigned int handle);
 	void collisionAddedCallback(const hkpCollisionEvent& ev);
 
 private:
-	Rocket* rocket;
+	unsigned int handle;	// Of its rocket
 };
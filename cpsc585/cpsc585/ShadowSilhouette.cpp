@@ -0,0 +1,237 @@
+#include "ShadowSilhouette.h"
+
+#include <string.h>
+#include <xmmintrin.h>
+
+
+ShadowSilhouette::ShadowSilhouette()
+{
+	faceCount = 0;
+	normalX = NULL;
+	normalY = NULL;
+	normalZ = NULL;
+	positions = NULL;
+	vertexNormals = NULL;
+	indices = NULL;
+	neighbours = NULL;
+}
+
+
+ShadowSilhouette::~ShadowSilhouette()
+{
+	release();
+}
+
+
+void ShadowSilhouette::release()
+{
+	if (normalX)
+	{
+		// One block holds all three normal arrays
+		_mm_free(normalX);
+		normalX = NULL;
+		normalY = NULL;
+		normalZ = NULL;
+	}
+
+	if (positions)
+	{
+		delete [] positions;
+		positions = NULL;
+	}
+
+	if (vertexNormals)
+	{
+		delete [] vertexNormals;
+		vertexNormals = NULL;
+	}
+
+	if (indices)
+	{
+		delete [] indices;
+		indices = NULL;
+	}
+
+	if (neighbours)
+	{
+		delete [] neighbours;
+		neighbours = NULL;
+	}
+
+	faceCount = 0;
+}
+
+
+void ShadowSilhouette::initialize(const float* vertexData, int stride, int numVertices,
+	const unsigned int* indexData, int numIndices, const unsigned int* adjacency)
+{
+	release();
+
+	faceCount = numIndices / 3;
+
+	positions = new float[numVertices * 3];
+	vertexNormals = new float[numVertices * 3];
+	for (int i = 0; i < numVertices; i++)
+	{
+		memcpy(&positions[i * 3], &vertexData[i * stride], sizeof(float) * 3);
+		memcpy(&vertexNormals[i * 3], &vertexData[i * stride + 3], sizeof(float) * 3);
+	}
+
+	indices = new unsigned int[faceCount * 3];
+	memcpy(indices, indexData, sizeof(unsigned int) * faceCount * 3);
+
+	neighbours = new unsigned int[faceCount * 3];
+	for (int i = 0; i < faceCount * 3; i++)
+	{
+		neighbours[i] = adjacency[i] == 0xFFFFFFFF ? 0 : adjacency[i];
+	}
+
+	// Face normals, summed and scaled in the same order the per-frame code did
+	int padded = (faceCount + 3) & ~3;
+	normalX = (float*) _mm_malloc(sizeof(float) * padded * 3, 16);
+	normalY = normalX + padded;
+	normalZ = normalY + padded;
+	memset(normalX, 0, sizeof(float) * padded * 3);
+
+	for (int f = 0; f < faceCount; f++)
+	{
+		const float* n0 = &vertexNormals[indices[f * 3] * 3];
+		const float* n1 = &vertexNormals[indices[f * 3 + 1] * 3];
+		const float* n2 = &vertexNormals[indices[f * 3 + 2] * 3];
+
+		normalX[f] = (n0[0] + n1[0] + n2[0]) * (1.0f / 3.0f);
+		normalY[f] = (n0[1] + n1[1] + n2[1]) * (1.0f / 3.0f);
+		normalZ[f] = (n0[2] + n1[2] + n2[2]) * (1.0f / 3.0f);
+	}
+}
+
+
+int ShadowSilhouette::extract(const float* light, float* points, unsigned char* faceFlags) const
+{
+	// Light facing test, 4 faces at a time
+	__m128 lightX = _mm_set1_ps(light[0]);
+	__m128 lightY = _mm_set1_ps(light[1]);
+	__m128 lightZ = _mm_set1_ps(light[2]);
+	__m128 zero = _mm_setzero_ps();
+
+	for (int f = 0; f < faceCount; f += 4)
+	{
+		__m128 dot = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_load_ps(&normalX[f]), lightX),
+			_mm_mul_ps(_mm_load_ps(&normalY[f]), lightY)),
+			_mm_mul_ps(_mm_load_ps(&normalZ[f]), lightZ));
+
+		int lit = _mm_movemask_ps(_mm_cmpgt_ps(dot, zero));
+		int unlit = _mm_movemask_ps(_mm_cmplt_ps(dot, zero));
+
+		int count = faceCount - f < 4 ? faceCount - f : 4;
+		for (int k = 0; k < count; k++)
+		{
+			faceFlags[f + k] = (unsigned char) ((((lit >> k) & 1) ? SHADOW_FACE_LIT : 0) | (((unlit >> k) & 1) ? SHADOW_FACE_UNLIT : 0));
+		}
+	}
+
+	return emitEdges(light, faceFlags, points);
+}
+
+
+int ShadowSilhouette::emitEdges(const float* light, const unsigned char* faceFlags, float* points) const
+{
+	float extrudeX = light[0] * SHADOW_EXTRUDE_DISTANCE;
+	float extrudeY = light[1] * SHADOW_EXTRUDE_DISTANCE;
+	float extrudeZ = light[2] * SHADOW_EXTRUDE_DISTANCE;
+
+	int numVertices = 0;
+
+	for (int f = 0; f < faceCount; f++)
+	{
+		if (!(faceFlags[f] & SHADOW_FACE_LIT))
+		{
+			continue;
+		}
+
+		// An edge of a lit face is on the silhouette when the face across it is unlit
+		for (int e = 0; e < 3; e++)
+		{
+			if (!(faceFlags[neighbours[f * 3 + e]] & SHADOW_FACE_UNLIT))
+			{
+				continue;
+			}
+
+			const float* a = &positions[indices[f * 3 + e] * 3];
+			const float* b = &positions[indices[f * 3 + (e + 1) % 3] * 3];
+
+			float extrudedA[3] = { a[0] - extrudeX, a[1] - extrudeY, a[2] - extrudeZ };
+			float extrudedB[3] = { b[0] - extrudeX, b[1] - extrudeY, b[2] - extrudeZ };
+
+			float* out = &points[numVertices * 3];
+			memcpy(&out[0], b, sizeof(float) * 3);
+			memcpy(&out[3], a, sizeof(float) * 3);
+			memcpy(&out[6], extrudedA, sizeof(float) * 3);
+			memcpy(&out[9], extrudedA, sizeof(float) * 3);
+			memcpy(&out[12], extrudedB, sizeof(float) * 3);
+			memcpy(&out[15], b, sizeof(float) * 3);
+			numVertices += 6;
+		}
+	}
+
+	return numVertices;
+}
+
+
+int ShadowSilhouette::extractReference(const float* light, float* points) const
+{
+	int numVertices = 0;
+
+	for (int i = 0; i < faceCount; i++)
+	{
+		const float* n0 = &vertexNormals[indices[i * 3] * 3];
+		const float* n1 = &vertexNormals[indices[i * 3 + 1] * 3];
+		const float* n2 = &vertexNormals[indices[i * 3 + 2] * 3];
+
+		float norm[3];
+		for (int k = 0; k < 3; k++)
+		{
+			norm[k] = (n0[k] + n1[k] + n2[k]) * (1.0f / 3.0f);
+		}
+
+		if (norm[0] * light[0] + norm[1] * light[1] + norm[2] * light[2] > 0.0f)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int neighbourTri = neighbours[i * 3 + e];
+
+				n0 = &vertexNormals[indices[neighbourTri * 3] * 3];
+				n1 = &vertexNormals[indices[neighbourTri * 3 + 1] * 3];
+				n2 = &vertexNormals[indices[neighbourTri * 3 + 2] * 3];
+
+				for (int k = 0; k < 3; k++)
+				{
+					norm[k] = (n0[k] + n1[k] + n2[k]) * (1.0f / 3.0f);
+				}
+
+				if (norm[0] * light[0] + norm[1] * light[1] + norm[2] * light[2] < 0.0f)
+				{
+					const float* v0 = &positions[indices[i * 3 + e] * 3];
+					const float* v1 = &positions[indices[i * 3 + (e + 1) % 3] * 3];
+
+					for (int k = 0; k < 3; k++)
+					{
+						float newV0 = v0[k] - light[k] * SHADOW_EXTRUDE_DISTANCE;
+						float newV1 = v1[k] - light[k] * SHADOW_EXTRUDE_DISTANCE;
+
+						points[(numVertices + 0) * 3 + k] = v1[k];
+						points[(numVertices + 1) * 3 + k] = v0[k];
+						points[(numVertices + 2) * 3 + k] = newV0;
+						points[(numVertices + 3) * 3 + k] = newV0;
+						points[(numVertices + 4) * 3 + k] = newV1;
+						points[(numVertices + 5) * 3 + k] = v1[k];
+					}
+					numVertices += 6;
+				}
+			}
+		}
+	}
+
+	return numVertices;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#define SHADOW_EXTRUDE_DISTANCE 200.0f
+
+#define SHADOW_FACE_LIT		0x1
+#define SHADOW_FACE_UNLIT	0x2		// Faces exactly edge on to the light are neither
+
+
+// Per-mesh data for finding the shadow volume silhouette: face normals
+// (the average of the corner normals, as the shadow code always used) in
+// structure-of-arrays form, plus copies of the positions, indices and edge
+// connectivity so the mesh's CPU data can be released.
+//
+// extract() only reads the shared data and writes to the buffers it is
+// given, so several casters using the same mesh can run it at once.
+class ShadowSilhouette
+{
+public:
+	ShadowSilhouette();
+	~ShadowSilhouette();
+
+	// Positions are the first three floats of every vertex and normals the next
+	// three; stride is in floats. adjacency is 3 per face, 0xFFFFFFFF on open edges.
+	void initialize(const float* vertexData, int stride, int numVertices,
+		const unsigned int* indexData, int numIndices, const unsigned int* adjacency);
+
+	// light points towards the light, in mesh space. Writes the extruded
+	// quads of every silhouette edge to points (xyz per vertex, room for
+	// getMaxPoints()) and returns the number of vertices. faceFlags needs faceCount bytes.
+	int extract(const float* light, float* points, unsigned char* faceFlags) const;
+	int extractReference(const float* light, float* points) const;	// The original per-face loop
+
+	int getMaxPoints() const { return faceCount * 18; }
+
+	int faceCount;
+
+private:
+	void release();
+	int emitEdges(const float* light, const unsigned char* faceFlags, float* points) const;
+
+	float* normalX;			// Padded to a multiple of 4 faces, 16 byte aligned
+	float* normalY;
+	float* normalZ;
+
+	float* positions;		// xyz per vertex
+	float* vertexNormals;	// Only used by extractReference
+	unsigned int* indices;	// 3 per face
+	unsigned int* neighbours;	// 3 per face, open edges point at face 0 like the old table
+};
@@ -0,0 +1,164 @@
+#include "ShadowTiers.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+// Sorts caster numbers by their ranking distance
+struct KeyLess
+{
+	const float* keys;
+
+	bool operator()(int a, int b) const
+	{
+		return keys[a] < keys[b];
+	}
+};
+
+
+ShadowTiers::ShadowTiers()
+{
+	vertices = new BlobVertex[SHADOW_MAX_BLOBS * 6];
+	vertexCount = 0;
+	dropped = 0;
+
+	for (int i = 0; i < SHADOW_TIER_COUNT; i++)
+	{
+		tierCounts[i] = 0;
+	}
+}
+
+
+ShadowTiers::~ShadowTiers()
+{
+	if (vertices)
+	{
+		delete [] vertices;
+		vertices = NULL;
+	}
+}
+
+
+void ShadowTiers::assign(const float* distances, int count, unsigned char* tiers)
+{
+	keys.resize(count);
+	order.resize(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		keys[i] = tiers[i] == SHADOW_TIER_VOLUME ? distances[i] * (1.0f - SHADOW_TIER_HYSTERESIS) : distances[i];
+		order[i] = i;
+	}
+
+	if (count > 0)
+	{
+		KeyLess less = { &keys[0] };
+		std::sort(order.begin(), order.end(), less);
+	}
+
+	for (int i = 0; i < SHADOW_TIER_COUNT; i++)
+	{
+		tierCounts[i] = 0;
+	}
+
+	for (int rank = 0; rank < count; rank++)
+	{
+		int caster = order[rank];
+
+		if (distances[caster] >= SHADOW_BLOB_DISTANCE)
+		{
+			tiers[caster] = SHADOW_TIER_NONE;
+		}
+		else if (rank < SHADOW_VOLUME_CASTERS)
+		{
+			tiers[caster] = SHADOW_TIER_VOLUME;
+		}
+		else
+		{
+			tiers[caster] = SHADOW_TIER_BLOB;
+		}
+
+		tierCounts[tiers[caster]]++;
+	}
+}
+
+
+void ShadowTiers::clear()
+{
+	vertexCount = 0;
+	dropped = 0;
+}
+
+
+void ShadowTiers::addBlob(const float* point, const float* normal, const float* forward, float distance)
+{
+	if (vertexCount + 6 > SHADOW_MAX_BLOBS * 6)
+	{
+		dropped++;
+		return;
+	}
+
+	// Across the blob: normal x forward, then along it: across x normal, so
+	// forward is flattened onto the ground
+	float side[3] = { normal[1] * forward[2] - normal[2] * forward[1],
+		normal[2] * forward[0] - normal[0] * forward[2],
+		normal[0] * forward[1] - normal[1] * forward[0] };
+	float length = sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+	if (length < 0.0001f)
+	{
+		// Forward straight into the ground; any direction on it will do
+		side[0] = normal[1];
+		side[1] = -normal[0];
+		side[2] = 0.0f;
+		length = sqrt(side[0] * side[0] + side[1] * side[1]);
+		if (length < 0.0001f)
+		{
+			side[0] = 1.0f;
+			side[1] = 0.0f;
+			length = 1.0f;
+		}
+	}
+
+	for (int k = 0; k < 3; k++)
+	{
+		side[k] /= length;
+	}
+
+	float along[3] = { side[1] * normal[2] - side[2] * normal[1],
+		side[2] * normal[0] - side[0] * normal[2],
+		side[0] * normal[1] - side[1] * normal[0] };
+
+	float fade = (SHADOW_BLOB_DISTANCE - distance) / SHADOW_BLOB_FADE;
+	fade = fade < 0.0f ? 0.0f : (fade > 1.0f ? 1.0f : fade);
+	unsigned int colour = (unsigned int) (SHADOW_BLOB_ALPHA * fade + 0.5f) << 24;
+
+	// Corners in the order of the two triangles
+	const float cornerSide[6] = { -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f };
+	const float cornerAlong[6] = { -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f };
+
+	for (int c = 0; c < 6; c++)
+	{
+		float s = cornerSide[c] * SHADOW_BLOB_WIDTH * 0.5f;
+		float a = cornerAlong[c] * SHADOW_BLOB_LENGTH * 0.5f;
+
+		BlobVertex& vertex = vertices[vertexCount++];
+		vertex.x = point[0] + side[0] * s + along[0] * a + normal[0] * SHADOW_BLOB_LIFT;
+		vertex.y = point[1] + side[1] * s + along[1] * a + normal[1] * SHADOW_BLOB_LIFT;
+		vertex.z = point[2] + side[2] * s + along[2] * a + normal[2] * SHADOW_BLOB_LIFT;
+		vertex.colour = colour;
+		vertex.u = cornerSide[c] * 0.5f + 0.5f;
+		vertex.v = cornerAlong[c] * 0.5f + 0.5f;
+	}
+}
+
+
+const BlobVertex* ShadowTiers::getVertices()
+{
+	return vertices;
+}
+
+
+int ShadowTiers::getVertexCount()
+{
+	return vertexCount;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+// Shadow detail per caster, best first from the bottom
+#define SHADOW_TIER_NONE		0
+#define SHADOW_TIER_BLOB		1	// A dark decal on the ground under it
+#define SHADOW_TIER_VOLUME		2	// Stencil shadow volumes
+#define SHADOW_TIER_COUNT		3
+
+#define SHADOW_VOLUME_CASTERS	3		// Casters nearest the camera that keep their volumes
+#define SHADOW_TIER_HYSTERESIS	0.15f	// Casters with volumes rank this much closer, so neighbours don't trade every frame
+#define SHADOW_BLOB_DISTANCE	400.0f	// No shadow at all past this
+#define SHADOW_BLOB_FADE		100.0f	// Blobs fade out over this much before SHADOW_BLOB_DISTANCE
+
+// Blobs are sized for a racer, wheels included
+#define SHADOW_BLOB_LENGTH		5.4f
+#define SHADOW_BLOB_WIDTH		2.6f
+#define SHADOW_BLOB_LIFT		0.05f	// Off the ground along its normal, so the decal isn't z-fighting it
+#define SHADOW_BLOB_ALPHA		180		// As dark as the stencil shadows at the centre
+#define SHADOW_MAX_BLOBS		32		// Per frame; anything past this is dropped
+
+
+// World space vertex: D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1
+struct BlobVertex
+{
+	float x, y, z;
+	unsigned int colour;
+	float u, v;
+};
+
+// Picks how much shadow each caster gets from its distance to the camera:
+// volumes for the nearest SHADOW_VOLUME_CASTERS, a blob for the rest and
+// nothing past SHADOW_BLOB_DISTANCE. Also lays the blobs out as quads, into a
+// vertex array allocated once. Nothing here touches the device:
+// D3D9BlobRenderer draws the blobs.
+class ShadowTiers
+{
+public:
+	ShadowTiers();
+	~ShadowTiers();
+
+	// tiers holds each caster's tier from last frame on the way in, for the
+	// hysteresis, and this frame's on the way out
+	void assign(const float* distances, int count, unsigned char* tiers);
+
+	void clear();
+
+	// A blob centred on point, lying on the plane through it with the given
+	// normal (unit length), its long side along forward. Fades out with distance.
+	void addBlob(const float* point, const float* normal, const float* forward, float distance);
+
+	const BlobVertex* getVertices();
+	int getVertexCount();	// 6 per blob, as a triangle list
+
+	// From the last assign
+	int tierCounts[SHADOW_TIER_COUNT];
+	int dropped;			// Blobs that didn't fit since the last clear()
+
+private:
+	std::vector<float> keys;	// Scratch for assign
+	std::vector<int> order;
+
+	BlobVertex* vertices;
+	int vertexCount;
+};
@@ -107,10 +107,10 @@ void Skybox::render(IDirect3DDevice9* device)
 
 void Skybox::drawQuad(IDirect3DDevice9* device, IDirect3DTexture9* tex, IDirect3DVertexBuffer9* buffer)
 {
-	device->SetTexture(0, tex);
-	device->SetStreamSource(0, buffer, 0, sizeof(Vertex));
-	device->SetFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2);
-	device->SetIndices(indexBuffer);
+	StateCache::cache->setTexture(0, tex);
+	StateCache::cache->setStreamSource(0, buffer, 0, sizeof(Vertex));
+	StateCache::cache->setFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2);
+	StateCache::cache->setIndices(indexBuffer);
 	device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, 6, 0, 2);
 }
 
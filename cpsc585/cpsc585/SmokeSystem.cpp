@@ -5,25 +5,18 @@ SmokeSystem* SmokeSystem::system = NULL;
 
 SmokeSystem::SmokeSystem()
 {
-	rocketSmokeBuffer = NULL;
-	explosionSmokeBuffer = NULL;
-	smokeList = NULL;
-	smokeList = new std::list<SmokeParticle*>();
-	smokeList->clear();
+	rocketSmoke = new ParticlePool(MAX_ROCKET_SMOKE_PARTICLES);
+	explosionSmoke = new ParticlePool(MAX_EXPLOSION_SMOKE_PARTICLES);
+
+	rocketSmokeRange.first = 0;
+	rocketSmokeRange.count = 0;
+	explosionSmokeRange.first = 0;
+	explosionSmokeRange.count = 0;
 
 	system = this;
 
 	D3DXCreateTextureFromFile(Renderer::device, "textures/smoke1.dds", &rocketSmokeTexture);
 	D3DXCreateTextureFromFile(Renderer::device, "textures/smoke2.dds", &explosionSmokeTexture);
-
-
-	Renderer::device->CreateVertexBuffer(MAX_ROCKET_SMOKE_PARTICLES * sizeof(ParticlePoint),
-		D3DUSAGE_DYNAMIC | D3DUSAGE_POINTS | D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT,
-		&rocketSmokeBuffer, NULL);
-
-	Renderer::device->CreateVertexBuffer(MAX_EXPLOSION_SMOKE_PARTICLES * sizeof(ParticlePoint),
-		D3DUSAGE_DYNAMIC | D3DUSAGE_POINTS | D3DUSAGE_WRITEONLY, D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT,
-		&explosionSmokeBuffer, NULL);
 }
 
 
@@ -31,123 +24,119 @@ SmokeSystem::~SmokeSystem()
 {
 	system = NULL;
 
-	if (smokeList)
+	if (rocketSmoke)
 	{
-		smokeList->clear();
-		delete smokeList;
+		delete rocketSmoke;
+		rocketSmoke = NULL;
+	}
+
+	if (explosionSmoke)
+	{
+		delete explosionSmoke;
+		explosionSmoke = NULL;
 	}
 }
 
 
 void SmokeSystem::update(float seconds)
 {
-	numRocketSmoke = 0;
-	numExplosionSmoke = 0;
+	rocketSmoke->update(seconds);
+	explosionSmoke->update(seconds);
+}
+
+
+int SmokeSystem::getCount()
+{
+	return rocketSmoke->count + explosionSmoke->count;
+}
+
+
+// One puff, unless the particle budget is used up
+void SmokeSystem::addSmoke(SmokeType type, hkVector4* position)
+{
+	if (!position)
+		return;
 
-	if (!(smokeList->empty()))
+	float pos[3] = { (*position)(0), (*position)(1), (*position)(2) };
+
+	if (ParticleBudget::budget->take(1) > 0)
 	{
-		ParticlePoint* rocketSmokeParticles = NULL;
-		ParticlePoint* explosionSmokeParticles = NULL;
-
-		rocketSmokeBuffer->Lock(0, MAX_ROCKET_SMOKE_PARTICLES * sizeof(ParticlePoint), (void**) &rocketSmokeParticles, D3DLOCK_DISCARD);
-		explosionSmokeBuffer->Lock(0, MAX_EXPLOSION_SMOKE_PARTICLES * sizeof(ParticlePoint), (void**) &explosionSmokeParticles, D3DLOCK_DISCARD);
-		
-		SmokeParticle* currentParticle = NULL;
-
-		for (std::list<SmokeParticle*>::iterator iter = smokeList->begin(); iter != smokeList->end();)
-		{
-			currentParticle = (*iter);
-			
-			if (currentParticle && currentParticle->destroyed)
-			{
-				delete currentParticle;
-				iter = smokeList->erase(iter);
-			}
-			else if (currentParticle && !(currentParticle->destroyed))
-			{
-				// Write this out to the vertex buffer for drawing
-				if ((currentParticle->typeOfSmoke == ROCKET_SMOKE) && (numRocketSmoke <= MAX_ROCKET_SMOKE_PARTICLES))
-				{
-					rocketSmokeParticles[numRocketSmoke].pos = currentParticle->position;
-					rocketSmokeParticles[numRocketSmoke].color = (D3DCOLOR) currentParticle->color;
-
-					++numRocketSmoke;
-				}
-				else if (numExplosionSmoke <= MAX_EXPLOSION_SMOKE_PARTICLES)
-				{
-					explosionSmokeParticles[numExplosionSmoke].pos = currentParticle->position;
-					explosionSmokeParticles[numExplosionSmoke].color = (D3DCOLOR) currentParticle->color;
-						
-					++numExplosionSmoke;
-				}
-
-				currentParticle->update(seconds);
-
-				++iter;
-			}
-		}
-
-		rocketSmokeBuffer->Unlock();
-		explosionSmokeBuffer->Unlock();
+		spawn(type, pos);
 	}
 }
 
 
-void SmokeSystem::addSmoke(SmokeType type, SmokeParticle* particle)
+// Whatever the emitter has due over seconds, slowed down when the budget is running short
+void SmokeSystem::emit(ParticleEmitter* emitter, SmokeType type, hkVector4* position, float seconds)
 {
-	if (!particle)
+	if (!emitter || !position)
 		return;
 
+	float pos[3] = { (*position)(0), (*position)(1), (*position)(2) };
+	float positions[PARTICLE_EMIT_MAX * 3];
+
+	float scale = ParticleBudget::budget->throttle(emitter->priority, pos);
+	int count = emitter->emit(seconds, scale, pos, positions, PARTICLE_EMIT_MAX);
+	count = ParticleBudget::budget->take(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		spawn(type, &positions[i * 3]);
+	}
+}
+
+
+// Rocket smoke rises and fades quickly; explosion smoke sinks and lingers.
+// Puffs past the pool's limit are dropped.
+void SmokeSystem::spawn(SmokeType type, const float* position)
+{
 	if (type == ROCKET_SMOKE)
 	{
-		particle->initialize(Renderer::device, &(hkVector4(0,1.0f,0)), 1.0f, 1.0f, 200, 100, 100, 140, ROCKET_SMOKE);
+		float velocity[3] = { 0.0f, 1.0f, 0.0f };
+		rocketSmoke->spawn(position, velocity, ROCKET_SMOKE_SIZE, 2.0f, 1.0f, D3DCOLOR_ARGB(200, 100, 100, 140));
 	}
 	else
 	{
-		particle->initialize(Renderer::device, &(hkVector4(0,-1.0f,0)), 1.0f, 4.0f, 255, 50, 50, 50, EXPLOSION_SMOKE);
+		float velocity[3] = { 0.0f, -1.0f, 0.0f };
+		explosionSmoke->spawn(position, velocity, EXPLOSION_SMOKE_SIZE, 5.0f, 1.0f, D3DCOLOR_ARGB(255, 50, 50, 50));
 	}
+}
 
 
-	smokeList->push_back(particle);
+void SmokeSystem::expand(D3D9ParticleRenderer* particles)
+{
+	rocketSmokeRange = particles->add(rocketSmoke);
+	explosionSmokeRange = particles->add(explosionSmoke);
 }
 
 
-void SmokeSystem::render(SmokeType type)
+void SmokeSystem::render(D3D9ParticleRenderer* particles, SmokeType type)
 {
-	IDirect3DDevice9* device = Renderer::device;
-
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-	device->SetRenderState(D3DRS_ALPHATESTENABLE, TRUE);
-	device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-	device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-	device->SetRenderState(D3DRS_LIGHTING, FALSE);
+	if (!particles)
+		return;
 
-	device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
-	device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, TRUE);
+	StateCache::cache->setRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	StateCache::cache->setRenderState(D3DRS_LIGHTING, FALSE);
 
-	device->SetRenderState(D3DRS_ALPHAREF, (unsigned long) 50);
-	device->SetRenderState(D3DRS_ALPHAFUNC, D3DCMP_GREATER);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+	StateCache::cache->setTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
 
-	device->SetFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHAREF, (unsigned long) 50);
+	StateCache::cache->setRenderState(D3DRS_ALPHAFUNC, D3DCMP_GREATER);
 
 	if (type == ROCKET_SMOKE)
 	{
-		device->SetRenderState(D3DRS_POINTSIZE, FtoDw(1));
-		device->SetTexture(0, rocketSmokeTexture);
-
-		device->SetStreamSource(0, rocketSmokeBuffer, 0, sizeof(ParticlePoint));
-		device->DrawPrimitive(D3DPT_POINTLIST, 0, numRocketSmoke);
+		particles->draw(rocketSmokeRange, rocketSmokeTexture);
 	}
 	else
 	{
-		device->SetRenderState(D3DRS_POINTSIZE, FtoDw(30));
-		device->SetTexture(0, explosionSmokeTexture);
-
-		device->SetStreamSource(0, explosionSmokeBuffer, 0, sizeof(ParticlePoint));
-		device->DrawPrimitive(D3DPT_POINTLIST, 0, numExplosionSmoke);
+		particles->draw(explosionSmokeRange, explosionSmokeTexture);
 	}
 
-	device->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-	device->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+	StateCache::cache->setRenderState(D3DRS_ALPHATESTENABLE, FALSE);
 }
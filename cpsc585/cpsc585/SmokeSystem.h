@@ -1,38 +1,51 @@
 #pragma once
 
-#include <list>
-#include "SmokeParticle.h"
+#include "Physics.h"
+#include "D3D9ParticleRenderer.h"
+#include "ParticleBudget.h"
+#include "ParticleEmitter.h"
 
 #define MAX_ROCKET_SMOKE_PARTICLES 600
 #define MAX_EXPLOSION_SMOKE_PARTICLES 200
 
+// World units across: what the old point sprites covered at the game's field of view
+#define ROCKET_SMOKE_SIZE 1.45f
+#define EXPLOSION_SMOKE_SIZE 43.6f
+
+// Smoke emitters, in particles a second
+#define ROCKET_TRAIL_RATE 60.0f
+#define ROCKET_TRAIL_PRIORITY 0.5f
+#define DEATH_SMOKE_RATE 60.0f
+#define DEATH_SMOKE_PRIORITY 0.25f
+#define DEATH_SMOKE_TIME 3.0f		// As long as a wreck waits to respawn
+
+enum SmokeType { EXPLOSION_SMOKE, ROCKET_SMOKE };
+
 class SmokeSystem
 {
 public:
 	SmokeSystem();
 	~SmokeSystem();
-	void addSmoke(SmokeType type, SmokeParticle* particle);
+	void addSmoke(SmokeType type, hkVector4* position);
+	void emit(ParticleEmitter* emitter, SmokeType type, hkVector4* position, float seconds);
 	void update(float seconds);
-	void render(SmokeType type);
+	int getCount();
+	void expand(D3D9ParticleRenderer* particles);
+	void render(D3D9ParticleRenderer* particles, SmokeType type);
 
 	static SmokeSystem* system;
 
 
-	inline DWORD FtoDw(float f)
-	{
-	    return *((DWORD*)&f);
-	}
-
-
 private:
-	std::list<SmokeParticle*>* smokeList;
+	void spawn(SmokeType type, const float* position);
+
+	ParticlePool* rocketSmoke;
+	ParticlePool* explosionSmoke;
 
 	IDirect3DTexture9* rocketSmokeTexture;
 	IDirect3DTexture9* explosionSmokeTexture;
 
-	int numRocketSmoke;
-	int numExplosionSmoke;
-
-	IDirect3DVertexBuffer9* rocketSmokeBuffer;
-	IDirect3DVertexBuffer9* explosionSmokeBuffer;
+	// Where they went in the particle buffer this frame
+	ParticleRange rocketSmokeRange;
+	ParticleRange explosionSmokeRange;
 };
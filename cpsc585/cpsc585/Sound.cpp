@@ -1,7 +1,36 @@
 #include "Sound.h"
 
+#include <math.h>
+
 Sound* Sound::sound = NULL;
 
+// How much each effect matters when there are more sounds than voices (see VoicePool)
+static const float effectPriority[] = {
+	0.5f,	// SFX_LASER
+	0.4f,	// SFX_CRASH
+	0.3f,	// SFX_ENGINE
+	0.5f,	// SFX_BOOST
+	0.5f,	// SFX_ROCKET
+	0.4f,	// SFX_DROPMINE
+	0.6f,	// SFX_SCREAM1
+	0.6f,	// SFX_SCREAM2
+	0.6f,	// SFX_SCREAM3
+	0.6f,	// SFX_SCREAM
+	0.9f,	// SFX_CAREXPLODE
+	0.8f,	// SFX_EXPLOSION
+	0.3f,	// SFX_BEEP
+	0.6f,	// SFX_ROCKETLAUNCH
+	0.7f,	// SFX_PICKUP
+	1.0f,	// SFX_SELECT
+	1.0f,	// SFX_SHOTGUN
+	1.0f,	// SFX_TAKENLEAD
+	1.0f,	// SFX_LOSTLEAD
+	0.7f,	// SFX_NOAMMO
+	1.0f,	// SFX_ONE
+	1.0f,	// SFX_TWO
+	1.0f	// SFX_THREE
+};
+
 Sound::Sound(void)
 {
 	initialized = false;
@@ -73,13 +102,8 @@ Sound::Sound(void)
 
 	sound = this;
 
-	currentVoice = 0;
-	maxVoices = 200;
-	maxReservedVoices = 30;
-	currentReservedVoice = 0;
-
-	voiceBuffer = NULL;
-	voiceBufferReserved = NULL;
+	voiceBackend = NULL;
+	voicePool = NULL;
 
 	std::srand((unsigned int) time(NULL));
 }
@@ -215,21 +239,13 @@ void Sound::initialize()
 
 	
 
-	voiceBuffer = new IXAudio2SourceVoice*[maxVoices];
-
-	for (int i = 0; i < maxVoices; i++)
-	{
-		voiceBuffer[i] = NULL;
-		audio->CreateSourceVoice(&(voiceBuffer[i]), (WAVEFORMATEX*) wfm, XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, 0, &SFXSendList, 0);
-	}
-
-	voiceBufferReserved = new IXAudio2SourceVoice*[maxReservedVoices];
+	// Every sound effect voice, made once and reused. wfm is the format of the
+	// last effect loaded, which they all share.
+	voiceBackend = new XAudio2Backend(audio, &SFXSendList);
+	voiceBackend->setFormat(SFX_FORMAT, (WAVEFORMATEX*) wfm);
 
-	for (int i = 0; i < maxReservedVoices; i++)
-	{
-		voiceBufferReserved[i] = NULL;
-		audio->CreateSourceVoice(&(voiceBufferReserved[i]), (WAVEFORMATEX*) wfm, XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, 0, &SFXSendList, 0);
-	}
+	voicePool = new VoicePool(voiceBackend, SFX_VOICES + SFX_RESERVED_VOICES);
+	voicePool->addVoices(SFX_FORMAT, SFX_VOICES + SFX_RESERVED_VOICES);
 	
 	initialized = true;
 	
@@ -252,26 +268,16 @@ void Sound::shutdown()
 		menumusic = NULL;
 	}
 
-	if (voiceBuffer)
+	if (voicePool)
 	{
-		for (int i = 0; i < maxVoices; i++)
-		{
-			if (voiceBuffer[i])
-				voiceBuffer[i]->DestroyVoice();
-		}
-
-		delete [] voiceBuffer;
+		delete voicePool;
+		voicePool = NULL;
 	}
 
-	if (voiceBufferReserved)
+	if (voiceBackend)
 	{
-		for (int i = 0; i < maxReservedVoices; i++)
-		{
-			if (voiceBufferReserved[i])
-				voiceBufferReserved[i]->DestroyVoice();
-		}
-
-		delete [] voiceBufferReserved;
+		delete voiceBackend;
+		voiceBackend = NULL;
 	}
 
 	if (ingamemusicBuffer)
@@ -1072,6 +1078,9 @@ void Sound::loadMusic(IXAudio2SourceVoice* &voice, std::string filename, BYTE* &
 
 void Sound::playEngine(X3DAUDIO_EMITTER* emit, float freq, IXAudio2SourceVoice* engine)
 {
+	if (!engine)
+		return;
+
 	engine->FlushSourceBuffers();
 	engine->SubmitSourceBuffer(engineBufferDetails, engineWMABuffer);
 
@@ -1092,6 +1101,9 @@ void Sound::playEngine(X3DAUDIO_EMITTER* emit, float freq, IXAudio2SourceVoice*
 
 void Sound::playRocket(X3DAUDIO_EMITTER* emit, IXAudio2SourceVoice* rocket)
 {	
+	if (!rocket)
+		return;
+
 	rocket->FlushSourceBuffers();
 	rocket->SubmitSourceBuffer(rocketBufferDetails, rocketWMABuffer);
 
@@ -1111,9 +1123,12 @@ void Sound::playRocket(X3DAUDIO_EMITTER* emit, IXAudio2SourceVoice* rocket)
 
 void Sound::playSoundEffect(SoundEffect effect, X3DAUDIO_EMITTER* emit)
 {
-	IXAudio2SourceVoice* voice = getSFXVoice();
+	IXAudio2SourceVoice* voice = getSFXVoice(effect, emit);
+	if (!voice)
+		return;
 
 	voice->FlushSourceBuffers();
+	voice->SetVolume(1.0f);		// Some effects play louder; that mustn't carry over to the next one
 	
 	switch (effect) {
 	case SFX_LASER:
@@ -1268,56 +1283,24 @@ void Sound::returnEmitter()
 	}
 }
 
-IXAudio2SourceVoice* Sound::getSFXVoice()
+IXAudio2SourceVoice* Sound::getSFXVoice(SoundEffect effect, X3DAUDIO_EMITTER* emit)
 {
-	currentVoice++;
-
-	if (currentVoice == maxVoices)
-	{
-		currentVoice = 0;
-
-		voiceBuffer[maxVoices - 1]->FlushSourceBuffers();
-		voiceBuffer[maxVoices - 1]->DestroyVoice();
-
-		audio->CreateSourceVoice(&(voiceBuffer[maxVoices - 1]), (WAVEFORMATEX*) wfm,
-			XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, NULL, &SFXSendList, NULL);
-		
-		return voiceBuffer[maxVoices - 1];
-	}
-	
-	voiceBuffer[currentVoice - 1]->FlushSourceBuffers();
-	voiceBuffer[currentVoice - 1]->DestroyVoice();
+	float x = emit->Position.x - listener.Position.x;
+	float y = emit->Position.y - listener.Position.y;
+	float z = emit->Position.z - listener.Position.z;
 
-	audio->CreateSourceVoice(&(voiceBuffer[currentVoice - 1]), (WAVEFORMATEX*) wfm,
-		XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, NULL, &SFXSendList, NULL);
-
-	return voiceBuffer[currentVoice - 1];
+	return (IXAudio2SourceVoice*) voicePool->acquire(SFX_FORMAT, effectPriority[effect], sqrtf(x * x + y * y + z * z));
 }
 
 IXAudio2SourceVoice* Sound::reserveSFXVoice()
 {
-	currentReservedVoice++;
-
-	if (currentReservedVoice == maxReservedVoices)
-	{
-		currentReservedVoice = 0;
-
-		voiceBufferReserved[maxReservedVoices - 1]->FlushSourceBuffers();
-		voiceBufferReserved[maxReservedVoices - 1]->DestroyVoice();
-
-		audio->CreateSourceVoice(&(voiceBufferReserved[maxReservedVoices - 1]), (WAVEFORMATEX*) wfm,
-			XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, NULL, &SFXSendList, NULL);
-		
-		return voiceBufferReserved[maxReservedVoices - 1];
-	}
-	
-	voiceBufferReserved[currentReservedVoice - 1]->FlushSourceBuffers();
-	voiceBufferReserved[currentReservedVoice - 1]->DestroyVoice();
-
-	audio->CreateSourceVoice(&(voiceBufferReserved[currentReservedVoice - 1]), (WAVEFORMATEX*) wfm,
-		XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO, NULL, &SFXSendList, NULL);
+	return (IXAudio2SourceVoice*) voicePool->reserve(SFX_FORMAT);
+}
 
-	return voiceBufferReserved[currentReservedVoice - 1];
+void Sound::releaseSFXVoice(IXAudio2SourceVoice* voice)
+{
+	if (voicePool && voice)
+		voicePool->release(voice);
 }
 
 void Sound::playInGameMusic()
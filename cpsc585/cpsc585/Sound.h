@@ -7,12 +7,18 @@
 #include <fstream>
 #include <time.h>
 
+#include "VoicePool.h"
+#include "XAudio2Backend.h"
+
 enum SoundEffect { SFX_LASER, SFX_CRASH, SFX_ENGINE, SFX_BOOST, SFX_ROCKET, SFX_DROPMINE,
 	SFX_SCREAM1, SFX_SCREAM2, SFX_SCREAM3, SFX_SCREAM, SFX_CAREXPLODE, SFX_EXPLOSION, SFX_BEEP,
 	SFX_ROCKETLAUNCH, SFX_PICKUP, SFX_SELECT, SFX_SHOTGUN, SFX_TAKENLEAD, SFX_LOSTLEAD,
 	SFX_NOAMMO, SFX_ONE, SFX_TWO, SFX_THREE };
 
 #define NUM_EMITTERS 500
+#define SFX_VOICES 64				// Sound effects playing at once, before new ones take over old ones
+#define SFX_RESERVED_VOICES 16		// Kept by engines and rockets
+#define SFX_FORMAT 0				// The voice pool's only format: every effect is mono, 44100 Hz
 
 class Sound
 {
@@ -22,8 +28,9 @@ public:
 	void initialize();
 	void shutdown();
 	void returnEmitter();
-	IXAudio2SourceVoice* getSFXVoice();
+	IXAudio2SourceVoice* getSFXVoice(SoundEffect effect, X3DAUDIO_EMITTER* emit);	// NULL when it shouldn't be played
 	IXAudio2SourceVoice* reserveSFXVoice();
+	void releaseSFXVoice(IXAudio2SourceVoice* voice);
 
 	void playSoundEffect(SoundEffect effect, X3DAUDIO_EMITTER* emit);
 	void playEngine(X3DAUDIO_EMITTER* emit, float freq, IXAudio2SourceVoice* engine);
@@ -42,6 +49,8 @@ public:
 
 	X3DAUDIO_EMITTER* playerEmitter;
 
+	VoicePool* voicePool;
+
 private:
 	// Some methods from MSDN
 	HRESULT FindChunk(HANDLE hFile, DWORD fourcc, DWORD & dwChunkSize, DWORD & dwChunkDataPosition);
@@ -128,14 +137,7 @@ private:
 	XAUDIO2_BUFFER_WMA* threeWMABuffer;
 
 
-	int currentVoice;
-	int maxVoices;
-
-	int currentReservedVoice;
-	int maxReservedVoices;
-
-	IXAudio2SourceVoice** voiceBuffer;
-	IXAudio2SourceVoice** voiceBufferReserved;
+	XAudio2Backend* voiceBackend;
 
 	WAVEFORMATEXTENSIBLE* wfm;
 
@@ -0,0 +1,239 @@
+#include "StateCache.h"
+
+#include <string.h>
+
+StateCache* StateCache::cache = NULL;
+
+// D3DTRANSFORMSTATETYPE values of the shadowed transforms
+#define TRANSFORM_VIEW			2
+#define TRANSFORM_PROJECTION	3
+#define TRANSFORM_WORLD			256
+
+
+StateCache::StateCache(StateDevice* device)
+{
+	this->device = device;
+
+	submitted = 0;
+	filtered = 0;
+	frameSubmitted = 0;
+	frameFiltered = 0;
+
+	invalidate();
+	cache = this;
+}
+
+
+StateCache::~StateCache()
+{
+	if (device)
+	{
+		delete device;
+		device = NULL;
+	}
+
+	if (cache == this)
+	{
+		cache = NULL;
+	}
+}
+
+
+void StateCache::invalidate()
+{
+	memset(renderStates, 0, sizeof(renderStates));
+	memset(renderStateKnown, 0, sizeof(renderStateKnown));
+	memset(samplerStates, 0, sizeof(samplerStates));
+	memset(samplerStateKnown, 0, sizeof(samplerStateKnown));
+	memset(stageStates, 0, sizeof(stageStates));
+	memset(stageStateKnown, 0, sizeof(stageStateKnown));
+	memset(textures, 0, sizeof(textures));
+	memset(textureKnown, 0, sizeof(textureKnown));
+	memset(streams, 0, sizeof(streams));
+	memset(streamKnown, 0, sizeof(streamKnown));
+	fvf = 0;
+	fvfKnown = false;
+	declaration = NULL;
+	declarationKnown = false;
+	indices = NULL;
+	indicesKnown = false;
+	memset(transforms, 0, sizeof(transforms));
+	memset(transformKnown, 0, sizeof(transformKnown));
+}
+
+
+void StateCache::beginFrame()
+{
+	frameSubmitted = submitted;
+	frameFiltered = filtered;
+	submitted = 0;
+	filtered = 0;
+}
+
+
+// Counts the call and says whether it has to reach the device
+bool StateCache::pass(bool& known, bool same)
+{
+	submitted++;
+
+	if (known && same)
+	{
+		filtered++;
+		return false;
+	}
+
+	known = true;
+	return true;
+}
+
+
+void StateCache::setRenderState(unsigned int state, unsigned int value)
+{
+	if (state >= STATE_CACHE_RENDER_STATES)
+	{
+		submitted++;
+		device->setRenderState(state, value);
+		return;
+	}
+
+	if (pass(renderStateKnown[state], renderStates[state] == value))
+	{
+		renderStates[state] = value;
+		device->setRenderState(state, value);
+	}
+}
+
+
+void StateCache::setSamplerState(unsigned int sampler, unsigned int type, unsigned int value)
+{
+	// D3DDMAPSAMPLER and the vertex samplers are numbered past the shadowed ones
+	if (sampler >= STATE_CACHE_SAMPLERS || type >= STATE_CACHE_SAMPLER_STATES)
+	{
+		submitted++;
+		device->setSamplerState(sampler, type, value);
+		return;
+	}
+
+	if (pass(samplerStateKnown[sampler][type], samplerStates[sampler][type] == value))
+	{
+		samplerStates[sampler][type] = value;
+		device->setSamplerState(sampler, type, value);
+	}
+}
+
+
+void StateCache::setTextureStageState(unsigned int stage, unsigned int type, unsigned int value)
+{
+	if (stage >= STATE_CACHE_STAGES || type >= STATE_CACHE_STAGE_STATES)
+	{
+		submitted++;
+		device->setTextureStageState(stage, type, value);
+		return;
+	}
+
+	if (pass(stageStateKnown[stage][type], stageStates[stage][type] == value))
+	{
+		stageStates[stage][type] = value;
+		device->setTextureStageState(stage, type, value);
+	}
+}
+
+
+void StateCache::setTexture(unsigned int stage, void* texture)
+{
+	if (stage >= STATE_CACHE_STAGES)
+	{
+		submitted++;
+		device->setTexture(stage, texture);
+		return;
+	}
+
+	if (pass(textureKnown[stage], textures[stage] == texture))
+	{
+		textures[stage] = texture;
+		device->setTexture(stage, texture);
+	}
+}
+
+
+void StateCache::setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride)
+{
+	if (stream >= STATE_CACHE_STREAMS)
+	{
+		submitted++;
+		device->setStreamSource(stream, buffer, offset, stride);
+		return;
+	}
+
+	StreamSource& current = streams[stream];
+	if (pass(streamKnown[stream], current.buffer == buffer && current.offset == offset && current.stride == stride))
+	{
+		current.buffer = buffer;
+		current.offset = offset;
+		current.stride = stride;
+		device->setStreamSource(stream, buffer, offset, stride);
+	}
+}
+
+
+void StateCache::setFVF(unsigned int fvf)
+{
+	if (pass(fvfKnown, this->fvf == fvf))
+	{
+		this->fvf = fvf;
+		declarationKnown = false;
+		device->setFVF(fvf);
+	}
+}
+
+
+void StateCache::setVertexDeclaration(void* declaration)
+{
+	if (pass(declarationKnown, this->declaration == declaration))
+	{
+		this->declaration = declaration;
+		fvfKnown = false;
+		device->setVertexDeclaration(declaration);
+	}
+}
+
+
+void StateCache::setIndices(void* indices)
+{
+	if (pass(indicesKnown, this->indices == indices))
+	{
+		this->indices = indices;
+		device->setIndices(indices);
+	}
+}
+
+
+void StateCache::setTransform(unsigned int type, const float* matrix)
+{
+	int slot = -1;
+	switch (type)
+	{
+	case TRANSFORM_VIEW:
+		slot = 0;
+		break;
+	case TRANSFORM_PROJECTION:
+		slot = 1;
+		break;
+	case TRANSFORM_WORLD:
+		slot = 2;
+		break;
+	}
+
+	if (slot == -1)
+	{
+		submitted++;
+		device->setTransform(type, matrix);
+		return;
+	}
+
+	if (pass(transformKnown[slot], memcmp(transforms[slot], matrix, sizeof(transforms[slot])) == 0))
+	{
+		memcpy(transforms[slot], matrix, sizeof(transforms[slot]));
+		device->setTransform(type, matrix);
+	}
+}
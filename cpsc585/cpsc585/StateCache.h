@@ -0,0 +1,85 @@
+#pragma once
+
+#include "StateDevice.h"
+
+// How much of the device is shadowed. Sets outside these ranges always go through.
+#define STATE_CACHE_RENDER_STATES		256		// Past D3DRS_BLENDOPALPHA
+#define STATE_CACHE_SAMPLERS			8
+#define STATE_CACHE_SAMPLER_STATES		14		// Past D3DSAMP_DMAPOFFSET
+#define STATE_CACHE_STAGES				8
+#define STATE_CACHE_STAGE_STATES		33		// Past D3DTSS_CONSTANT
+#define STATE_CACHE_STREAMS				4
+#define STATE_CACHE_TRANSFORMS			3		// View, projection and world
+
+
+// Remembers what was last sent to the device and drops sets that would not
+// change anything. Everything that draws goes through StateCache::cache
+// rather than setting states on the device itself, or the shadow copy goes
+// stale; call invalidate() if something else may have changed them.
+class StateCache
+{
+public:
+	StateCache(StateDevice* device);	// Takes ownership of the device
+	~StateCache();
+
+	void setRenderState(unsigned int state, unsigned int value);
+	void setSamplerState(unsigned int sampler, unsigned int type, unsigned int value);
+	void setTextureStageState(unsigned int stage, unsigned int type, unsigned int value);
+	void setTexture(unsigned int stage, void* texture);
+	void setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride);
+	void setFVF(unsigned int fvf);
+	void setVertexDeclaration(void* declaration);	// Shares the device's slot with the FVF
+	void setIndices(void* indices);
+	void setTransform(unsigned int type, const float* matrix);
+
+	void invalidate();		// Forget everything, so the next set of each state goes through
+	void beginFrame();		// Moves this frame's counts into the last frame's
+
+	static StateCache* cache;
+
+	// Calls made this frame, and how many of them never reached the device
+	int submitted;
+	int filtered;
+
+	// The same for the last full frame, for the debug overlay
+	int frameSubmitted;
+	int frameFiltered;
+
+private:
+	bool pass(bool& known, bool same);
+
+	StateDevice* device;
+
+	unsigned int renderStates[STATE_CACHE_RENDER_STATES];
+	bool renderStateKnown[STATE_CACHE_RENDER_STATES];
+
+	unsigned int samplerStates[STATE_CACHE_SAMPLERS][STATE_CACHE_SAMPLER_STATES];
+	bool samplerStateKnown[STATE_CACHE_SAMPLERS][STATE_CACHE_SAMPLER_STATES];
+
+	unsigned int stageStates[STATE_CACHE_STAGES][STATE_CACHE_STAGE_STATES];
+	bool stageStateKnown[STATE_CACHE_STAGES][STATE_CACHE_STAGE_STATES];
+
+	void* textures[STATE_CACHE_STAGES];
+	bool textureKnown[STATE_CACHE_STAGES];
+
+	struct StreamSource
+	{
+		void* buffer;
+		unsigned int offset;
+		unsigned int stride;
+	};
+	StreamSource streams[STATE_CACHE_STREAMS];
+	bool streamKnown[STATE_CACHE_STREAMS];
+
+	unsigned int fvf;
+	bool fvfKnown;
+
+	void* declaration;
+	bool declarationKnown;
+
+	void* indices;
+	bool indicesKnown;
+
+	float transforms[STATE_CACHE_TRANSFORMS][16];
+	bool transformKnown[STATE_CACHE_TRANSFORMS];
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+
+// The device calls the StateCache filters. States, types and values are the
+// D3D9 enums and DWORDs as plain integers, so the cache can run against a mock.
+class StateDevice
+{
+public:
+	virtual ~StateDevice() {}
+
+	virtual void setRenderState(unsigned int state, unsigned int value) = 0;
+	virtual void setSamplerState(unsigned int sampler, unsigned int type, unsigned int value) = 0;
+	virtual void setTextureStageState(unsigned int stage, unsigned int type, unsigned int value) = 0;
+	virtual void setTexture(unsigned int stage, void* texture) = 0;
+	virtual void setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride) = 0;
+	virtual void setFVF(unsigned int fvf) = 0;
+	virtual void setVertexDeclaration(void* declaration) = 0;
+	virtual void setIndices(void* indices) = 0;
+	virtual void setTransform(unsigned int type, const float* matrix) = 0;	// 16 floats
+};
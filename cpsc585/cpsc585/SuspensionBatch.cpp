@@ -0,0 +1,281 @@
+#include "SuspensionBatch.h"
+
+#include <string.h>
+#include <math.h>
+#include <xmmintrin.h>
+
+#define NUM_WHEEL_ARRAYS 14
+#define NUM_BODY_ARRAYS 21
+
+
+SuspensionBatch::SuspensionBatch()
+{
+	// One aligned block, carved into fixed size streams
+	int size = NUM_WHEEL_ARRAYS * MAX_BATCH_WHEELS + NUM_BODY_ARRAYS * MAX_BATCH_BODIES;
+	memory = (float*) _mm_malloc(sizeof(float) * size, 16);
+	memset(memory, 0, sizeof(float) * size);
+
+	float** wheelArrays[NUM_WHEEL_ARRAYS] = {
+		&offsetX, &offsetY, &offsetZ, &leverX, &leverY, &leverZ, &grounded,
+		&springK, &damperC, &extents, &forceCap, &forceX, &forceY, &forceZ };
+
+	float** bodyArrays[NUM_BODY_ARRAYS] = {
+		&upX, &upY, &upZ, &velX, &velY, &velZ, &angVelX, &angVelY, &angVelZ,
+		&axisXx, &axisXy, &axisXz, &axisZx, &axisZy, &axisZz,
+		&frictionX, &frictionZ, &drag, &bodyForceX, &bodyForceY, &bodyForceZ };
+
+	float* next = memory;
+	for (int i = 0; i < NUM_WHEEL_ARRAYS; i++)
+	{
+		*wheelArrays[i] = next;
+		next += MAX_BATCH_WHEELS;
+	}
+	for (int i = 0; i < NUM_BODY_ARRAYS; i++)
+	{
+		*bodyArrays[i] = next;
+		next += MAX_BATCH_BODIES;
+	}
+
+	for (int i = 0; i < MAX_BATCH_BODIES; i++)
+	{
+		bodyOwner[i] = NULL;
+		queued[i] = false;
+	}
+
+	numBodies = 0;
+}
+
+
+SuspensionBatch::~SuspensionBatch()
+{
+	if (memory)
+	{
+		_mm_free(memory);
+		memory = NULL;
+	}
+}
+
+int SuspensionBatch::addBody(float dragCoeff, void* owner)
+{
+	for (int i = 0; i < MAX_BATCH_BODIES; i++)
+	{
+		if (!bodyOwner[i])
+		{
+			bodyOwner[i] = owner;
+			queued[i] = false;
+			drag[i] = dragCoeff;
+
+			if (i >= numBodies)
+			{
+				numBodies = i + 1;
+			}
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void SuspensionBatch::removeBody(int body)
+{
+	if (body < 0 || body >= MAX_BATCH_BODIES)
+	{
+		return;
+	}
+
+	// Zeroed lanes produce zero forces, so free slots can stay in the kernel's runs of 4
+	for (int i = 0; i < NUM_WHEEL_ARRAYS; i++)
+	{
+		memset(memory + i * MAX_BATCH_WHEELS + body * 4, 0, sizeof(float) * 4);
+	}
+	float* bodies = memory + NUM_WHEEL_ARRAYS * MAX_BATCH_WHEELS;
+	for (int i = 0; i < NUM_BODY_ARRAYS; i++)
+	{
+		bodies[i * MAX_BATCH_BODIES + body] = 0.0f;
+	}
+
+	bodyOwner[body] = NULL;
+	queued[body] = false;
+
+	while (numBodies > 0 && !bodyOwner[numBodies - 1])
+	{
+		numBodies--;
+	}
+}
+
+void SuspensionBatch::setWheel(int wheel, float k, float c, float ext, float cap)
+{
+	springK[wheel] = k;
+	damperC[wheel] = c;
+	extents[wheel] = ext;
+	forceCap[wheel] = cap;
+}
+
+void SuspensionBatch::setFriction(int body, float yComponent, float xFriction, float zFriction, bool applyFriction)
+{
+	// No grip on walls and ceilings
+	if (applyFriction && yComponent >= 0.01f)
+	{
+		frictionX[body] = yComponent * yComponent * xFriction;
+		frictionZ[body] = yComponent * yComponent * zFriction;
+	}
+	else
+	{
+		frictionX[body] = 0.0f;
+		frictionZ[body] = 0.0f;
+	}
+}
+
+void SuspensionBatch::compute()
+{
+	const __m128 zero = _mm_setzero_ps();
+
+	// One body's four wheels at a time
+	for (int b = 0; b < numBodies; b++)
+	{
+		int i = b * 4;
+
+		__m128 ux = _mm_set1_ps(upX[b]);
+		__m128 uy = _mm_set1_ps(upY[b]);
+		__m128 uz = _mm_set1_ps(upZ[b]);
+
+		// Spring displacement along up, clamped to the suspension travel
+		__m128 ext = _mm_load_ps(extents + i);
+		__m128 displacement = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_load_ps(offsetX + i), ux),
+			_mm_mul_ps(_mm_load_ps(offsetY + i), uy)),
+			_mm_mul_ps(_mm_load_ps(offsetZ + i), uz));
+		displacement = _mm_min_ps(_mm_max_ps(displacement, _mm_sub_ps(zero, ext)), ext);
+
+		// Chassis velocity at the attachment point: v + w x r
+		__m128 rx = _mm_load_ps(leverX + i);
+		__m128 ry = _mm_load_ps(leverY + i);
+		__m128 rz = _mm_load_ps(leverZ + i);
+		__m128 wx = _mm_set1_ps(angVelX[b]);
+		__m128 wy = _mm_set1_ps(angVelY[b]);
+		__m128 wz = _mm_set1_ps(angVelZ[b]);
+
+		__m128 px = _mm_add_ps(_mm_set1_ps(velX[b]), _mm_sub_ps(_mm_mul_ps(wy, rz), _mm_mul_ps(wz, ry)));
+		__m128 py = _mm_add_ps(_mm_set1_ps(velY[b]), _mm_sub_ps(_mm_mul_ps(wz, rx), _mm_mul_ps(wx, rz)));
+		__m128 pz = _mm_add_ps(_mm_set1_ps(velZ[b]), _mm_sub_ps(_mm_mul_ps(wx, ry), _mm_mul_ps(wy, rx)));
+
+		__m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, ux), _mm_mul_ps(py, uy)), _mm_mul_ps(pz, uz));
+
+		// force = up * (k * displacement - c * speed), nothing for wheels in the air
+		__m128 magnitude = _mm_mul_ps(_mm_load_ps(grounded + i), _mm_sub_ps(
+			_mm_mul_ps(_mm_load_ps(springK + i), displacement),
+			_mm_mul_ps(_mm_load_ps(damperC + i), speed)));
+
+		__m128 fx = _mm_mul_ps(ux, magnitude);
+		__m128 fy = _mm_mul_ps(uy, magnitude);
+		__m128 fz = _mm_mul_ps(uz, magnitude);
+
+		// Cap the length, only touching lanes that are over
+		__m128 cap = _mm_load_ps(forceCap + i);
+		__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz));
+		__m128 over = _mm_cmpgt_ps(lengthSq, _mm_mul_ps(cap, cap));
+		__m128 scale = _mm_div_ps(cap, _mm_sqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(1e-20f))));
+		scale = _mm_or_ps(_mm_and_ps(over, scale), _mm_andnot_ps(over, _mm_set1_ps(1.0f)));
+
+		_mm_store_ps(forceX + i, _mm_mul_ps(fx, scale));
+		_mm_store_ps(forceY + i, _mm_mul_ps(fy, scale));
+		_mm_store_ps(forceZ + i, _mm_mul_ps(fz, scale));
+	}
+
+	for (int i = 0; i < numBodies; i += 4)
+	{
+		__m128 vx = _mm_load_ps(velX + i);
+		__m128 vy = _mm_load_ps(velY + i);
+		__m128 vz = _mm_load_ps(velZ + i);
+
+		__m128 speedSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		__m128 moving = _mm_cmpgt_ps(speedSq, zero);
+		__m128 speed = _mm_sqrt_ps(speedSq);
+		__m128 invSpeed = _mm_and_ps(moving, _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(speed, _mm_set1_ps(1e-20f))));
+
+		// Direction of travel (zero when at rest, like normalize3IfNotZero)
+		__m128 nx = _mm_mul_ps(vx, invSpeed);
+		__m128 ny = _mm_mul_ps(vy, invSpeed);
+		__m128 nz = _mm_mul_ps(vz, invSpeed);
+
+		__m128 xx = _mm_load_ps(axisXx + i);
+		__m128 xy = _mm_load_ps(axisXy + i);
+		__m128 xz = _mm_load_ps(axisXz + i);
+		__m128 zx = _mm_load_ps(axisZx + i);
+		__m128 zy = _mm_load_ps(axisZy + i);
+		__m128 zz = _mm_load_ps(axisZz + i);
+
+		__m128 xScale = _mm_mul_ps(_mm_load_ps(frictionX + i),
+			_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, xx), _mm_mul_ps(ny, xy)), _mm_mul_ps(nz, xz)));
+		__m128 zScale = _mm_mul_ps(_mm_load_ps(frictionZ + i),
+			_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, zx), _mm_mul_ps(ny, zy)), _mm_mul_ps(nz, zz)));
+		__m128 dragScale = _mm_sub_ps(zero, _mm_mul_ps(_mm_load_ps(drag + i), speedSq));
+
+		_mm_store_ps(bodyForceX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, xScale), _mm_mul_ps(zx, zScale)), _mm_mul_ps(nx, dragScale)));
+		_mm_store_ps(bodyForceY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xy, xScale), _mm_mul_ps(zy, zScale)), _mm_mul_ps(ny, dragScale)));
+		_mm_store_ps(bodyForceZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xz, xScale), _mm_mul_ps(zz, zScale)), _mm_mul_ps(nz, dragScale)));
+	}
+}
+
+void SuspensionBatch::computeReference()
+{
+	for (int i = 0; i < numBodies * 4; i++)
+	{
+		int b = i / 4;
+
+		float displacement = offsetX[i] * upX[b] + offsetY[i] * upY[b] + offsetZ[i] * upZ[b];
+		if (displacement < -extents[i])
+		{
+			displacement = -extents[i];
+		}
+		else if (displacement > extents[i])
+		{
+			displacement = extents[i];
+		}
+
+		float px = velX[b] + angVelY[b] * leverZ[i] - angVelZ[b] * leverY[i];
+		float py = velY[b] + angVelZ[b] * leverX[i] - angVelX[b] * leverZ[i];
+		float pz = velZ[b] + angVelX[b] * leverY[i] - angVelY[b] * leverX[i];
+		float speed = px * upX[b] + py * upY[b] + pz * upZ[b];
+
+		float magnitude = grounded[i] * (springK[i] * displacement - damperC[i] * speed);
+		float fx = upX[b] * magnitude;
+		float fy = upY[b] * magnitude;
+		float fz = upZ[b] * magnitude;
+
+		float lengthSq = fx * fx + fy * fy + fz * fz;
+		if (lengthSq > forceCap[i] * forceCap[i])
+		{
+			float scale = forceCap[i] / sqrt(lengthSq);
+			fx *= scale;
+			fy *= scale;
+			fz *= scale;
+		}
+
+		forceX[i] = fx;
+		forceY[i] = fy;
+		forceZ[i] = fz;
+	}
+
+	for (int i = 0; i < numBodies; i++)
+	{
+		float speedSq = velX[i] * velX[i] + velY[i] * velY[i] + velZ[i] * velZ[i];
+		float speed = sqrt(speedSq);
+		float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+		if (speed > 0.0f)
+		{
+			nx = velX[i] / speed;
+			ny = velY[i] / speed;
+			nz = velZ[i] / speed;
+		}
+
+		float xScale = frictionX[i] * (nx * axisXx[i] + ny * axisXy[i] + nz * axisXz[i]);
+		float zScale = frictionZ[i] * (nx * axisZx[i] + ny * axisZy[i] + nz * axisZz[i]);
+		float dragScale = -drag[i] * speedSq;
+
+		bodyForceX[i] = axisXx[i] * xScale + axisZx[i] * zScale + nx * dragScale;
+		bodyForceY[i] = axisXy[i] * xScale + axisZy[i] * zScale + ny * dragScale;
+		bodyForceZ[i] = axisXz[i] * xScale + axisZz[i] * zScale + nz * dragScale;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#define MAX_BATCH_BODIES 16
+#define MAX_BATCH_WHEELS (MAX_BATCH_BODIES * 4)		// Wheel w of body b is slot b * 4 + w
+
+
+// Structure-of-arrays batch for the per-tick suspension, friction and drag
+// maths of every racer. A racer takes a body slot once, along with the
+// constants that never change, and from then on writes its state straight
+// into its own slots every tick, so nothing is cleared or gathered. A body's
+// four wheels are one group of SSE lanes and share the body's up vector and
+// velocities. The whole batch is evaluated at once and the resulting forces
+// are handed back to the bodies in one pass.
+class SuspensionBatch
+{
+public:
+	SuspensionBatch();
+	~SuspensionBatch();
+
+	// Returns the body slot, or -1 if the batch is full
+	int addBody(float dragCoeff, void* owner);
+	void removeBody(int body);
+	void setWheel(int wheel, float springK, float damperC, float extents, float forceCap);
+
+	// yComponent is multiplied in twice, for a strong grip on the ground and a weak one on walls
+	void setFriction(int body, float yComponent, float xFriction, float zFriction, bool applyFriction);
+
+	void compute();				// SSE kernel
+	void computeReference();	// Scalar version, one lane at a time
+
+	int numBodies;				// Up to the highest slot handed out, free ones included
+
+	// Wheel inputs
+	float* offsetX; float* offsetY; float* offsetZ;		// Wheel position - rest position
+	float* leverX; float* leverY; float* leverZ;		// Rest position - center of mass
+	float* grounded;									// 1 when touching the ground, 0 for no force
+	float* springK; float* damperC; float* extents; float* forceCap;
+
+	// Wheel outputs (applied at the rest position)
+	float* forceX; float* forceY; float* forceZ;
+
+	// Body inputs
+	float* upX; float* upY; float* upZ;
+	float* velX; float* velY; float* velZ;
+	float* angVelX; float* angVelY; float* angVelZ;
+	float* axisXx; float* axisXy; float* axisXz;
+	float* axisZx; float* axisZy; float* axisZz;
+	float* frictionX; float* frictionZ;		// Already scaled by yComponent^2, zero when not applied
+	float* drag;
+	void* bodyOwner[MAX_BATCH_BODIES];		// NULL on free slots
+	bool queued[MAX_BATCH_BODIES];			// Written this tick; the owner clears it once applied
+
+	// Body outputs (friction + drag, applied at the center of mass)
+	float* bodyForceX; float* bodyForceY; float* bodyForceZ;
+
+private:
+	float* memory;
+};
@@ -0,0 +1,150 @@
+#include "TextBatch.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+TextBatch::TextBatch()
+{
+	atlasWidth = 0;
+	atlasHeight = 0;
+	glyphHeight = 0;
+	memset(glyphX, 0, sizeof(glyphX));
+	memset(glyphY, 0, sizeof(glyphY));
+	memset(glyphWidth, 0, sizeof(glyphWidth));
+
+	vertices = new TextVertex[TEXT_MAX_GLYPHS * 6];
+	vertexCount = 0;
+	dropped = 0;
+}
+
+
+TextBatch::~TextBatch()
+{
+	if (vertices)
+	{
+		delete [] vertices;
+		vertices = NULL;
+	}
+}
+
+
+bool TextBatch::packGlyphs(const int* widths, int height)
+{
+	memcpy(glyphWidth, widths, sizeof(glyphWidth));
+	glyphHeight = height;
+
+	for (int size = 64; size <= TEXT_ATLAS_MAX_SIZE; size *= 2)
+	{
+		if (tryPack(size))
+		{
+			return true;
+		}
+	}
+
+	atlasWidth = 0;
+	atlasHeight = 0;
+	return false;
+}
+
+
+// Rows of glyphs in character order; they are all the same height
+bool TextBatch::tryPack(int size)
+{
+	int x = 0, y = 0;
+
+	for (int c = 0; c < TEXT_CHAR_COUNT; c++)
+	{
+		if (x + glyphWidth[c] > size)
+		{
+			x = 0;
+			y += glyphHeight + TEXT_ATLAS_PADDING;
+		}
+
+		if (glyphWidth[c] > size || y + glyphHeight > size)
+		{
+			return false;
+		}
+
+		glyphX[c] = x;
+		glyphY[c] = y;
+		x += glyphWidth[c] + TEXT_ATLAS_PADDING;
+	}
+
+	atlasWidth = size;
+	atlasHeight = size;
+	return true;
+}
+
+
+void TextBatch::clear()
+{
+	vertexCount = 0;
+	dropped = 0;
+}
+
+
+void TextBatch::addLine(const char* text, float x, float y, unsigned int colour)
+{
+	if (atlasWidth == 0)
+	{
+		return;
+	}
+
+	for (const char* character = text; *character; character++)
+	{
+		int c = (unsigned char) *character - TEXT_FIRST_CHAR;
+		if (c < 0 || c >= TEXT_CHAR_COUNT)
+		{
+			c = 0;
+		}
+
+		// Spaces only move along
+		if (c == 0)
+		{
+			x += glyphWidth[0];
+			continue;
+		}
+
+		if (vertexCount == TEXT_MAX_GLYPHS * 6)
+		{
+			dropped++;
+			continue;
+		}
+
+		float left = x - 0.5f, top = y - 0.5f;		// Half a pixel puts texels on pixels
+		float right = left + glyphWidth[c], bottom = top + glyphHeight;
+		float u0 = (float) glyphX[c] / atlasWidth, v0 = (float) glyphY[c] / atlasHeight;
+		float u1 = (float) (glyphX[c] + glyphWidth[c]) / atlasWidth, v1 = (float) (glyphY[c] + glyphHeight) / atlasHeight;
+
+		TextVertex corners[4] = {
+			{ left, top, 0.0f, 1.0f, colour, u0, v0 },
+			{ right, top, 0.0f, 1.0f, colour, u1, v0 },
+			{ left, bottom, 0.0f, 1.0f, colour, u0, v1 },
+			{ right, bottom, 0.0f, 1.0f, colour, u1, v1 }
+		};
+
+		// Clockwise, so the default cull mode keeps them
+		TextVertex* out = &vertices[vertexCount];
+		out[0] = corners[0];
+		out[1] = corners[1];
+		out[2] = corners[2];
+		out[3] = corners[2];
+		out[4] = corners[1];
+		out[5] = corners[3];
+		vertexCount += 6;
+
+		x += glyphWidth[c];
+	}
+}
+
+
+const TextVertex* TextBatch::getVertices()
+{
+	return vertices;
+}
+
+int TextBatch::getVertexCount()
+{
+	return vertexCount;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Characters in the glyph atlas: printable ASCII
+#define TEXT_FIRST_CHAR		32
+#define TEXT_LAST_CHAR		126
+#define TEXT_CHAR_COUNT		(TEXT_LAST_CHAR - TEXT_FIRST_CHAR + 1)
+
+#define TEXT_MAX_GLYPHS		4096	// Per batch; anything past this is dropped
+#define TEXT_ATLAS_PADDING	1
+#define TEXT_ATLAS_MAX_SIZE	1024
+
+
+// Pre-transformed vertex: D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1
+struct TextVertex
+{
+	float x, y, z, rhw;
+	unsigned int colour;
+	float u, v;
+};
+
+// Lays lines of text out as quads over a bitmap glyph atlas, into a vertex
+// array of fixed size allocated once, so adding text never allocates.
+// Nothing here touches the device: D3D9TextRenderer rasterizes the glyphs
+// into the atlas and draws the batch.
+class TextBatch
+{
+public:
+	TextBatch();
+	~TextBatch();
+
+	// Places a cell per character (widths of TEXT_CHAR_COUNT, all height texels
+	// tall) in the smallest square power of two atlas they fit. False if none do.
+	bool packGlyphs(const int* widths, int height);
+
+	void clear();
+
+	// Top left of the line at (x, y). Characters outside the atlas take the space's width.
+	void addLine(const char* text, float x, float y, unsigned int colour);
+
+	const TextVertex* getVertices();
+	int getVertexCount();	// 6 per glyph, as a triangle list
+
+	int atlasWidth, atlasHeight;
+	int glyphHeight;
+	int glyphX[TEXT_CHAR_COUNT], glyphY[TEXT_CHAR_COUNT];
+	int glyphWidth[TEXT_CHAR_COUNT];
+
+	int dropped;			// Glyphs that didn't fit since the last clear()
+
+private:
+	bool tryPack(int size);
+
+	TextVertex* vertices;
+	int vertexCount;
+};
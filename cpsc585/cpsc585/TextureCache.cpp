@@ -0,0 +1,281 @@
+#include "TextureCache.h"
+
+#include <fstream>
+#include <vector>
+#include <string.h>
+
+TextureCache* TextureCache::cache = NULL;
+
+// DDS header fields used here
+#define DDS_MAGIC				0x20534444	// "DDS "
+#define DDS_HEADER_SIZE			124
+#define DDSD_MIPMAPCOUNT		0x20000
+#define DDPF_FOURCC				0x4
+#define DDSCAPS2_CUBEMAP		0x200
+
+#define FOURCC(a, b, c, d) ((unsigned int) (a) | ((unsigned int) (b) << 8) | ((unsigned int) (c) << 16) | ((unsigned int) (d) << 24))
+
+
+static unsigned int readUInt(const char* data, int offset)
+{
+	unsigned int value;
+	memcpy(&value, data + offset, sizeof(value));
+	return value;
+}
+
+
+TextureCache::TextureCache(TextureLoader* loader)
+{
+	this->loader = loader;
+	hits = 0;
+	misses = 0;
+	bytesResident = 0;
+	cache = this;
+}
+
+
+TextureCache::~TextureCache()
+{
+	for (std::map<std::string, CachedTexture*>::iterator it = textures.begin(); it != textures.end(); it++)
+	{
+		destroy(it->second);
+	}
+	textures.clear();
+
+	if (loader)
+	{
+		delete loader;
+		loader = NULL;
+	}
+
+	if (cache == this)
+	{
+		cache = NULL;
+	}
+}
+
+
+bool TextureCache::parseDDSHeader(const char* data, unsigned int size, TextureInfo& info)
+{
+	memset(&info, 0, sizeof(info));
+
+	if (size < 4 + DDS_HEADER_SIZE || readUInt(data, 0) != DDS_MAGIC || readUInt(data, 4) != DDS_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	unsigned int flags = readUInt(data, 8);
+	info.height = readUInt(data, 12);
+	info.width = readUInt(data, 16);
+	unsigned int mipCount = readUInt(data, 28);
+
+	unsigned int formatFlags = readUInt(data, 80);
+	info.fourCC = (formatFlags & DDPF_FOURCC) ? readUInt(data, 84) : 0;
+	info.bitsPerPixel = info.fourCC ? 0 : readUInt(data, 88);
+	info.cubeMap = (readUInt(data, 112) & DDSCAPS2_CUBEMAP) != 0;
+
+	if (info.width <= 0 || info.height <= 0)
+	{
+		return false;
+	}
+
+	// D3DX builds the whole chain when the file doesn't bring its own
+	int fullChain = 1;
+	for (int largest = info.width > info.height ? info.width : info.height; largest > 1; largest >>= 1)
+	{
+		fullChain++;
+	}
+	info.mipLevels = ((flags & DDSD_MIPMAPCOUNT) && mipCount > 1) ? mipCount : fullChain;
+
+	// Block compressed formats stay compressed; 24 bit colour is padded to 32
+	int blockBytes = 0;
+	if (info.fourCC == FOURCC('D', 'X', 'T', '1'))
+	{
+		blockBytes = 8;
+	}
+	else if (info.fourCC == FOURCC('D', 'X', 'T', '2') || info.fourCC == FOURCC('D', 'X', 'T', '3') ||
+		info.fourCC == FOURCC('D', 'X', 'T', '4') || info.fourCC == FOURCC('D', 'X', 'T', '5'))
+	{
+		blockBytes = 16;
+	}
+	int bytesPerPixel = info.bitsPerPixel == 24 ? 4 : (info.bitsPerPixel > 0 ? info.bitsPerPixel / 8 : 4);
+
+	unsigned int bytes = 0;
+	int width = info.width, height = info.height;
+	for (int level = 0; level < info.mipLevels; level++)
+	{
+		if (blockBytes)
+		{
+			bytes += ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		}
+		else
+		{
+			bytes += width * height * bytesPerPixel;
+		}
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	info.bytes = info.cubeMap ? bytes * 6 : bytes;
+
+	return true;
+}
+
+
+CachedTexture* TextureCache::load(std::string path)
+{
+	CachedTexture* texture = new CachedTexture();
+	texture->path = path;
+	texture->texture = NULL;
+	texture->refCount = 0;
+	texture->pinned = false;
+	memset(&texture->info, 0, sizeof(texture->info));
+
+	// One read for the whole file
+	std::ifstream filestream(path.c_str(), std::ifstream::binary);
+	if (filestream.is_open())
+	{
+		filestream.seekg(0, std::ios::end);
+		unsigned int size = (unsigned int) filestream.tellg();
+		filestream.seekg(0, std::ios::beg);
+
+		std::vector<char> data(size > 0 ? size : 1);
+		filestream.read(&data[0], size);
+		filestream.close();
+
+		// Anything that isn't a DDS is still handed to the loader, just without an estimate
+		parseDDSHeader(&data[0], size, texture->info);
+		texture->texture = loader->create(path, &data[0], size, texture->info);
+	}
+
+	if (texture->texture)
+	{
+		bytesResident += texture->info.bytes;
+	}
+
+	textures[path] = texture;
+
+	return texture;
+}
+
+
+void TextureCache::destroy(CachedTexture* texture)
+{
+	if (texture->texture)
+	{
+		loader->destroy(texture->texture);
+		bytesResident -= texture->info.bytes;
+	}
+	delete texture;
+}
+
+
+CachedTexture* TextureCache::acquire(std::string path)
+{
+	CachedTexture* texture = NULL;
+
+	std::map<std::string, CachedTexture*>::iterator found = textures.find(path);
+	if (found != textures.end())
+	{
+		texture = found->second;
+		hits++;
+	}
+	else
+	{
+		texture = load(path);
+		misses++;
+	}
+
+	texture->refCount++;
+
+	return texture;
+}
+
+
+void TextureCache::release(CachedTexture* texture)
+{
+	if (!texture)
+	{
+		return;
+	}
+
+	texture->refCount--;
+
+	if (texture->refCount <= 0 && !texture->pinned)
+	{
+		textures.erase(texture->path);
+		destroy(texture);
+	}
+}
+
+
+int TextureCache::preload(std::string manifest)
+{
+	std::ifstream filestream(manifest.c_str());
+	if (!filestream.is_open())
+	{
+		return 0;
+	}
+
+	int loaded = 0;
+	std::string path;
+
+	while (filestream >> path)
+	{
+		CachedTexture* texture = NULL;
+
+		std::map<std::string, CachedTexture*>::iterator found = textures.find(path);
+		if (found != textures.end())
+		{
+			texture = found->second;
+		}
+		else
+		{
+			texture = load(path);
+			if (texture->texture)
+			{
+				loaded++;
+			}
+		}
+
+		texture->pinned = true;
+	}
+
+	filestream.close();
+
+	return loaded;
+}
+
+
+void TextureCache::unpinAll()
+{
+	std::map<std::string, CachedTexture*>::iterator it = textures.begin();
+	while (it != textures.end())
+	{
+		CachedTexture* texture = it->second;
+		texture->pinned = false;
+
+		if (texture->refCount <= 0)
+		{
+			textures.erase(it++);
+			destroy(texture);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+
+int TextureCache::getResidentCount()
+{
+	int count = 0;
+	for (std::map<std::string, CachedTexture*>::iterator it = textures.begin(); it != textures.end(); it++)
+	{
+		if (it->second->texture)
+		{
+			count++;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "TextureLoader.h"
+
+
+struct CachedTexture
+{
+	std::string path;
+	void* texture;			// NULL if the file is missing or unreadable
+	TextureInfo info;
+	int refCount;
+	bool pinned;			// Preloaded, stays resident when nothing uses it
+};
+
+// Shares textures between everything that draws with them, keyed by path.
+// A texture is read and created the first time it is acquired and destroyed
+// when its last user releases it, unless it was preloaded. Missing files are
+// remembered too, so they only cost one trip to the disk.
+class TextureCache
+{
+public:
+	TextureCache(TextureLoader* loader);	// Takes ownership of the loader
+	~TextureCache();
+
+	CachedTexture* acquire(std::string path);
+	void release(CachedTexture* texture);
+
+	// One path per line. Returns the number of textures loaded.
+	int preload(std::string manifest);
+	void unpinAll();		// Let preloaded textures go once nothing uses them
+
+	static bool parseDDSHeader(const char* data, unsigned int size, TextureInfo& info);
+
+	int getResidentCount();
+
+	static TextureCache* cache;
+
+	// Stats
+	int hits;
+	int misses;
+	unsigned int bytesResident;
+
+private:
+	CachedTexture* load(std::string path);
+	void destroy(CachedTexture* texture);
+
+	TextureLoader* loader;
+	std::map<std::string, CachedTexture*> textures;
+};
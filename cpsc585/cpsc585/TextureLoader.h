@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+
+// What the cache knows about a texture before it is created, from the DDS header
+struct TextureInfo
+{
+	int width;
+	int height;
+	int mipLevels;				// As created: a full chain unless the file has its own
+	unsigned int fourCC;		// 0 for uncompressed formats
+	int bitsPerPixel;			// In the file; 0 for compressed formats
+	bool cubeMap;
+	unsigned int bytes;			// Estimated video memory, every level and face
+};
+
+// Turns file contents into a texture object. The cache only sees void*, so
+// it can run against a stub instead of a device.
+class TextureLoader
+{
+public:
+	virtual ~TextureLoader() {}
+
+	// Returns NULL if the data can't be used
+	virtual void* create(const std::string& path, const char* data, unsigned int size, const TextureInfo& info) = 0;
+	virtual void destroy(void* texture) = 0;
+};
@@ -0,0 +1,239 @@
+#include "TransformSnapshot.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#pragma intrinsic(_InterlockedExchange)
+#endif
+
+
+// Full barrier both ways: everything written before is visible to whoever reads the new value
+static long exchange(volatile long* target, long value)
+{
+#ifdef _WIN32
+	return _InterlockedExchange(target, value);
+#else
+	return __atomic_exchange_n(target, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+TransformSnapshot::TransformSnapshot(int capacity, SnapshotOwnerFunction keep, SnapshotOwnerFunction release)
+{
+	this->capacity = capacity;
+	this->keep = keep;
+	this->release = release;
+	dropped = 0;
+
+	for (int f = 0; f < SNAPSHOT_FRAMES; f++)
+	{
+		frames[f].entries = new SnapshotEntry[capacity];
+		frames[f].count = 0;
+		frames[f].staticCount = 0;
+		frames[f].tick = 0;
+		frames[f].complete = false;
+	}
+
+	writing = 0;
+	ready = 1;
+	reading = 2;
+}
+
+
+TransformSnapshot::~TransformSnapshot()
+{
+	for (int f = 0; f < SNAPSHOT_FRAMES; f++)
+	{
+		if (frames[f].entries)
+		{
+			releaseOwners(frames[f]);
+			delete [] frames[f].entries;
+			frames[f].entries = NULL;
+		}
+	}
+}
+
+
+void TransformSnapshot::releaseOwners(SnapshotFrame& frame)
+{
+	if (release)
+	{
+		for (int i = 0; i < frame.count; i++)
+		{
+			release(frame.entries[i].owner);
+		}
+	}
+	frame.count = 0;
+}
+
+
+// The frame being filled is never the one the renderer holds, so its owners can go
+void TransformSnapshot::begin()
+{
+	releaseOwners(frames[writing]);
+	frames[writing].staticCount = 0;
+	dropped = 0;
+}
+
+
+SnapshotEntry* TransformSnapshot::add(void* owner, const float* current, const float* previous)
+{
+	SnapshotFrame& frame = frames[writing];
+	if (frame.count >= capacity)
+	{
+		dropped++;
+		return NULL;
+	}
+
+	if (keep)
+	{
+		keep(owner);
+	}
+
+	SnapshotEntry& entry = frame.entries[frame.count++];
+	entry.owner = owner;
+	memcpy(entry.current, current, sizeof(entry.current));
+	memcpy(entry.previous, previous ? previous : current, sizeof(entry.previous));
+	entry.onGround = false;
+	memset(entry.groundPoint, 0, sizeof(entry.groundPoint));
+	memset(entry.groundNormal, 0, sizeof(entry.groundNormal));
+	return &entry;
+}
+
+
+void TransformSnapshot::markStatic()
+{
+	frames[writing].staticCount = frames[writing].count;
+}
+
+
+void TransformSnapshot::publish(unsigned int tick)
+{
+	frames[writing].tick = tick;
+	frames[writing].complete = true;
+
+	// The old ready frame is either unread or already given up by the reader; fill it next
+	long old = exchange(&ready, writing | SNAPSHOT_FRESH);
+	writing = old & ~SNAPSHOT_FRESH;
+}
+
+
+const SnapshotFrame* TransformSnapshot::acquire()
+{
+	if (ready & SNAPSHOT_FRESH)
+	{
+		long old = exchange(&ready, reading);
+		reading = old & ~SNAPSHOT_FRESH;
+	}
+
+	return frames[reading].complete ? &frames[reading] : NULL;
+}
+
+
+// Rotation part (rows are the axes, scaled) to a unit quaternion x, y, z, w
+static void toQuaternion(const float* m, const float* scale, float* q)
+{
+	float r[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			r[row][col] = m[row * 4 + col] / scale[row];
+		}
+	}
+
+	float trace = r[0][0] + r[1][1] + r[2][2];
+	if (trace > 0.0f)
+	{
+		float s = sqrt(trace + 1.0f) * 2.0f;
+		q[3] = 0.25f * s;
+		q[0] = (r[1][2] - r[2][1]) / s;
+		q[1] = (r[2][0] - r[0][2]) / s;
+		q[2] = (r[0][1] - r[1][0]) / s;
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		float s = sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		q[3] = (r[1][2] - r[2][1]) / s;
+		q[0] = 0.25f * s;
+		q[1] = (r[1][0] + r[0][1]) / s;
+		q[2] = (r[2][0] + r[0][2]) / s;
+	}
+	else if (r[1][1] > r[2][2])
+	{
+		float s = sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		q[3] = (r[2][0] - r[0][2]) / s;
+		q[0] = (r[1][0] + r[0][1]) / s;
+		q[1] = 0.25f * s;
+		q[2] = (r[2][1] + r[1][2]) / s;
+	}
+	else
+	{
+		float s = sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+		q[3] = (r[0][1] - r[1][0]) / s;
+		q[0] = (r[2][0] + r[0][2]) / s;
+		q[1] = (r[2][1] + r[1][2]) / s;
+		q[2] = 0.25f * s;
+	}
+}
+
+
+void TransformSnapshot::interpolate(const float* previous, const float* current, float alpha, float* result)
+{
+	float scaleA[3], scaleB[3], scale[3];
+	for (int row = 0; row < 3; row++)
+	{
+		const float* a = previous + row * 4;
+		const float* b = current + row * 4;
+		scaleA[row] = sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+		scaleB[row] = sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+		scale[row] = scaleA[row] + (scaleB[row] - scaleA[row]) * alpha;
+	}
+
+	// Degenerate axes can't be turned into a rotation; don't blend those at all
+	if (scaleA[0] * scaleA[1] * scaleA[2] <= 0.0f || scaleB[0] * scaleB[1] * scaleB[2] <= 0.0f)
+	{
+		memcpy(result, alpha < 0.5f ? previous : current, sizeof(float) * 16);
+		return;
+	}
+
+	float qa[4], qb[4], q[4];
+	toQuaternion(previous, scaleA, qa);
+	toQuaternion(current, scaleB, qb);
+
+	// The short way round
+	float dot = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+	for (int k = 0; k < 4; k++)
+	{
+		q[k] = qa[k] + (qb[k] * sign - qa[k]) * alpha;
+	}
+	float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	for (int k = 0; k < 4; k++)
+	{
+		q[k] /= length;
+	}
+
+	float x = q[0], y = q[1], z = q[2], w = q[3];
+	float rotation[3][3] = {
+		{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w) },
+		{ 2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w) },
+		{ 2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y) } };
+
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			result[row * 4 + col] = rotation[row][col] * scale[row];
+		}
+		result[row * 4 + 3] = previous[row * 4 + 3] + (current[row * 4 + 3] - previous[row * 4 + 3]) * alpha;
+	}
+
+	for (int col = 0; col < 4; col++)
+	{
+		result[12 + col] = previous[12 + col] + (current[12 + col] - previous[12 + col]) * alpha;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+
+#define SNAPSHOT_FRAMES		3
+#define SNAPSHOT_FRESH		0x4		// Set on the ready frame's index until the reader takes it
+
+
+// Takes or gives up a reference on an entry's owner
+typedef void (*SnapshotOwnerFunction)(void* owner);
+
+struct SnapshotEntry
+{
+	void* owner;			// What the transforms belong to (a Drawable in the game)
+	float previous[16];		// At the tick before, for interpolating; 4x4, D3D layout
+	float current[16];
+
+	// Copied from the owner at the tick, for its blob shadow; false and zero unless set
+	bool onGround;
+	float groundPoint[3];
+	float groundNormal[3];
+};
+
+struct SnapshotFrame
+{
+	SnapshotEntry* entries;
+	int count;
+	int staticCount;		// The first entries are there every tick; the rest come and go (rockets, landmines)
+	unsigned int tick;
+	bool complete;			// False until a tick has been published into it
+};
+
+// Hands the transform of everything drawn from the simulation to the
+// renderer a whole tick at a time, so the two never share a matrix and the
+// renderer can draw between the last two ticks.
+//
+// There are three frames: the simulation fills one while the renderer reads
+// another, and the third holds the newest complete tick. Publishing and
+// acquiring each swap a frame with the ready one in a single atomic exchange,
+// so neither side waits and a tick is never seen half written, even with the
+// two on different threads.
+//
+// Every entry holds a reference on its owner, taken with keep when it is
+// added and given up with release when its frame is filled again (or the
+// snapshot is deleted), so something removed from the game stays alive for
+// as long as a frame the renderer could still be drawing has it. Both are
+// only called from the simulation side.
+class TransformSnapshot
+{
+public:
+	TransformSnapshot(int capacity, SnapshotOwnerFunction keep = NULL, SnapshotOwnerFunction release = NULL);
+	~TransformSnapshot();
+
+	// Simulation side: begin, add every transform, publish
+	void begin();
+	SnapshotEntry* add(void* owner, const float* current, const float* previous);	// NULL once full
+	void markStatic();		// Everything added so far is static
+	void publish(unsigned int tick);
+
+	// Render side: the newest complete tick, the same frame as last time if
+	// nothing newer is ready, or NULL before the first publish
+	const SnapshotFrame* acquire();
+
+	// Translation and scale are lerped and rotation nlerped, alpha from 0 (previous) to 1
+	static void interpolate(const float* previous, const float* current, float alpha, float* result);
+
+	int capacity;
+	int dropped;			// Transforms that didn't fit in the last published tick
+
+private:
+	void releaseOwners(SnapshotFrame& frame);
+
+	SnapshotOwnerFunction keep;
+	SnapshotOwnerFunction release;
+
+	SnapshotFrame frames[SNAPSHOT_FRAMES];
+	int writing;			// Owned by the simulation
+	int reading;			// Owned by the renderer
+	volatile long ready;	// Exchanged between them
+};
@@ -0,0 +1,168 @@
+#include "VertexPacking.h"
+
+#include <math.h>
+#include <string.h>
+
+
+// -1..1 to -32767..32767, rounded to nearest
+static short toSnorm(float value)
+{
+	if (value > 1.0f) value = 1.0f;
+	if (value < -1.0f) value = -1.0f;
+
+	return (short) floorf(value * 32767.0f + 0.5f);
+}
+
+static float fromSnorm(short value)
+{
+	return value * (1.0f / 32767.0f);
+}
+
+
+VertexPacker::VertexPacker()
+{
+	float zero[3] = { 0.0f, 0.0f, 0.0f };
+	setBounds(zero, zero, zero, zero);
+}
+
+
+void VertexPacker::setBounds(const float* positionMin, const float* positionMax, const float* uvMin, const float* uvMax)
+{
+	// A flat axis still needs a scale to divide by; everything on it packs to 0
+	for (int k = 0; k < 3; k++)
+	{
+		positionCenter[k] = (positionMin[k] + positionMax[k]) * 0.5f;
+		positionScale[k] = positionMax[k] > positionMin[k] ? (positionMax[k] - positionMin[k]) * 0.5f : 1.0f;
+		positionTolerance[k] = positionScale[k] * (0.5f / 32767.0f);
+	}
+
+	for (int k = 0; k < 2; k++)
+	{
+		uvCenter[k] = (uvMin[k] + uvMax[k]) * 0.5f;
+		uvScale[k] = uvMax[k] > uvMin[k] ? (uvMax[k] - uvMin[k]) * 0.5f : 1.0f;
+		uvTolerance[k] = uvScale[k] * (0.5f / 32767.0f);
+	}
+}
+
+
+void VertexPacker::pack(const float* vertexData, int stride, int numVertices, PackedVertex* packed) const
+{
+	for (int i = 0; i < numVertices; i++)
+	{
+		const float* vertex = &vertexData[i * stride];
+		PackedVertex& out = packed[i];
+
+		for (int k = 0; k < 3; k++)
+		{
+			out.position[k] = toSnorm((vertex[k] - positionCenter[k]) / positionScale[k]);
+		}
+		out.position[3] = 0;
+
+		encodeNormal(&vertex[3], out.normal);
+
+		for (int k = 0; k < 2; k++)
+		{
+			out.uv[k] = toSnorm((vertex[6 + k] - uvCenter[k]) / uvScale[k]);
+		}
+	}
+}
+
+
+void VertexPacker::unpack(const PackedVertex* packed, int numVertices, float* vertexData, int stride) const
+{
+	for (int i = 0; i < numVertices; i++)
+	{
+		const PackedVertex& in = packed[i];
+		float* vertex = &vertexData[i * stride];
+
+		for (int k = 0; k < 3; k++)
+		{
+			vertex[k] = positionCenter[k] + fromSnorm(in.position[k]) * positionScale[k];
+		}
+
+		decodeNormal(in.normal, &vertex[3]);
+
+		for (int k = 0; k < 2; k++)
+		{
+			vertex[6 + k] = uvCenter[k] + fromSnorm(in.uv[k]) * uvScale[k];
+		}
+	}
+}
+
+
+void VertexPacker::getShaderConstants(float* constants) const
+{
+	memcpy(&constants[0], positionCenter, sizeof(float) * 3);
+	constants[3] = 0.0f;
+	memcpy(&constants[4], positionScale, sizeof(float) * 3);
+	constants[7] = 0.0f;
+	memcpy(&constants[8], uvCenter, sizeof(float) * 2);
+	memcpy(&constants[10], uvScale, sizeof(float) * 2);
+}
+
+
+// The normal is projected onto the octahedron |x| + |y| + |z| = 1 and the
+// lower half folded over the upper, giving two numbers in -1..1
+void VertexPacker::encodeNormal(const float* normal, short* encoded)
+{
+	float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	if (length == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = normal[0] / length;
+	float y = normal[1] / length;
+
+	if (normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// Rounding each way independently can be off by most of a step; try the
+	// four neighbours and keep the one that decodes closest
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		short candidate[2];
+		candidate[0] = (short) ((i & 1) ? ceilf(x * 32767.0f) : floorf(x * 32767.0f));
+		candidate[1] = (short) ((i & 2) ? ceilf(y * 32767.0f) : floorf(y * 32767.0f));
+
+		float decoded[3];
+		decodeNormal(candidate, decoded);
+
+		float dot = decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2];
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+// The same sums as the shader
+void VertexPacker::decodeNormal(const short* encoded, float* normal)
+{
+	float x = fromSnorm(encoded[0]);
+	float y = fromSnorm(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	if (z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
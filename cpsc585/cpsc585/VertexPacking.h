@@ -0,0 +1,44 @@
+#pragma once
+
+#define VERTEX_PACKING_CONSTANTS 12		// Floats getShaderConstants() writes
+
+
+// 16 bytes instead of 32. Every component is a signed 16 bit integer read as
+// SHORT4N/SHORT2N (value / 32767), so it works on any card with those types.
+struct PackedVertex
+{
+	short position[4];		// Across the mesh's bounding box, w unused
+	short normal[2];		// Octahedral
+	short uv[2];			// Across the mesh's uv range
+};
+
+// Quantizes vertices to PackedVertex and back. Positions are the first
+// three floats of every vertex, the normal the next three and then u and v,
+// as in MeshFileVertex; stride is in floats. The shader decodes the same way
+// unpack() does, so the CPU copy matches what is drawn.
+class VertexPacker
+{
+public:
+	VertexPacker();
+
+	void setBounds(const float* positionMin, const float* positionMax, const float* uvMin, const float* uvMax);
+
+	void pack(const float* vertexData, int stride, int numVertices, PackedVertex* packed) const;
+	void unpack(const PackedVertex* packed, int numVertices, float* vertexData, int stride) const;
+
+	// Position centre and scale, then uv centre and scale, as three float4s
+	void getShaderConstants(float* constants) const;
+
+	static void encodeNormal(const float* normal, short* encoded);
+	static void decodeNormal(const short* encoded, float* normal);
+
+	// Half the spacing between quantized positions on each axis: the most any position moves
+	float positionTolerance[3];
+	float uvTolerance[2];
+
+private:
+	float positionCenter[3];
+	float positionScale[3];		// Half the box size, never 0
+	float uvCenter[2];
+	float uvScale[2];
+};
@@ -0,0 +1,166 @@
+#include "VoicePool.h"
+
+#include <stddef.h>
+
+
+VoicePool::VoicePool(AudioBackend* backend, int capacity)
+{
+	this->backend = backend;
+	this->capacity = capacity;
+	slots = new VoiceSlot[capacity];
+	count = 0;
+	handedOut = 0;
+
+	acquired = 0;
+	steals = 0;
+	rejections = 0;
+	reserveFailures = 0;
+}
+
+
+VoicePool::~VoicePool()
+{
+	if (slots)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			backend->destroyVoice(slots[i].voice);
+		}
+
+		delete [] slots;
+		slots = NULL;
+	}
+}
+
+
+bool VoicePool::addVoices(int format, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (this->count == capacity)
+		{
+			return false;
+		}
+
+		void* voice = backend->createVoice(format);
+		if (!voice)
+		{
+			return false;
+		}
+
+		VoiceSlot& slot = slots[this->count++];
+		slot.voice = voice;
+		slot.format = format;
+		slot.reserved = false;
+		slot.priority = 0.0f;
+		slot.distance = 0.0f;
+		slot.order = 0;
+	}
+
+	return true;
+}
+
+
+void* VoicePool::acquire(int format, float priority, float distance)
+{
+	VoiceSlot* chosen = NULL;
+	VoiceSlot* victim = NULL;
+	float victimAudibility = 0.0f;
+
+	for (int i = 0; i < count; i++)
+	{
+		VoiceSlot& slot = slots[i];
+		if (slot.format != format || slot.reserved)
+		{
+			continue;
+		}
+
+		if (!backend->isPlaying(slot.voice))
+		{
+			chosen = &slot;
+			break;
+		}
+
+		float current = audibility(slot.priority, slot.distance);
+		if (!victim || current < victimAudibility || (current == victimAudibility && slot.order < victim->order))
+		{
+			victim = &slot;
+			victimAudibility = current;
+		}
+	}
+
+	if (!chosen)
+	{
+		// A newer sound wins a tie
+		if (!victim || audibility(priority, distance) < victimAudibility)
+		{
+			rejections++;
+			return NULL;
+		}
+
+		backend->stopVoice(victim->voice);
+		chosen = victim;
+		steals++;
+	}
+
+	chosen->priority = priority;
+	chosen->distance = distance;
+	chosen->order = ++handedOut;
+	acquired++;
+
+	return chosen->voice;
+}
+
+
+void* VoicePool::reserve(int format)
+{
+	for (int i = 0; i < count; i++)
+	{
+		VoiceSlot& slot = slots[i];
+		if (slot.format == format && !slot.reserved && !backend->isPlaying(slot.voice))
+		{
+			slot.reserved = true;
+			slot.order = ++handedOut;
+			return slot.voice;
+		}
+	}
+
+	reserveFailures++;
+	return NULL;
+}
+
+
+void VoicePool::release(void* voice)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (slots[i].voice == voice && slots[i].reserved)
+		{
+			backend->stopVoice(voice);
+			slots[i].reserved = false;
+			return;
+		}
+	}
+}
+
+
+int VoicePool::getPlaying(int format)
+{
+	int playing = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (slots[i].format == format && (slots[i].reserved || backend->isPlaying(slots[i].voice)))
+		{
+			playing++;
+		}
+	}
+
+	return playing;
+}
+
+
+// Priority, fading with distance
+float VoicePool::audibility(float priority, float distance)
+{
+	return priority / (1.0f + distance / VOICE_FALLOFF_DISTANCE);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AudioBackend.h"
+
+#define VOICE_FALLOFF_DISTANCE	50.0f	// A sound this far from the listener counts half as much as one right there
+
+
+struct VoiceSlot
+{
+	void* voice;
+	int format;
+	bool reserved;			// Held until released, and never stolen
+	float priority;			// Of the last sound started on it
+	float distance;
+	unsigned int order;		// When it was last handed out
+};
+
+// Source voices made once, up front, and handed out again and again instead
+// of being destroyed and recreated for every sound. Voices are grouped by
+// format, since a voice can only play the format it was made with.
+//
+// When every voice of a format is busy, a new sound takes the one playing
+// whatever counts least (see audibility; the oldest on a tie), as long as
+// that counts no more than the new sound. Otherwise the new sound isn't
+// played. Reserved voices are never taken.
+class VoicePool
+{
+public:
+	VoicePool(AudioBackend* backend, int capacity);
+	~VoicePool();		// Destroys every voice
+
+	// False if the backend couldn't make them all, or there's no room
+	bool addVoices(int format, int count);
+
+	// For a one-shot sound of priority (0 to 1) at distance from the listener.
+	// NULL when it can't be played (counted in rejections).
+	void* acquire(int format, float priority, float distance);
+
+	// For a looping sound (an engine, a rocket): an idle voice, kept until released
+	void* reserve(int format);
+	void release(void* voice);
+
+	int getPlaying(int format);
+
+	static float audibility(float priority, float distance);
+
+private:
+	AudioBackend* backend;
+	VoiceSlot* slots;
+	unsigned int handedOut;
+
+public:
+	int capacity;
+	int count;
+
+	// Since startup
+	int acquired;
+	int steals;
+	int rejections;
+	int reserveFailures;
+};
@@ -84,7 +84,7 @@ void WaypointEditor::loadWaypoints(Waypoint* _waypoints[], std::string fileName)
 
 	}
 	else{
-		std::string stringArray[] = { "Failed To open file" };
-		renderer->setText(stringArray, sizeof(stringArray) / sizeof(std::string));
+		const char* lines[] = { "Failed To open file" };
+		renderer->setText(lines, sizeof(lines) / sizeof(const char*));
 	}
 }
\ No newline at end of file
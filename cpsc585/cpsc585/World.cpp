@@ -1,21 +1,51 @@
 #include "World.h"
 
+World* World::world = NULL;
 
 World::World(IDirect3DDevice9* device, Renderer* r, Physics* p)
 {
+	world = this;
+	initialized = false;
+	drawable = NULL;
+	body = NULL;
+	meshShape = NULL;
+
+	// Collide against the simplified mesh built by the tools project, and
+	// build it here from the render mesh if the asset is missing
+	collisionMesh = new CollisionMesh();
+	if (!collisionMesh->load("models/world.col"))
+	{
+		// The registry may have dropped its CPU copy of the world, so read the file again
+		MeshFile source;
+		if (!source.load("models/world.mesh"))
+		{
+			return;
+		}
+
+		CollisionMeshParams params;
+		params.minNormalY = COLLISION_TRACK_MIN_NORMAL_Y;
+		collisionMesh->build((const float*) source.vertices, 8, source.vertexCount,
+			source.indices, source.indexCount, params);
+	}
+
+	if (collisionMesh->triangleCount == 0)
+	{
+		return;
+	}
+
 	drawable = new Drawable(WORLD, "textures/terrain0.dds", device);
 
-	hkpExtendedMeshShape* meshShape = new hkpExtendedMeshShape();
+	meshShape = new hkpExtendedMeshShape();
 	meshShape->setRadius(0.0f);
 
 	hkpExtendedMeshShape::TrianglesSubpart subPart;
 
-	subPart.m_vertexBase = (const hkReal*) drawable->mesh->vertices;
-	subPart.m_vertexStriding = sizeof(float) * 8;
-	subPart.m_numVertices = drawable->mesh->vertexCount;
-	subPart.m_indexBase = (const hkReal*) drawable->mesh->indices;
-	subPart.m_indexStriding = sizeof(unsigned long) * 3;
-	subPart.m_numTriangleShapes = drawable->mesh->indexCount / 3;
+	subPart.m_vertexBase = (const hkReal*) collisionMesh->vertices;
+	subPart.m_vertexStriding = sizeof(float) * 3;
+	subPart.m_numVertices = collisionMesh->vertexCount;
+	subPart.m_indexBase = (const hkReal*) collisionMesh->indices;
+	subPart.m_indexStriding = sizeof(unsigned int) * 3;
+	subPart.m_numTriangleShapes = collisionMesh->triangleCount;
 	subPart.m_stridingType = hkpExtendedMeshShape::INDICES_INT32;
 
 	meshShape->addTrianglesSubpart(subPart);
@@ -38,6 +68,8 @@ World::World(IDirect3DDevice9* device, Renderer* r, Physics* p)
 
 	r->addDrawable(drawable);
 	p->addRigidBody(body);
+
+	initialized = true;
 }
 
 
@@ -47,6 +79,18 @@ World::~World(void)
 	{
 		body->removeReference();
 	}
+
+	// The shape references this data, so it has to outlive the body
+	if (collisionMesh)
+	{
+		delete collisionMesh;
+		collisionMesh = NULL;
+	}
+
+	if (world == this)
+	{
+		world = NULL;
+	}
 }
 
 void World::setPosAndRot(float posX, float posY, float posZ,
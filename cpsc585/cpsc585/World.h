@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CollisionMesh.h"
 #include "Drawable.h"
 #include "Physics.h"
 #include "Renderer.h"
@@ -18,4 +19,9 @@ private:
 public:
 	Drawable* drawable;
 	hkpRigidBody* body;
+	hkpExtendedMeshShape* meshShape;
+	CollisionMesh* collisionMesh;
+	bool initialized;		// False when neither models/world.col nor models/world.mesh could be read
+
+	static World* world;
 };
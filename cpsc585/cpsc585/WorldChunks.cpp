@@ -0,0 +1,408 @@
+#include "WorldChunks.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+
+#define ALL_PLANES	0x3F
+
+
+struct WorldChunksHeader
+{
+	char magic[4];
+	int version;
+	int chunkCount;
+	int nodeCount;
+	int indexCount;
+};
+
+// Sorts triangle numbers by one coordinate of their centroid
+struct CentroidLess
+{
+	const float* centroids;
+	int axis;
+
+	bool operator()(int a, int b) const
+	{
+		return centroids[a * 3 + axis] < centroids[b * 3 + axis];
+	}
+};
+
+// Outside when the box is entirely behind a plane. Planes the box is entirely
+// in front of are cleared from mask, so children don't test them again.
+static bool boxOutside(const float planes[6][4], const float* aabbMin, const float* aabbMax, int& mask)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		if (!(mask & (1 << p)))
+		{
+			continue;
+		}
+
+		const float* plane = planes[p];
+
+		// The corners furthest along and furthest against the normal
+		float nearest = plane[3], furthest = plane[3];
+		for (int k = 0; k < 3; k++)
+		{
+			if (plane[k] >= 0.0f)
+			{
+				furthest += plane[k] * aabbMax[k];
+				nearest += plane[k] * aabbMin[k];
+			}
+			else
+			{
+				furthest += plane[k] * aabbMin[k];
+				nearest += plane[k] * aabbMax[k];
+			}
+		}
+
+		if (furthest < 0.0f)
+		{
+			return true;
+		}
+		if (nearest >= 0.0f)
+		{
+			mask &= ~(1 << p);
+		}
+	}
+
+	return false;
+}
+
+
+WorldChunks::WorldChunks()
+{
+	indexCount = 0;
+	visibleTriangles = 0;
+	boxTests = 0;
+}
+
+
+void WorldChunks::build(const float* vertexData, int stride, unsigned int* indices, int indexCount, int maxTriangles)
+{
+	int faceCount = indexCount / 3;
+	this->indexCount = indexCount;
+
+	centroids.resize(faceCount * 3);
+	order.resize(faceCount);
+	for (int f = 0; f < faceCount; f++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			centroids[f * 3 + k] = (vertexData[indices[f * 3] * stride + k] + vertexData[indices[f * 3 + 1] * stride + k] +
+				vertexData[indices[f * 3 + 2] * stride + k]) * (1.0f / 3.0f);
+		}
+		order[f] = f;
+	}
+
+	chunks.clear();
+	nodes.clear();
+	if (faceCount > 0)
+	{
+		split(vertexData, stride, indices, 0, faceCount, maxTriangles > 0 ? maxTriangles : 1);
+	}
+
+	// Triangles in leaf order
+	std::vector<unsigned int> reordered(indexCount);
+	for (int f = 0; f < faceCount; f++)
+	{
+		memcpy(&reordered[f * 3], &indices[order[f] * 3], sizeof(unsigned int) * 3);
+	}
+	if (indexCount > 0)
+	{
+		memcpy(indices, &reordered[0], sizeof(unsigned int) * indexCount);
+	}
+
+	computeRanges(indices);
+}
+
+
+int WorldChunks::split(const float* vertexData, int stride, const unsigned int* indices, int first, int count, int maxTriangles)
+{
+	int node = nodes.size();
+	WorldChunkNode empty = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, -1, -1, -1 };
+	nodes.push_back(empty);
+
+	// Bounds of the whole triangles, and of their centroids to pick the split axis
+	float aabbMin[3], aabbMax[3], centroidMin[3], centroidMax[3];
+	for (int k = 0; k < 3; k++)
+	{
+		aabbMin[k] = centroidMin[k] = 1e30f;
+		aabbMax[k] = centroidMax[k] = -1e30f;
+	}
+
+	for (int i = first; i < first + count; i++)
+	{
+		int face = order[i];
+		for (int k = 0; k < 3; k++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				float value = vertexData[indices[face * 3 + corner] * stride + k];
+				aabbMin[k] = std::min(aabbMin[k], value);
+				aabbMax[k] = std::max(aabbMax[k], value);
+			}
+			centroidMin[k] = std::min(centroidMin[k], centroids[face * 3 + k]);
+			centroidMax[k] = std::max(centroidMax[k], centroids[face * 3 + k]);
+		}
+	}
+
+	memcpy(nodes[node].aabbMin, aabbMin, sizeof(aabbMin));
+	memcpy(nodes[node].aabbMax, aabbMax, sizeof(aabbMax));
+
+	if (count <= maxTriangles)
+	{
+		WorldChunk chunk;
+		memcpy(chunk.aabbMin, aabbMin, sizeof(aabbMin));
+		memcpy(chunk.aabbMax, aabbMax, sizeof(aabbMax));
+		chunk.firstIndex = first * 3;
+		chunk.indexCount = count * 3;
+		chunk.minVertex = 0;
+		chunk.vertexCount = 0;
+
+		nodes[node].chunk = chunks.size();
+		chunks.push_back(chunk);
+		return node;
+	}
+
+	int axis = 0;
+	for (int k = 1; k < 3; k++)
+	{
+		if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+		{
+			axis = k;
+		}
+	}
+
+	CentroidLess less = { &centroids[0], axis };
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, less);
+
+	// nodes may move as children are added
+	int left = split(vertexData, stride, indices, first, half, maxTriangles);
+	int right = split(vertexData, stride, indices, first + half, count - half, maxTriangles);
+	nodes[node].left = left;
+	nodes[node].right = right;
+
+	return node;
+}
+
+
+void WorldChunks::computeRanges(const unsigned int* indices)
+{
+	for (unsigned int c = 0; c < chunks.size(); c++)
+	{
+		WorldChunk& chunk = chunks[c];
+		unsigned int low = 0xFFFFFFFF, high = 0;
+
+		for (unsigned int i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; i++)
+		{
+			low = std::min(low, indices[i]);
+			high = std::max(high, indices[i]);
+		}
+
+		chunk.minVertex = chunk.indexCount > 0 ? low : 0;
+		chunk.vertexCount = chunk.indexCount > 0 ? high - low + 1 : 0;
+	}
+}
+
+
+void WorldChunks::addVisible(int chunk)
+{
+	const WorldChunk& visible = chunks[chunk];
+	visibleTriangles += visible.indexCount / 3;
+
+	// Straight after the last run in the index buffer: draw them together
+	if (!visibleRuns.empty())
+	{
+		WorldChunkRun& last = visibleRuns.back();
+		if (last.firstIndex + last.indexCount == visible.firstIndex)
+		{
+			unsigned int end = std::max(last.minVertex + last.vertexCount, visible.minVertex + visible.vertexCount);
+			last.minVertex = std::min(last.minVertex, visible.minVertex);
+			last.vertexCount = end - last.minVertex;
+			last.indexCount += visible.indexCount;
+			return;
+		}
+	}
+
+	WorldChunkRun run = { visible.firstIndex, visible.indexCount, visible.minVertex, visible.vertexCount };
+	visibleRuns.push_back(run);
+}
+
+
+int WorldChunks::cull(const float planes[6][4])
+{
+	visibleRuns.clear();
+	visibleTriangles = 0;
+	boxTests = 0;
+
+	if (nodes.empty())
+	{
+		return 0;
+	}
+
+	int visibleChunks = 0;
+
+	// Depth first, left before right, so chunks come out in index buffer order
+	stack.clear();
+	stack.push_back(0);
+	stack.push_back(ALL_PLANES);
+
+	while (!stack.empty())
+	{
+		int mask = stack.back();
+		stack.pop_back();
+		int node = stack.back();
+		stack.pop_back();
+
+		const WorldChunkNode& current = nodes[node];
+		if (mask != 0)
+		{
+			boxTests++;
+			if (boxOutside(planes, current.aabbMin, current.aabbMax, mask))
+			{
+				continue;
+			}
+		}
+
+		if (current.chunk >= 0)
+		{
+			addVisible(current.chunk);
+			visibleChunks++;
+		}
+		else
+		{
+			stack.push_back(current.right);
+			stack.push_back(mask);
+			stack.push_back(current.left);
+			stack.push_back(mask);
+		}
+	}
+
+	return visibleChunks;
+}
+
+
+int WorldChunks::cullChunks(const float planes[6][4])
+{
+	visibleRuns.clear();
+	visibleTriangles = 0;
+	boxTests = 0;
+
+	int visibleChunks = 0;
+
+	for (unsigned int c = 0; c < chunks.size(); c++)
+	{
+		int mask = ALL_PLANES;
+		boxTests++;
+		if (!boxOutside(planes, chunks[c].aabbMin, chunks[c].aabbMax, mask))
+		{
+			addVisible(c);
+			visibleChunks++;
+		}
+	}
+
+	return visibleChunks;
+}
+
+
+bool WorldChunks::load(std::string filename)
+{
+	std::ifstream filestream(filename.c_str(), std::ifstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	WorldChunksHeader header;
+	filestream.read((char*)&header, sizeof(header));
+
+	if (!filestream.good() ||
+		header.magic[0] != 'C' || header.magic[1] != 'H' ||
+		header.magic[2] != 'N' || header.magic[3] != 'K' ||
+		header.version != WORLD_CHUNKS_VERSION ||
+		header.chunkCount <= 0 || header.nodeCount <= 0 || header.indexCount <= 0)
+	{
+		return false;
+	}
+
+	chunks.resize(header.chunkCount);
+	nodes.resize(header.nodeCount);
+	indexCount = header.indexCount;
+
+	filestream.read((char*)&chunks[0], sizeof(WorldChunk) * header.chunkCount);
+	filestream.read((char*)&nodes[0], sizeof(WorldChunkNode) * header.nodeCount);
+
+	if (!filestream.good())
+	{
+		chunks.clear();
+		nodes.clear();
+		return false;
+	}
+
+	filestream.close();
+
+	// Everything the traversal follows has to point somewhere real
+	for (unsigned int n = 0; n < nodes.size(); n++)
+	{
+		const WorldChunkNode& node = nodes[n];
+		bool leafOK = node.chunk >= 0 && node.chunk < header.chunkCount;
+		bool innerOK = node.chunk == -1 && node.left > (int) n && node.right > (int) n &&
+			node.left < header.nodeCount && node.right < header.nodeCount;
+
+		if (!leafOK && !innerOK)
+		{
+			chunks.clear();
+			nodes.clear();
+			return false;
+		}
+	}
+
+	for (unsigned int c = 0; c < chunks.size(); c++)
+	{
+		if (chunks[c].firstIndex + chunks[c].indexCount > (unsigned int) indexCount)
+		{
+			chunks.clear();
+			nodes.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool WorldChunks::save(std::string filename)
+{
+	if (chunks.empty())
+	{
+		return false;
+	}
+
+	std::ofstream filestream(filename.c_str(), std::ofstream::binary);
+	if (!filestream.is_open())
+	{
+		return false;
+	}
+
+	WorldChunksHeader header;
+	header.magic[0] = 'C';
+	header.magic[1] = 'H';
+	header.magic[2] = 'N';
+	header.magic[3] = 'K';
+	header.version = WORLD_CHUNKS_VERSION;
+	header.chunkCount = chunks.size();
+	header.nodeCount = nodes.size();
+	header.indexCount = indexCount;
+
+	filestream.write((const char*)&header, sizeof(header));
+	filestream.write((const char*)&chunks[0], sizeof(WorldChunk) * chunks.size());
+	filestream.write((const char*)&nodes[0], sizeof(WorldChunkNode) * nodes.size());
+
+	bool ok = filestream.good();
+	filestream.close();
+
+	return ok;
+}
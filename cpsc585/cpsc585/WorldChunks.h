@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define WORLD_CHUNKS_VERSION	1
+#define WORLD_CHUNK_TRIANGLES	256		// Most triangles in one chunk
+
+
+struct WorldChunk
+{
+	float aabbMin[3];
+	float aabbMax[3];
+	unsigned int firstIndex;	// Into the mesh's index buffer; each chunk's triangles are contiguous
+	unsigned int indexCount;
+	unsigned int minVertex;		// Range of vertices the chunk uses, for DrawIndexedPrimitive
+	unsigned int vertexCount;
+};
+
+struct WorldChunkNode
+{
+	float aabbMin[3];
+	float aabbMax[3];
+	int left, right;			// Child nodes; -1 on leaves
+	int chunk;					// Leaves only, -1 otherwise
+};
+
+// Visible chunks that follow each other in the index buffer, drawn as one call
+struct WorldChunkRun
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int minVertex;
+	unsigned int vertexCount;
+};
+
+// Splits a big static mesh (the track) into spatial chunks, with a bounding
+// volume hierarchy over them for frustum culling. Built offline by the tools
+// project (models/world.chunks), which also rewrites the mesh with its
+// triangles in chunk order.
+//
+// The hierarchy is the median split that made the chunks, so chunks close
+// in the tree are close in the index buffer, and the visible ones merge
+// into a few runs.
+class WorldChunks
+{
+public:
+	WorldChunks();
+
+	// Reorders the triangles so each chunk's are contiguous, splitting along
+	// the longest axis until no chunk has more than maxTriangles. Positions are
+	// the first three floats of every vertex; stride is in floats.
+	void build(const float* vertexData, int stride, unsigned int* indices, int indexCount, int maxTriangles);
+
+	// Vertex ranges from the final indices, once the vertices have been reordered
+	void computeRanges(const unsigned int* indices);
+
+	bool load(std::string filename);
+	bool save(std::string filename);
+
+	// Planes as FrustumCuller keeps them, in the mesh's space. Fills visibleRuns
+	// and returns the number of visible chunks. cullChunks tests every chunk on
+	// its own, for checking and timing against the hierarchy.
+	int cull(const float planes[6][4]);
+	int cullChunks(const float planes[6][4]);
+
+private:
+	int split(const float* vertexData, int stride, const unsigned int* indices, int first, int count, int maxTriangles);
+	void addVisible(int chunk);
+
+	// Scratch for build
+	std::vector<float> centroids;		// xyz per triangle
+	std::vector<int> order;
+
+	std::vector<int> stack;				// Node and plane mask pairs, reused by cull
+
+public:
+	std::vector<WorldChunk> chunks;
+	std::vector<WorldChunkNode> nodes;		// Root first
+	int indexCount;							// Of the mesh it was built for
+
+	// From the last cull
+	std::vector<WorldChunkRun> visibleRuns;
+	int visibleTriangles;
+	int boxTests;
+};
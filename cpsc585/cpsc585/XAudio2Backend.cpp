@@ -0,0 +1,63 @@
+#include "XAudio2Backend.h"
+
+
+XAudio2Backend::XAudio2Backend(IXAudio2* audio, XAUDIO2_VOICE_SENDS* sends)
+{
+	this->audio = audio;
+	this->sends = sends;
+
+	for (int i = 0; i < AUDIO_MAX_FORMATS; i++)
+	{
+		formats[i] = NULL;
+	}
+}
+
+
+void XAudio2Backend::setFormat(int format, WAVEFORMATEX* waveFormat)
+{
+	if (format >= 0 && format < AUDIO_MAX_FORMATS)
+	{
+		formats[format] = waveFormat;
+	}
+}
+
+
+void* XAudio2Backend::createVoice(int format)
+{
+	if (format < 0 || format >= AUDIO_MAX_FORMATS || !formats[format])
+	{
+		return NULL;
+	}
+
+	IXAudio2SourceVoice* voice = NULL;
+	if (FAILED(audio->CreateSourceVoice(&voice, formats[format], XAUDIO2_VOICE_USEFILTER, XAUDIO2_MAX_FREQ_RATIO,
+		NULL, sends, NULL)))
+	{
+		return NULL;
+	}
+
+	return voice;
+}
+
+
+void XAudio2Backend::destroyVoice(void* voice)
+{
+	((IXAudio2SourceVoice*) voice)->DestroyVoice();
+}
+
+
+void XAudio2Backend::stopVoice(void* voice)
+{
+	IXAudio2SourceVoice* sourceVoice = (IXAudio2SourceVoice*) voice;
+	sourceVoice->Stop(0);
+	sourceVoice->FlushSourceBuffers();
+}
+
+
+bool XAudio2Backend::isPlaying(void* voice)
+{
+	XAUDIO2_VOICE_STATE state;
+	((IXAudio2SourceVoice*) voice)->GetState(&state);
+
+	return state.BuffersQueued > 0;
+}
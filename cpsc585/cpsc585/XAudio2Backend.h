@@ -0,0 +1,28 @@
+#pragma once
+
+#include <XAudio2.h>
+
+#include "AudioBackend.h"
+
+#define AUDIO_MAX_FORMATS	4
+
+
+// Source voices on an XAudio2 engine, all sending to the same submix voice.
+// Each format's wave format has to be set before voices of it are made.
+class XAudio2Backend : public AudioBackend
+{
+public:
+	XAudio2Backend(IXAudio2* audio, XAUDIO2_VOICE_SENDS* sends);
+
+	void setFormat(int format, WAVEFORMATEX* waveFormat);
+
+	void* createVoice(int format);
+	void destroyVoice(void* voice);
+	void stopVoice(void* voice);
+	bool isPlaying(void* voice);
+
+private:
+	IXAudio2* audio;
+	XAUDIO2_VOICE_SENDS* sends;
+	WAVEFORMATEX* formats[AUDIO_MAX_FORMATS];
+};
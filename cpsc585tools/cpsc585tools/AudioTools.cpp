@@ -0,0 +1,175 @@
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+
+#include "NullAudioBackend.h"
+#include "ToolsCommon.h"
+#include "VoicePool.h"
+
+using namespace std;
+
+// Handing out, taking over and reserving voices, on a pool small enough to
+// fill by hand
+static int checkVoicePool()
+{
+	int failures = 0;
+	NullAudioBackend backend;
+
+	{
+		VoicePool pool(&backend, 6);
+		pool.addVoices(0, 4);
+		pool.addVoices(1, 2);
+		failures += check(backend.created == 6 && pool.count == 6, "every voice made up front");
+		failures += check(!pool.addVoices(0, 1) && backend.created == 6, "no more than the capacity");
+
+		// Idle voices are handed out again
+		void* first = pool.acquire(0, 0.5f, 0.0f);
+		backend.start(first, 1.0f);
+		void* second = pool.acquire(0, 0.5f, 0.0f);
+		failures += check(first && second && second != first, "a playing voice isn't handed out while others are idle");
+		backend.advance(2.0f);
+		failures += check(pool.acquire(0, 0.5f, 0.0f) == first && backend.created == 6, "a finished voice is reused");
+		backend.advance(10.0f);
+
+		// All four busy: the new sound takes the least audible
+		void* a = pool.acquire(0, 0.5f, 0.0f);
+		backend.start(a, 5.0f);
+		void* b = pool.acquire(0, 0.3f, 0.0f);
+		backend.start(b, 5.0f);
+		void* c = pool.acquire(0, 0.5f, 100.0f);
+		backend.start(c, 5.0f);
+		void* d = pool.acquire(0, 0.3f, 0.0f);
+		backend.start(d, 5.0f);
+		failures += check(pool.getPlaying(0) == 4 && pool.steals == 0, "four sounds on four voices");
+
+		int stopped = backend.stopped;
+		void* taken = pool.acquire(0, 0.5f, 0.0f);
+		failures += check(taken == c && pool.steals == 1 && backend.stopped == stopped + 1, "the far away sound is stopped for a nearer one");
+		backend.start(taken, 5.0f);
+
+		taken = pool.acquire(0, 0.3f, 0.0f);
+		failures += check(taken == b && pool.steals == 2, "of two equally quiet sounds, the older one goes");
+		backend.start(taken, 5.0f);
+
+		failures += check(pool.acquire(0, 0.1f, 0.0f) == NULL && pool.rejections == 1, "a quieter sound than all the playing ones isn't played");
+		failures += check(pool.acquire(0, 0.5f, 1000.0f) == NULL && pool.rejections == 2, "nor is a very distant one");
+		failures += check(pool.acquire(0, 1.0f, 0.0f) != NULL, "the player's own sounds always play");
+
+		void* other = pool.acquire(1, 0.1f, 0.0f);
+		failures += check(other && backend.getFormat(other) == 1 && pool.steals == 3, "formats don't share voices");
+		backend.advance(10.0f);
+
+		// Reserved voices are never taken, and come back when released
+		void* engine = pool.reserve(0);
+		backend.start(engine, 1000.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			backend.start(pool.acquire(0, 0.5f, 0.0f), 5.0f);
+		}
+		bool engineTaken = false;
+		for (int i = 0; i < 10; i++)
+		{
+			void* voice = pool.acquire(0, 1.0f, 0.0f);
+			engineTaken = engineTaken || voice == engine;
+			backend.start(voice, 5.0f);
+		}
+		failures += check(!engineTaken && backend.isPlaying(engine), "a reserved voice is never taken over");
+		failures += check(pool.reserve(0) == NULL && pool.reserveFailures == 1, "nothing to reserve while every voice plays");
+		failures += check(pool.getPlaying(0) == 4, "the reserved voice counts as playing");
+
+		pool.release(engine);
+		failures += check(!backend.isPlaying(engine) && pool.acquire(0, 0.01f, 0.0f) == engine, "a released voice is stopped and handed out again");
+	}
+	failures += check(backend.destroyed == 6, "every voice destroyed with the pool");
+
+	return failures;
+}
+
+// The voice pool: the checks above, then a long fight through Sound's pool
+// (SFX_VOICES plus SFX_RESERVED_VOICES, eight engines and the rocket held),
+// with lasers, crashes and explosions going off all around faster than the
+// voices free up. Nothing is made or destroyed after startup, and the player's
+// own sounds always get a voice.
+int voices(int argc, char** argv)
+{
+	int seconds = argument(argc, argv, 2, 120);
+	int soundsPerTick = argument(argc, argv, 3, 2);
+	const int numVoices = 64 + 16;
+	const float tick = 1.0f / 60.0f;
+
+	int failures = checkVoicePool();
+
+	// Priority and length of the effects the fight plays, as Sound gives them
+	const float priorities[] = { 0.5f, 0.4f, 0.9f, 0.8f, 0.6f, 0.6f, 0.4f, 0.3f };
+	const float lengths[] = { 0.4f, 0.8f, 2.5f, 2.0f, 1.5f, 1.2f, 0.5f, 0.2f };
+	const int numEffects = sizeof(priorities) / sizeof(priorities[0]);
+
+	NullAudioBackend backend;
+	VoicePool pool(&backend, numVoices);
+	failures += check(pool.addVoices(0, numVoices), "Sound's voices made");
+
+	void* held[9];
+	for (int i = 0; i < 9; i++)
+	{
+		held[i] = pool.reserve(0);
+		backend.start(held[i], 1e9f);
+	}
+	failures += check(pool.reserveFailures == 0, "an engine voice for every racer and one for the rockets");
+
+	srand(585);
+	int created = backend.created, start = heapAllocations;
+	int playerSounds = 0, playerDropped = 0, mostPlaying = 0;
+	BenchTimer elapsed;
+	for (int t = 0; t < seconds * 60; t++)
+	{
+		elapsed.start();
+		for (int s = 0; s < soundsPerTick; s++)
+		{
+			int effect = rand() % numEffects;
+			void* voice = pool.acquire(0, priorities[effect], randomFloat(0.0f, 200.0f));
+			if (voice)
+			{
+				backend.start(voice, lengths[effect]);
+			}
+		}
+
+		// The player's gun, now and then
+		if (t % 20 == 0)
+		{
+			void* voice = pool.acquire(0, 1.0f, 0.0f);
+			playerSounds++;
+			if (voice)
+			{
+				backend.start(voice, 0.4f);
+			}
+			else
+			{
+				playerDropped++;
+			}
+		}
+		elapsed.stop();
+
+		mostPlaying = max(mostPlaying, pool.getPlaying(0));
+		backend.advance(tick);
+	}
+
+	int allocations = heapAllocations - start;
+
+	bool heldPlaying = true;
+	for (int i = 0; i < 9; i++)
+	{
+		heldPlaying = heldPlaying && backend.isPlaying(held[i]);
+	}
+
+	failures += check(backend.created == created && backend.destroyed == 0, "no voices made or destroyed during play");
+	failures += check(allocations == 0, "no heap allocations during play");
+	failures += check(heldPlaying, "engines and the rocket kept their voices");
+	failures += check(playerDropped == 0, "every one of the player's sounds played");
+
+	cout << seconds << " s at " << soundsPerTick * 60 << " sounds a second on " << numVoices << " voices: " << pool.acquired << " played, "
+		<< pool.steals << " took over another, " << pool.rejections << " dropped" << endl;
+	cout << "  at most " << mostPlaying << " playing, " << playerSounds << " player sounds, "
+		<< elapsed.microsecondsPer(pool.acquired) << " us per sound started" << endl;
+
+	return finish(failures);
+}
@@ -0,0 +1,214 @@
+#include <iostream>
+#include <vector>
+#include <list>
+#include <stdlib.h>
+#include <new>
+
+#include "FrameArena.h"
+#include "HandlePool.h"
+#include "NullBackend.h"
+#include "ParticleBudget.h"
+#include "ParticlePool.h"
+#include "RenderQueue.h"
+#include "TextBatch.h"
+#include "ToolsCommon.h"
+#include "TransformSnapshot.h"
+
+using namespace std;
+
+// Scratch containers on the arena: where their memory comes from, falling
+// back to the heap when it is full, and catching one that outlives its frame
+static int checkFrameAllocator()
+{
+	int failures = 0;
+	FrameArena* previous = FrameArena::arena;
+
+	{
+		FrameArena arena(1024);
+		{
+			vector<int, FrameAllocator<int> > numbers;
+			numbers.reserve(16);
+			for (int i = 0; i < 16; i++)
+			{
+				numbers.push_back(i);
+			}
+			failures += check(arena.contains(&numbers[0]) && arena.outstanding > 0, "a scratch vector lives in the arena");
+
+			list<int, FrameAllocator<int> > nodes;
+			for (int i = 0; i < 8; i++)
+			{
+				nodes.push_back(i);
+			}
+			failures += check(arena.contains(&nodes.front()), "so do a scratch list's nodes");
+
+			// Far more than fits: the rest comes from the heap, and is given back there
+			vector<int, FrameAllocator<int> > big(4096, 7);
+			failures += check(!arena.contains(&big[0]) && arena.heapFallbacks > 0 && big[4095] == 7, "too big for the arena comes from the heap");
+		}
+		failures += check(arena.outstanding == 0, "every block given back when the containers go");
+		arena.reset();
+		failures += check(arena.escapes == 0, "nothing escaped");
+
+#ifndef FRAME_ARENA_CHECKS
+		// Debug builds stop here instead
+		vector<int, FrameAllocator<int> >* escaped = new vector<int, FrameAllocator<int> >(4, 1);
+		arena.reset();
+		failures += check(arena.escapes == 1, "a container alive at the reset is caught");
+		delete escaped;
+		failures += check(arena.outstanding == 0, "and giving it back late doesn't hide the next one");
+#endif
+	}
+
+	FrameArena::arena = previous;
+	return failures;
+}
+
+// One steady-state frame of everything in a simulate and render tick that
+// doesn't need Havok or the device: the debug text, a scratch list, smoke and
+// its emitters under the budget, rockets through their pool, the transform
+// hand over and the render queue. After a few frames of warm-up none of it
+// should touch the heap.
+int frame(int argc, char** argv)
+{
+	int numFrames = argument(argc, argv, 2, 3000);
+	const int warmup = 60;
+	const float seconds = 1.0f / 60.0f;
+
+	int failures = checkFrameAllocator();
+
+	FrameArena arena(64 * 1024);
+
+	int widths[TEXT_CHAR_COUNT];
+	for (int c = 0; c < TEXT_CHAR_COUNT; c++)
+	{
+		widths[c] = 7;
+	}
+	TextBatch batch;
+	batch.packGlyphs(widths, 12);
+	const char* lines[48];
+
+	ParticlePool smoke(PARTICLE_BUDGET);
+	ParticleBudget budget(PARTICLE_BUDGET);
+	vector<BenchEmitter> trails(16);
+	for (unsigned int e = 0; e < trails.size(); e++)
+	{
+		trails[e].emitter.initialize(60.0f, 0, 0.0f, 0.5f);
+		trails[e].emitter.start();
+		trails[e].position[0] = trails[e].position[1] = trails[e].position[2] = 0.0f;
+	}
+	float viewer[3] = { 0.0f, 0.0f, 0.0f };
+	float rise[3] = { 0.0f, 1.0f, 0.0f };
+	float positions[PARTICLE_EMIT_MAX * 3];
+
+	HandlePool<BenchObject> rockets(128);
+	TransformSnapshot snapshot(256);
+	float transforms[256 * 16];
+	for (int i = 0; i < 256; i++)
+	{
+		randomMatrix(&transforms[i * 16]);
+	}
+	float result[16];
+
+	RenderQueue queue;
+	NullBackend backend;
+	static char textures[16], meshes[16];
+
+	srand(585);
+	int allocations = 0, fallbacksBefore = 0;
+	BenchTimer elapsed;
+	for (int f = 0; f < warmup + numFrames; f++)
+	{
+		if (f == warmup)
+		{
+			fallbacksBefore = arena.heapFallbacks;
+		}
+		int start = heapAllocations;
+		elapsed.start();
+
+		// Debug text
+		layOutLines(batch, lines, formatDebugLines(arena, lines, f));
+
+		// A scratch list, like the waypoints AI::simulate gathers, gone before the reset
+		{
+			vector<const char*, FrameAllocator<const char*> > passed;
+			for (int i = 0; i < 83; i++)
+			{
+				passed.push_back(lines[i % 40]);
+			}
+		}
+
+		// Smoke trails
+		budget.startTick(smoke.count, viewer);
+		for (unsigned int e = 0; e < trails.size(); e++)
+		{
+			trails[e].position[0] += 2.0f;
+			float scale = budget.throttle(trails[e].emitter.priority, trails[e].position);
+			int count = budget.take(trails[e].emitter.emit(seconds, scale, trails[e].position, positions, PARTICLE_EMIT_MAX));
+			for (int i = 0; i < count; i++)
+			{
+				smoke.spawn(&positions[i * 3], rise, 1.45f, 2.0f, 1.0f, 0xC8646488);
+			}
+		}
+		smoke.update(seconds);
+
+		// Rockets: a few fired, each lasting a while, released at the end of the frame
+		for (int i = 0; i < 2; i++)
+		{
+			unsigned int handle;
+			void* memory = rockets.allocate(handle);
+			if (memory)
+			{
+				new (memory) BenchObject(handle);
+				rockets.get(handle)->lifetime = 30 + rand() % 60;
+			}
+		}
+		for (int i = 0; i < rockets.count; i++)
+		{
+			rockets.at(i)->destroyed = --rockets.at(i)->lifetime <= 0;
+		}
+
+		// The tick's transforms, and a frame drawn from them
+		snapshot.begin();
+		for (int i = 0; i < 8 * 7 + rockets.count && i < 256; i++)
+		{
+			snapshot.add(NULL, &transforms[i * 16], &transforms[((i + 1) % 256) * 16]);
+		}
+		snapshot.publish(f + 1);
+		const SnapshotFrame* drawn = snapshot.acquire();
+		queue.clear();
+		for (int i = 0; drawn && i < drawn->count; i++)
+		{
+			TransformSnapshot::interpolate(drawn->entries[i].previous, drawn->entries[i].current, 0.5f, result);
+			queue.submit(RENDER_PASS_OPAQUE, RENDER_DRAW_MESH, &textures[i % 16], &meshes[i % 16], result, result[14]);
+		}
+		queue.sort();
+		queue.replay(&backend);
+
+		// End of the frame
+		for (int i = rockets.count - 1; i >= 0; i--)
+		{
+			if (rockets.at(i)->destroyed)
+			{
+				rockets.release(rockets.handleAt(i));
+			}
+		}
+		arena.reset();
+
+		elapsed.stop();
+		if (f >= warmup)
+		{
+			allocations += heapAllocations - start;
+		}
+	}
+
+	failures += check(allocations == 0, "no heap allocations in a steady-state frame");
+	failures += check(arena.heapFallbacks == fallbacksBefore && arena.overflows == 0, "the frame fits in the arena");
+	failures += check(arena.escapes == 0, "nothing outlives its frame");
+
+	cout << numFrames << " frames after " << warmup << " of warm-up: " << allocations << " heap allocations, "
+		<< elapsed.microsecondsPer(warmup + numFrames) << " us per frame" << endl;
+	cout << "  arena high water " << arena.highWater << " of " << arena.capacity << " bytes, " << smoke.count
+		<< " smoke particles, " << rockets.count << " rockets, " << backend.drawCalls << " draws replayed" << endl;
+
+	return finish(failures);
+}
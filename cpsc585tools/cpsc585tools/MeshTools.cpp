@@ -0,0 +1,1151 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "EdgeConnectivity.h"
+#include "FrustumCuller.h"
+#include "MeshFile.h"
+#include "MeshLod.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ToolsCommon.h"
+#include "VertexPacking.h"
+#include "WorldChunks.h"
+
+using namespace std;
+
+// Shared corners welded, triangle order for the post-transform cache and
+// overdraw, then vertices in the order they are fetched
+static void optimizeMesh(MeshOptimizer& optimizer, MeshFile& mesh, float overdrawThreshold)
+{
+	mesh.vertexCount = optimizer.weldVertices(mesh.vertices, sizeof(MeshFileVertex), mesh.vertexCount, mesh.indices, mesh.indexCount);
+	optimizer.optimizeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount);
+	if (overdrawThreshold > 0.0f)
+	{
+		optimizer.optimizeOverdraw(mesh.indices, mesh.indexCount, mesh.vertices[0].position,
+			sizeof(MeshFileVertex) / sizeof(float), mesh.vertexCount, overdrawThreshold);
+	}
+	optimizer.optimizeVertexFetch(mesh.vertices, sizeof(MeshFileVertex), mesh.vertexCount, mesh.indices, mesh.indexCount);
+}
+
+// Snaps positions and uvs to what they decode to once packed within the header's bounds.
+// Adjacency for a packed file has to come from these: quantizing can move two corners
+// into or out of weld distance, and the game welds what it loads, not what was exported.
+// Normals are left alone, since re-encoding a decoded normal can land one step over.
+static void quantizeVertices(MeshFile& mesh)
+{
+	VertexPacker packer;
+	packer.setBounds(mesh.header.aabbMin, mesh.header.aabbMax, mesh.header.uvMin, mesh.header.uvMax);
+
+	vector<PackedVertex> packed(mesh.vertexCount);
+	vector<MeshFileVertex> decoded(mesh.vertexCount);
+	packer.pack(mesh.vertices[0].position, sizeof(MeshFileVertex) / sizeof(float), mesh.vertexCount, &packed[0]);
+	packer.unpack(&packed[0], mesh.vertexCount, decoded[0].position, sizeof(MeshFileVertex) / sizeof(float));
+
+	for (int i = 0; i < mesh.vertexCount; i++)
+	{
+		memcpy(mesh.vertices[i].position, decoded[i].position, sizeof(decoded[i].position));
+		mesh.vertices[i].u = decoded[i].u;
+		mesh.vertices[i].v = decoded[i].v;
+	}
+}
+
+// Whether a loaded file's adjacency is what the game would build from the positions it decodes to
+static bool storedAdjacencyMatches(const MeshFile& mesh)
+{
+	if (!mesh.adjacency)
+	{
+		return false;
+	}
+
+	vector<unsigned int> rebuilt(mesh.indexCount);
+	EdgeConnectivity builder;
+	builder.build((const float*) mesh.vertices, sizeof(MeshFileVertex) / sizeof(float), mesh.vertexCount,
+		mesh.indices, mesh.indexCount, MESH_ADJACENCY_WELD, &rebuilt[0]);
+	return memcmp(&rebuilt[0], mesh.adjacency, sizeof(unsigned int) * mesh.indexCount) == 0;
+}
+
+int convert(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		cout << "Usage: cpsc585tools convert <input.ese> <output.mesh> [index32] [weldDistance] [packed]" << endl;
+		return 1;
+	}
+
+	MeshFile mesh;
+	if (!mesh.load(argv[2]))
+	{
+		cerr << "Could not read " << argv[2] << endl;
+		return 1;
+	}
+
+	bool index16 = !(argc > 4 && string(argv[4]) == "index32");
+	float weldDistance = argument(argc, argv, 5, MESH_ADJACENCY_WELD);
+	bool packed = argc > 6 && string(argv[6]) == "packed";
+
+	MeshOptimizer optimizer;
+	optimizeMesh(optimizer, mesh, MESH_OVERDRAW_THRESHOLD);
+
+	mesh.computeBounds();
+	if (packed)
+	{
+		quantizeVertices(mesh);
+	}
+	mesh.computeAdjacency(weldDistance);
+
+	if (!mesh.save(argv[3], index16, packed))
+	{
+		cerr << "Could not write " << argv[3] << endl;
+		return 1;
+	}
+
+	cout << argv[2] << " -> " << argv[3] << ": " << mesh.vertexCount << " vertices, "
+		<< mesh.indexCount << " indices (" << ((mesh.header.flags & MESH_FILE_INDEX16) ? 16 : 32) << " bit), "
+		<< mesh.header.fileSize << " bytes, radius " << mesh.header.sphereRadius << endl;
+
+	return 0;
+}
+
+// The loader Mesh used before v2: one 4 byte read per float and per index.
+// Returns how many indices it read.
+static int loadLegacyPerFloat(string filename)
+{
+	ifstream filestream(filename.c_str(), ifstream::binary);
+
+	int vertexCount, indexCount;
+	filestream.read((char*)&vertexCount, 4);
+	filestream.read((char*)&indexCount, 4);
+
+	MeshFileVertex* vertices = new MeshFileVertex[vertexCount];
+	unsigned int* indices = new unsigned int[indexCount];
+
+	for (int i = 0; i < vertexCount; i++)
+	{
+		filestream.read((char*)&vertices[i].position[0], 4);
+		filestream.read((char*)&vertices[i].position[1], 4);
+		filestream.read((char*)&vertices[i].position[2], 4);
+
+		filestream.read((char*)&vertices[i].normal[0], 4);
+		filestream.read((char*)&vertices[i].normal[1], 4);
+		filestream.read((char*)&vertices[i].normal[2], 4);
+
+		filestream.read((char*)&vertices[i].u, 4);
+		filestream.read((char*)&vertices[i].v, 4);
+	}
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		filestream.read((char*)&indices[i], 4);
+	}
+
+	filestream.close();
+
+	delete [] vertices;
+	delete [] indices;
+
+	return indexCount;
+}
+
+// Writes a damaged copy of a .mesh file and returns whether MeshFile still
+// loads it. offset is where in the file the 4-byte value goes.
+static bool loadsDamaged(const string& filename, unsigned int offset, unsigned int value)
+{
+	ifstream in(filename.c_str(), ifstream::binary);
+	vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	in.close();
+
+	memcpy(&data[offset], &value, 4);
+
+	string damaged = filename + ".damaged";
+	ofstream out(damaged.c_str(), ofstream::binary);
+	out.write(&data[0], data.size());
+	out.close();
+
+	MeshFile mesh;
+	bool loaded = mesh.load(damaged);
+	remove(damaged.c_str());
+
+	return loaded;
+}
+
+// Counts that only fit because count * size wraps around in 32 bits, and
+// adjacency entries that point past the last face, must both be refused
+static int checkDamagedMesh(const string& filename)
+{
+	MeshFile mesh;
+	if (!mesh.load(filename) || mesh.header.version != MESH_FILE_VERSION)
+	{
+		return 0;
+	}
+
+	int accepted = 0;
+	const MeshFileHeader& header = mesh.header;
+
+	unsigned int wrappingVertices = header.vertexCount + 0x80000000u / header.vertexStride * 2;
+	if (loadsDamaged(filename, offsetof(MeshFileHeader, vertexCount), wrappingVertices))
+	{
+		cout << "  " << filename << ": accepted a vertex count of " << wrappingVertices << endl;
+		accepted++;
+	}
+
+	if (!(header.flags & MESH_FILE_INDEX16))
+	{
+		// 3 * 2^30 keeps the count a multiple of 3 and wraps to the same size
+		unsigned int wrappingIndices = header.indexCount + 0xC0000000u;
+		if (loadsDamaged(filename, offsetof(MeshFileHeader, indexCount), wrappingIndices))
+		{
+			cout << "  " << filename << ": accepted an index count of " << wrappingIndices << endl;
+			accepted++;
+		}
+	}
+
+	if (header.flags & MESH_FILE_ADJACENCY)
+	{
+		if (loadsDamaged(filename, header.adjacencyOffset, header.indexCount / 3))
+		{
+			cout << "  " << filename << ": accepted an adjacent face past the last face" << endl;
+			accepted++;
+		}
+	}
+
+	return accepted;
+}
+
+int loadbench(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	int iterations = argument(argc, argv, 3, 20);
+
+	vector<string> files = listFiles(directory, ".ese");
+	if (files.empty())
+	{
+		cerr << "No .ese files in " << directory << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	double totalLegacy = 0.0, totalVersion2 = 0.0;
+
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		string ese = directory + "/" + files[i];
+		string converted = directory + "/" + files[i].substr(0, files[i].size() - 4) + ".mesh";
+
+		BenchTimer legacy;
+		int legacyIndices = 0;
+		legacy.start();
+		for (int it = 0; it < iterations; it++)
+		{
+			legacyIndices = loadLegacyPerFloat(ese);
+		}
+		legacy.stop();
+
+		MeshFile mesh;
+		if (!mesh.load(converted) || mesh.header.version != MESH_FILE_VERSION)
+		{
+			failures += check(false, files[i] + " has a v2 .mesh (run convert)");
+			continue;
+		}
+
+		BenchTimer version2;
+		version2.start();
+		for (int it = 0; it < iterations; it++)
+		{
+			mesh.load(converted);
+		}
+		version2.stop();
+
+		// Welding and reordering change the vertices but never the triangles
+		failures += check(mesh.indexCount == legacyIndices, files[i] + " and its .mesh have the same triangles");
+
+		cout << files[i] << ": per-float " << legacy.milliseconds() / iterations << " ms, v2 " << version2.milliseconds() / iterations << " ms" << endl;
+
+		totalLegacy += legacy.milliseconds() / iterations;
+		totalVersion2 += version2.milliseconds() / iterations;
+	}
+
+	cout << "Total: per-float " << totalLegacy << " ms, v2 " << totalVersion2 << " ms" << endl;
+
+	int accepted = 0;
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		accepted += checkDamagedMesh(directory + "/" + files[i].substr(0, files[i].size() - 4) + ".mesh");
+	}
+	failures += check(accepted == 0, "damaged files are refused");
+
+	return finish(failures);
+}
+
+static bool samePosition(const MeshFileVertex& a, const MeshFileVertex& b)
+{
+	return a.position[0] == b.position[0] && a.position[1] == b.position[1] && a.position[2] == b.position[2];
+}
+
+// Two corners in the same place
+static bool degenerateFace(const MeshFile& mesh, unsigned int face)
+{
+	const MeshFileVertex& c0 = mesh.vertices[mesh.indices[face * 3]];
+	const MeshFileVertex& c1 = mesh.vertices[mesh.indices[face * 3 + 1]];
+	const MeshFileVertex& c2 = mesh.vertices[mesh.indices[face * 3 + 2]];
+	return samePosition(c0, c1) || samePosition(c1, c2) || samePosition(c2, c0);
+}
+
+// The table Drawable used to build: every face against every other face.
+// Open edges are left at 0.
+static void legacyConnectivity(const MeshFile& mesh, unsigned int* table)
+{
+	int numFaces = mesh.indexCount / 3;
+	const MeshFileVertex* vertices = mesh.vertices;
+	const unsigned int* indices = mesh.indices;
+
+	memset(table, 0, sizeof(unsigned int) * numFaces * 3);
+
+	for (int i = 0; i < numFaces; i++)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			// Searching for (b, a) for the edge (a, b)
+			const MeshFileVertex& a = vertices[indices[i * 3 + e]];
+			const MeshFileVertex& b = vertices[indices[i * 3 + (e + 1) % 3]];
+
+			for (int j = 0; j < numFaces; j++)
+			{
+				if (j == i)
+				{
+					continue;
+				}
+
+				const MeshFileVertex& c0 = vertices[indices[j * 3]];
+				const MeshFileVertex& c1 = vertices[indices[j * 3 + 1]];
+				const MeshFileVertex& c2 = vertices[indices[j * 3 + 2]];
+
+				if (samePosition(c0, b))
+				{
+					if (samePosition(c1, a))
+					{
+						table[i * 3 + e] = j;
+						break;
+					}
+				}
+				else if (samePosition(c1, b))
+				{
+					if (samePosition(c2, a))
+					{
+						table[i * 3 + e] = j;
+						break;
+					}
+				}
+				else if (samePosition(c2, b))
+				{
+					if (samePosition(c0, a))
+					{
+						table[i * 3 + e] = j;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Checks the hashed builder (and the adjacency stored in each .mesh) against
+// the old pairwise search, and times both
+int connectivity(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	float weldDistance = argument(argc, argv, 3, MESH_ADJACENCY_WELD);
+
+	vector<string> files = listFiles(directory, ".mesh");
+	if (files.empty())
+	{
+		cerr << "No .mesh files in " << directory << endl;
+		return 1;
+	}
+
+	int failures = 0;
+
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		MeshFile mesh;
+		if (!mesh.load(directory + "/" + files[i]))
+		{
+			cerr << "Could not read " << files[i] << endl;
+			failures++;
+			continue;
+		}
+
+		vector<unsigned int> legacy(mesh.indexCount), hashed(mesh.indexCount);
+
+		BenchTimer legacyTime;
+		legacyTime.start();
+		legacyConnectivity(mesh, &legacy[0]);
+		legacyTime.stop();
+
+		EdgeConnectivity builder;
+		BenchTimer hashedTime;
+		hashedTime.start();
+		builder.build((const float*) mesh.vertices, sizeof(MeshFileVertex) / sizeof(float), mesh.vertexCount,
+			mesh.indices, mesh.indexCount, weldDistance, &hashed[0]);
+		hashedTime.stop();
+
+		// The old table can't tell an open edge from a neighbour of face 0. Its
+		// else-if chain also stops at the first corner matching b, so it can miss
+		// (or pick a later) neighbour when a degenerate face is involved; those are
+		// counted separately.
+		int mismatches = 0, degenerateMismatches = 0, storedMismatches = 0;
+		for (int k = 0; k < mesh.indexCount; k++)
+		{
+			unsigned int expected = hashed[k] == EDGE_NO_NEIGHBOUR ? 0 : hashed[k];
+			if (legacy[k] != expected)
+			{
+				if (degenerateFace(mesh, k / 3) || degenerateFace(mesh, legacy[k]) || degenerateFace(mesh, expected))
+				{
+					degenerateMismatches++;
+				}
+				else
+				{
+					mismatches++;
+				}
+			}
+			if (mesh.adjacency && mesh.adjacency[k] != hashed[k])
+			{
+				storedMismatches++;
+			}
+		}
+
+		cout << files[i] << ": " << mesh.indexCount / 3 << " faces, " << builder.weldedVertexCount << " welded vertices, "
+			<< builder.openEdgeCount << " open edges, pairwise " << legacyTime.milliseconds() << " ms, hashed "
+			<< hashedTime.milliseconds() << " ms, " << mismatches << " mismatches (" << degenerateMismatches << " on degenerate faces)";
+		if (mesh.adjacency)
+		{
+			cout << ", " << storedMismatches << " differ from the stored table";
+		}
+		else
+		{
+			cout << ", no stored table";
+		}
+		cout << endl;
+
+		failures += check(mismatches == 0, files[i] + " matches the pairwise search");
+		failures += check(storedMismatches == 0, files[i] + " stores the table the game would build");
+	}
+
+	return finish(failures);
+}
+
+// Every corner of every face, as a sorted list of position triples, so
+// reordering can be checked for losing, adding or flipping a triangle
+static void faceSignature(const MeshFile& mesh, vector<float>& signature)
+{
+	int faceCount = mesh.indexCount / 3;
+	vector< vector<float> > faces(faceCount);
+
+	for (int f = 0; f < faceCount; f++)
+	{
+		// Rotate the corners so the lowest position comes first, keeping the winding
+		const float* corners[3];
+		for (int k = 0; k < 3; k++)
+		{
+			corners[k] = mesh.vertices[mesh.indices[f * 3 + k]].position;
+		}
+
+		int first = 0;
+		for (int k = 1; k < 3; k++)
+		{
+			if (lexicographical_compare(corners[k], corners[k] + 3, corners[first], corners[first] + 3))
+			{
+				first = k;
+			}
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			const MeshFileVertex& v = mesh.vertices[mesh.indices[f * 3 + (first + k) % 3]];
+			faces[f].insert(faces[f].end(), v.position, v.position + 3);
+			faces[f].insert(faces[f].end(), v.normal, v.normal + 3);
+			faces[f].push_back(v.u);
+			faces[f].push_back(v.v);
+		}
+	}
+
+	sort(faces.begin(), faces.end());
+
+	signature.clear();
+	for (int f = 0; f < faceCount; f++)
+	{
+		signature.insert(signature.end(), faces[f].begin(), faces[f].end());
+	}
+}
+
+int optimize(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	int cacheSize = argument(argc, argv, 3, MESH_ANALYZE_CACHE_SIZE);
+	float overdrawThreshold = argument(argc, argv, 4, MESH_OVERDRAW_THRESHOLD);
+
+	vector<string> files = listFiles(directory, ".ese");
+	if (files.empty())
+	{
+		cerr << "No .ese files in " << directory << endl;
+		return 1;
+	}
+
+	MeshOptimizer optimizer;
+	int failures = 0;
+	int totalTriangles = 0, totalBefore = 0, totalAfter = 0;
+
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		string ese = directory + "/" + files[i];
+		string converted = directory + "/" + files[i].substr(0, files[i].size() - 4) + ".mesh";
+
+		MeshFile mesh;
+		if (!mesh.load(ese))
+		{
+			cerr << "Could not read " << ese << endl;
+			failures++;
+			continue;
+		}
+
+		vector<float> before, after;
+		faceSignature(mesh, before);
+
+		optimizer.analyzeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount, cacheSize);
+		float acmrBefore = optimizer.acmr, atvrBefore = optimizer.atvr;
+		int transformedBefore = optimizer.transformedCount;
+		int vertexCount = mesh.vertexCount;
+
+		BenchTimer elapsed;
+		elapsed.start();
+		optimizeMesh(optimizer, mesh, overdrawThreshold);
+		elapsed.stop();
+
+		optimizer.analyzeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount, cacheSize);
+
+		bool inRange = true;
+		for (int j = 0; j < mesh.indexCount; j++)
+		{
+			inRange = inRange && mesh.indices[j] < (unsigned int) mesh.vertexCount;
+		}
+		failures += check(inRange, files[i] + ": indices in range");
+
+		faceSignature(mesh, after);
+		failures += check(before == after, files[i] + ": same triangles, same winding");
+
+		// Vertices should now come in the order they are first used
+		bool fetchOrder = true;
+		unsigned int nextNew = 0;
+		for (int j = 0; j < mesh.indexCount && fetchOrder; j++)
+		{
+			fetchOrder = mesh.indices[j] <= nextNew;
+			if (mesh.indices[j] == nextNew)
+			{
+				nextNew++;
+			}
+		}
+		failures += check(fetchOrder, files[i] + ": vertices in first use order");
+
+		// A chunked mesh is ordered chunk by chunk and only chunks writes it, along with its .chunks
+		string chunkFile = directory + "/" + files[i].substr(0, files[i].size() - 4) + ".chunks";
+		bool chunked = ifstream(chunkFile.c_str()).good();
+
+		// Otherwise written back the way it was stored, 16 bit and packed by default
+		MeshFile existing;
+		bool index16 = true, packed = true;
+		if (existing.load(converted))
+		{
+			index16 = (existing.header.flags & MESH_FILE_INDEX16) != 0;
+			packed = (existing.header.flags & MESH_FILE_PACKED) != 0;
+		}
+
+		mesh.computeBounds();
+		if (packed)
+		{
+			quantizeVertices(mesh);
+		}
+		mesh.computeAdjacency(MESH_ADJACENCY_WELD);
+		if (chunked)
+		{
+			cout << converted << " left to chunks" << endl;
+		}
+		else if (!mesh.save(converted, index16, packed))
+		{
+			cerr << "Could not write " << converted << endl;
+			failures++;
+		}
+
+		cout << files[i] << ": " << mesh.indexCount / 3 << " triangles, " << vertexCount << " -> " << mesh.vertexCount << " vertices, ACMR " << acmrBefore << " -> " << optimizer.acmr
+			<< ", ATVR " << atvrBefore << " -> " << optimizer.atvr << ", " << optimizer.clusterCount << " overdraw clusters, "
+			<< elapsed.milliseconds() << " ms" << endl;
+
+		totalTriangles += mesh.indexCount / 3;
+		totalBefore += transformedBefore;
+		totalAfter += optimizer.transformedCount;
+	}
+
+	if (totalTriangles > 0)
+	{
+		cout << "Total: " << totalBefore << " -> " << totalAfter << " vertices transformed (" << cacheSize
+			<< " entry FIFO), ACMR " << (float) totalBefore / totalTriangles << " -> " << (float) totalAfter / totalTriangles << endl;
+	}
+	return finish(failures);
+}
+
+int pack(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+
+	vector<string> files = listFiles(directory, ".mesh");
+	if (files.empty())
+	{
+		cerr << "No .mesh files in " << directory << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	int totalBefore = 0, totalAfter = 0;
+
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		string filename = directory + "/" + files[i];
+
+		MeshFile mesh;
+		if (!mesh.load(filename))
+		{
+			cerr << "Could not read " << filename << endl;
+			failures++;
+			continue;
+		}
+
+		if (mesh.packedVertices)
+		{
+			// Saving again would re-encode the decoded normals, which can move them a step,
+			// so a stale table is left for whatever wrote the file (convert, lod or chunks)
+			if (mesh.adjacency)
+			{
+				failures += check(storedAdjacencyMatches(mesh), files[i] + ": adjacency matches the packed positions");
+			}
+			cout << files[i] << ": already packed" << endl;
+			continue;
+		}
+
+		// Bounds straight from the vertices, in case the header's are stale
+		mesh.computeBounds();
+
+		VertexPacker packer;
+		packer.setBounds(mesh.header.aabbMin, mesh.header.aabbMax, mesh.header.uvMin, mesh.header.uvMax);
+
+		vector<PackedVertex> packed(mesh.vertexCount);
+		vector<MeshFileVertex> decoded(mesh.vertexCount);
+		packer.pack(mesh.vertices[0].position, sizeof(MeshFileVertex) / sizeof(float), mesh.vertexCount, &packed[0]);
+		packer.unpack(&packed[0], mesh.vertexCount, decoded[0].position, sizeof(MeshFileVertex) / sizeof(float));
+
+		// Every position and uv within half a step (plus float rounding) of where it was
+		float positionError = 0.0f, uvError = 0.0f, normalError = 0.0f;
+		bool positionsOK = true, uvsOK = true;
+		int unnormalized = 0;
+		for (int v = 0; v < mesh.vertexCount; v++)
+		{
+			const MeshFileVertex& original = mesh.vertices[v];
+			for (int k = 0; k < 3; k++)
+			{
+				float error = fabs(decoded[v].position[k] - original.position[k]);
+				positionError = max(positionError, error);
+				positionsOK = positionsOK && error <= packer.positionTolerance[k] * 1.001f + fabs(original.position[k]) * 1e-6f;
+			}
+
+			float uv[2] = { original.u, original.v };
+			float decodedUV[2] = { decoded[v].u, decoded[v].v };
+			for (int k = 0; k < 2; k++)
+			{
+				float error = fabs(decodedUV[k] - uv[k]);
+				uvError = max(uvError, error);
+				uvsOK = uvsOK && error <= packer.uvTolerance[k] * 1.001f + fabs(uv[k]) * 1e-6f;
+			}
+
+			// A few exported normals are near zero; those only keep their direction
+			const float* n = original.normal;
+			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (fabs(length - 1.0f) > 0.01f)
+			{
+				unnormalized++;
+			}
+			else
+			{
+				// acos loses everything this small in float; the cross product keeps it
+				const float* d = decoded[v].normal;
+				double cross[3] = { (double) n[1] * d[2] - (double) n[2] * d[1], (double) n[2] * d[0] - (double) n[0] * d[2],
+					(double) n[0] * d[1] - (double) n[1] * d[0] };
+				double dot = (double) n[0] * d[0] + (double) n[1] * d[1] + (double) n[2] * d[2];
+				double angle = atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot);
+				normalError = max(normalError, (float) (angle * 180.0 / 3.14159265358979));
+			}
+		}
+
+		failures += check(positionsOK, files[i] + ": positions within half a step");
+		failures += check(uvsOK, files[i] + ": uvs within half a step");
+		failures += check(normalError < 0.01f, files[i] + ": normals within 0.01 degrees");
+		if (!positionsOK || !uvsOK || normalError >= 0.01f)
+		{
+			continue;
+		}
+
+		// The file must decode to exactly what was checked, adjacency included
+		quantizeVertices(mesh);
+		mesh.computeAdjacency(MESH_ADJACENCY_WELD);
+
+		int before = mesh.header.fileSize;
+		bool index16 = (mesh.header.flags & MESH_FILE_INDEX16) != 0;
+		if (!mesh.save(filename, index16, true))
+		{
+			cerr << "Could not write " << filename << endl;
+			failures++;
+			continue;
+		}
+
+		MeshFile reloaded;
+		bool same = reloaded.load(filename) && reloaded.packedVertices && reloaded.vertexCount == mesh.vertexCount &&
+			memcmp(reloaded.packedVertices, &packed[0], sizeof(PackedVertex) * mesh.vertexCount) == 0 &&
+			memcmp(reloaded.vertices, &decoded[0], sizeof(MeshFileVertex) * mesh.vertexCount) == 0;
+		failures += check(same, files[i] + ": reloads as checked");
+		failures += check(same && storedAdjacencyMatches(reloaded), files[i] + ": adjacency matches the packed positions");
+
+		cout << files[i] << ": " << mesh.vertexCount << " vertices, " << before << " -> " << reloaded.header.fileSize
+			<< " bytes, largest error position " << positionError << " (step " << packer.positionTolerance[0] * 2.0f << ", "
+			<< packer.positionTolerance[1] * 2.0f << ", " << packer.positionTolerance[2] * 2.0f << "), uv " << uvError
+			<< ", normal " << normalError << " degrees";
+		if (unnormalized > 0)
+		{
+			cout << " (" << unnormalized << " normals not unit length)";
+		}
+		cout << endl;
+
+		totalBefore += before;
+		totalAfter += reloaded.header.fileSize;
+	}
+
+	cout << "Total: " << totalBefore << " -> " << totalAfter << " bytes" << endl;
+
+	return finish(failures);
+}
+
+// Models that get simplified levels: the ones there are several of, or that are seen from far off
+static const char* lodMeshes[] = { "racer", "frontTire", "rearTire", "gunmount", "gun", "rocket", "landmine" };
+static const float lodRatios[LOD_MAX_LEVELS] = { 1.0f, 0.5f, 0.25f, 0.125f };	// Of the full mesh's triangles
+
+// The coarsest level whose error is under the limit, with nothing to stop it going back and forth
+static int selectLodWithoutHysteresis(const float* errors, int levelCount, float screenSize)
+{
+	for (int level = levelCount - 1; level > 0; level--)
+	{
+		if (errors[level] * screenSize <= LOD_PIXEL_ERROR)
+		{
+			return level;
+		}
+	}
+	return 0;
+}
+
+int lod(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	float maxError = argument(argc, argv, 3, 0.1f);	// Fraction of the bounding radius
+
+	MeshOptimizer optimizer;
+	MeshSimplifier simplifier;
+	int failures = 0;
+
+	for (unsigned int m = 0; m < sizeof(lodMeshes) / sizeof(lodMeshes[0]); m++)
+	{
+		string name = lodMeshes[m];
+		string ese = directory + "/" + name + ".ese";
+
+		MeshFile mesh;
+		if (!mesh.load(ese))
+		{
+			cerr << "Could not read " << ese << endl;
+			failures++;
+			continue;
+		}
+
+		// The same welded, reordered mesh convert writes as level 0
+		optimizeMesh(optimizer, mesh, MESH_OVERDRAW_THRESHOLD);
+		mesh.computeBounds();
+		float radius = mesh.header.sphereRadius;
+		const float* positions = mesh.vertices[0].position;
+		int stride = sizeof(MeshFileVertex) / sizeof(float);
+
+		cout << name << ": " << mesh.indexCount / 3 << " triangles, " << mesh.vertexCount << " vertices, radius " << radius << endl;
+
+		vector<unsigned int> original(mesh.indices, mesh.indices + mesh.indexCount);
+		vector<unsigned int> previous = original;
+		float previousError = 0.0f;
+		int level = 1;
+
+		for (; level < LOD_MAX_LEVELS; level++)
+		{
+			int target = (int) (original.size() / 3 * lodRatios[level]) * 3;
+
+			// Each level is simplified from the one before, so they nest
+			vector<unsigned int> simplified(previous.size());
+			BenchTimer elapsed;
+			elapsed.start();
+			int count = simplifier.simplify(&simplified[0], &previous[0], previous.size(), positions, stride,
+				mesh.vertexCount, target, maxError * radius);
+			elapsed.stop();
+			simplified.resize(count);
+
+			// Not worth a level of its own
+			if (count > (int) previous.size() * 4 / 5)
+			{
+				cout << "  lod" << level << ": only " << previous.size() / 3 << " -> " << count / 3
+					<< " triangles within the error limit, no more levels" << endl;
+				break;
+			}
+
+			bool inRange = true, collapsed = false;
+			for (int i = 0; i < count; i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					inRange = inRange && simplified[i + k] < (unsigned int) mesh.vertexCount;
+				}
+				const float* a = &positions[simplified[i] * stride];
+				const float* b = &positions[simplified[i + 1] * stride];
+				const float* c = &positions[simplified[i + 2] * stride];
+				collapsed = collapsed || memcmp(a, b, 12) == 0 || memcmp(b, c, 12) == 0 || memcmp(c, a, 12) == 0;
+			}
+			failures += check(inRange, name + ": indices in range");
+			failures += check(!collapsed, name + ": no zero area faces left behind");
+
+			// Selection assumes each level is at least as far off as the one before
+			float error = simplifier.measureError(positions, stride, &original[0], original.size(), &simplified[0], count);
+			error = max(error, previousError);
+
+			// Compact the level into a file of its own, ordered like the others
+			MeshFile lodMesh;
+			lodMesh.vertexCount = mesh.vertexCount;
+			lodMesh.indexCount = count;
+			lodMesh.vertices = new MeshFileVertex[mesh.vertexCount];
+			lodMesh.indices = new unsigned int[count];
+			memcpy(lodMesh.vertices, mesh.vertices, sizeof(MeshFileVertex) * mesh.vertexCount);
+			memcpy(lodMesh.indices, &simplified[0], sizeof(unsigned int) * count);
+
+			optimizer.optimizeVertexCache(lodMesh.indices, lodMesh.indexCount, lodMesh.vertexCount);
+			optimizer.optimizeOverdraw(lodMesh.indices, lodMesh.indexCount, lodMesh.vertices[0].position, stride,
+				lodMesh.vertexCount, MESH_OVERDRAW_THRESHOLD);
+			lodMesh.vertexCount = optimizer.optimizeVertexFetch(lodMesh.vertices, sizeof(MeshFileVertex), lodMesh.vertexCount,
+				lodMesh.indices, lodMesh.indexCount);
+
+			lodMesh.computeBounds();
+			quantizeVertices(lodMesh);
+			lodMesh.computeAdjacency(MESH_ADJACENCY_WELD);
+			lodMesh.header.lodError = error;
+
+			char suffix[32];		// Room for any int, so -Wformat-overflow has nothing to say
+			sprintf(suffix, "_lod%d.mesh", level);
+			string filename = directory + "/" + name + suffix;
+			if (!lodMesh.save(filename, true, true))
+			{
+				cerr << "Could not write " << filename << endl;
+				failures++;
+				break;
+			}
+
+			MeshFile reloaded;
+			failures += check(reloaded.load(filename) && reloaded.indexCount == count && reloaded.header.lodError == error,
+				name + suffix + ": reloads with its error");
+			failures += check(storedAdjacencyMatches(reloaded), name + suffix + ": adjacency matches the packed positions");
+
+			cout << "  lod" << level << ": " << count / 3 << " triangles (" << 100 * count / (int) original.size() << "%), "
+				<< lodMesh.vertexCount << " vertices, error " << error << " (" << 100.0f * error / radius << "% of radius, quadric "
+				<< simplifier.resultError << "), drawn below " << LOD_PIXEL_ERROR * radius / error << " pixels, "
+				<< simplifier.passCount << " passes, " << elapsed.milliseconds() << " ms" << endl;
+
+			previous = simplified;
+			previousError = error;
+		}
+
+		// Levels from an earlier run that weren't made this time
+		for (; level < LOD_MAX_LEVELS; level++)
+		{
+			char suffix[32];
+			sprintf(suffix, "_lod%d.mesh", level);
+			remove((directory + "/" + name + suffix).c_str());
+		}
+	}
+
+	// A speck drifting away with a shaky camera: the screen size falls from
+	// 400 to 2 pixels, jittering 5% frame to frame
+	float errors[LOD_MAX_LEVELS] = { 0.0f, 0.01f, 0.03f, 0.1f };
+	int current = 0, naive = 0;
+	int switches = 0, naiveSwitches = 0;
+	bool ordered = true;
+	int frames = 2000;
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		float size = 400.0f * powf(2.0f / 400.0f, frame / (float) (frames - 1)) * (1.0f + 0.05f * sinf(frame * 2.3f));
+
+		int next = selectLod(errors, LOD_MAX_LEVELS, size, current);
+		int nextNaive = selectLodWithoutHysteresis(errors, LOD_MAX_LEVELS, size);
+
+		ordered = ordered && next >= current;
+		switches += next != current ? 1 : 0;
+		naiveSwitches += nextNaive != naive ? 1 : 0;
+		current = next;
+		naive = nextNaive;
+	}
+
+	failures += check(ordered && current == LOD_MAX_LEVELS - 1, "selection only ever gets coarser as the speck leaves");
+	failures += check(switches == LOD_MAX_LEVELS - 1, "one switch per level with hysteresis");
+	failures += check(selectLod(errors, LOD_MAX_LEVELS, 1000.0f, LOD_MAX_LEVELS - 1) == 0, "close up gets the full mesh");
+	cout << "Level switches over " << frames << " frames: " << naiveSwitches << " without hysteresis, " << switches << " with" << endl;
+
+	return finish(failures);
+}
+
+static bool boxContains(const float* aabbMin, const float* aabbMax, const float* point)
+{
+	return point[0] >= aabbMin[0] && point[1] >= aabbMin[1] && point[2] >= aabbMin[2] &&
+		point[0] <= aabbMax[0] && point[1] <= aabbMax[1] && point[2] <= aabbMax[2];
+}
+
+// Splits the track into chunks, rewrites models/world.mesh in chunk order with
+// models/world.chunks next to it, then replays a camera path (see cameraPath)
+// counting the triangles submitted with the whole mesh in one draw against
+// only the chunks the hierarchy lets through.
+int chunks(int argc, char** argv)
+{
+	int maxTriangles = argument(argc, argv, 2, WORLD_CHUNK_TRIANGLES);
+	string trackFile = argument(argc, argv, 3, "RaceTrack.txt");
+	string pathFile = argument(argc, argv, 4, "");
+	int iterations = 200;
+
+	vector<float> waypoints, path;
+	if (!cameraPath(trackFile, pathFile, waypoints, path))
+	{
+		return 1;
+	}
+	int numFrames = path.size() / 6;
+
+	MeshFile world;
+	if (!world.load("models/world.ese"))
+	{
+		cerr << "Could not read models/world.ese" << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	int stride = sizeof(MeshFileVertex) / sizeof(float);
+	MeshOptimizer optimizer;
+	WorldChunks chunker;
+
+	world.vertexCount = optimizer.weldVertices(world.vertices, sizeof(MeshFileVertex), world.vertexCount, world.indices, world.indexCount);
+	vector<float> before, after;
+	faceSignature(world, before);
+
+	// Chunks first, then each chunk ordered for the vertex cache and overdraw on
+	// its own, so the triangles stay in their chunks
+	chunker.build(world.vertices[0].position, stride, world.indices, world.indexCount, maxTriangles);
+	for (unsigned int c = 0; c < chunker.chunks.size(); c++)
+	{
+		unsigned int* chunkIndices = world.indices + chunker.chunks[c].firstIndex;
+		int count = chunker.chunks[c].indexCount;
+		optimizer.optimizeVertexCache(chunkIndices, count, world.vertexCount);
+		optimizer.optimizeOverdraw(chunkIndices, count, world.vertices[0].position, stride, world.vertexCount, MESH_OVERDRAW_THRESHOLD);
+	}
+	world.vertexCount = optimizer.optimizeVertexFetch(world.vertices, sizeof(MeshFileVertex), world.vertexCount, world.indices, world.indexCount);
+	chunker.computeRanges(world.indices);
+
+	faceSignature(world, after);
+	failures += check(before == after, "same triangles, same winding");
+
+	bool contiguous = true, bounded = true, ranged = true, small = true;
+	unsigned int nextIndex = 0;
+	for (unsigned int c = 0; c < chunker.chunks.size(); c++)
+	{
+		const WorldChunk& chunk = chunker.chunks[c];
+		contiguous = contiguous && chunk.firstIndex == nextIndex;
+		small = small && (int) chunk.indexCount <= maxTriangles * 3;
+		nextIndex = chunk.firstIndex + chunk.indexCount;
+
+		for (unsigned int i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; i++)
+		{
+			unsigned int index = world.indices[i];
+			bounded = bounded && boxContains(chunk.aabbMin, chunk.aabbMax, world.vertices[index].position);
+			ranged = ranged && index >= chunk.minVertex && index < chunk.minVertex + chunk.vertexCount;
+		}
+	}
+	failures += check(contiguous && nextIndex == (unsigned int) world.indexCount, "chunks cover the index buffer in order");
+	failures += check(small, "no chunk over the triangle limit");
+	failures += check(bounded, "chunk boxes hold their triangles");
+	failures += check(ranged, "chunk vertex ranges hold their indices");
+
+	bool nested = true;
+	for (unsigned int n = 0; n < chunker.nodes.size(); n++)
+	{
+		const WorldChunkNode& node = chunker.nodes[n];
+		if (node.chunk >= 0)
+		{
+			nested = nested && memcmp(node.aabbMin, chunker.chunks[node.chunk].aabbMin, sizeof(node.aabbMin)) == 0 &&
+				memcmp(node.aabbMax, chunker.chunks[node.chunk].aabbMax, sizeof(node.aabbMax)) == 0;
+			continue;
+		}
+
+		for (int side = 0; side < 2; side++)
+		{
+			const WorldChunkNode& child = chunker.nodes[side == 0 ? node.left : node.right];
+			nested = nested && boxContains(node.aabbMin, node.aabbMax, child.aabbMin) && boxContains(node.aabbMin, node.aabbMax, child.aabbMax);
+		}
+	}
+	failures += check(nested, "node boxes hold their children");
+
+	world.computeBounds();
+	quantizeVertices(world);
+	world.computeAdjacency(MESH_ADJACENCY_WELD);
+	if (!world.save("models/world.mesh", true, true) || !chunker.save("models/world.chunks"))
+	{
+		cerr << "Could not write models/world.mesh and models/world.chunks" << endl;
+		return 1;
+	}
+
+	MeshFile reloadedWorld;
+	WorldChunks reloaded;
+	failures += check(reloadedWorld.load("models/world.mesh") && reloaded.load("models/world.chunks") &&
+		reloaded.indexCount == reloadedWorld.indexCount && reloaded.chunks.size() == chunker.chunks.size() &&
+		reloaded.nodes.size() == chunker.nodes.size(), "world.mesh and world.chunks reload and match");
+	failures += check(storedAdjacencyMatches(reloadedWorld), "world.mesh adjacency matches the packed positions");
+
+	cout << "models/world.ese: " << world.indexCount / 3 << " triangles, " << world.vertexCount << " vertices, "
+		<< chunker.chunks.size() << " chunks of at most " << maxTriangles << " triangles, " << chunker.nodes.size() << " nodes" << endl;
+
+	// Projection as Renderer::initialize sets it up, for a 16:9 screen
+	float projection[16];
+	perspectiveFovLH(3.14159265f / 2.5f, 16.0f / 9.0f, 1.0f, 1200.0f, projection);
+
+	FrustumCuller culler;
+	vector<unsigned char> chunkVisible(chunker.chunks.size());
+	long long wholeTriangles = 0, chunkedTriangles = 0, totalRuns = 0, totalChunks = 0, treeTests = 0, flatTests = 0;
+	BenchTimer treeTime, flatTime;
+
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		float eye[3], viewProjection[16];
+		followCamera(&path[frame * 6], &path[frame * 6 + 3], projection, eye, viewProjection);
+		culler.setViewProjection(viewProjection);
+		culler.setDistanceLimit(eye, 0.0f);
+
+		// What the renderer does now: the world's sphere is always on screen, so all of it is drawn
+		unsigned char wholeVisible;
+		culler.cull(&world.header.sphereCenter[0], &world.header.sphereCenter[1], &world.header.sphereCenter[2],
+			&world.header.sphereRadius, 1, &wholeVisible);
+		wholeTriangles += wholeVisible ? world.indexCount / 3 : 0;
+
+		flatTime.start();
+		for (int it = 0; it < iterations; it++)
+		{
+			chunker.cullChunks(culler.planes);
+		}
+		flatTime.stop();
+		vector<WorldChunkRun> flatRuns = chunker.visibleRuns;
+		int flatTriangles = chunker.visibleTriangles;
+		flatTests += chunker.boxTests;
+
+		treeTime.start();
+		int visibleChunks = 0;
+		for (int it = 0; it < iterations; it++)
+		{
+			visibleChunks = chunker.cull(culler.planes);
+		}
+		treeTime.stop();
+		treeTests += chunker.boxTests;
+
+		bool same = flatTriangles == chunker.visibleTriangles && flatRuns.size() == chunker.visibleRuns.size();
+		for (unsigned int r = 0; r < flatRuns.size() && same; r++)
+		{
+			same = memcmp(&flatRuns[r], &chunker.visibleRuns[r], sizeof(WorldChunkRun)) == 0;
+		}
+		if (!same)
+		{
+			cerr << "Frame " << frame << ": the hierarchy and the flat test disagree" << endl;
+			failures++;
+		}
+
+		chunkedTriangles += chunker.visibleTriangles;
+		totalRuns += chunker.visibleRuns.size();
+		totalChunks += visibleChunks;
+
+		// Nothing culled may reach the screen: no corner of a dropped triangle is inside the clip volume
+		for (unsigned int c = 0; c < chunker.chunks.size(); c++)
+		{
+			chunkVisible[c] = 0;
+			for (unsigned int r = 0; r < chunker.visibleRuns.size(); r++)
+			{
+				const WorldChunkRun& run = chunker.visibleRuns[r];
+				if (chunker.chunks[c].firstIndex >= run.firstIndex && chunker.chunks[c].firstIndex < run.firstIndex + run.indexCount)
+				{
+					chunkVisible[c] = 1;
+				}
+			}
+
+			if (chunkVisible[c])
+			{
+				continue;
+			}
+
+			const WorldChunk& chunk = chunker.chunks[c];
+			for (unsigned int i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; i++)
+			{
+				const float* p = world.vertices[world.indices[i]].position;
+				if (!outsideClip(viewProjection, p[0], p[1], p[2]))
+				{
+					cerr << "Frame " << frame << ": chunk " << c << " was culled but can be seen" << endl;
+					failures++;
+					break;
+				}
+			}
+		}
+	}
+
+	cout << numFrames << " camera positions" << endl;
+	cout << "  triangles submitted per frame: whole mesh " << (double) wholeTriangles / numFrames << ", chunked "
+		<< (double) chunkedTriangles / numFrames << " (" << 100.0 * chunkedTriangles / max(wholeTriangles, 1LL) << "%)" << endl;
+	cout << "  chunks visible: " << (double) totalChunks / numFrames << " of " << chunker.chunks.size() << ", in "
+		<< (double) totalRuns / numFrames << " draws" << endl;
+	cout << "  boxes tested: hierarchy " << (double) treeTests / numFrames << ", every chunk " << (double) flatTests / numFrames << endl;
+	cout << "  hierarchy " << treeTime.microsecondsPer(numFrames * iterations) << " us per frame, every chunk "
+		<< flatTime.microsecondsPer(numFrames * iterations) << " us per frame" << endl;
+
+	return finish(failures);
+}
+
+// Every derived model file, in the order they depend on each other, ending with
+// the adjacency check. Run from the game's directory before committing models.
+int rebuild(int /*argc*/, char** argv)
+{
+	const char* steps[] = { "optimize", "pack", "lod", "chunks", "connectivity" };
+	int (*commands[])(int, char**) = { optimize, pack, lod, chunks, connectivity };
+
+	for (int i = 0; i < 5; i++)
+	{
+		cout << "--- " << steps[i] << endl;
+		char* args[] = { argv[0], (char*) steps[i] };
+		if (commands[i](2, args) != 0)
+		{
+			cerr << "FAILED: " << steps[i] << ", stopping" << endl;
+			return 1;
+		}
+	}
+
+	return finish(0);
+}
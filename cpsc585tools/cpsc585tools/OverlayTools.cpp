@@ -0,0 +1,415 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "FrameArena.h"
+#include "HUDLayout.h"
+#include "TextBatch.h"
+#include "TextureCache.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+// A HUD state partway through a race
+static HUDState raceState()
+{
+	HUDState state;
+	state.needleAngle = 0.5f;
+	state.health = 70;
+	state.position = 3;
+	state.lap = 2;
+	state.numLaps = 3;
+	state.rocketAmmo = 1;
+	state.speedAmmo = 2;
+	state.landmineAmmo = 0;
+	state.radialEnabled = false;
+	state.selectedAbility = HUD_ABILITY_LASER;
+	state.countdown = 0;
+	state.showAmmo = false;
+	state.ammoIconType = HUD_ABILITY_ROCKET;
+	return state;
+}
+
+// True when the uv lies inside the packed rectangle of one of the textures
+static bool insideAtlasTexture(const HUDLayout& layout, float u, float v)
+{
+	float x = u * layout.atlasWidth, y = v * layout.atlasHeight;
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+	{
+		if (x >= layout.atlasX[i] - 0.01f && x <= layout.atlasX[i] + layout.textureWidth[i] + 0.01f
+			&& y >= layout.atlasY[i] - 0.01f && y <= layout.atlasY[i] + layout.textureHeight[i] + 0.01f)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Packs the HUD's textures (sizes from their DDS headers) and checks the atlas,
+// that the quads are only rebuilt when something shown changes, and where they land
+int hudlayout(int argc, char** argv)
+{
+	int iterations = argument(argc, argv, 2, 100000);
+
+	int failures = 0;
+	int widths[HUD_TEXTURE_COUNT], heights[HUD_TEXTURE_COUNT];
+	unsigned int separateBytes = 0;
+
+	for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+	{
+		ifstream filestream(HUDLayout::getTextureFile(i), ifstream::binary);
+		char header[128];
+		filestream.read(header, sizeof(header));
+
+		TextureInfo info;
+		if (!TextureCache::parseDDSHeader(header, (unsigned int) filestream.gcount(), info))
+		{
+			cerr << "Couldn't read " << HUDLayout::getTextureFile(i) << endl;
+			return 1;
+		}
+		widths[i] = info.width;
+		heights[i] = info.height;
+		separateBytes += info.bytes;
+	}
+
+	int screenWidth = 1280, screenHeight = 720;
+	HUDLayout layout(screenWidth, screenHeight);
+
+	// Power of two for cards that need it, then any height; the rest of the checks use the second
+	for (int anyHeight = 0; anyHeight < 2; anyHeight++)
+	{
+		failures += check(layout.packAtlas(widths, heights, anyHeight != 0), "textures fit in the atlas");
+
+		bool powerOfTwo = (layout.atlasWidth & (layout.atlasWidth - 1)) == 0 && (layout.atlasHeight & (layout.atlasHeight - 1)) == 0;
+		failures += check(anyHeight || powerOfTwo, "power of two when asked for");
+
+		// Inside the atlas and inside the file, and no two textures within the padding of each other
+		for (int i = 0; i < HUD_TEXTURE_COUNT; i++)
+		{
+			int w = layout.textureWidth[i], h = layout.textureHeight[i];
+			failures += check(w <= widths[i] && h <= heights[i] && layout.atlasX[i] >= 0 && layout.atlasY[i] >= 0
+				&& layout.atlasX[i] + w <= layout.atlasWidth && layout.atlasY[i] + h <= layout.atlasHeight,
+				string("in bounds: ") + HUDLayout::getTextureFile(i));
+
+			for (int j = i + 1; j < HUD_TEXTURE_COUNT; j++)
+			{
+				bool apart = layout.atlasX[i] + w + HUD_ATLAS_PADDING <= layout.atlasX[j]
+					|| layout.atlasX[j] + layout.textureWidth[j] + HUD_ATLAS_PADDING <= layout.atlasX[i]
+					|| layout.atlasY[i] + h + HUD_ATLAS_PADDING <= layout.atlasY[j]
+					|| layout.atlasY[j] + layout.textureHeight[j] + HUD_ATLAS_PADDING <= layout.atlasY[i];
+				failures += check(apart, string("no overlap: ") + HUDLayout::getTextureFile(i) + " and " + HUDLayout::getTextureFile(j));
+			}
+		}
+
+		cout << HUD_TEXTURE_COUNT << " textures in a " << layout.atlasWidth << "x" << layout.atlasHeight << " atlas"
+			<< (anyHeight ? "" : " (power of two)") << ": " << layout.atlasWidth * layout.atlasHeight * 4 / 1024
+			<< " KB, was " << separateBytes / 1024 << " KB with mips" << endl;
+	}
+	failures += check(layout.atlasWidth * layout.atlasHeight * 4 < (int) separateBytes, "smaller than the separate textures");
+
+	// Rebuilt only when something shown changes
+	HUDState state = raceState();
+	failures += check(layout.update(state), "first update builds");
+	failures += check(!layout.update(state), "same state doesn't rebuild");
+	failures += check(layout.getVertexCount() == 14 * 6, "14 quads mid race");
+
+	for (int field = 0; field < 13; field++)
+	{
+		HUDState changed = raceState();
+		switch (field)
+		{
+		case 0: changed.needleAngle += 0.01f; break;
+		case 1: changed.health--; break;
+		case 2: changed.position++; break;
+		case 3: changed.lap++; break;
+		case 4: changed.numLaps++; break;
+		case 5: changed.rocketAmmo++; break;
+		case 6: changed.speedAmmo++; break;
+		case 7: changed.landmineAmmo++; break;
+		case 8: changed.radialEnabled = true; break;
+		case 9: changed.selectedAbility = HUD_ABILITY_ROCKET; break;
+		case 10: changed.countdown = 2; break;
+		case 11: changed.showAmmo = true; break;
+		case 12: changed.ammoIconType = HUD_ABILITY_SPEED; break;
+		}
+
+		failures += check(layout.update(changed), "changing field " + string(1, (char) ('a' + field)) + " rebuilds");
+		failures += check(!layout.update(changed), "and only once");
+		layout.update(state);
+	}
+
+	layout.invalidate();
+	failures += check(layout.update(state), "invalidate rebuilds");
+
+	// During the countdown the reticule goes and the number comes; so does the pickup icon
+	HUDState countdown = raceState();
+	countdown.countdown = 3;
+	countdown.showAmmo = true;
+	layout.update(countdown);
+	failures += check(layout.getVertexCount() == 15 * 6, "15 quads with countdown and pickup");
+
+	// Every uv inside its texture's rectangle; the speedometer where the sprite put it
+	layout.update(state);
+	const HUDVertex* vertices = layout.getVertices();
+	for (int i = 0; i < layout.getVertexCount(); i++)
+	{
+		failures += check(insideAtlasTexture(layout, vertices[i].u, vertices[i].v), "uv inside a packed texture");
+	}
+
+	// Every cell the HUD can draw comes from the part of its texture that was packed
+	for (int cell = 0; cell < 12; cell++)
+	{
+		HUDState every = raceState();
+		every.position = cell <= 8 ? cell : 8;
+		every.lap = cell <= 9 ? cell : 9;
+		every.numLaps = 9;
+		every.countdown = cell % 4;
+		every.showAmmo = true;
+		every.ammoIconType = cell % 4;
+		every.selectedAbility = cell % 4;
+		every.rocketAmmo = every.speedAmmo = every.landmineAmmo = cell <= 9 ? cell : 9;
+		layout.update(every);
+
+		const HUDVertex* everyVertices = layout.getVertices();
+		bool inside = true;
+		for (int i = 0; i < layout.getVertexCount(); i++)
+		{
+			inside = inside && insideAtlasTexture(layout, everyVertices[i].u, everyVertices[i].v);
+		}
+		failures += check(inside, "every cell inside a packed texture");
+	}
+	layout.update(state);
+	vertices = layout.getVertices();
+
+	const HUDVertex* speedo = &vertices[6];
+	failures += check(speedo->x == screenWidth - 180.0f - 256.0f - 0.5f && speedo->y == screenHeight - 180.0f - 256.0f - 0.5f,
+		"speedometer centred at its position");
+	failures += check(speedo->u * layout.atlasWidth == layout.atlasX[HUD_TEXTURE_SPEEDOMETER]
+		&& vertices[11].v * layout.atlasHeight == layout.atlasY[HUD_TEXTURE_SPEEDOMETER] + 512, "speedometer uvs");
+
+	// The needle keeps its shape as it turns about the speedometer's centre
+	const HUDVertex* needle = &vertices[12];
+	float pivotX = screenWidth - 180.0f - 0.5f, pivotY = screenHeight - 180.0f - 0.5f;
+	for (int c = 0; c < 6; c++)
+	{
+		float x = needle[c].x - pivotX, y = needle[c].y - pivotY;
+		float cornerX = (c == 1 || c == 4 || c == 5) ? 256.0f - 155.0f : -155.0f;
+		float cornerY = (c >= 2 && c != 4) ? 128.0f - 64.0f : -64.0f;
+		failures += check(fabs(x * x + y * y - (cornerX * cornerX + cornerY * cornerY)) < 0.1f, "needle turns about its centre");
+	}
+
+	// Frames where nothing changes, then where the needle moves every frame
+	int rebuilds = layout.rebuilds;
+	BenchTimer unchanged;
+	unchanged.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		layout.update(state);
+	}
+	unchanged.stop();
+	failures += check(layout.rebuilds == rebuilds, "no rebuilds while nothing changes");
+
+	BenchTimer moving;
+	moving.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		state.needleAngle = (it % 100) * 0.01f;
+		layout.update(state);
+	}
+	moving.stop();
+	failures += check(layout.rebuilds >= rebuilds + iterations - 1, "rebuilt whenever the needle moves");
+
+	cout << layout.getVertexCount() / 6 << " quads in 1 draw from the atlas (the sprite drew them from 8 textures)" << endl;
+	cout << "Unchanged: " << unchanged.microsecondsPer(iterations) << " us per frame, needle moving: " << moving.microsecondsPer(iterations) << " us per frame" << endl;
+
+	return finish(failures);
+}
+
+int formatDebugLines(FrameArena& arena, const char** lines, int frame)
+{
+	int count = 0;
+
+	lines[count++] = arena.format("FPS: %d", 60 + frame % 3);
+	for (int i = 0; i < 6; i++)
+	{
+		lines[count++] = arena.format("Button %d: %s", i, (frame >> i) & 1 ? "True" : "False");
+	}
+	for (int i = 0; i < 7; i++)
+	{
+		lines[count++] = arena.format("Axis %d: %d", i, (frame * 977 + i * 4099) % 65536 - 32768);
+	}
+	lines[count++] = " ";
+	lines[count++] = "Player Information:";
+	for (int i = 0; i < 28; i++)
+	{
+		lines[count++] = arena.format("Statistic number %d: %d", i, frame * (i + 1));
+	}
+
+	return count;
+}
+
+void layOutLines(TextBatch& batch, const char** lines, int count)
+{
+	batch.clear();
+	for (int i = 0; i < count; i++)
+	{
+		batch.addLine(lines[i], 20.0f, 20.0f + i * 30.0f, 0xFFC83232);
+	}
+}
+
+// The same lines the old way: _itoa_s into a buffer, std::string concatenation,
+// and a fresh copy of the array in Renderer::setText
+static int stringOverlayFrame(std::string*& sentences, int frame)
+{
+	std::string lines[44];
+	int count = 0;
+	char buffer[33];
+
+	sprintf(buffer, "%d", 60 + frame % 3);
+	lines[count++] = std::string("FPS: ").append(buffer);
+	for (int i = 0; i < 6; i++)
+	{
+		sprintf(buffer, "%d", i);
+		lines[count++] = std::string("Button ").append(buffer) + ": " + ((frame >> i) & 1 ? "True" : "False");
+	}
+	for (int i = 0; i < 7; i++)
+	{
+		sprintf(buffer, "%d", (frame * 977 + i * 4099) % 65536 - 32768);
+		lines[count++] = std::string("Axis: ").append(buffer);
+	}
+	lines[count++] = " ";
+	lines[count++] = "Player Information:";
+	for (int i = 0; i < 28; i++)
+	{
+		sprintf(buffer, "%d", frame * (i + 1));
+		lines[count++] = std::string("Statistic number: ").append(buffer);
+	}
+
+	if (sentences)
+	{
+		delete [] sentences;
+	}
+	sentences = new std::string[count];
+	for (int i = 0; i < count; i++)
+	{
+		sentences[i] = std::string(lines[i]);
+	}
+
+	return count;
+}
+
+// Checks the glyph atlas packing, the text layout and the frame arena, and
+// that a frame of debug text makes no heap allocations once warmed up
+int textoverlay(int argc, char** argv)
+{
+	int frames = argument(argc, argv, 2, 10000);
+
+	int failures = 0;
+
+	// A 7x12 fixed font, with a few odd widths like a proportional one
+	int widths[TEXT_CHAR_COUNT];
+	for (int c = 0; c < TEXT_CHAR_COUNT; c++)
+	{
+		widths[c] = c % 13 == 0 ? 3 : (c % 7 == 0 ? 11 : 7);
+	}
+
+	TextBatch batch;
+	failures += check(batch.packGlyphs(widths, 12), "glyphs fit in the atlas");
+	for (int c = 0; c < TEXT_CHAR_COUNT; c++)
+	{
+		failures += check(batch.glyphX[c] + widths[c] <= batch.atlasWidth && batch.glyphY[c] + 12 <= batch.atlasHeight, "glyph in bounds");
+		for (int d = c + 1; d < TEXT_CHAR_COUNT; d++)
+		{
+			bool apart = batch.glyphY[c] != batch.glyphY[d] || batch.glyphX[c] + widths[c] + TEXT_ATLAS_PADDING <= batch.glyphX[d];
+			failures += check(apart, "glyphs don't overlap");
+		}
+	}
+	cout << TEXT_CHAR_COUNT << " glyphs in a " << batch.atlasWidth << "x" << batch.atlasHeight << " atlas" << endl;
+
+	// A quad per visible character, advancing by each glyph's width
+	batch.clear();
+	batch.addLine("Ab c", 20.0f, 50.0f, 0xFFFFFFFF);
+	failures += check(batch.getVertexCount() == 3 * 6, "spaces make no quads");
+	const TextVertex* vertices = batch.getVertices();
+	int a = 'A' - TEXT_FIRST_CHAR, b = 'b' - TEXT_FIRST_CHAR;
+	failures += check(vertices[0].x == 19.5f && vertices[0].y == 49.5f && vertices[5].x == 19.5f + widths[a]
+		&& vertices[5].y == 49.5f + 12, "first glyph placed");
+	failures += check(vertices[6].x == 19.5f + widths[a], "second glyph follows the first");
+	failures += check(vertices[12].x == 19.5f + widths[a] + widths[b] + widths[0], "space advances");
+	failures += check(vertices[0].u * batch.atlasWidth == batch.glyphX[a] && vertices[5].v * batch.atlasHeight == batch.glyphY[a] + 12,
+		"glyph uvs");
+
+	// Capacity: whatever is past TEXT_MAX_GLYPHS is dropped, not written
+	batch.clear();
+	char longLine[257];
+	memset(longLine, 'x', 256);
+	longLine[256] = 0;
+	for (int i = 0; i < TEXT_MAX_GLYPHS / 256 + 1; i++)
+	{
+		batch.addLine(longLine, 0.0f, 0.0f, 0xFFFFFFFF);
+	}
+	failures += check(batch.getVertexCount() == TEXT_MAX_GLYPHS * 6 && batch.dropped == 256, "glyphs past the capacity dropped");
+
+	// The arena: aligned blocks, strings, and refusing rather than overrunning
+	{
+		FrameArena arena(64);
+		void* first = arena.allocate(3);
+		void* second = arena.allocate(8);
+		failures += check(first && second && (char*) second - (char*) first == FRAME_ARENA_ALIGNMENT, "allocations aligned");
+		failures += check(arena.allocate(64) == NULL && arena.overflows == 1, "full arena refuses");
+
+		arena.reset();
+		const char* text = arena.format("%s %d", "lap", 3);
+		failures += check(strcmp(text, "lap 3") == 0 && arena.used == 6, "format");
+		const char* tooLong = arena.format("%s", longLine);
+		failures += check(tooLong != NULL && tooLong[0] == 0 && arena.overflows == 2 && arena.used == 6, "format that doesn't fit gives \"\"");
+		failures += check(arena.highWater == 24, "high water mark");
+	}
+
+	// Allocations per frame, old and new
+	FrameArena arena(64 * 1024);
+	const char* lines[48];
+	layOutLines(batch, lines, formatDebugLines(arena, lines, 0));
+	arena.reset();
+
+	int allocations = heapAllocations;
+	BenchTimer formatting, layout;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		formatting.start();
+		int count = formatDebugLines(arena, lines, frame);
+		formatting.stop();
+		layout.start();
+		layOutLines(batch, lines, count);
+		layout.stop();
+		arena.reset();
+	}
+	int arenaAllocations = heapAllocations - allocations;
+	failures += check(arenaAllocations == 0, "no heap allocations from the arena and batch");
+	failures += check(arena.overflows == 0, "a frame fits in the arena");
+
+	std::string* sentences = NULL;
+	int count = stringOverlayFrame(sentences, 0);
+	allocations = heapAllocations;
+	BenchTimer stringElapsed;
+	stringElapsed.start();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		stringOverlayFrame(sentences, frame);
+	}
+	stringElapsed.stop();
+	int stringAllocations = heapAllocations - allocations;
+	delete [] sentences;
+
+	cout << count << " lines, " << batch.getVertexCount() / 6 << " glyphs, " << arena.highWater << " bytes of arena" << endl;
+	cout << "  strings: " << (double) stringAllocations / frames << " allocations, " << stringElapsed.microsecondsPer(frames) << " us per frame formatting" << endl;
+	cout << "  arena:   " << (double) arenaAllocations / frames << " allocations, " << formatting.microsecondsPer(frames)
+		<< " us per frame formatting, " << layout.microsecondsPer(frames) << " us laying out glyphs" << endl;
+
+	return finish(failures);
+}
@@ -0,0 +1,390 @@
+#include <iostream>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ParticleBudget.h"
+#include "ParticleEmitter.h"
+#include "ParticlePool.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+// How SmokeSystem kept its particles before the pools: one heap object each, in a list
+struct ListParticle
+{
+	float position[3];
+	float velocity[3];
+	float age, life, fadeStart;
+	unsigned int colour;
+	bool destroyed;
+};
+
+struct ListPoint
+{
+	float position[3];
+	unsigned int colour;
+};
+
+static void spawnRandom(float* position, float* velocity, float& life, float& fadeStart)
+{
+	position[0] = randomFloat(-500.0f, 500.0f);
+	position[1] = randomFloat(0.0f, 50.0f);
+	position[2] = randomFloat(-500.0f, 500.0f);
+	velocity[0] = randomFloat(-2.0f, 2.0f);
+	velocity[1] = randomFloat(-1.0f, 3.0f);
+	velocity[2] = randomFloat(-2.0f, 2.0f);
+	life = randomFloat(0.5f, 5.0f);
+	fadeStart = life * randomFloat(0.2f, 0.8f);
+}
+
+// Quad checks: centred on the particle, size across along right and up, full
+// alpha until fadeStart then fading to nothing, and the pool's limits
+static int checkParticles()
+{
+	int failures = 0;
+	float right[3] = { 0.6f, 0.0f, -0.8f };
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	ParticleVertex quad[PARTICLE_VERTICES];
+
+	ParticlePool pool(8);
+	float position[3] = { 10.0f, 20.0f, 30.0f };
+	float velocity[3] = { 1.0f, 2.0f, -4.0f };
+	pool.spawn(position, velocity, 2.0f, 4.0f, 2.0f, 0xC8102030);
+
+	pool.update(0.5f);
+	pool.expand(quad, 1, right, up);
+	float centre[3] = { 0.0f, 0.0f, 0.0f };
+	for (int c = 0; c < PARTICLE_VERTICES; c++)
+	{
+		centre[0] += quad[c].x * 0.25f;
+		centre[1] += quad[c].y * 0.25f;
+		centre[2] += quad[c].z * 0.25f;
+	}
+	bool centred = fabs(centre[0] - 10.5f) < 0.001f && fabs(centre[1] - 21.0f) < 0.001f && fabs(centre[2] - 28.0f) < 0.001f;
+	float across[3] = { quad[1].x - quad[0].x, quad[1].y - quad[0].y, quad[1].z - quad[0].z };
+	float down[3] = { quad[0].x - quad[2].x, quad[0].y - quad[2].y, quad[0].z - quad[2].z };
+	bool sized = fabs(across[0] - 1.2f) < 0.001f && fabs(across[1]) < 0.001f && fabs(across[2] + 1.6f) < 0.001f &&
+		fabs(down[0]) < 0.001f && fabs(down[1] - 2.0f) < 0.001f && fabs(down[2]) < 0.001f;
+	failures += check(centred && sized, "quads are centred on the particle and face the camera");
+	failures += check(quad[0].colour == 0xC8102030 && quad[3].colour == 0xC8102030, "full colour until the fade starts");
+
+	// 3 seconds old: halfway through the fade
+	pool.update(2.5f);
+	pool.expand(quad, 1, right, up);
+	failures += check(quad[0].colour == 0x64102030, "alpha halfway down halfway through the fade");
+
+	pool.update(1.0f);
+	failures += check(pool.count == 0, "gone at the end of its life");
+
+	for (int i = 0; i < 10; i++)
+	{
+		pool.spawn(position, velocity, 1.0f, 1.0f, 1.0f, 0xFFFFFFFF);
+	}
+	failures += check(pool.count == 8 && pool.dropped == 2, "spawns past the capacity are dropped");
+	failures += check(pool.expand(quad, 1, right, up) == 1, "expand stops at maxParticles");
+
+	return failures;
+}
+
+// 100k particles a frame kept topped up (about what a whole race's smoke
+// would be at 50 times the density), updated and billboarded. Checks the 4-wide
+// update against the one at a time one, and times both against the list of
+// heap objects SmokeSystem used to walk.
+int particles(int argc, char** argv)
+{
+	int numParticles = argument(argc, argv, 2, 100000);
+	int numFrames = argument(argc, argv, 3, 300);
+	const float seconds = 1.0f / 60.0f;
+	float right[3] = { 1.0f, 0.0f, 0.0f };
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+
+	int failures = checkParticles();
+
+	ParticlePool pool(numParticles);
+	ParticlePool reference(numParticles);
+	vector<ParticleVertex> vertices(numParticles * PARTICLE_VERTICES);
+	vector<ParticleVertex> referenceVertices(numParticles * PARTICLE_VERTICES);
+
+	list<ListParticle*> listParticles;
+	vector<ListPoint> listPoints(numParticles);
+
+	// What is spawned each frame, made before anything is timed
+	vector<ListParticle> spawns(numParticles);
+
+	srand(585);
+	BenchTimer updateTime, referenceTime, expandTime, listTime;
+	bool same = true;
+	int spawned = 0, expired = 0, allocations = 0;
+
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		// Top everything back up, with the same particles in each
+		int needed = numParticles - pool.count;
+		for (int i = 0; i < needed; i++)
+		{
+			spawnRandom(spawns[i].position, spawns[i].velocity, spawns[i].life, spawns[i].fadeStart);
+		}
+		spawned += needed;
+
+		int start = heapAllocations;
+		updateTime.start();
+		for (int i = 0; i < needed; i++)
+		{
+			pool.spawn(spawns[i].position, spawns[i].velocity, 1.0f, spawns[i].life, spawns[i].fadeStart, 0xC8646488);
+		}
+		pool.update(seconds);
+		updateTime.stop();
+
+		expandTime.start();
+		pool.expand(&vertices[0], numParticles, right, up);
+		expandTime.stop();
+		allocations += heapAllocations - start;
+
+		expired += numParticles - pool.count;
+
+		referenceTime.start();
+		for (int i = 0; i < needed; i++)
+		{
+			reference.spawn(spawns[i].position, spawns[i].velocity, 1.0f, spawns[i].life, spawns[i].fadeStart, 0xC8646488);
+		}
+		reference.updateReference(seconds);
+		referenceTime.stop();
+
+		// The list: spawn, then write out what's alive, move it and delete what died last frame
+		listTime.start();
+		for (int i = 0; i < needed; i++)
+		{
+			ListParticle* particle = new ListParticle(spawns[i]);
+			particle->age = 0.0f;
+			particle->colour = 0xC8646488;
+			particle->destroyed = false;
+			listParticles.push_back(particle);
+		}
+
+		int written = 0;
+		for (list<ListParticle*>::iterator iter = listParticles.begin(); iter != listParticles.end();)
+		{
+			ListParticle* particle = *iter;
+			if (particle->destroyed)
+			{
+				delete particle;
+				iter = listParticles.erase(iter);
+				continue;
+			}
+
+			memcpy(listPoints[written].position, particle->position, sizeof(particle->position));
+			listPoints[written].colour = particle->colour;
+			written++;
+
+			particle->age += seconds;
+			particle->destroyed = particle->age >= particle->life;
+			for (int k = 0; k < 3; k++)
+			{
+				particle->position[k] += particle->velocity[k] * seconds;
+			}
+			++iter;
+		}
+		listTime.stop();
+
+		if (pool.count != reference.count)
+		{
+			same = false;
+			continue;
+		}
+		reference.expand(&referenceVertices[0], numParticles, right, up);
+		for (int v = 0; v < pool.count * PARTICLE_VERTICES && same; v++)
+		{
+			same = fabs(vertices[v].x - referenceVertices[v].x) < 0.001f && fabs(vertices[v].y - referenceVertices[v].y) < 0.001f &&
+				fabs(vertices[v].z - referenceVertices[v].z) < 0.001f && vertices[v].colour == referenceVertices[v].colour;
+		}
+	}
+
+	for (list<ListParticle*>::iterator iter = listParticles.begin(); iter != listParticles.end(); ++iter)
+	{
+		delete *iter;
+	}
+
+	failures += check(same, "4-wide update matches one at a time");
+	failures += check(allocations == 0, "no heap allocations updating or expanding");
+
+	cout << numFrames << " frames of " << numParticles << " particles, " << (double) spawned / numFrames
+		<< " spawned and " << (double) expired / numFrames << " expired per frame" << endl;
+	cout << "  spawning and updating: pool " << updateTime.milliseconds() / numFrames << " ms, one at a time "
+		<< referenceTime.milliseconds() / numFrames << " ms, list of heap particles " << listTime.milliseconds() / numFrames << " ms" << endl;
+	cout << "  billboarding into the vertex buffer: " << expandTime.milliseconds() / numFrames << " ms" << endl;
+
+	return finish(failures);
+}
+
+// Runs an emitter to the end of its duration at steps of seconds (jittered
+// around it if jitter), and returns how many particles it spawned
+static int runEmitter(float rate, int burst, float duration, float scale, float seconds, bool jitter)
+{
+	ParticleEmitter emitter;
+	emitter.initialize(rate, burst, duration, 1.0f);
+	emitter.start();
+
+	float position[3] = { 0.0f, 0.0f, 0.0f };
+	float positions[PARTICLE_EMIT_MAX * 3];
+	int total = 0;
+
+	for (int step = 0; emitter.isActive() && step < 100000; step++)
+	{
+		float dt = jitter ? seconds * randomFloat(0.25f, 1.75f) : seconds;
+		total += emitter.emit(dt, scale, position, positions, PARTICLE_EMIT_MAX);
+	}
+
+	// Nothing more once it has run out
+	total += emitter.emit(seconds, scale, position, positions, PARTICLE_EMIT_MAX);
+
+	return total;
+}
+
+// Ticks a set of emitters spawning into one pool under a budget, and returns
+// the most particles that were ever alive at once
+static int runBudget(ParticleBudget& budget, ParticlePool& pool, vector<BenchEmitter>& emitters, int ticks, int* spawned)
+{
+	const float seconds = 1.0f / 60.0f;
+	float viewer[3] = { 0.0f, 0.0f, 0.0f };
+	float velocity[3] = { 0.0f, 1.0f, 0.0f };
+	float positions[PARTICLE_EMIT_MAX * 3];
+	int mostLive = 0;
+
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		budget.startTick(pool.count, viewer);
+		for (unsigned int e = 0; e < emitters.size(); e++)
+		{
+			float scale = budget.throttle(emitters[e].emitter.priority, emitters[e].position);
+			int count = emitters[e].emitter.emit(seconds, scale, emitters[e].position, positions, PARTICLE_EMIT_MAX);
+			count = budget.take(count);
+			for (int i = 0; i < count; i++)
+			{
+				pool.spawn(&positions[i * 3], velocity, 1.0f, 2.0f, 1.0f, 0xFFFFFFFF);
+			}
+			spawned[e] += count;
+		}
+
+		mostLive = std::max(mostLive, pool.count);
+		pool.update(seconds);
+	}
+
+	return mostLive;
+}
+
+// Checks that emitters spawn the same particles at any tick length, spread
+// along their path, and that the budget holds the limit and throttles the far
+// and unimportant first
+int emitters(int argc, char** argv)
+{
+	int numEmitters = argument(argc, argv, 2, 40);
+	int numTicks = argument(argc, argv, 3, 600);
+	int failures = 0;
+
+	srand(585);
+	const float steps[] = { 1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 144.0f, 1.0f / 240.0f };
+	bool exact = true, exactBurst = true, exactSlow = true, halved = true;
+	for (int s = 0; s < 5; s++)
+	{
+		float seconds = s < 4 ? steps[s] : 1.0f / 60.0f;
+		bool jitter = s == 4;
+
+		int full = runEmitter(60.0f, 0, 3.0f, 1.0f, seconds, jitter);
+		int burst = runEmitter(60.0f, 10, 3.0f, 1.0f, seconds, jitter);
+		int slow = runEmitter(7.3f, 0, 10.0f, 1.0f, seconds, jitter);
+		int half = runEmitter(60.0f, 0, 3.0f, 0.5f, seconds, jitter);
+
+		cout << "  " << (jitter ? "jittered " : "") << "1/" << (int) (1.0f / seconds + 0.5f) << " s steps: "
+			<< full << " at 60/s for 3 s, " << burst << " with a burst of 10, " << slow << " at 7.3/s for 10 s, "
+			<< half << " at half rate" << endl;
+
+		exact = exact && full == 180;
+		exactBurst = exactBurst && burst == 190;
+		exactSlow = exactSlow && slow == 73;
+		halved = halved && half == 90;
+	}
+	failures += check(exact, "60 a second for 3 seconds is 180 particles at any step");
+	failures += check(exactBurst, "the burst comes on top, once");
+	failures += check(exactSlow, "fractional rates carry over between steps");
+	failures += check(halved, "half the scale spawns half the particles");
+
+	// 240 a second moving 8 units in a 1/30 s step: 8 particles a unit apart
+	ParticleEmitter moving;
+	moving.initialize(240.0f, 0, 0.0f, 1.0f);
+	moving.start();
+	float from[3] = { 0.0f, 0.0f, 0.0f };
+	float to[3] = { 8.0f, 0.0f, 0.0f };
+	float positions[PARTICLE_EMIT_MAX * 3];
+	int first = moving.emit(1.0f / 30.0f, 1.0f, from, positions, PARTICLE_EMIT_MAX);
+	bool together = true;
+	for (int i = 0; i < first; i++)
+	{
+		together = together && positions[i * 3] == 0.0f;
+	}
+	int second = moving.emit(1.0f / 30.0f, 1.0f, to, positions, PARTICLE_EMIT_MAX);
+	bool spread = second == 8;
+	for (int i = 0; i < second && spread; i++)
+	{
+		spread = fabs(positions[i * 3] - (i + 1)) < 0.001f && positions[i * 3 + 1] == 0.0f;
+	}
+	failures += check(first == 8 && together, "the first step spawns where the emitter is");
+	failures += check(spread, "particles are spread evenly along the way moved");
+	failures += check(moving.emit(1.0f, 1.0f, to, positions, PARTICLE_EMIT_MAX) == PARTICLE_EMIT_MAX, "a long step spawns no more than maxCount");
+
+	// No pressure: two emitters well under the soft limit run at their full rate
+	ParticlePool pool(PARTICLE_BUDGET * 4);
+	vector<BenchEmitter> few(2);
+	for (unsigned int e = 0; e < few.size(); e++)
+	{
+		few[e].emitter.initialize(60.0f, 0, 0.0f, 0.1f);
+		few[e].emitter.start();
+		few[e].position[0] = 1000.0f;
+		few[e].position[1] = few[e].position[2] = 0.0f;
+	}
+	ParticleBudget calm(PARTICLE_BUDGET);
+	vector<int> calmSpawned(few.size(), 0);
+	runBudget(calm, pool, few, numTicks, &calmSpawned[0]);
+	failures += check(calmSpawned[0] == numTicks && calmSpawned[1] == numTicks && calm.totalRefused == 0,
+		"under the soft limit nothing is throttled");
+
+	// Pressure: far more wanted than the budget, from emitters near and far,
+	// important and not, in an order that has nothing to do with either
+	pool.clear();
+	vector<BenchEmitter> many(numEmitters);
+	for (int e = 0; e < numEmitters; e++)
+	{
+		bool important = e % 2 == 0;
+		bool near = (e / 2) % 2 == 0;
+		many[e].emitter.initialize(60.0f, 0, 0.0f, important ? 1.0f : 0.25f);
+		many[e].emitter.start();
+		many[e].position[0] = near ? 20.0f : 300.0f;
+		many[e].position[1] = 0.0f;
+		many[e].position[2] = (float) e;
+	}
+	ParticleBudget budget(PARTICLE_BUDGET);
+	vector<int> spawned(numEmitters, 0);
+	int mostLive = runBudget(budget, pool, many, numTicks, &spawned[0]);
+
+	// Near and important, near and not, far and important, far and not
+	int kinds[4] = { 0, 0, 0, 0 };
+	for (int e = 0; e < numEmitters; e++)
+	{
+		kinds[((e / 2) % 2) * 2 + e % 2] += spawned[e];
+	}
+	failures += check(mostLive <= PARTICLE_BUDGET, "never more live particles than the budget");
+	failures += check(kinds[0] > kinds[1] && kinds[0] > kinds[2], "near, important emitters keep the most");
+	failures += check(kinds[1] > kinds[3] && kinds[2] > kinds[3], "far, unimportant emitters lose the most");
+
+	cout << numEmitters << " emitters at 60/s for " << numTicks << " ticks against a budget of " << PARTICLE_BUDGET
+		<< " (" << numEmitters * 120 << " would be alive)" << endl;
+	cout << "  most alive at once: " << mostLive << ", spawned " << budget.totalSpawned << ", refused " << budget.totalRefused
+		<< ", last tick " << budget.throttled << " emitters throttled" << endl;
+	cout << "  spawned by near important " << kinds[0] << ", near unimportant " << kinds[1] << ", far important "
+		<< kinds[2] << ", far unimportant " << kinds[3] << endl;
+
+	return finish(failures);
+}
@@ -0,0 +1,473 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+#include "CollisionMesh.h"
+#include "MeshFile.h"
+#include "SuspensionBatch.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+#define SUSPENSION_TOLERANCE	0.001f		// Newtons the SSE forces may be off by, of up to 90
+
+// Where a segment crosses a collision triangle, both sides counted, as ContactCache tests it
+static bool segmentHitsTriangle(const CollisionMesh& mesh, int tri, const float* from, const float* to, float& fraction)
+{
+	const float* n = &mesh.planes[tri * 4];
+	float distFrom = n[0] * from[0] + n[1] * from[1] + n[2] * from[2] - n[3];
+	float distTo = n[0] * to[0] + n[1] * to[1] + n[2] * to[2] - n[3];
+	if ((distFrom > 0.0f && distTo > 0.0f) || (distFrom < 0.0f && distTo < 0.0f) || distFrom == distTo)
+	{
+		return false;
+	}
+
+	fraction = distFrom / (distFrom - distTo);
+	float hit[3];
+	for (int k = 0; k < 3; k++)
+	{
+		hit[k] = from[k] + (to[k] - from[k]) * fraction;
+	}
+
+	for (int e = 0; e < 3; e++)
+	{
+		const float* a = &mesh.vertices[mesh.indices[tri * 3 + e] * 3];
+		const float* b = &mesh.vertices[mesh.indices[tri * 3 + (e + 1) % 3] * 3];
+		float edge[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float toHit[3] = { hit[0] - a[0], hit[1] - a[1], hit[2] - a[2] };
+		float c[3] = { edge[1] * toHit[2] - edge[2] * toHit[1], edge[2] * toHit[0] - edge[0] * toHit[2], edge[0] * toHit[1] - edge[1] * toHit[0] };
+		if (c[0] * n[0] + c[1] * n[1] + c[2] * n[2] < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Casts wheel-length rays down onto random triangles and, wherever ContactCache would trust
+// the triangle's nearby list, checks no triangle outside it is hit first. Returns the failures.
+static int checkNearby(const CollisionMesh& mesh, int rays)
+{
+	int trusted = 0, wrong = 0;
+
+	srand(585);
+	for (int r = 0; r < rays; r++)
+	{
+		int t = rand() % mesh.triangleCount;
+		float u = randomFloat(0.0f, 1.0f), v = randomFloat(0.0f, 1.0f);
+		if (u + v > 1.0f)
+		{
+			u = 1.0f - u;
+			v = 1.0f - v;
+		}
+
+		const float* a = &mesh.vertices[mesh.indices[t * 3] * 3];
+		const float* b = &mesh.vertices[mesh.indices[t * 3 + 1] * 3];
+		const float* c = &mesh.vertices[mesh.indices[t * 3 + 2] * 3];
+		float from[3], to[3];
+		float length = randomFloat(0.1f, 1.5f);
+		for (int k = 0; k < 3; k++)
+		{
+			float point = a[k] + (b[k] - a[k]) * u + (c[k] - a[k]) * v;
+			float down = (k == 1 ? -1.0f : 0.0f) + randomFloat(-0.2f, 0.2f);
+			from[k] = point - down * length;
+			to[k] = point + down * 0.35f;
+		}
+
+		// What the cache sees: the triangle and the ones near it
+		float best = 2.0f, fraction;
+		if (segmentHitsTriangle(mesh, t, from, to, fraction))
+		{
+			best = fraction;
+		}
+		for (int i = mesh.nearbyStart[t]; i < mesh.nearbyStart[t + 1]; i++)
+		{
+			if (segmentHitsTriangle(mesh, mesh.nearby[i], from, to, fraction) && fraction < best)
+			{
+				best = fraction;
+			}
+		}
+		if (best > 1.0f)
+		{
+			continue;
+		}
+
+		bool inside = true;
+		for (int k = 0; k < 3; k++)
+		{
+			float end = from[k] + (to[k] - from[k]) * best;
+			float boxMin = min(a[k], min(b[k], c[k])) - COLLISION_NEARBY_MARGIN;
+			float boxMax = max(a[k], max(b[k], c[k])) + COLLISION_NEARBY_MARGIN;
+			inside = inside && min(from[k], end) > boxMin && max(from[k], end) < boxMax;
+		}
+		if (!inside)
+		{
+			continue;
+		}
+
+		// What a full cast sees
+		trusted++;
+		float closest = best;
+		for (int u = 0; u < mesh.triangleCount; u++)
+		{
+			if (segmentHitsTriangle(mesh, u, from, to, fraction) && fraction < closest)
+			{
+				closest = fraction;
+			}
+		}
+		wrong += closest < best ? 1 : 0;
+	}
+
+	cout << "Triangles near each triangle: " << (double) mesh.nearbyStart[mesh.triangleCount] / mesh.triangleCount << " on average" << endl;
+	cout << "Rays the cache would answer: " << trusted << " of " << rays << ", " << wrong << " with something closer outside the list" << endl;
+	return check(wrong == 0, "nothing outside a triangle's nearby list is hit within reach of it");
+}
+
+int collision(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		cout << "Usage: cpsc585tools collision <input.mesh|.ese> <output.col> [weldDistance] [maxError]" << endl;
+		return 1;
+	}
+
+	MeshFile data;
+	if (!data.load(argv[2]))
+	{
+		cerr << "Could not read " << argv[2] << endl;
+		return 1;
+	}
+
+	CollisionMeshParams params;
+	params.minNormalY = COLLISION_TRACK_MIN_NORMAL_Y;
+	params.weldDistance = argument(argc, argv, 4, params.weldDistance);
+	params.maxError = argument(argc, argv, 5, params.maxError);
+
+	CollisionMesh mesh;
+	mesh.build((const float*) data.vertices, 8, data.vertexCount, data.indices, data.indexCount, params);
+
+	cout << "Source triangles:     " << mesh.sourceTriangleCount << endl;
+	cout << "Dropped degenerate:   " << mesh.droppedDegenerate << endl;
+	cout << "Dropped non-drivable: " << mesh.droppedNonDrivable << endl;
+	cout << "Collapsed vertices:   " << mesh.collapsedVertices << endl;
+	cout << "Collision triangles:  " << mesh.triangleCount << endl;
+	cout << "Collision vertices:   " << mesh.vertexCount << endl;
+
+	if (!mesh.save(argv[3]))
+	{
+		cerr << "Could not write " << argv[3] << endl;
+		return 1;
+	}
+
+	// Adjacency and the nearby lists are rebuilt on every load
+	CollisionMesh reloaded;
+	BenchTimer loadTime;
+	loadTime.start();
+	bool loaded = reloaded.load(argv[3]);
+	loadTime.stop();
+	int failures = check(loaded && reloaded.triangleCount == mesh.triangleCount, "collision mesh reloads");
+	if (loaded)
+	{
+		cout << "Load (with adjacency and nearby lists): " << loadTime.milliseconds() << " ms" << endl;
+		failures += checkNearby(reloaded, 20000);
+	}
+
+	return finish(failures);
+}
+
+// Stand-ins for the Havok objects the old per-racer path chased pointers through
+struct BenchWheel
+{
+	float position[3];
+	bool touchingGround;
+};
+
+struct BenchRacer
+{
+	float rotation[9];		// Columns are the x, y and z axes
+	float translation[3];
+	float centerOfMass[3];
+	float linearVelocity[3];
+	float angularVelocity[3];
+	BenchWheel* wheels[4];
+	float attach[4][3];
+};
+
+// The old Racer::getForce / applyFriction / applyDrag maths, one object at a time
+static void perObjectForces(BenchRacer* racer, float* wheelForces, float* bodyForce)
+{
+	const float* up = &racer->rotation[3];
+
+	for (int w = 0; w < 4; w++)
+	{
+		BenchWheel* wheel = racer->wheels[w];
+		float* force = &wheelForces[w * 3];
+		force[0] = force[1] = force[2] = 0.0f;
+
+		if (!wheel->touchingGround)
+		{
+			continue;
+		}
+
+		float rest[3];
+		for (int k = 0; k < 3; k++)
+		{
+			rest[k] = racer->translation[k] + racer->rotation[k] * racer->attach[w][0] +
+				racer->rotation[3 + k] * racer->attach[w][1] + racer->rotation[6 + k] * racer->attach[w][2];
+		}
+
+		float extents = w < 2 ? 0.3f : 0.35f;
+		float displacement = (wheel->position[0] - rest[0]) * up[0] +
+			(wheel->position[1] - rest[1]) * up[1] + (wheel->position[2] - rest[2]) * up[2];
+		if (displacement < -extents) displacement = -extents;
+		else if (displacement > extents) displacement = extents;
+
+		float r[3] = { rest[0] - racer->centerOfMass[0], rest[1] - racer->centerOfMass[1], rest[2] - racer->centerOfMass[2] };
+		const float* v = racer->linearVelocity;
+		const float* a = racer->angularVelocity;
+		float pointVel[3] = { v[0] + a[1] * r[2] - a[2] * r[1], v[1] + a[2] * r[0] - a[0] * r[2], v[2] + a[0] * r[1] - a[1] * r[0] };
+		float speed = pointVel[0] * up[0] + pointVel[1] * up[1] + pointVel[2] * up[2];
+
+		float magnitude = 300.0f * displacement - 20.0f * speed;
+		for (int k = 0; k < 3; k++)
+		{
+			force[k] = up[k] * magnitude;
+		}
+
+		float lengthSq = force[0] * force[0] + force[1] * force[1] + force[2] * force[2];
+		if (lengthSq > 90.0f * 90.0f)
+		{
+			float scale = 90.0f / sqrt(lengthSq);
+			force[0] *= scale; force[1] *= scale; force[2] *= scale;
+		}
+	}
+
+	const float* v = racer->linearVelocity;
+	float speed = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	float n[3] = { 0.0f, 0.0f, 0.0f };
+	if (speed > 0.0f)
+	{
+		n[0] = v[0] / speed; n[1] = v[1] / speed; n[2] = v[2] / speed;
+	}
+
+	float y = up[1];
+	float xFriction = y >= 0.01f ? y * y * -40.0f : 0.0f;
+	float zFriction = y >= 0.01f ? y * y * -0.8f : 0.0f;
+	const float* xAxis = &racer->rotation[0];
+	const float* zAxis = &racer->rotation[6];
+	float xScale = xFriction * (n[0] * xAxis[0] + n[1] * xAxis[1] + n[2] * xAxis[2]);
+	float zScale = zFriction * (n[0] * zAxis[0] + n[1] * zAxis[1] + n[2] * zAxis[2]);
+	for (int k = 0; k < 3; k++)
+	{
+		bodyForce[k] = xAxis[k] * xScale + zAxis[k] * zScale - n[k] * 0.01f * speed * speed;
+	}
+}
+
+// What the Racer constructor does once
+static int addRacer(SuspensionBatch& batch, BenchRacer* racer)
+{
+	int b = batch.addBody(0.01f, racer);
+	for (int w = 0; w < 4; w++)
+	{
+		batch.setWheel(b * 4 + w, 300.0f, 20.0f, w < 2 ? 0.3f : 0.35f, 90.0f);
+	}
+	return b;
+}
+
+// What Racer::queueForces does every tick: straight into the racer's own slots
+static void fillRacer(SuspensionBatch& batch, int b, BenchRacer* racer)
+{
+	batch.upX[b] = racer->rotation[3]; batch.upY[b] = racer->rotation[4]; batch.upZ[b] = racer->rotation[5];
+	batch.velX[b] = racer->linearVelocity[0]; batch.velY[b] = racer->linearVelocity[1]; batch.velZ[b] = racer->linearVelocity[2];
+	batch.angVelX[b] = racer->angularVelocity[0]; batch.angVelY[b] = racer->angularVelocity[1]; batch.angVelZ[b] = racer->angularVelocity[2];
+	batch.axisXx[b] = racer->rotation[0]; batch.axisXy[b] = racer->rotation[1]; batch.axisXz[b] = racer->rotation[2];
+	batch.axisZx[b] = racer->rotation[6]; batch.axisZy[b] = racer->rotation[7]; batch.axisZz[b] = racer->rotation[8];
+
+	for (int i = 0; i < 4; i++)
+	{
+		int w = b * 4 + i;
+		BenchWheel* wheel = racer->wheels[i];
+		if (!wheel->touchingGround)
+		{
+			batch.grounded[w] = 0.0f;
+			continue;
+		}
+
+		float rest[3];
+		for (int k = 0; k < 3; k++)
+		{
+			rest[k] = racer->translation[k] + racer->rotation[k] * racer->attach[i][0] +
+				racer->rotation[3 + k] * racer->attach[i][1] + racer->rotation[6 + k] * racer->attach[i][2];
+		}
+
+		batch.offsetX[w] = wheel->position[0] - rest[0];
+		batch.offsetY[w] = wheel->position[1] - rest[1];
+		batch.offsetZ[w] = wheel->position[2] - rest[2];
+		batch.leverX[w] = rest[0] - racer->centerOfMass[0];
+		batch.leverY[w] = rest[1] - racer->centerOfMass[1];
+		batch.leverZ[w] = rest[2] - racer->centerOfMass[2];
+		batch.grounded[w] = 1.0f;
+	}
+
+	batch.setFriction(b, racer->rotation[4], -40.0f, -0.8f, true);
+	batch.queued[b] = true;
+}
+
+int suspension(int argc, char** argv)
+{
+	int iterations = argument(argc, argv, 2, 200000);
+	const int numRacers = MAX_BATCH_BODIES;
+
+	// Allocate racers and wheels separately, like the game does
+	srand(585);
+	vector<BenchRacer*> racers;
+	for (int i = 0; i < numRacers; i++)
+	{
+		BenchRacer* racer = new BenchRacer();
+
+		float yaw = randomFloat(-3.14f, 3.14f);
+		float pitch = randomFloat(-0.3f, 0.3f);
+		float cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+		float rotation[9] = { cy, 0.0f, -sy, sy * sp, cp, cy * sp, sy * cp, -sp, cy * cp };
+		for (int k = 0; k < 9; k++) racer->rotation[k] = rotation[k];
+
+		for (int k = 0; k < 3; k++)
+		{
+			racer->translation[k] = randomFloat(-300.0f, 300.0f);
+			racer->centerOfMass[k] = racer->translation[k];
+			racer->linearVelocity[k] = randomFloat(-40.0f, 40.0f);
+			racer->angularVelocity[k] = randomFloat(-2.0f, 2.0f);
+		}
+
+		float attach[4][3] = { { -0.8f, -0.67f, 1.65f }, { 0.8f, -0.67f, 1.65f }, { -0.8f, -0.6f, -1.3f }, { 0.8f, -0.6f, -1.3f } };
+		for (int w = 0; w < 4; w++)
+		{
+			racer->wheels[w] = new BenchWheel();
+			racer->wheels[w]->touchingGround = (rand() % 8) != 0;
+			for (int k = 0; k < 3; k++)
+			{
+				racer->attach[w][k] = attach[w][k];
+				racer->wheels[w]->position[k] = racer->translation[k] + randomFloat(-1.5f, 1.5f);
+			}
+		}
+
+		racers.push_back(racer);
+	}
+
+	vector<float> wheelForces(numRacers * 12);
+	vector<float> bodyForces(numRacers * 3);
+	float sink = 0.0f;
+
+	BenchTimer perObject;
+	perObject.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		for (int i = 0; i < numRacers; i++)
+		{
+			perObjectForces(racers[i], &wheelForces[i * 12], &bodyForces[i * 3]);
+		}
+		sink += wheelForces[it % wheelForces.size()];
+	}
+	perObject.stop();
+
+	SuspensionBatch batch, reference;
+	vector<int> slots(numRacers);
+	for (int i = 0; i < numRacers; i++)
+	{
+		slots[i] = addRacer(batch, racers[i]);
+		addRacer(reference, racers[i]);
+	}
+
+	BenchTimer batched;
+	batched.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		for (int i = 0; i < numRacers; i++)
+		{
+			fillRacer(batch, slots[i], racers[i]);
+		}
+		batch.compute();
+		sink += batch.forceX[it % MAX_BATCH_WHEELS];
+	}
+	batched.stop();
+
+	BenchTimer kernel;
+	kernel.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		batch.compute();
+		sink += batch.forceY[it % MAX_BATCH_WHEELS];
+	}
+	kernel.stop();
+
+	// The SSE kernel against the scalar reference and the per-object maths
+	for (int i = 0; i < numRacers; i++)
+	{
+		fillRacer(reference, slots[i], racers[i]);
+	}
+	reference.computeReference();
+
+	float objectError = 0.0f, referenceError = 0.0f;
+	int grounded = 0, airborneForces = 0;
+	for (int i = 0; i < numRacers; i++)
+	{
+		int b = slots[i];
+		for (int w = 0; w < 4; w++)
+		{
+			int wheel = b * 4 + w;
+			const float* expected = &wheelForces[i * 12 + w * 3];
+			objectError = max(objectError, (float) fabs(batch.forceX[wheel] - expected[0]));
+			objectError = max(objectError, (float) fabs(batch.forceY[wheel] - expected[1]));
+			objectError = max(objectError, (float) fabs(batch.forceZ[wheel] - expected[2]));
+			referenceError = max(referenceError, (float) fabs(batch.forceX[wheel] - reference.forceX[wheel]));
+			referenceError = max(referenceError, (float) fabs(batch.forceY[wheel] - reference.forceY[wheel]));
+			referenceError = max(referenceError, (float) fabs(batch.forceZ[wheel] - reference.forceZ[wheel]));
+
+			if (racers[i]->wheels[w]->touchingGround)
+			{
+				grounded++;
+			}
+			else if (batch.forceX[wheel] != 0.0f || batch.forceY[wheel] != 0.0f || batch.forceZ[wheel] != 0.0f)
+			{
+				airborneForces++;
+			}
+		}
+		const float* expected = &bodyForces[i * 3];
+		objectError = max(objectError, (float) fabs(batch.bodyForceX[b] - expected[0]));
+		objectError = max(objectError, (float) fabs(batch.bodyForceY[b] - expected[1]));
+		objectError = max(objectError, (float) fabs(batch.bodyForceZ[b] - expected[2]));
+		referenceError = max(referenceError, (float) fabs(batch.bodyForceX[b] - reference.bodyForceX[b]));
+		referenceError = max(referenceError, (float) fabs(batch.bodyForceY[b] - reference.bodyForceY[b]));
+		referenceError = max(referenceError, (float) fabs(batch.bodyForceZ[b] - reference.bodyForceZ[b]));
+	}
+
+	int failures = 0;
+	failures += check(objectError < SUSPENSION_TOLERANCE, "SSE forces match the per-object maths");
+	failures += check(referenceError < SUSPENSION_TOLERANCE, "SSE forces match the scalar reference");
+	failures += check(airborneForces == 0, "wheels off the ground push nothing");
+	failures += check(grounded > 0 && grounded < numRacers * 4, "some wheels on the ground and some off");
+
+	cout << "Racers: " << numRacers << ", wheels on the ground: " << grounded << ", iterations: " << iterations << endl;
+	// Only the maths: the game also pays for Havok's getters and applyForce on either path,
+	// which the "Racer forces" debug line times with BATCHFORCES 1 and 0
+	double racerTicks = iterations * (double) numRacers;
+	cout << "Per-object maths: " << perObject.milliseconds() << " ms (" << perObject.nanosecondsPer(racerTicks) << " ns per racer)" << endl;
+	cout << "Batched SSE:      " << batched.milliseconds() << " ms (" << batched.nanosecondsPer(racerTicks) << " ns per racer, filling the slots included)" << endl;
+	cout << "SSE kernel only:  " << kernel.milliseconds() << " ms (" << kernel.nanosecondsPer(racerTicks) << " ns per racer)" << endl;
+	cout << "Max difference:   " << objectError << " from the per-object maths, " << referenceError << " from the scalar reference" << endl;
+	cout << "(checksum " << sink << ")" << endl;
+
+	for (int i = 0; i < numRacers; i++)
+	{
+		for (int w = 0; w < 4; w++)
+		{
+			delete racers[i]->wheels[w];
+		}
+		delete racers[i];
+	}
+
+	return finish(failures);
+}
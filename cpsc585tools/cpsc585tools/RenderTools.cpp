@@ -0,0 +1,850 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "FrustumCuller.h"
+#include "InstanceBatch.h"
+#include "MeshFile.h"
+#include "NullBackend.h"
+#include "RenderQueue.h"
+#include "ShadowSilhouette.h"
+#include "StateCache.h"
+#include "TextureCache.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+// Records a race's worth of draws (see queueRace), then counts what reaches
+// the backend with and without sorting
+int renderqueue(int argc, char** argv)
+{
+	int numRacers = argument(argc, argv, 2, 8);
+	int numDynamic = argument(argc, argv, 3, 40);
+	int iterations = argument(argc, argv, 4, 2000);
+
+	srand(585);
+	int failures = 0;
+
+	vector<RaceDrawable> drawables;
+	raceDrawables(numRacers, numDynamic, drawables);
+
+	for (int twoSided = 1; twoSided >= 0; twoSided--)
+	{
+		RenderQueue queue;
+		NullBackend unsorted, sorted;
+
+		queueRace(queue, drawables, twoSided != 0);
+		queue.replay(&unsorted);
+		queue.sort();
+		queue.replay(&sorted);
+
+		bool ordered = true;
+		for (int i = 1; i < queue.getCount(); i++)
+		{
+			ordered = ordered && queue.getKey(i - 1) <= queue.getKey(i);
+		}
+		failures += check(ordered, "keys in order after sorting");
+		failures += check(sorted.drawCalls == queue.getCount() && unsorted.drawCalls == queue.getCount(), "every command drawn once");
+		failures += check(sorted.getStateChanges() <= unsorted.getStateChanges(), "sorting never adds state changes");
+
+		// Sorted, each pass starts once and each texture is set once in it
+		failures += check(sorted.passChanges == (twoSided ? 2 : 3), "each pass started once");
+		failures += check(sorted.textureChanges <= RACE_TEXTURES + 1, "each texture set once");
+
+		cout << (twoSided ? "Two-sided stencil" : "Two pass stencil") << ", " << queue.getCount() << " commands:" << endl;
+		cout << "  old draw order: " << unsorted.passChanges << " passes, " << unsorted.textureChanges << " textures, "
+			<< unsorted.geometryChanges << " meshes, " << unsorted.transformChanges << " transforms, " << unsorted.drawCalls << " draws" << endl;
+		cout << "  sorted:         " << sorted.passChanges << " passes, " << sorted.textureChanges << " textures, "
+			<< sorted.geometryChanges << " meshes, " << sorted.transformChanges << " transforms, " << sorted.drawCalls << " draws" << endl;
+	}
+
+	// Cost of recording and sorting a frame
+	RenderQueue queue;
+	BenchTimer elapsed;
+	elapsed.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		queueRace(queue, drawables, true);
+		queue.sort();
+	}
+	elapsed.stop();
+	cout << "Record and sort: " << elapsed.microsecondsPer(iterations) << " us per frame" << endl;
+
+	return finish(failures);
+}
+
+// Loader that hands out dummy objects and counts them, in place of a device
+class StubTextureLoader : public TextureLoader
+{
+public:
+	StubTextureLoader() { created = 0; destroyed = 0; }
+
+	void* create(const std::string& /*path*/, const char* /*data*/, unsigned int /*size*/, const TextureInfo& /*info*/)
+	{
+		created++;
+		return new char[1];
+	}
+
+	void destroy(void* texture)
+	{
+		destroyed++;
+		delete [] (char*) texture;
+	}
+
+	int created;
+	int destroyed;
+};
+
+// Checks the cache's sharing, pinning and stats against a stub loader, and
+// prints what the DDS header parser makes of every texture
+int texturecache(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "textures");
+	int spawns = argument(argc, argv, 3, 200);
+
+	vector<string> files = listFiles(directory, ".dds");
+	if (files.empty())
+	{
+		cerr << "No .dds files in " << directory << endl;
+		return 1;
+	}
+
+	int failures = 0;
+	unsigned int totalBytes = 0;
+
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		ifstream filestream((directory + "/" + files[i]).c_str(), ifstream::binary);
+		char header[128];
+		filestream.read(header, sizeof(header));
+
+		TextureInfo info;
+		bool parsed = TextureCache::parseDDSHeader(header, (unsigned int) filestream.gcount(), info);
+		failures += check(parsed, "parse " + files[i]);
+
+		cout << files[i] << ": " << info.width << "x" << info.height << ", " << info.mipLevels << " levels, "
+			<< (info.fourCC ? "compressed" : "uncompressed") << " " << info.bitsPerPixel << " bpp, "
+			<< info.bytes / 1024 << " KB" << endl;
+		totalBytes += info.bytes;
+	}
+	cout << "Total if all resident: " << totalBytes / 1024 << " KB" << endl;
+
+	string first = directory + "/" + files[0];
+	string second = directory + "/" + files[files.size() - 1];
+	string missing = directory + "/missing.dds";
+
+	// Sharing: one create per path however many users
+	{
+		StubTextureLoader* loader = new StubTextureLoader();
+		TextureCache cache(loader);
+
+		CachedTexture* a = cache.acquire(first);
+		CachedTexture* b = cache.acquire(first);
+		failures += check(a == b && a->texture != NULL, "same path gives the same texture");
+		failures += check(loader->created == 1 && cache.hits == 1 && cache.misses == 1, "second acquire is a hit");
+		failures += check(a->refCount == 2 && cache.bytesResident == a->info.bytes, "refcount and bytes");
+
+		cache.release(a);
+		failures += check(loader->destroyed == 0 && cache.getResidentCount() == 1, "still used after one release");
+		cache.release(b);
+		failures += check(loader->destroyed == 1 && cache.getResidentCount() == 0 && cache.bytesResident == 0, "destroyed after the last release");
+
+		CachedTexture* m1 = cache.acquire(missing);
+		CachedTexture* m2 = cache.acquire(missing);
+		failures += check(m1 == m2 && m1->texture == NULL && loader->created == 1, "missing file is remembered");
+		cache.release(m1);
+		cache.release(m2);
+	}
+
+	// Preloading pins until unpinAll
+	{
+		string manifest = directory + "/cachetest.txt";
+		ofstream out(manifest.c_str());
+		out << first << endl << second << endl << missing << endl;
+		out.close();
+
+		StubTextureLoader* loader = new StubTextureLoader();
+		TextureCache cache(loader);
+
+		int loaded = cache.preload(manifest);
+		remove(manifest.c_str());
+		failures += check(loaded == (first == second ? 1 : 2), "preload count");
+
+		CachedTexture* a = cache.acquire(first);
+		cache.release(a);
+		failures += check(loader->destroyed == 0 && cache.misses == 0 && cache.hits == 1, "preloaded texture survives release");
+
+		cache.unpinAll();
+		failures += check(loader->destroyed == loader->created && cache.bytesResident == 0, "unpinAll frees unused textures");
+	}
+
+	// Rockets spawning and dying: the old path created a texture every time
+	{
+		StubTextureLoader* loader = new StubTextureLoader();
+		TextureCache cache(loader);
+
+		BenchTimer uncached;
+		uncached.start();
+		for (int i = 0; i < spawns; i++)
+		{
+			cache.release(cache.acquire(first));
+		}
+		uncached.stop();
+		int uncachedCreates = loader->created;
+
+		string manifest = directory + "/cachetest.txt";
+		ofstream out(manifest.c_str());
+		out << first << endl;
+		out.close();
+		cache.preload(manifest);
+		remove(manifest.c_str());
+
+		int before = loader->created;
+		BenchTimer cached;
+		cached.start();
+		for (int i = 0; i < spawns; i++)
+		{
+			cache.release(cache.acquire(first));
+		}
+		cached.stop();
+
+		failures += check(loader->created == before, "no creates once preloaded");
+
+		cout << spawns << " spawns of " << files[0] << ": " << uncachedCreates << " loads, " << uncached.milliseconds()
+			<< " ms unpinned; " << loader->created - before << " loads, " << cached.milliseconds() << " ms preloaded" << endl;
+	}
+
+	return finish(failures);
+}
+
+struct CullingScene
+{
+	vector<float> x, y, z, radius;
+	vector<bool> casts;
+};
+
+// Sphere of a model from its .mesh header, at a position (models are left unrotated)
+static void addModel(CullingScene& scene, const MeshFile& mesh, float x, float y, float z, bool casts)
+{
+	scene.x.push_back(x + mesh.header.sphereCenter[0]);
+	scene.y.push_back(y + mesh.header.sphereCenter[1]);
+	scene.z.push_back(z + mesh.header.sphereCenter[2]);
+	scene.radius.push_back(mesh.header.sphereRadius);
+	scene.casts.push_back(casts);
+}
+
+// Runs the renderer's culling along a camera path (see cameraPath). Checks the
+// SSE test against the scalar one and that nothing culled could have been seen.
+int culling(int argc, char** argv)
+{
+	string trackFile = argument(argc, argv, 2, "RaceTrack.txt");
+	string pathFile = argument(argc, argv, 3, "");
+	int iterations = argument(argc, argv, 4, 200);
+
+	vector<float> waypoints, path;
+	if (!cameraPath(trackFile, pathFile, waypoints, path))
+	{
+		return 1;
+	}
+	int numWaypoints = waypoints.size() / 3;
+	int numFrames = path.size() / 6;
+
+	MeshFile world, racer, frontTire, rearTire, gunmount, gun, rocket, landmine;
+	if (!world.load("models/world.mesh") || !racer.load("models/racer.mesh") || !frontTire.load("models/frontTire.mesh")
+		|| !rearTire.load("models/rearTire.mesh") || !gunmount.load("models/gunmount.mesh") || !gun.load("models/gun.mesh")
+		|| !rocket.load("models/rocket.mesh") || !landmine.load("models/landmine.mesh"))
+	{
+		cerr << "Could not read the models in models/" << endl;
+		return 1;
+	}
+
+	// Projection as Renderer::initialize sets it up, for a 16:9 screen
+	float projection[16];
+	perspectiveFovLH(3.14159265f / 2.5f, 16.0f / 9.0f, 1.0f, 1200.0f, projection);
+
+	float light[3] = { 0.0f, -0.7f, -1.0f };
+	float lightLength = sqrt(light[1] * light[1] + light[2] * light[2]);
+	light[1] /= lightLength;
+	light[2] /= lightLength;
+
+	srand(585);
+	int failures = 0;
+	long long totalDrawn = 0, totalVisible = 0, totalShadows = 0, totalShadowsCulled = 0;
+	BenchTimer sseTime, referenceTime;
+
+	FrustumCuller culler;
+	vector<unsigned char> visible, reference;
+
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		const float* focus = &path[frame * 6];
+		const float* look = &path[frame * 6 + 3];
+
+		// The followed racer plus 7 others spread around the track, and some rockets and landmines
+		CullingScene scene;
+		addModel(scene, world, 0.0f, 0.0f, 0.0f, false);
+		for (int r = 0; r < 8; r++)
+		{
+			float position[3];
+			if (r == 0)
+			{
+				memcpy(position, focus, sizeof(position));
+			}
+			else
+			{
+				memcpy(position, &waypoints[((frame / 8 + r * numWaypoints / 8) % numWaypoints) * 3], sizeof(position));
+			}
+
+			addModel(scene, racer, position[0], position[1], position[2], true);
+			addModel(scene, gunmount, position[0], position[1] + 1.0f, position[2], true);
+			addModel(scene, gun, position[0], position[1] + 1.5f, position[2], false);
+			addModel(scene, frontTire, position[0] - 1.0f, position[1] - 0.5f, position[2] + 1.5f, true);
+			addModel(scene, frontTire, position[0] + 1.0f, position[1] - 0.5f, position[2] + 1.5f, true);
+			addModel(scene, rearTire, position[0] - 1.0f, position[1] - 0.5f, position[2] - 1.5f, true);
+			addModel(scene, rearTire, position[0] + 1.0f, position[1] - 0.5f, position[2] - 1.5f, true);
+		}
+		for (int i = 0; i < 40; i++)
+		{
+			const float* spot = &waypoints[(rand() % numWaypoints) * 3];
+			addModel(scene, i % 2 ? rocket : landmine, spot[0] + randomFloat(-10.0f, 10.0f), spot[1], spot[2] + randomFloat(-10.0f, 10.0f), false);
+		}
+
+		// Shadow volume spheres, as Renderer::cullScene builds them
+		CullingScene shadows;
+		for (unsigned int i = 0; i < scene.x.size(); i++)
+		{
+			if (scene.casts[i])
+			{
+				shadows.x.push_back(scene.x[i] + light[0] * SHADOW_EXTRUDE_DISTANCE * 0.5f);
+				shadows.y.push_back(scene.y[i] + light[1] * SHADOW_EXTRUDE_DISTANCE * 0.5f);
+				shadows.z.push_back(scene.z[i] + light[2] * SHADOW_EXTRUDE_DISTANCE * 0.5f);
+				shadows.radius.push_back(scene.radius[i] + SHADOW_EXTRUDE_DISTANCE * 0.5f);
+			}
+		}
+
+		float eye[3], viewProjection[16];
+		followCamera(focus, look, projection, eye, viewProjection);
+		culler.setViewProjection(viewProjection);
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			CullingScene& spheres = pass == 0 ? scene : shadows;
+			int count = spheres.x.size();
+			culler.setDistanceLimit(eye, pass == 0 ? 0.0f : 500.0f);
+
+			visible.resize(count);
+			reference.resize(count);
+
+			sseTime.start();
+			for (int it = 0; it < iterations; it++)
+			{
+				culler.cull(&spheres.x[0], &spheres.y[0], &spheres.z[0], &spheres.radius[0], count, &visible[0]);
+			}
+			sseTime.stop();
+			int numVisible = culler.visibleCount;
+
+			referenceTime.start();
+			for (int it = 0; it < iterations; it++)
+			{
+				culler.cullReference(&spheres.x[0], &spheres.y[0], &spheres.z[0], &spheres.radius[0], count, &reference[0]);
+			}
+			referenceTime.stop();
+
+			if (visible != reference || numVisible != culler.visibleCount)
+			{
+				cerr << "Frame " << frame << ": SSE and scalar culling disagree" << endl;
+				failures++;
+			}
+
+			if (pass == 0)
+			{
+				failures += check(visible[0] && visible[1], "world and followed racer are visible");
+				totalDrawn += count;
+				totalVisible += numVisible;
+			}
+			else
+			{
+				totalShadows += count;
+				totalShadowsCulled += count - numVisible;
+			}
+
+			// Nothing culled may reach the screen: points over the sphere all project outside
+			// it, or the sphere is past the distance limit
+			for (int i = 0; i < count; i++)
+			{
+				if (visible[i])
+				{
+					continue;
+				}
+
+				float dx = spheres.x[i] - eye[0], dy = spheres.y[i] - eye[1], dz = spheres.z[i] - eye[2];
+				if (pass == 1 && sqrt(dx * dx + dy * dy + dz * dz) - spheres.radius[i] > 500.0f)
+				{
+					continue;
+				}
+
+				for (int s = 0; s < 64; s++)
+				{
+					float theta = randomFloat(0.0f, 6.2831853f), height = randomFloat(-1.0f, 1.0f);
+					float ring = sqrt(1.0f - height * height) * spheres.radius[i] * randomFloat(0.0f, 1.0f);
+					if (!outsideClip(viewProjection, spheres.x[i] + ring * cos(theta), spheres.y[i] + height * spheres.radius[i], spheres.z[i] + ring * sin(theta)))
+					{
+						cerr << "Frame " << frame << ": sphere " << i << (pass ? " (shadow)" : "") << " was culled but can be seen" << endl;
+						failures++;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	cout << numFrames << " camera positions, " << totalDrawn / numFrames << " drawables and " << totalShadows / numFrames << " shadow volumes per frame" << endl;
+	cout << "  drawables visible: " << (double) totalVisible / numFrames << ", culled: " << (double) (totalDrawn - totalVisible) / numFrames << endl;
+	cout << "  shadow volumes culled: " << (double) totalShadowsCulled / numFrames << endl;
+	cout << "  SSE: " << sseTime.microsecondsPer(numFrames * iterations) << " us per frame, scalar: "
+		<< referenceTime.microsecondsPer(numFrames * iterations) << " us per frame" << endl;
+
+	return finish(failures);
+}
+
+// Device that records what reaches it, in place of a D3D9 device
+class MockStateDevice : public StateDevice
+{
+public:
+	MockStateDevice() { calls = 0; }
+
+	void setRenderState(unsigned int state, unsigned int value) { calls++; set(0, state, 0, value); }
+	void setSamplerState(unsigned int sampler, unsigned int type, unsigned int value) { calls++; set(1, sampler, type, value); }
+	void setTextureStageState(unsigned int stage, unsigned int type, unsigned int value) { calls++; set(2, stage, type, value); }
+	void setTexture(unsigned int stage, void* texture) { calls++; set(3, stage, 0, (unsigned long long) (size_t) texture); }
+	void setStreamSource(unsigned int stream, void* buffer, unsigned int offset, unsigned int stride)
+	{
+		calls++;
+		set(4, stream, 0, (unsigned long long) (size_t) buffer);
+		set(4, stream, 1, offset);
+		set(4, stream, 2, stride);
+	}
+	void setFVF(unsigned int fvf) { calls++; set(5, 0, 0, fvf); }
+	void setVertexDeclaration(void* declaration) { calls++; set(5, 0, 0, (unsigned long long) (size_t) declaration | 1ULL << 40); }
+	void setIndices(void* indices) { calls++; set(6, 0, 0, (unsigned long long) (size_t) indices); }
+	void setTransform(unsigned int type, const float* matrix)
+	{
+		calls++;
+		for (int k = 0; k < 16; k++)
+		{
+			unsigned int bits;
+			memcpy(&bits, &matrix[k], sizeof(bits));
+			set(7, type, k, bits);
+		}
+	}
+
+	int calls;
+	map<unsigned long long, unsigned long long> state;	// (kind, index, type) -> value
+
+private:
+	void set(unsigned int kind, unsigned int index, unsigned int type, unsigned long long value)
+	{
+		state[((unsigned long long) kind << 48) | ((unsigned long long) index << 16) | type] = value;
+	}
+};
+
+// One random call, made the same way on the cache and straight on a device
+static void randomStateCall(StateCache& cache, MockStateDevice& direct, float* matrices)
+{
+	unsigned int a = rand() % 3, b = rand() % 3, value = rand() % 3;
+	void* pointer = (void*) (size_t) (0x1000 + (rand() % 3) * 0x100);
+	const unsigned int transformTypes[] = { 2, 3, 256, 16 };
+
+	switch (rand() % 10)
+	{
+	case 0:
+		// Mostly cached states, sometimes one past the end
+		a = rand() % 8 ? 7 + a : STATE_CACHE_RENDER_STATES + a;
+		cache.setRenderState(a, value);
+		direct.setRenderState(a, value);
+		break;
+	case 1:
+		cache.setSamplerState(a, b, value);
+		direct.setSamplerState(a, b, value);
+		break;
+	case 2:
+		cache.setTextureStageState(a, b, value);
+		direct.setTextureStageState(a, b, value);
+		break;
+	case 3:
+		cache.setTexture(a, pointer);
+		direct.setTexture(a, pointer);
+		break;
+	case 4:
+		cache.setStreamSource(a, pointer, b * 16, 32 + value * 4);
+		direct.setStreamSource(a, pointer, b * 16, 32 + value * 4);
+		break;
+	case 5:
+		cache.setFVF(value);
+		direct.setFVF(value);
+		break;
+	case 6:
+		cache.setIndices(pointer);
+		direct.setIndices(pointer);
+		break;
+	case 7:
+		cache.setVertexDeclaration(pointer);
+		direct.setVertexDeclaration(pointer);
+		break;
+	default:
+		a = transformTypes[a + (rand() % 4 == 0)];
+		cache.setTransform(a, &matrices[value * 16]);
+		direct.setTransform(a, &matrices[value * 16]);
+		break;
+	}
+}
+
+// The sets one frame of the game makes, in the order it makes them: the skybox,
+// the sorted opaque pass, the shadow passes and the particle systems. States
+// are numbered by their D3DRS_ values.
+static void stateCacheFrame(StateCache& cache, int numRacers, const vector<float>& transforms)
+{
+	void* skybox = (void*) 0x100;
+	void* world = (void*) 0x200;
+	void* racer = (void*) 0x300;
+	void* tire = (void*) 0x400;
+	void* smoke = (void*) 0x500;
+
+	const float* identity = &transforms[0];
+
+	cache.setTransform(3, identity);
+	cache.setTransform(2, &transforms[16]);
+	cache.setTransform(256, identity);
+	cache.setRenderState(7, 0);			// ZENABLE
+	cache.setRenderState(137, 0);		// LIGHTING
+	cache.setTexture(0, skybox);
+	cache.setStreamSource(0, skybox, 0, 32);
+	cache.setFVF(0x212);
+	cache.setIndices(skybox);
+	cache.setRenderState(137, 1);
+	cache.setRenderState(7, 1);
+	cache.setTransform(2, &transforms[32]);
+
+	// Opaque pass: the world, then racers and their wheels sorted by texture and mesh
+	cache.setRenderState(28, 1);		// FOGENABLE
+	cache.setTexture(0, world);
+	cache.setStreamSource(0, world, 0, 32);
+	cache.setFVF(0x212);
+	cache.setIndices(world);
+	cache.setTransform(256, identity);
+	for (int r = 0; r < numRacers; r++)
+	{
+		cache.setTexture(0, (char*) racer + r);
+		cache.setStreamSource(0, racer, 0, 32);
+		cache.setFVF(0x212);
+		cache.setIndices(racer);
+		cache.setTransform(256, &transforms[(3 + r * 5) * 16]);
+	}
+	cache.setTexture(0, tire);
+	cache.setStreamSource(0, tire, 0, 32);
+	cache.setFVF(0x212);
+	cache.setIndices(tire);
+	for (int w = 0; w < numRacers * 4; w++)
+	{
+		cache.setTransform(256, &transforms[(4 + (w / 4) * 5 + w % 4) * 16]);
+	}
+	cache.setRenderState(28, 0);
+
+	// Two-sided stencil shadow pass
+	const unsigned int shadowStates[][2] = { { 15, 0 }, { 137, 0 }, { 7, 1 }, { 14, 0 }, { 52, 1 }, { 9, 1 }, { 56, 8 },
+		{ 54, 1 }, { 53, 1 }, { 58, 0xFFFFFFFF }, { 59, 0xFFFFFFFF }, { 55, 7 }, { 27, 1 }, { 19, 1 }, { 20, 2 },
+		{ 185, 1 }, { 189, 8 }, { 187, 1 }, { 186, 1 }, { 188, 8 }, { 22, 1 } };
+	for (unsigned int i = 0; i < sizeof(shadowStates) / sizeof(shadowStates[0]); i++)
+	{
+		cache.setRenderState(shadowStates[i][0], shadowStates[i][1]);
+	}
+	for (int c = 0; c < numRacers * 6; c++)
+	{
+		cache.setTransform(256, &transforms[(3 + c) * 16]);
+		cache.setStreamSource(0, (char*) racer + 0x1000 + c, 0, 12);
+		cache.setFVF(0x2);
+	}
+	const unsigned int finishStates[][2] = { { 185, 0 }, { 9, 2 }, { 22, 3 }, { 14, 1 }, { 7, 0 }, { 27, 1 }, { 19, 5 },
+		{ 20, 6 }, { 57, 1 }, { 52, 1 }, { 55, 1 }, { 7, 1 }, { 137, 1 }, { 52, 0 } };
+	for (unsigned int i = 0; i < sizeof(finishStates) / sizeof(finishStates[0]); i++)
+	{
+		cache.setRenderState(finishStates[i][0], finishStates[i][1]);
+	}
+	cache.setTextureStageState(0, 2, 2);
+	cache.setTextureStageState(0, 3, 0);
+	cache.setTextureStageState(0, 1, 4);
+	cache.setTextureStageState(0, 5, 2);
+	cache.setTextureStageState(0, 6, 0);
+	cache.setTextureStageState(0, 4, 4);
+	cache.setStreamSource(0, (void*) 0x900, 0, 20);
+	cache.setFVF(0x44);
+
+	// Smoke and lasers each set up blending, then undo it
+	for (int system = 0; system < 2; system++)
+	{
+		cache.setRenderState(27, 1);
+		cache.setRenderState(15, 1);
+		cache.setRenderState(19, 5);
+		cache.setRenderState(20, 6);
+		cache.setRenderState(137, 0);
+		cache.setTextureStageState(0, 5, 2);
+		cache.setTextureStageState(0, 6, 0);
+		cache.setTextureStageState(0, 4, 4);
+		cache.setRenderState(24, 50);
+		cache.setRenderState(25, 5);
+		cache.setFVF(0x42);
+		cache.setRenderState(154, 0x3F800000);
+		cache.setTexture(0, smoke);
+		cache.setStreamSource(0, smoke, 0, 16);
+		cache.setRenderState(27, 0);
+		cache.setRenderState(15, 0);
+	}
+	cache.setTransform(256, identity);
+}
+
+// Checks the state cache against a mock device and counts what it filters
+// from a frame of the game's state changes
+int statecache(int argc, char** argv)
+{
+	int calls = argument(argc, argv, 2, 100000);
+	int numRacers = argument(argc, argv, 3, 8);
+
+	srand(585);
+	int failures = 0;
+
+	// The basics for every kind of call
+	{
+		MockStateDevice* device = new MockStateDevice();
+		StateCache cache(device);
+		float a[16] = { 1.0f }, b[16] = { 2.0f };
+		void* texture = (void*) 0x10;
+
+		cache.setRenderState(7, 1);
+		cache.setRenderState(7, 1);
+		failures += check(device->calls == 1 && cache.filtered == 1, "repeated render state filtered");
+		cache.setRenderState(7, 0);
+		failures += check(device->calls == 2, "changed render state goes through");
+
+		cache.setSamplerState(0, 1, 3);
+		cache.setSamplerState(0, 1, 3);
+		cache.setSamplerState(1, 1, 3);
+		cache.setTextureStageState(0, 4, 4);
+		cache.setTextureStageState(0, 4, 4);
+		cache.setTexture(0, texture);
+		cache.setTexture(0, texture);
+		cache.setTexture(1, texture);
+		failures += check(device->calls == 7, "samplers, stages and textures are tracked separately");
+
+		cache.setStreamSource(0, texture, 0, 32);
+		cache.setStreamSource(0, texture, 0, 32);
+		cache.setStreamSource(0, texture, 0, 12);
+		cache.setFVF(0x212);
+		cache.setFVF(0x212);
+		cache.setIndices(texture);
+		cache.setIndices(texture);
+		failures += check(device->calls == 11, "stream source, FVF and indices");
+
+		cache.setTransform(256, a);
+		cache.setTransform(256, a);
+		cache.setTransform(256, b);
+		cache.setTransform(2, b);
+		cache.setTransform(16, a);
+		cache.setTransform(16, a);
+		failures += check(device->calls == 16, "transforms compare by value, uncached types go through");
+
+		cache.setRenderState(STATE_CACHE_RENDER_STATES + 1, 1);
+		cache.setRenderState(STATE_CACHE_RENDER_STATES + 1, 1);
+		failures += check(device->calls == 18, "render states past the table go through");
+
+		int before = device->calls;
+		cache.invalidate();
+		cache.setRenderState(7, 0);
+		cache.setTransform(256, b);
+		failures += check(device->calls == before + 2, "invalidate resends");
+
+		int submitted = cache.submitted, filtered = cache.filtered;
+		cache.beginFrame();
+		failures += check(cache.frameSubmitted == submitted && cache.frameFiltered == filtered
+			&& cache.submitted == 0 && cache.filtered == 0, "beginFrame keeps the last frame's counts");
+		failures += check(submitted == 28 && filtered == 8, "submitted and filtered counts");
+	}
+
+	// Random calls: the device behind the cache must always end up in the same
+	// state as one that got every call
+	{
+		MockStateDevice* cached = new MockStateDevice();
+		MockStateDevice direct;
+		StateCache cache(cached);
+
+		float matrices[48];
+		for (int i = 0; i < 48; i++)
+		{
+			matrices[i] = (float) (i % 5);
+		}
+
+		bool same = true;
+		for (int i = 0; i < calls && same; i++)
+		{
+			randomStateCall(cache, direct, matrices);
+			if (i % 64 == 0 || i == calls - 1)
+			{
+				same = cached->state == direct.state;
+			}
+		}
+		failures += check(same, "device state matches with and without the cache");
+
+		cout << calls << " random calls: " << cached->calls << " reached the device, " << cache.filtered << " filtered" << endl;
+	}
+
+	// A frame of the game's state changes, after the first has filled the cache
+	{
+		vector<float> transforms((3 + numRacers * 5) * 16);
+		for (unsigned int i = 0; i < transforms.size(); i++)
+		{
+			transforms[i] = randomFloat(-1.0f, 1.0f);
+		}
+		memset(&transforms[0], 0, sizeof(float) * 16);
+		transforms[0] = transforms[5] = transforms[10] = transforms[15] = 1.0f;
+
+		MockStateDevice* device = new MockStateDevice();
+		StateCache cache(device);
+
+		stateCacheFrame(cache, numRacers, transforms);
+		cache.beginFrame();
+		int firstFrame = device->calls;
+
+		BenchTimer elapsed;
+		int frames = 1000;
+		elapsed.start();
+		for (int f = 0; f < frames; f++)
+		{
+			stateCacheFrame(cache, numRacers, transforms);
+			cache.beginFrame();
+		}
+		elapsed.stop();
+
+		cout << "Frame with " << numRacers << " racers: " << cache.frameSubmitted << " calls, " << cache.frameFiltered
+			<< " filtered (" << 100 * cache.frameFiltered / cache.frameSubmitted << "%), "
+			<< (device->calls - firstFrame) / frames << " reach the device; "
+			<< elapsed.microsecondsPer(frames) << " us per frame in the cache" << endl;
+	}
+
+	return finish(failures);
+}
+
+// Checks InstanceBatch's grouping and packing on a race's worth of drawables
+// (see raceDrawables) and counts the draws and state changes it saves
+int instancing(int argc, char** argv)
+{
+	int numRacers = argument(argc, argv, 2, 8);
+	int numDynamic = argument(argc, argv, 3, 40);
+	int iterations = argument(argc, argv, 4, 20000);
+
+	srand(585);
+	int failures = 0;
+
+	char meshes[RACE_MESHES], textures[RACE_TEXTURES];
+	vector<RaceDrawable> items;
+	raceDrawables(numRacers, numDynamic, items);
+
+	InstanceBatch batch;
+	for (unsigned int i = 0; i < items.size(); i++)
+	{
+		batch.add(&meshes[items[i].mesh], &textures[items[i].texture], items[i].transform, 0xFF000000 | i, items[i].depth, &items[i]);
+	}
+	batch.build();
+
+	// Every drawable once, in a group with its mesh and texture, with its matrix columns
+	int seen = 0, draws = 0;
+	for (int g = 0; g < batch.getGroupCount(); g++)
+	{
+		InstanceGroup* group = batch.getGroup(g);
+		float nearest = 1e30f;
+
+		failures += check(group->first == seen, "groups are packed back to back");
+		for (int i = group->first; i < group->first + group->count; i++)
+		{
+			RaceDrawable* item = (RaceDrawable*) batch.getOwner(i);
+			const InstanceData& data = batch.getInstances()[i];
+
+			bool matches = group->geometry == &meshes[item->mesh] && group->texture == &textures[item->texture]
+				&& data.colour == (0xFF000000 | (unsigned int) (item - &items[0]));
+			for (int k = 0; k < 4; k++)
+			{
+				matches = matches && data.column0[k] == item->transform[k * 4] && data.column1[k] == item->transform[k * 4 + 1]
+					&& data.column2[k] == item->transform[k * 4 + 2];
+			}
+			failures += check(matches, "instance data matches its drawable");
+
+			if (item->depth < nearest)
+			{
+				nearest = item->depth;
+			}
+		}
+		failures += check(group->depth == nearest, "group depth is its nearest instance");
+
+		seen += group->count;
+		draws += group->count >= INSTANCE_MIN_COUNT ? 1 : group->count;
+	}
+	failures += check(seen == (int) items.size() && batch.getInstanceCount() == seen, "every drawable packed once");
+
+	// The opaque pass played back with and without instancing
+	RenderQueue plain, instanced;
+	for (unsigned int i = 0; i < items.size(); i++)
+	{
+		plain.submit(RENDER_PASS_OPAQUE, RENDER_DRAW_MESH, &textures[items[i].texture], &meshes[items[i].mesh], items[i].transform, items[i].depth);
+	}
+	for (int g = 0; g < batch.getGroupCount(); g++)
+	{
+		InstanceGroup* group = batch.getGroup(g);
+		if (group->count >= INSTANCE_MIN_COUNT)
+		{
+			instanced.submit(RENDER_PASS_OPAQUE, RENDER_DRAW_INSTANCES, group->texture, group, NULL, group->depth);
+		}
+		else
+		{
+			for (int i = group->first; i < group->first + group->count; i++)
+			{
+				RaceDrawable* item = (RaceDrawable*) batch.getOwner(i);
+				instanced.submit(RENDER_PASS_OPAQUE, RENDER_DRAW_MESH, &textures[item->texture], &meshes[item->mesh], item->transform, item->depth);
+			}
+		}
+	}
+
+	NullBackend plainBackend, instancedBackend;
+	plain.sort();
+	plain.replay(&plainBackend);
+	instanced.sort();
+	instanced.replay(&instancedBackend);
+	failures += check(instancedBackend.drawCalls == draws, "one draw per instanced group");
+	failures += check(instancedBackend.drawCalls < plainBackend.drawCalls, "instancing saves draws");
+
+	cout << items.size() << " drawables in " << batch.getGroupCount() << " groups, " << batch.getInstanceCount() * sizeof(InstanceData) << " bytes of instance data" << endl;
+	cout << "  one at a time: " << plainBackend.drawCalls << " draws, " << plainBackend.transformChanges << " transforms, "
+		<< plainBackend.textureChanges << " textures, " << plainBackend.geometryChanges << " meshes" << endl;
+	cout << "  instanced:     " << instancedBackend.drawCalls << " draws, " << instancedBackend.transformChanges << " transforms, "
+		<< instancedBackend.textureChanges << " textures, " << instancedBackend.geometryChanges << " meshes" << endl;
+
+	// Cost of collecting and packing a frame
+	BenchTimer elapsed;
+	elapsed.start();
+	for (int it = 0; it < iterations; it++)
+	{
+		batch.clear();
+		for (unsigned int i = 0; i < items.size(); i++)
+		{
+			batch.add(&meshes[items[i].mesh], &textures[items[i].texture], items[i].transform, 0xFFFFFFFF, items[i].depth, &items[i]);
+		}
+		batch.build();
+	}
+	elapsed.stop();
+	cout << "Collect and pack: " << elapsed.microsecondsPer(iterations) << " us per frame" << endl;
+
+	return finish(failures);
+}
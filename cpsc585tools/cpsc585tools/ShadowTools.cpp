@@ -0,0 +1,418 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "FrustumCuller.h"
+#include "MeshFile.h"
+#include "ShadowSilhouette.h"
+#include "ShadowTiers.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+// Checks the SSE silhouette kernel against the original per-face loop for
+// random light directions, then times a frame's worth of casters
+int silhouette(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	int iterations = argument(argc, argv, 3, 2000);
+
+	// Shadow casters and how many of each a full race has
+	const char* names[] = { "racer", "frontTire", "rearTire", "gunmount" };
+	const int perRace[] = { 8, 16, 16, 8 };
+	const int numMeshes = 4;
+
+	ShadowSilhouette meshes[numMeshes];
+	for (int m = 0; m < numMeshes; m++)
+	{
+		MeshFile file;
+		if (!file.load(directory + "/" + names[m] + ".mesh"))
+		{
+			cerr << "Could not read " << names[m] << ".mesh" << endl;
+			return 1;
+		}
+		if (!file.adjacency)
+		{
+			file.computeAdjacency(MESH_ADJACENCY_WELD);
+		}
+		meshes[m].initialize((const float*) file.vertices, sizeof(MeshFileVertex) / sizeof(float), file.vertexCount,
+			file.indices, file.indexCount, file.adjacency);
+	}
+
+	srand(585);
+	int failures = 0;
+
+	for (int m = 0; m < numMeshes; m++)
+	{
+		vector<float> expected(meshes[m].getMaxPoints() * 3), actual(meshes[m].getMaxPoints() * 3);
+		vector<unsigned char> flags(meshes[m].faceCount);
+		int mismatches = 0, totalEdges = 0;
+
+		for (int it = 0; it < iterations; it++)
+		{
+			float light[3] = { randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f) };
+
+			int expectedCount = meshes[m].extractReference(light, &expected[0]);
+			int actualCount = meshes[m].extract(light, &actual[0], &flags[0]);
+			totalEdges += expectedCount / 6;
+
+			if (expectedCount != actualCount || memcmp(&expected[0], &actual[0], sizeof(float) * 3 * expectedCount) != 0)
+			{
+				mismatches++;
+			}
+		}
+
+		BenchTimer reference;
+		reference.start();
+		for (int it = 0; it < iterations; it++)
+		{
+			float light[3] = { 0.3f, 0.7f, (float) it / iterations };
+			meshes[m].extractReference(light, &expected[0]);
+		}
+		reference.stop();
+
+		BenchTimer kernel;
+		kernel.start();
+		for (int it = 0; it < iterations; it++)
+		{
+			float light[3] = { 0.3f, 0.7f, (float) it / iterations };
+			meshes[m].extract(light, &actual[0], &flags[0]);
+		}
+		kernel.stop();
+
+		cout << names[m] << ": " << meshes[m].faceCount << " faces, " << totalEdges / iterations << " silhouette edges on average, per face "
+			<< reference.microsecondsPer(iterations) << " us, SSE " << kernel.microsecondsPer(iterations) << " us, "
+			<< mismatches << " of " << iterations << " lights differ" << endl;
+
+		failures += check(mismatches == 0, string(names[m]) + " silhouettes match the per-face loop");
+		failures += check(totalEdges > 0, string(names[m]) + " has silhouette edges");
+	}
+
+	// One frame: every caster in a full race, serially and split across threads
+	vector<ShadowSilhouette*> casters;
+	for (int m = 0; m < numMeshes; m++)
+	{
+		for (int k = 0; k < perRace[m]; k++)
+		{
+			casters.push_back(&meshes[m]);
+		}
+	}
+
+	int numCasters = (int) casters.size();
+	vector<vector<float> > points(numCasters);
+	vector<vector<unsigned char> > flags(numCasters);
+	for (int i = 0; i < numCasters; i++)
+	{
+		points[i].resize(casters[i]->getMaxPoints() * 3);
+		flags[i].resize(casters[i]->faceCount);
+	}
+
+	int frames = iterations / 10 + 1;
+
+	BenchTimer serialReference;
+	serialReference.start();
+	for (int it = 0; it < frames; it++)
+	{
+		for (int i = 0; i < numCasters; i++)
+		{
+			float light[3] = { 0.3f, 0.7f, (float) (i + it) / numCasters };
+			casters[i]->extractReference(light, &points[i][0]);
+		}
+	}
+	serialReference.stop();
+
+	BenchTimer serial;
+	serial.start();
+	for (int it = 0; it < frames; it++)
+	{
+		for (int i = 0; i < numCasters; i++)
+		{
+			float light[3] = { 0.3f, 0.7f, (float) (i + it) / numCasters };
+			casters[i]->extract(light, &points[i][0], &flags[i][0]);
+		}
+	}
+	serial.stop();
+
+	vector<int> serialCounts(numCasters);
+	vector<vector<float> > serialPoints(points);
+	for (int i = 0; i < numCasters; i++)
+	{
+		float light[3] = { 0.3f, 0.7f, (float) (i + frames - 1) / numCasters };
+		serialCounts[i] = casters[i]->extract(light, &serialPoints[i][0], &flags[i][0]);
+	}
+
+	// Each caster has its own buffers, so the threads share nothing
+	BenchTimer parallel;
+	vector<int> counts(numCasters);
+	parallel.start();
+	for (int it = 0; it < frames; it++)
+	{
+		#pragma omp parallel for
+		for (int i = 0; i < numCasters; i++)
+		{
+			float light[3] = { 0.3f, 0.7f, (float) (i + it) / numCasters };
+			counts[i] = casters[i]->extract(light, &points[i][0], &flags[i][0]);
+		}
+	}
+	parallel.stop();
+
+	bool same = true;
+	for (int i = 0; i < numCasters; i++)
+	{
+		same = same && counts[i] == serialCounts[i] && memcmp(&points[i][0], &serialPoints[i][0], sizeof(float) * 3 * counts[i]) == 0;
+	}
+	failures += check(same, "silhouettes extracted across threads match the serial ones");
+
+	cout << numCasters << " casters per frame: per face " << serialReference.milliseconds() / frames << " ms, SSE "
+		<< serial.milliseconds() / frames << " ms, SSE across threads " << parallel.milliseconds() / frames << " ms" << endl;
+
+	return finish(failures);
+}
+
+// Blob quad checks: corners on the ground plane at SHADOW_BLOB_LIFT, a
+// SHADOW_BLOB_WIDTH by SHADOW_BLOB_LENGTH rectangle with its long side along
+// forward, and alpha falling from SHADOW_BLOB_ALPHA to nothing at the cutoff
+static int checkBlobs()
+{
+	int failures = 0;
+	ShadowTiers tiers;
+
+	bool onPlane = true, rectangle = true, aligned = true, finite = true;
+	for (int it = 0; it < 1000; it++)
+	{
+		float point[3] = { randomFloat(-500.0f, 500.0f), randomFloat(-20.0f, 20.0f), randomFloat(-500.0f, 500.0f) };
+		float normal[3] = { randomFloat(-0.5f, 0.5f), 1.0f, randomFloat(-0.5f, 0.5f) };
+		float forward[3] = { randomFloat(-1.0f, 1.0f), randomFloat(-0.3f, 0.3f), randomFloat(-1.0f, 1.0f) };
+
+		// Now and then a forward straight into the ground
+		if (it % 100 == 0)
+		{
+			memcpy(forward, normal, sizeof(forward));
+		}
+
+		float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int k = 0; k < 3; k++)
+		{
+			normal[k] /= length;
+		}
+
+		tiers.clear();
+		tiers.addBlob(point, normal, forward, 0.0f);
+		const BlobVertex* v = tiers.getVertices();
+
+		for (int c = 0; c < 6; c++)
+		{
+			float offset[3] = { v[c].x - point[0], v[c].y - point[1], v[c].z - point[2] };
+			float height = offset[0] * normal[0] + offset[1] * normal[1] + offset[2] * normal[2];
+			onPlane = onPlane && fabs(height - SHADOW_BLOB_LIFT) < 0.001f;
+			finite = finite && v[c].x == v[c].x && v[c].y == v[c].y && v[c].z == v[c].z;
+		}
+
+		// First triangle: (-side, -along), (-side, +along), (+side, -along)
+		float alongEdge[3] = { v[1].x - v[0].x, v[1].y - v[0].y, v[1].z - v[0].z };
+		float sideEdge[3] = { v[2].x - v[0].x, v[2].y - v[0].y, v[2].z - v[0].z };
+		float alongLength = sqrt(alongEdge[0] * alongEdge[0] + alongEdge[1] * alongEdge[1] + alongEdge[2] * alongEdge[2]);
+		float sideLength = sqrt(sideEdge[0] * sideEdge[0] + sideEdge[1] * sideEdge[1] + sideEdge[2] * sideEdge[2]);
+		float corner = alongEdge[0] * sideEdge[0] + alongEdge[1] * sideEdge[1] + alongEdge[2] * sideEdge[2];
+		rectangle = rectangle && fabs(alongLength - SHADOW_BLOB_LENGTH) < 0.001f && fabs(sideLength - SHADOW_BLOB_WIDTH) < 0.001f &&
+			fabs(corner) < 0.001f;
+
+		// Along the blob is forward flattened onto the ground
+		if (it % 100 != 0)
+		{
+			float dot = forward[0] * normal[0] + forward[1] * normal[1] + forward[2] * normal[2];
+			float flat[3] = { forward[0] - normal[0] * dot, forward[1] - normal[1] * dot, forward[2] - normal[2] * dot };
+			float flatLength = sqrt(flat[0] * flat[0] + flat[1] * flat[1] + flat[2] * flat[2]);
+			float cosine = (flat[0] * alongEdge[0] + flat[1] * alongEdge[1] + flat[2] * alongEdge[2]) / (flatLength * alongLength);
+			aligned = aligned && (flatLength < 0.01f || cosine > 0.999f);
+		}
+	}
+	failures += check(onPlane, "blob corners lie just above the ground");
+	failures += check(rectangle, "blobs are width by length rectangles");
+	failures += check(aligned, "blobs point along the racer");
+	failures += check(finite, "blobs with forward into the ground are still finite");
+
+	float point[3] = { 0.0f, 0.0f, 0.0f }, normal[3] = { 0.0f, 1.0f, 0.0f }, forward[3] = { 0.0f, 0.0f, 1.0f };
+	bool fades = true;
+	unsigned int lastAlpha = 256;
+	for (float distance = 0.0f; distance <= SHADOW_BLOB_DISTANCE; distance += 5.0f)
+	{
+		tiers.clear();
+		tiers.addBlob(point, normal, forward, distance);
+		unsigned int alpha = tiers.getVertices()[0].colour >> 24;
+		fades = fades && alpha <= lastAlpha && (tiers.getVertices()[0].colour & 0xFFFFFF) == 0;
+		lastAlpha = alpha;
+
+		if (distance == 0.0f)
+		{
+			fades = fades && alpha == SHADOW_BLOB_ALPHA;
+		}
+	}
+	failures += check(fades && lastAlpha == 0, "blobs are black and fade out by the cutoff");
+
+	tiers.clear();
+	for (int b = 0; b < SHADOW_MAX_BLOBS + 5; b++)
+	{
+		tiers.addBlob(point, normal, forward, 0.0f);
+	}
+	failures += check(tiers.getVertexCount() == SHADOW_MAX_BLOBS * 6 && tiers.dropped == 5, "blobs past the limit are dropped");
+
+	return failures;
+}
+
+// Eight racers spread along a camera path (see cameraPath), the camera
+// following the first. Counts the racers in each shadow tier and how often a
+// racer changes tier, with and without the hysteresis, and what the
+// silhouettes cost per frame against every racer casting volumes.
+int shadowtiers(int argc, char** argv)
+{
+	string directory = argument(argc, argv, 2, "models");
+	string trackFile = argument(argc, argv, 3, "RaceTrack.txt");
+	string pathFile = argument(argc, argv, 4, "");
+	const int numRacers = 8;
+
+	vector<float> waypoints, path;
+	if (!cameraPath(trackFile, pathFile, waypoints, path))
+	{
+		return 1;
+	}
+	int numFrames = path.size() / 6;
+
+	// One racer's casters, as Racer puts them together
+	const char* names[] = { "racer", "frontTire", "frontTire", "rearTire", "rearTire", "gunmount" };
+	const int numParts = 6;
+
+	ShadowSilhouette meshes[numParts];
+	int maxPoints = 0;
+	for (int p = 0; p < numParts; p++)
+	{
+		MeshFile file;
+		if (!file.load(directory + "/" + names[p] + ".mesh"))
+		{
+			cerr << "Could not read " << names[p] << ".mesh" << endl;
+			return 1;
+		}
+		if (!file.adjacency)
+		{
+			file.computeAdjacency(MESH_ADJACENCY_WELD);
+		}
+		meshes[p].initialize((const float*) file.vertices, sizeof(MeshFileVertex) / sizeof(float), file.vertexCount,
+			file.indices, file.indexCount, file.adjacency);
+		maxPoints = max(maxPoints, meshes[p].getMaxPoints());
+	}
+	vector<float> points(maxPoints * 3);
+	vector<unsigned char> flags(maxPoints);
+
+	srand(585);
+	int failures = checkBlobs();
+
+	// Path frames each racer is ahead of the camera's (negative: behind), some
+	// in a pack with it and some strung out down the track. The others surge
+	// and fall back a few units, so the pack keeps passing each other.
+	const int offsets[numRacers] = { 0, 2, -3, 3, -25, 40, 70, -110 };
+
+	ShadowTiers tiers, plain;
+	unsigned char current[numRacers], previous[numRacers], unsmoothed[numRacers], unsmoothedPrevious[numRacers];
+	float distances[numRacers];
+	memset(current, SHADOW_TIER_VOLUME, sizeof(current));
+	memset(unsmoothed, SHADOW_TIER_VOLUME, sizeof(unsmoothed));
+
+	long long counts[SHADOW_TIER_COUNT] = { 0, 0, 0 };
+	int switches = 0, plainSwitches = 0;
+	long long tieredPoints = 0, allPoints = 0;
+	BenchTimer tieredTime, allTime;
+	bool limited = true, cutoff = true, nearest = true, ordered = true;
+
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		float eye[3], viewProjection[16], projection[16];
+		perspectiveFovLH(3.14159265f / 2.5f, 16.0f / 9.0f, 1.0f, 1200.0f, projection);
+		followCamera(&path[frame * 6], &path[frame * 6 + 3], projection, eye, viewProjection);
+
+		for (int r = 0; r < numRacers; r++)
+		{
+			const float* racer = &path[(((frame + offsets[r]) % numFrames + numFrames) % numFrames) * 6];
+			float surge = r > 0 ? 5.0f * sin(frame * 0.3f + r * 2.0f) : 0.0f;
+			float x = racer[0] + racer[3] * surge - eye[0], y = racer[1] + racer[4] * surge - eye[1], z = racer[2] + racer[5] * surge - eye[2];
+			distances[r] = sqrt(x * x + y * y + z * z);
+		}
+
+		memcpy(previous, current, sizeof(current));
+		memcpy(unsmoothedPrevious, unsmoothed, sizeof(unsmoothed));
+		tiers.assign(distances, numRacers, current);
+
+		// Without hysteresis: nobody keeps anything from last frame
+		memset(unsmoothed, SHADOW_TIER_NONE, sizeof(unsmoothed));
+		plain.assign(distances, numRacers, unsmoothed);
+
+		for (int r = 0; r < numRacers; r++)
+		{
+			counts[current[r]]++;
+			switches += frame > 0 && current[r] != previous[r];
+			plainSwitches += frame > 0 && unsmoothed[r] != unsmoothedPrevious[r];
+
+			cutoff = cutoff && (current[r] == SHADOW_TIER_NONE) == (distances[r] >= SHADOW_BLOB_DISTANCE);
+
+			// Without hysteresis the volumes go to exactly the nearest racers
+			for (int other = 0; other < numRacers; other++)
+			{
+				if (unsmoothed[r] == SHADOW_TIER_VOLUME && unsmoothed[other] == SHADOW_TIER_BLOB)
+				{
+					ordered = ordered && distances[r] <= distances[other];
+				}
+			}
+		}
+		limited = limited && tiers.tierCounts[SHADOW_TIER_VOLUME] <= SHADOW_VOLUME_CASTERS;
+		nearest = nearest && current[0] == SHADOW_TIER_VOLUME;
+
+		// Silhouettes, with the light turning in mesh space as the racers do
+		float light[3] = { 0.3f, 0.7f, (float) frame / numFrames };
+		allTime.start();
+		for (int r = 0; r < numRacers; r++)
+		{
+			for (int p = 0; p < numParts; p++)
+			{
+				allPoints += meshes[p].extract(light, &points[0], &flags[0]);
+			}
+		}
+		allTime.stop();
+
+		tieredTime.start();
+		tiers.clear();
+		for (int r = 0; r < numRacers; r++)
+		{
+			if (current[r] == SHADOW_TIER_VOLUME)
+			{
+				for (int p = 0; p < numParts; p++)
+				{
+					tieredPoints += meshes[p].extract(light, &points[0], &flags[0]);
+				}
+			}
+			else if (current[r] == SHADOW_TIER_BLOB)
+			{
+				float up[3] = { 0.0f, 1.0f, 0.0f };
+				tiers.addBlob(&path[frame * 6], up, &path[frame * 6 + 3], distances[r]);
+			}
+		}
+		tieredTime.stop();
+	}
+
+	failures += check(limited, "never more than the volume limit");
+	failures += check(cutoff, "no shadow exactly past the cutoff");
+	failures += check(nearest, "the racer being followed always has volumes");
+	failures += check(ordered, "without hysteresis, volumes go to the nearest");
+
+	cout << numFrames << " camera positions, " << numRacers << " racers" << endl;
+	cout << "  racers per frame: " << (double) counts[SHADOW_TIER_VOLUME] / numFrames << " volumes, "
+		<< (double) counts[SHADOW_TIER_BLOB] / numFrames << " blobs, " << (double) counts[SHADOW_TIER_NONE] / numFrames << " none" << endl;
+	cout << "  tier changes: " << switches << " with hysteresis, " << plainSwitches << " without" << endl;
+	cout << "  shadow volume vertices per frame: " << (double) tieredPoints / numFrames << ", every racer casting "
+		<< (double) allPoints / numFrames << endl;
+	cout << "  silhouettes and blobs: " << tieredTime.microsecondsPer(numFrames) << " us per frame, every racer casting "
+		<< allTime.microsecondsPer(numFrames) << " us" << endl;
+
+	return finish(failures);
+}
@@ -0,0 +1,622 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+
+#include "HandlePool.h"
+#include "ToolsCommon.h"
+#include "TransformSnapshot.h"
+
+using namespace std;
+
+// D3D layout (rows are the axes): a rotation of angle about y, scaled, then moved
+static void yawMatrix(float angle, float scale, float x, float y, float z, float* m)
+{
+	memset(m, 0, sizeof(float) * 16);
+	m[0] = cos(angle) * scale;
+	m[2] = -sin(angle) * scale;
+	m[5] = scale;
+	m[8] = sin(angle) * scale;
+	m[10] = cos(angle) * scale;
+	m[12] = x;
+	m[13] = y;
+	m[14] = z;
+	m[15] = 1.0f;
+}
+
+void randomMatrix(float* m)
+{
+	float q[4];
+	float length = 0.0f;
+	for (int k = 0; k < 4; k++)
+	{
+		q[k] = randomFloat(-1.0f, 1.0f);
+		length += q[k] * q[k];
+	}
+	length = sqrt(length);
+	float x = q[0] / length, y = q[1] / length, z = q[2] / length, w = q[3] / length;
+	float scale = randomFloat(0.2f, 5.0f);
+
+	float rotation[9] = {
+		1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w),
+		2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w),
+		2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y) };
+
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			m[row * 4 + col] = rotation[row * 3 + col] * scale;
+		}
+		m[row * 4 + 3] = 0.0f;
+	}
+	m[12] = randomFloat(-1000.0f, 1000.0f);
+	m[13] = randomFloat(-50.0f, 50.0f);
+	m[14] = randomFloat(-1000.0f, 1000.0f);
+	m[15] = 1.0f;
+}
+
+static bool closeMatrix(const float* a, const float* b, float tolerance)
+{
+	for (int k = 0; k < 16; k++)
+	{
+		if (fabs(a[k] - b[k]) > tolerance * (1.0f + fabs(b[k])))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Axes at right angles and all the given length
+static bool orthogonal(const float* m, float scale)
+{
+	for (int a = 0; a < 3; a++)
+	{
+		const float* axisA = m + a * 4;
+		if (fabs(sqrt(axisA[0] * axisA[0] + axisA[1] * axisA[1] + axisA[2] * axisA[2]) - scale) > 0.001f * scale)
+		{
+			return false;
+		}
+		for (int b = a + 1; b < 3; b++)
+		{
+			const float* axisB = m + b * 4;
+			if (fabs(axisA[0] * axisB[0] + axisA[1] * axisB[1] + axisA[2] * axisB[2]) > 0.001f * scale * scale)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static int checkInterpolation()
+{
+	int failures = 0;
+	float previous[16], current[16], result[16], expected[16];
+
+	bool endpoints = true, rigid = true;
+	for (int it = 0; it < 10000; it++)
+	{
+		randomMatrix(previous);
+		randomMatrix(current);
+
+		TransformSnapshot::interpolate(previous, current, 0.0f, result);
+		endpoints = endpoints && closeMatrix(result, previous, 0.001f);
+		TransformSnapshot::interpolate(previous, current, 1.0f, result);
+		endpoints = endpoints && closeMatrix(result, current, 0.001f);
+
+		// Same scale at both ends, so the same in between
+		float scale = sqrt(previous[0] * previous[0] + previous[1] * previous[1] + previous[2] * previous[2]);
+		float currentScale = sqrt(current[0] * current[0] + current[1] * current[1] + current[2] * current[2]);
+		for (int row = 0; row < 3; row++)
+		{
+			for (int col = 0; col < 3; col++)
+			{
+				current[row * 4 + col] *= scale / currentScale;
+			}
+		}
+		TransformSnapshot::interpolate(previous, current, randomFloat(0.0f, 1.0f), result);
+		rigid = rigid && orthogonal(result, scale);
+	}
+	failures += check(endpoints, "alpha 0 and 1 give the two ticks");
+	failures += check(rigid, "interpolated rotations stay rigid");
+
+	// A quarter turn is an eighth halfway, with the position and scale halfway too
+	yawMatrix(0.0f, 2.0f, 0.0f, 0.0f, 0.0f, previous);
+	yawMatrix(1.5707963f, 4.0f, 10.0f, -4.0f, 6.0f, current);
+	yawMatrix(0.7853982f, 3.0f, 5.0f, -2.0f, 3.0f, expected);
+	TransformSnapshot::interpolate(previous, current, 0.5f, result);
+	failures += check(closeMatrix(result, expected, 0.001f), "halfway through a quarter turn is an eighth");
+
+	// Across the back (170 to -170 degrees) the short way is through 180, not 0
+	yawMatrix(2.9670597f, 1.0f, 0.0f, 0.0f, 0.0f, previous);
+	yawMatrix(-2.9670597f, 1.0f, 0.0f, 0.0f, 0.0f, current);
+	yawMatrix(3.1415927f, 1.0f, 0.0f, 0.0f, 0.0f, expected);
+	TransformSnapshot::interpolate(previous, current, 0.5f, result);
+	failures += check(closeMatrix(result, expected, 0.001f), "rotations take the short way round");
+
+	return failures;
+}
+
+// What the writer puts in a tick: a count that changes every tick, and every
+// float of every entry the tick number (and one less for the tick before)
+static int snapshotCount(unsigned int tick, int capacity)
+{
+	return capacity / 4 + (tick * 7) % (capacity * 3 / 4);
+}
+
+static bool wholeTick(const SnapshotEntry* entries, int count, unsigned int tick, int capacity)
+{
+	if (count != snapshotCount(tick, capacity))
+	{
+		return false;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		if (entries[i].owner != (void*) (size_t) (tick * 1000 + i))
+		{
+			return false;
+		}
+		for (int k = 0; k < 16; k++)
+		{
+			if (entries[i].current[k] != (float) tick || entries[i].previous[k] != (float) (tick - 1))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static const int snapshotCapacity = 256;
+
+// One buffer both sides use straight away: what the renderer did before the snapshot
+struct SharedTick
+{
+	volatile unsigned int tick;
+	volatile int count;
+	SnapshotEntry entries[snapshotCapacity];
+};
+
+// The simulation publishing as fast as it can on one thread while the renderer
+// acquires on another. Every frame the renderer gets has to be one whole tick,
+// never older than the last. The same with one shared buffer shows what the
+// test catches.
+// Stands in for a Drawable: how many references it has
+struct CountedOwner
+{
+	int references;
+};
+
+static void keepCounted(void* owner)
+{
+	((CountedOwner*) owner)->references++;
+}
+
+static void releaseCounted(void* owner)
+{
+	((CountedOwner*) owner)->references--;
+}
+
+// Something removed from the game has to stay alive while the renderer holds
+// a frame with it in, and be let go once no frame has it
+static int checkSnapshotOwners()
+{
+	int failures = 0;
+	float transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	TransformSnapshot* snapshot = new TransformSnapshot(4, keepCounted, releaseCounted);
+	CountedOwner racer = { 1 }, rocket = { 1 };
+
+	snapshot->begin();
+	snapshot->add(&racer, transform, NULL);
+	SnapshotEntry* entry = snapshot->add(&rocket, transform, NULL);
+	snapshot->publish(1);
+	failures += check(entry && !entry->onGround, "entries start off the ground");
+	failures += check(racer.references == 2 && rocket.references == 2, "a published tick holds a reference on each");
+
+	const SnapshotFrame* drawing = snapshot->acquire();
+
+	// The rocket blows up; the renderer is still on tick 1 while the simulation runs on
+	rocket.references--;
+	for (unsigned int tick = 2; tick <= 4; tick++)
+	{
+		snapshot->begin();
+		snapshot->add(&racer, transform, NULL);
+		snapshot->publish(tick);
+	}
+	failures += check(drawing->count == 2 && drawing->entries[1].owner == &rocket && rocket.references == 1,
+		"kept while the renderer is drawing it");
+
+	// Once the renderer moves on, the frame with the rocket is filled again two ticks later
+	snapshot->acquire();
+	for (unsigned int tick = 5; tick <= 6; tick++)
+	{
+		snapshot->begin();
+		snapshot->add(&racer, transform, NULL);
+		snapshot->publish(tick);
+	}
+	failures += check(rocket.references == 0, "let go once no frame has it");
+	failures += check(racer.references == 1 + SNAPSHOT_FRAMES, "one reference per frame it is in");
+
+	delete snapshot;
+	failures += check(racer.references == 1, "the snapshot lets go of everything when deleted");
+
+	return failures;
+}
+
+int snapshot(int argc, char** argv)
+{
+	int numTicks = argument(argc, argv, 2, 200000);
+	const int capacity = snapshotCapacity;
+	int failures = checkInterpolation();
+	failures += checkSnapshotOwners();
+
+	TransformSnapshot* snapshot = new TransformSnapshot(capacity);
+	failures += check(snapshot->acquire() == NULL, "nothing to draw before the first tick");
+
+	float current[16], previous[16];
+	volatile int writerDone = 0;
+	int framesRead = 0, tornFrames = 0, backwards = 0, repeats = 0;
+
+	#pragma omp parallel sections num_threads(2)
+	{
+		#pragma omp section
+		{
+			for (unsigned int tick = 1; tick <= (unsigned int) numTicks; tick++)
+			{
+				for (int k = 0; k < 16; k++)
+				{
+					current[k] = (float) tick;
+					previous[k] = (float) (tick - 1);
+				}
+
+				snapshot->begin();
+				int count = snapshotCount(tick, capacity);
+				for (int i = 0; i < count; i++)
+				{
+					snapshot->add((void*) (size_t) (tick * 1000 + i), current, previous);
+				}
+				snapshot->publish(tick);
+			}
+			writerDone = 1;
+		}
+
+		#pragma omp section
+		{
+			unsigned int lastTick = 0;
+			bool finishing = false;
+			while (!finishing)
+			{
+				finishing = writerDone != 0;
+
+				const SnapshotFrame* frame = snapshot->acquire();
+				if (!frame)
+				{
+					continue;
+				}
+
+				framesRead++;
+				if (!wholeTick(frame->entries, frame->count, frame->tick, capacity))
+				{
+					tornFrames++;
+				}
+				if (frame->tick < lastTick)
+				{
+					backwards++;
+				}
+				if (frame->tick == lastTick)
+				{
+					repeats++;
+				}
+				lastTick = frame->tick;
+			}
+
+			// Once the writer is done, the last tick it published has to come through
+			failures += check(lastTick == (unsigned int) numTicks, "the renderer ends on the last tick");
+		}
+	}
+
+	failures += check(framesRead > 0 && tornFrames == 0, "every frame acquired is one whole tick");
+	failures += check(backwards == 0, "ticks never go backwards");
+
+	// The same, with no hand over at all
+	SharedTick* shared = new SharedTick;
+	shared->tick = 0;
+	shared->count = 0;
+	writerDone = 0;
+	int sharedRead = 0, sharedTorn = 0;
+
+	#pragma omp parallel sections num_threads(2)
+	{
+		#pragma omp section
+		{
+			for (unsigned int tick = 1; tick <= (unsigned int) numTicks; tick++)
+			{
+				shared->tick = tick;
+				shared->count = snapshotCount(tick, capacity);
+				for (int i = 0; i < shared->count; i++)
+				{
+					SnapshotEntry& entry = shared->entries[i];
+					entry.owner = (void*) (size_t) (tick * 1000 + i);
+					for (int k = 0; k < 16; k++)
+					{
+						entry.current[k] = (float) tick;
+						entry.previous[k] = (float) (tick - 1);
+					}
+				}
+			}
+			writerDone = 1;
+		}
+
+		#pragma omp section
+		{
+			while (!writerDone)
+			{
+				unsigned int tick = shared->tick;
+				if (tick == 0)
+				{
+					continue;
+				}
+
+				sharedRead++;
+				if (!wholeTick(shared->entries, shared->count, tick, capacity))
+				{
+					sharedTorn++;
+				}
+			}
+		}
+	}
+
+	// Publish and acquire, and interpolating everything, at the game's size
+	const int gameCount = 200 + 40;
+	BenchTimer publishTime;
+	publishTime.start();
+	for (int it = 0; it < 10000; it++)
+	{
+		snapshot->begin();
+		for (int i = 0; i < gameCount; i++)
+		{
+			snapshot->add(NULL, current, previous);
+		}
+		snapshot->publish(numTicks + it + 1);
+	}
+	publishTime.stop();
+
+	float result[16];
+	randomMatrix(previous);
+	randomMatrix(current);
+	BenchTimer interpolateTime;
+	interpolateTime.start();
+	for (int it = 0; it < 10000; it++)
+	{
+		for (int i = 0; i < gameCount; i++)
+		{
+			TransformSnapshot::interpolate(previous, current, (float) i / gameCount, result);
+		}
+	}
+	interpolateTime.stop();
+
+	cout << numTicks << " ticks published, " << framesRead << " frames acquired (" << repeats << " repeats), "
+		<< tornFrames << " torn" << endl;
+	cout << "  one shared buffer: " << sharedTorn << " of " << sharedRead << " reads torn" << endl;
+	cout << "  publishing " << gameCount << " transforms: " << publishTime.microsecondsPer(10000) << " us, interpolating them: "
+		<< interpolateTime.microsecondsPer(10000) << " us" << endl;
+
+	delete shared;
+	delete snapshot;
+
+	return finish(failures);
+}
+
+int BenchObject::constructed = 0;
+int BenchObject::destructed = 0;
+
+struct ListObject
+{
+	bool destroyed;
+	int lifetime;
+	float transform[16];
+	float payload[8];
+};
+
+// Handles going stale on release, the generation wrapping past 0, full pools
+// and objects staying put while others come and go
+static int checkHandles()
+{
+	int failures = 0;
+
+	HandlePool<BenchObject> pool(4);
+	unsigned int handles[5];
+	BenchObject* objects[5];
+	for (int i = 0; i < 5; i++)
+	{
+		void* memory = pool.allocate(handles[i]);
+		objects[i] = memory ? new (memory) BenchObject(handles[i]) : NULL;
+	}
+	failures += check(objects[4] == NULL && handles[4] == HANDLE_NONE && pool.refused == 1, "a full pool refuses");
+	failures += check(pool.get(HANDLE_NONE) == NULL, "HANDLE_NONE never resolves");
+
+	pool.release(handles[1]);
+	failures += check(pool.get(handles[1]) == NULL && BenchObject::destructed == 1, "released handles go stale and the object is destroyed");
+	failures += check(pool.get(handles[0]) == objects[0] && pool.get(handles[2]) == objects[2] && pool.get(handles[3]) == objects[3],
+		"the others don't move");
+
+	unsigned int reused;
+	new (pool.allocate(reused)) BenchObject(reused);
+	failures += check((reused & HANDLE_INDEX_MASK) == (handles[1] & HANDLE_INDEX_MASK) && reused != handles[1] &&
+		pool.get(handles[1]) == NULL && pool.get(reused)->self == reused, "a reused slot gets a new handle");
+
+	pool.release(handles[1]);
+	failures += check(pool.get(reused) != NULL, "releasing a stale handle leaves the new object alone");
+
+	bool listed = pool.count == 4;
+	for (int i = 0; i < pool.count && listed; i++)
+	{
+		listed = pool.get(pool.handleAt(i)) == pool.at(i) && pool.at(i)->self == pool.handleAt(i);
+	}
+	failures += check(listed, "the live list is every live object");
+
+	// Round and round one slot, past where the generation wraps
+	HandlePool<BenchObject> single(1);
+	unsigned int previous = HANDLE_NONE;
+	bool stale = true, neverNone = true;
+	for (int i = 0; i < 70000; i++)
+	{
+		unsigned int handle;
+		new (single.allocate(handle)) BenchObject(handle);
+		neverNone = neverNone && handle != HANDLE_NONE;
+		stale = stale && (previous == HANDLE_NONE || single.get(previous) == NULL);
+		single.release(handle);
+		previous = handle;
+	}
+	failures += check(neverNone, "the generation skips 0 when it wraps");
+	failures += check(stale, "the last handle for a slot is stale once it's reused");
+
+	return failures;
+}
+
+// Spawns objects that live a few frames each, until numSpawns have come and
+// gone, destroying them the way DynamicObjManager does: marked mid-frame,
+// released at the end. Checks every live handle resolves to its own object and
+// a ring of released ones never do, counts heap allocations after the first
+// frames, and times it against the list of heap objects the manager used to keep.
+int handles(int argc, char** argv)
+{
+	int numSpawns = argument(argc, argv, 2, 100000);
+	int capacity = argument(argc, argv, 3, 256);
+	const int warmup = 10;
+	const int staleRing = 1024;
+
+	int failures = checkHandles();
+
+	srand(585);
+	HandlePool<BenchObject> pool(capacity);
+	vector<unsigned int> released(staleRing, HANDLE_NONE);
+	int releasedCount = 0, spawned = 0, frames = 0, allocations = 0, refused = 0;
+	bool resolved = true, stale = true;
+	BenchTimer poolTime;
+	int constructedBefore = BenchObject::constructed, destructedBefore = BenchObject::destructed;
+
+	while (spawned < numSpawns)
+	{
+		int start = heapAllocations;
+		poolTime.start();
+
+		// A burst of spawns, up to a third of the pool
+		int spawns = rand() % (capacity / 3 + 1);
+		for (int i = 0; i < spawns && spawned < numSpawns; i++)
+		{
+			unsigned int handle;
+			void* memory = pool.allocate(handle);
+			if (!memory)
+			{
+				refused++;
+				break;
+			}
+			BenchObject* object = new (memory) BenchObject(handle);
+			object->lifetime = 1 + rand() % 8;
+			spawned++;
+		}
+
+		// Update: count down and mark, but don't release yet
+		for (int i = 0; i < pool.count; i++)
+		{
+			BenchObject* object = pool.at(i);
+			object->destroyed = --object->lifetime <= 0;
+			object->transform[12] += 1.0f;
+		}
+
+		// End of the frame
+		for (int i = pool.count - 1; i >= 0; i--)
+		{
+			if (pool.at(i)->destroyed)
+			{
+				unsigned int handle = pool.handleAt(i);
+				pool.release(handle);
+				released[releasedCount++ % staleRing] = handle;
+			}
+		}
+
+		poolTime.stop();
+		if (frames >= warmup)
+		{
+			allocations += heapAllocations - start;
+		}
+		frames++;
+
+		for (int i = 0; i < pool.count && resolved; i++)
+		{
+			resolved = pool.get(pool.handleAt(i)) == pool.at(i) && pool.at(i)->self == pool.handleAt(i);
+		}
+		for (int i = 0; i < staleRing && i < releasedCount && stale; i++)
+		{
+			stale = pool.get(released[i]) == NULL;
+		}
+	}
+
+	// Drain what's left
+	while (pool.count > 0)
+	{
+		pool.release(pool.handleAt(0));
+	}
+
+	failures += check(resolved, "every live handle resolves to its own object");
+	failures += check(stale, "released handles never resolve");
+	failures += check(BenchObject::constructed - constructedBefore == spawned && BenchObject::destructed - destructedBefore == spawned,
+		"every object is destroyed exactly once");
+	failures += check(allocations == 0, "no heap allocations after warm-up");
+
+	// The same lifetimes through a list of heap objects
+	srand(585);
+	list<ListObject*> objects;
+	int listSpawned = 0, listAllocations = 0;
+	BenchTimer listTime;
+	listTime.start();
+	while (listSpawned < numSpawns)
+	{
+		int start = heapAllocations;
+		int spawns = rand() % (capacity / 3 + 1);
+		for (int i = 0; i < spawns && listSpawned < numSpawns && (int) objects.size() < capacity; i++)
+		{
+			ListObject* object = new ListObject();
+			object->destroyed = false;
+			object->lifetime = 1 + rand() % 8;
+			objects.push_back(object);
+			listSpawned++;
+		}
+
+		for (list<ListObject*>::iterator iter = objects.begin(); iter != objects.end();)
+		{
+			ListObject* object = *iter;
+			if (object->destroyed)
+			{
+				delete object;
+				iter = objects.erase(iter);
+				continue;
+			}
+			object->destroyed = --object->lifetime <= 0;
+			object->transform[12] += 1.0f;
+			++iter;
+		}
+		listAllocations += heapAllocations - start;
+	}
+	listTime.stop();
+	for (list<ListObject*>::iterator iter = objects.begin(); iter != objects.end(); ++iter)
+	{
+		delete *iter;
+	}
+
+	cout << spawned << " objects spawned and destroyed over " << frames << " frames in a pool of " << capacity
+		<< " (" << refused << " frames hit the limit)" << endl;
+	cout << "  pool: " << poolTime.milliseconds() << " ms, " << allocations << " heap allocations after " << warmup << " frames of warm-up, "
+		<< pool.staleLookups << " stale lookups caught" << endl;
+	cout << "  list of heap objects: " << listTime.milliseconds() << " ms, " << listAllocations << " heap allocations" << endl;
+
+	return finish(failures);
+}
@@ -0,0 +1,362 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <dirent.h>
+#endif
+
+#include "RenderQueue.h"
+#include "ToolsCommon.h"
+
+using namespace std;
+
+
+double now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+	timeval time;
+	gettimeofday(&time, NULL);
+	return time.tv_sec + time.tv_usec * 0.000001;
+#endif
+}
+
+BenchTimer::BenchTimer()
+{
+	seconds = 0.0;
+	started = 0.0;
+}
+
+void BenchTimer::start()
+{
+	started = now();
+}
+
+void BenchTimer::stop()
+{
+	seconds += now() - started;
+}
+
+double BenchTimer::milliseconds() const
+{
+	return seconds * 1000.0;
+}
+
+double BenchTimer::microsecondsPer(double count) const
+{
+	return seconds * 1000000.0 / count;
+}
+
+double BenchTimer::nanosecondsPer(double count) const
+{
+	return seconds * 1000000000.0 / count;
+}
+
+float randomFloat(float low, float high)
+{
+	return low + (high - low) * (rand() / (float) RAND_MAX);
+}
+
+int check(bool condition, string what)
+{
+	if (!condition)
+	{
+		cerr << "FAILED: " << what << endl;
+		return 1;
+	}
+	return 0;
+}
+
+int finish(int failures)
+{
+	cout << (failures ? "FAILED" : "OK") << endl;
+	return failures > 0 ? 1 : 0;
+}
+
+int argument(int argc, char** argv, int index, int fallback)
+{
+	return argc > index ? atoi(argv[index]) : fallback;
+}
+
+float argument(int argc, char** argv, int index, float fallback)
+{
+	return argc > index ? (float) atof(argv[index]) : fallback;
+}
+
+string argument(int argc, char** argv, int index, const char* fallback)
+{
+	return argc > index ? argv[index] : fallback;
+}
+
+int heapAllocations = 0;
+
+void* operator new(size_t size)
+{
+	heapAllocations++;
+	void* block = malloc(size ? size : 1);
+	if (!block)
+	{
+		throw bad_alloc();
+	}
+	return block;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* block) throw()
+{
+	free(block);
+}
+
+void operator delete[](void* block) throw()
+{
+	free(block);
+}
+
+vector<string> listFiles(string directory, string extension)
+{
+	vector<string> files;
+
+#ifdef _WIN32
+	WIN32_FIND_DATA findData;
+	HANDLE find = FindFirstFile((directory + "\\*" + extension).c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			files.push_back(findData.cFileName);
+		} while (FindNextFile(find, &findData));
+		FindClose(find);
+	}
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir)
+	{
+		while (dirent* entry = readdir(dir))
+		{
+			string name = entry->d_name;
+			if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+			{
+				files.push_back(name);
+			}
+		}
+		closedir(dir);
+	}
+#endif
+
+	return files;
+}
+
+// Row-vector look-at matrix, laid out like D3DXMatrixLookAtLH
+static void lookAtLH(const float* eye, const float* at, float* m)
+{
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+	float length = sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	z[0] /= length; z[1] /= length; z[2] /= length;
+
+	float x[3] = { z[2], 0.0f, -z[0] };		// up (0, 1, 0) cross z
+	length = sqrt(x[0] * x[0] + x[2] * x[2]);
+	x[0] /= length; x[2] /= length;
+
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	float result[16] = {
+		x[0], y[0], z[0], 0.0f,
+		x[1], y[1], z[1], 0.0f,
+		x[2], y[2], z[2], 0.0f,
+		-(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]),
+		-(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]),
+		-(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f };
+	memcpy(m, result, sizeof(result));
+}
+
+void perspectiveFovLH(float fieldOfView, float aspect, float zNear, float zFar, float* m)
+{
+	float yScale = 1.0f / tan(fieldOfView * 0.5f);
+	float xScale = yScale / aspect;
+
+	float result[16] = {
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, zFar / (zFar - zNear), 1.0f,
+		0.0f, 0.0f, -zNear * zFar / (zFar - zNear), 0.0f };
+	memcpy(m, result, sizeof(result));
+}
+
+static void multiply(const float* a, const float* b, float* m)
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			m[row * 4 + column] = a[row * 4] * b[column] + a[row * 4 + 1] * b[4 + column]
+				+ a[row * 4 + 2] * b[8 + column] + a[row * 4 + 3] * b[12 + column];
+		}
+	}
+}
+
+bool outsideClip(const float* m, float x, float y, float z)
+{
+	float clip[4];
+	for (int k = 0; k < 4; k++)
+	{
+		clip[k] = x * m[k] + y * m[4 + k] + z * m[8 + k] + m[12 + k];
+	}
+	return clip[0] < -clip[3] || clip[0] > clip[3] || clip[1] < -clip[3] || clip[1] > clip[3] || clip[2] < 0.0f || clip[2] > clip[3];
+}
+
+bool cameraPath(string trackFile, string pathFile, vector<float>& waypoints, vector<float>& path)
+{
+	ifstream track(trackFile.c_str());
+	string line;
+	getline(track, line);
+	while (getline(track, line))
+	{
+		float x, y, z;
+		if (sscanf(line.c_str(), "%f|%f|%f", &x, &y, &z) == 3)
+		{
+			waypoints.push_back(x);
+			waypoints.push_back(y);
+			waypoints.push_back(z);
+		}
+	}
+	int numWaypoints = waypoints.size() / 3;
+	if (numWaypoints < 2)
+	{
+		cerr << "Could not read waypoints from " << trackFile << endl;
+		return false;
+	}
+
+	if (!pathFile.empty())
+	{
+		ifstream recorded(pathFile.c_str());
+		float values[6];
+		while (recorded >> values[0] >> values[1] >> values[2] >> values[3] >> values[4] >> values[5])
+		{
+			path.insert(path.end(), values, values + 6);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < numWaypoints; i++)
+		{
+			const float* from = &waypoints[i * 3];
+			const float* to = &waypoints[((i + 1) % numWaypoints) * 3];
+			float look[3] = { to[0] - from[0], 0.0f, to[2] - from[2] };
+			float length = sqrt(look[0] * look[0] + look[2] * look[2]);
+			if (length <= 0.0f)
+			{
+				continue;
+			}
+
+			for (int step = 0; step < 8; step++)
+			{
+				float t = step / 8.0f;
+				float frame[6] = { from[0] + (to[0] - from[0]) * t, from[1] + (to[1] - from[1]) * t, from[2] + (to[2] - from[2]) * t,
+					look[0] / length, 0.0f, look[2] / length };
+				path.insert(path.end(), frame, frame + 6);
+			}
+		}
+	}
+
+	if (path.empty())
+	{
+		cerr << "Empty camera path" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void followCamera(const float* focus, const float* look, const float* projection, float* eye, float* viewProjection)
+{
+	eye[0] = focus[0] - look[0] * 7.0f;
+	eye[1] = focus[1] - look[1] * 7.0f + 2.0f;
+	eye[2] = focus[2] - look[2] * 7.0f;
+
+	float at[3] = { eye[0] + look[0], eye[1] + look[1], eye[2] + look[2] };
+	float view[16];
+	lookAtLH(eye, at, view);
+	multiply(view, projection, viewProjection);
+}
+
+void raceDrawables(int numRacers, int numDynamic, vector<RaceDrawable>& drawables)
+{
+	drawables.clear();
+	for (int i = 0; i < 1 + 4 + numRacers * 7 + numDynamic; i++)
+	{
+		RaceDrawable drawable;
+		if (i < 5)
+		{
+			// The world, then the checkpoints
+			drawable.mesh = drawable.texture = i == 0 ? 0 : 1;
+			drawable.shadow = false;
+		}
+		else if (i < 5 + numRacers * 7)
+		{
+			// Body, four wheels, gun mount and gun
+			const int racerMeshes[7] = { 2, 3, 3, 4, 4, 5, 6 };
+			const int racerTextures[7] = { 7, 2, 2, 2, 2, 3, 4 };
+			int racer = (i - 5) / 7, part = (i - 5) % 7;
+			drawable.mesh = racerMeshes[part];
+			drawable.texture = part == 0 ? racerTextures[part] + racer % 8 : racerTextures[part];
+			drawable.shadow = part < 6;
+		}
+		else
+		{
+			// Rockets and landmines
+			drawable.mesh = 7 + i % 2;
+			drawable.texture = 5 + i % 2;
+			drawable.shadow = false;
+		}
+
+		for (int k = 0; k < 16; k++)
+		{
+			drawable.transform[k] = randomFloat(-100.0f, 100.0f);
+		}
+		drawable.depth = randomFloat(1.0f, 400.0f);
+		drawables.push_back(drawable);
+	}
+}
+
+void queueRace(RenderQueue& queue, vector<RaceDrawable>& drawables, bool twoSided)
+{
+	// Stand-ins for textures and meshes; only their addresses matter
+	static char textures[RACE_TEXTURES], meshes[RACE_MESHES];
+
+	queue.clear();
+	for (unsigned int i = 0; i < drawables.size(); i++)
+	{
+		const RaceDrawable& drawable = drawables[i];
+		queue.submit(RENDER_PASS_OPAQUE, RENDER_DRAW_MESH, &textures[drawable.texture], &meshes[drawable.mesh], drawable.transform, drawable.depth);
+	}
+	for (int pass = RENDER_PASS_SHADOW; pass <= (twoSided ? RENDER_PASS_SHADOW : RENDER_PASS_SHADOW_BACK); pass++)
+	{
+		for (unsigned int i = 0; i < drawables.size(); i++)
+		{
+			// Each caster has its own volume
+			RaceDrawable& drawable = drawables[i];
+			if (drawable.shadow)
+			{
+				queue.submit(pass, RENDER_DRAW_SHADOW_VOLUME, NULL, &drawable, drawable.transform, drawable.depth);
+			}
+		}
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "HandlePool.h"
+#include "ParticleEmitter.h"
+
+#define RACE_MESHES		9		// Meshes raceDrawables numbers
+#define RACE_TEXTURES	15		// Textures raceDrawables numbers: 7 shared, then 8 racer colours
+
+class FrameArena;
+class RenderQueue;
+class TextBatch;
+
+
+// Every command returns 0 when all its checks pass and 1 when any fails, so a
+// script (or rebuild) can stop at the first broken one. Checks report what
+// failed on cerr; the numbers go to cout.
+
+// 1 and a line on cerr when condition is false, for adding to a failure count
+int check(bool condition, std::string what);
+
+// Prints OK or FAILED and returns the command's exit code
+int finish(int failures);
+
+// Command line argument index if it was given, else fallback
+int argument(int argc, char** argv, int index, int fallback);
+float argument(int argc, char** argv, int index, float fallback);
+std::string argument(int argc, char** argv, int index, const char* fallback);
+
+// Wall clock time in seconds
+double now();
+
+// Time spent between start and stop, summed over every run
+class BenchTimer
+{
+public:
+	BenchTimer();
+
+	void start();
+	void stop();
+
+	double milliseconds() const;
+
+	// Microseconds per count things done, or nanoseconds, over the whole time
+	double microsecondsPer(double count) const;
+	double nanosecondsPer(double count) const;
+
+	double seconds;
+
+private:
+	double started;
+};
+
+float randomFloat(float low, float high);
+
+// Every heap allocation the tools make is counted, for checking code that mustn't allocate
+extern int heapAllocations;
+
+// Names of the files in a directory ending in extension
+std::vector<std::string> listFiles(std::string directory, std::string extension);
+
+
+// The camera, as the game sets it up
+
+// Row-vector projection matrix, laid out like D3DXMatrixPerspectiveFovLH
+void perspectiveFovLH(float fieldOfView, float aspect, float zNear, float zFar, float* m);
+
+// True when the point is outside the clip volume (0 <= z <= w)
+bool outsideClip(const float* m, float x, float y, float z);
+
+// Focus position and look direction per frame, for replaying the camera: the
+// track's waypoints, or a recorded file of "x y z lookX lookY lookZ" lines
+bool cameraPath(std::string trackFile, std::string pathFile, std::vector<float>& waypoints, std::vector<float>& path);
+
+// Eye and view * projection of the camera following a racer at focus, 7
+// behind and 2 up, like Camera::update
+void followCamera(const float* focus, const float* look, const float* projection, float* eye, float* viewProjection);
+
+
+// Fixtures more than one command uses
+
+// One thing the renderer draws in a race. Meshes are numbered 0 world,
+// 1 checkpoint, 2 racer, 3 front tire, 4 rear tire, 5 gun mount, 6 gun,
+// 7 rocket, 8 landmine; textures 0 to 6 the same without the racer, whose
+// colour is 7 plus its number mod 8.
+struct RaceDrawable
+{
+	int mesh;
+	int texture;
+	bool shadow;		// Casts a shadow volume
+	float transform[16];
+	float depth;
+};
+
+// The world, four checkpoints, numRacers racers (body, four wheels, gun mount
+// and gun each) and numDynamic rockets and landmines, at random transforms and
+// depths
+void raceDrawables(int numRacers, int numDynamic, std::vector<RaceDrawable>& drawables);
+
+// Records drawables the way Renderer::render does: the opaque pass, then the
+// shadow volumes in one pass or two
+void queueRace(RenderQueue& queue, std::vector<RaceDrawable>& drawables, bool twoSided);
+
+// Random rotation from a random quaternion, with a scale and translation
+void randomMatrix(float* m);
+
+// Lines like AI::displayDebugInfo's, formatted into the arena; returns how many
+int formatDebugLines(FrameArena& arena, const char** lines, int frame);
+void layOutLines(TextBatch& batch, const char** lines, int count);
+
+// Stands in for a rocket or landmine: about as big, and counts its
+// constructions and destructions
+struct BenchObject
+{
+	BenchObject(unsigned int handle)
+	{
+		self = handle;
+		destroyed = false;
+		lifetime = 0;
+		constructed++;
+	}
+
+	~BenchObject()
+	{
+		self = HANDLE_NONE;
+		destructed++;
+	}
+
+	unsigned int self;
+	bool destroyed;
+	int lifetime;
+	float transform[16];
+	float payload[8];
+
+	static int constructed;
+	static int destructed;
+};
+
+struct BenchEmitter
+{
+	ParticleEmitter emitter;
+	float position[3];
+};
+
+
+// The commands, by the file they are in
+
+// MeshTools.cpp
+int convert(int argc, char** argv);
+int loadbench(int argc, char** argv);
+int connectivity(int argc, char** argv);
+int optimize(int argc, char** argv);
+int pack(int argc, char** argv);
+int lod(int argc, char** argv);
+int chunks(int argc, char** argv);
+int rebuild(int argc, char** argv);
+
+// PhysicsTools.cpp
+int collision(int argc, char** argv);
+int suspension(int argc, char** argv);
+
+// RenderTools.cpp
+int renderqueue(int argc, char** argv);
+int texturecache(int argc, char** argv);
+int culling(int argc, char** argv);
+int statecache(int argc, char** argv);
+int instancing(int argc, char** argv);
+
+// ShadowTools.cpp
+int silhouette(int argc, char** argv);
+int shadowtiers(int argc, char** argv);
+
+// OverlayTools.cpp
+int hudlayout(int argc, char** argv);
+int textoverlay(int argc, char** argv);
+
+// SimulationTools.cpp
+int snapshot(int argc, char** argv);
+int handles(int argc, char** argv);
+
+// ParticleTools.cpp
+int particles(int argc, char** argv);
+int emitters(int argc, char** argv);
+
+// FrameTools.cpp
+int frame(int argc, char** argv);
+
+// AudioTools.cpp
+int voices(int argc, char** argv);
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <string>
+
+#include "ToolsCommon.h"
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	string command = argc > 1 ? argv[1] : "";
+
+	if (command == "collision")
+	{
+		return collision(argc, argv);
+	}
+	else if (command == "texturecache")
+	{
+		return texturecache(argc, argv);
+	}
+	else if (command == "convert")
+	{
+		return convert(argc, argv);
+	}
+	else if (command == "loadbench")
+	{
+		return loadbench(argc, argv);
+	}
+	else if (command == "connectivity")
+	{
+		return connectivity(argc, argv);
+	}
+	else if (command == "culling")
+	{
+		return culling(argc, argv);
+	}
+	else if (command == "renderqueue")
+	{
+		return renderqueue(argc, argv);
+	}
+	else if (command == "silhouette")
+	{
+		return silhouette(argc, argv);
+	}
+	else if (command == "suspension")
+	{
+		return suspension(argc, argv);
+	}
+	else if (command == "statecache")
+	{
+		return statecache(argc, argv);
+	}
+	else if (command == "instancing")
+	{
+		return instancing(argc, argv);
+	}
+	else if (command == "hudlayout")
+	{
+		return hudlayout(argc, argv);
+	}
+	else if (command == "textoverlay")
+	{
+		return textoverlay(argc, argv);
+	}
+	else if (command == "optimize")
+	{
+		return optimize(argc, argv);
+	}
+	else if (command == "rebuild")
+	{
+		return rebuild(argc, argv);
+	}
+	else if (command == "pack")
+	{
+		return pack(argc, argv);
+	}
+	else if (command == "lod")
+	{
+		return lod(argc, argv);
+	}
+	else if (command == "chunks")
+	{
+		return chunks(argc, argv);
+	}
+	else if (command == "shadowtiers")
+	{
+		return shadowtiers(argc, argv);
+	}
+	else if (command == "snapshot")
+	{
+		return snapshot(argc, argv);
+	}
+	else if (command == "particles")
+	{
+		return particles(argc, argv);
+	}
+	else if (command == "emitters")
+	{
+		return emitters(argc, argv);
+	}
+	else if (command == "handles")
+	{
+		return handles(argc, argv);
+	}
+	else if (command == "frame")
+	{
+		return frame(argc, argv);
+	}
+	else if (command == "voices")
+	{
+		return voices(argc, argv);
+	}
+
+	cout << "Usage: cpsc585tools <command> [arguments]" << endl;
+	cout << "Commands:" << endl;
+	cout << "  chunks        Split the track into chunks for culling and count triangles submitted along a camera path [maxTriangles] [track] [pathFile]" << endl;
+	cout << "  collision     Build a simplified collision mesh (.col) from a render mesh (.ese)" << endl;
+	cout << "  connectivity  Compare hashed edge connectivity with the old pairwise search [dir] [weldDistance]" << endl;
+	cout << "  convert       Convert an .ese model to the v2 .mesh format [index32] [weldDistance] [packed]" << endl;
+	cout << "  culling       Check and time frustum culling along a camera path [track] [pathFile] [iterations]" << endl;
+	cout << "  emitters      Check emitter rates at any tick length and the particle budget's limit and throttling [emitters] [ticks]" << endl;
+	cout << "  frame         Check the frame arena's allocator and count heap allocations in a steady-state frame [frames]" << endl;
+	cout << "  handles       Check the handle pool and spawn and destroy 100k objects through it, counting heap allocations [spawns] [capacity]" << endl;
+	cout << "  hudlayout     Check the HUD atlas packing, when its quads are rebuilt and where they land [iterations]" << endl;
+	cout << "  instancing    Check instance packing and count the draws it saves [racers] [dynamic] [iterations]" << endl;
+	cout << "  textoverlay   Check glyph layout and the frame arena, and count heap allocations per debug frame [frames]" << endl;
+	cout << "  texturecache  Check the texture cache against a stub loader and parse every DDS header [dir] [spawns]" << endl;
+	cout << "  pack          Rewrite every .mesh in a directory with packed vertices, checking the decoding error [dir]" << endl;
+	cout << "  optimize      Reorder every model for the vertex cache and overdraw, report ACMR/ATVR and rewrite the .mesh files, keeping their format [dir] [cacheSize] [threshold]" << endl;
+	cout << "  rebuild       Run optimize, pack, lod, chunks and connectivity over models, stopping at the first failure" << endl;
+	cout << "  lod           Build simplified levels of detail for the vehicle and weapon models, report their triangles and error [dir] [maxError]" << endl;
+	cout << "  loadbench     Time loading every model in a directory, .ese against .mesh [dir] [iterations]" << endl;
+	cout << "  particles     Check the particle pool and time updating and billboarding 100k particles a frame [count] [frames]" << endl;
+	cout << "  renderqueue   Count state changes reaching the backend, sorted and unsorted [racers] [dynamic] [iterations]" << endl;
+	cout << "  shadowtiers   Check the shadow detail tiers and blob quads, and count racers per tier along a camera path [dir] [track] [pathFile]" << endl;
+	cout << "  snapshot      Check the transform hand over between threads for torn ticks, and interpolation between ticks [ticks]" << endl;
+	cout << "  silhouette    Check and time the SSE shadow silhouette kernel [dir] [iterations]" << endl;
+	cout << "  statecache    Check the render state cache against a mock device and count what it filters [calls] [racers]" << endl;
+	cout << "  suspension    Check the batched suspension/friction/drag kernel against the per-object maths and time both [iterations]" << endl;
+	cout << "  voices        Check the sound voice pool's stealing and reservations, and play a long fight through it [seconds] [soundsPerTick]" << endl;
+
+	return command.empty() ? 0 : 1;
+}